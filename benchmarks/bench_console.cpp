@@ -0,0 +1,58 @@
+#include "benchmark/benchmark.h"
+
+#include <cstring>
+
+extern "C" {
+
+#include "anchor/console/console.h"
+
+};
+
+static intptr_t m_arg_sum;
+
+CONSOLE_COMMAND_DEF(bench_cmd, "Benchmark command",
+  CONSOLE_INT_ARG_DEF(value, "An integer value"),
+  CONSOLE_STR_ARG_DEF(name, "A string value"),
+  CONSOLE_OPTIONAL_INT_ARG_DEF(extra, "An optional integer value")
+);
+
+static void bench_cmd_command_handler(const bench_cmd_args_t* args) {
+  m_arg_sum += args->value + (intptr_t)strlen(args->name);
+}
+
+static void write_function(const char* str) {
+  benchmark::DoNotOptimize(str);
+}
+
+static void init_console(void) {
+  static bool is_initialized = false;
+  if (is_initialized) {
+    return;
+  }
+  const console_init_t init = {
+    .write_function = write_function,
+  };
+  console_init(&init);
+  console_command_register(bench_cmd);
+  is_initialized = true;
+}
+
+static void run_line(benchmark::State& state, const char* line) {
+  init_console();
+  const uint32_t length = strlen(line);
+  for (auto _ : state) {
+    console_process((const uint8_t*)line, length);
+  }
+  benchmark::DoNotOptimize(m_arg_sum);
+  state.SetBytesProcessed(state.iterations() * length);
+}
+
+static void BM_ConsoleProcessCommand(benchmark::State& state) {
+  run_line(state, "bench_cmd 0x1234 hello 42\n");
+}
+BENCHMARK(BM_ConsoleProcessCommand);
+
+static void BM_ConsoleProcessInvalidCommand(benchmark::State& state) {
+  run_line(state, "not_a_command 1 2 3\n");
+}
+BENCHMARK(BM_ConsoleProcessInvalidCommand);
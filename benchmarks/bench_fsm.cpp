@@ -0,0 +1,75 @@
+#include "benchmark/benchmark.h"
+
+extern "C" {
+
+#include "anchor/fsm/fsm.h"
+
+};
+
+FSM_STATE_DEF(IDLE);
+FSM_STATE_DEF(CONNECTING);
+FSM_STATE_DEF(CONNECTED);
+FSM_STATE_DEF(ERROR);
+
+FSM_EVENT_DEF(CONNECT);
+FSM_EVENT_DEF(CONNECT_SUCCESS);
+FSM_EVENT_DEF(CONNECT_FAILED);
+FSM_EVENT_DEF(DISCONNECT);
+FSM_EVENT_DEF(RESET);
+FSM_EVENT_DEF(UNHANDLED);
+
+// The transitions are searched in order, so the ones for the last state are the most expensive to find
+static const fsm_transition_t TRANSITIONS[] = {
+  {FSM_STATE(IDLE), FSM_STATE(CONNECTING), FSM_EVENT(CONNECT)},
+  {FSM_STATE(CONNECTING), FSM_STATE(CONNECTED), FSM_EVENT(CONNECT_SUCCESS)},
+  {FSM_STATE(CONNECTING), FSM_STATE(ERROR), FSM_EVENT(CONNECT_FAILED)},
+  {FSM_STATE(CONNECTED), FSM_STATE(IDLE), FSM_EVENT(DISCONNECT)},
+  {FSM_STATE(ERROR), FSM_STATE(IDLE), FSM_EVENT(RESET)},
+};
+
+static uint32_t m_num_transitions;
+
+static void on_state_enter_handler(const fsm_t* fsm, fsm_state_t state) {
+  m_num_transitions++;
+}
+
+static void on_state_exit_handler(const fsm_t* fsm, fsm_state_t state) {
+}
+
+static void init_fsm(fsm_t* fsm) {
+  fsm->transitions = TRANSITIONS;
+  fsm->num_transitions = sizeof(TRANSITIONS) / sizeof(TRANSITIONS[0]);
+  fsm->on_state_enter_handler = on_state_enter_handler;
+  fsm->on_state_exit_handler = on_state_exit_handler;
+  fsm->initial_state = FSM_STATE(IDLE);
+  fsm_init(fsm);
+}
+
+static void BM_FsmProcessEvent(benchmark::State& state) {
+  // cycle through every state with each iteration processing one event
+  static const fsm_event_t EVENTS[] = {
+    FSM_EVENT(CONNECT), FSM_EVENT(CONNECT_FAILED), FSM_EVENT(RESET),
+    FSM_EVENT(CONNECT), FSM_EVENT(CONNECT_SUCCESS), FSM_EVENT(DISCONNECT),
+  };
+  fsm_t fsm = {};
+  init_fsm(&fsm);
+  uint32_t index = 0;
+  for (auto _ : state) {
+    fsm_process_event(&fsm, EVENTS[index]);
+    if (++index == sizeof(EVENTS) / sizeof(EVENTS[0])) {
+      index = 0;
+    }
+  }
+  benchmark::DoNotOptimize(m_num_transitions);
+}
+BENCHMARK(BM_FsmProcessEvent);
+
+static void BM_FsmProcessUnhandledEvent(benchmark::State& state) {
+  // an event with no matching transition has to check every transition
+  fsm_t fsm = {};
+  init_fsm(&fsm);
+  for (auto _ : state) {
+    fsm_process_event(&fsm, FSM_EVENT(UNHANDLED));
+  }
+}
+BENCHMARK(BM_FsmProcessUnhandledEvent);
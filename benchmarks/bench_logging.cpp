@@ -0,0 +1,216 @@
+#include "benchmark/benchmark.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#define LOGGING_MODULE_NAME "BENCH"
+#include "anchor/logging/logging.h"
+
+// NOTE: Logging is initialized by main() with a default level of INFO and a write function which discards the lines.
+
+static void BM_LogFormatted(benchmark::State& state) {
+  uint32_t i = 0;
+  for (auto _ : state) {
+    LOG_INFO("Processed request (id=%" PRIu32 ", status=%s, value=0x%08" PRIx32 ")", i, "ok", i * 31);
+    i++;
+  }
+}
+BENCHMARK(BM_LogFormatted);
+
+static void BM_LogConstant(benchmark::State& state) {
+  for (auto _ : state) {
+    LOG_INFO("Connected");
+  }
+}
+BENCHMARK(BM_LogConstant);
+
+static void BM_LogLongLine(benchmark::State& state) {
+  // a line which fills most of the buffer
+  for (auto _ : state) {
+    LOG_INFO("Failed to process request: the response from the server did not match the expected response for the "
+      "current state of the connection");
+  }
+}
+BENCHMARK(BM_LogLongLine);
+
+static void BM_LogFiltered(benchmark::State& state) {
+  uint32_t i = 0;
+  for (auto _ : state) {
+    // below the default level, so this should be dropped without being formatted
+    LOG_DEBUG("Processed request (id=%" PRIu32 ")", i);
+    i++;
+  }
+}
+BENCHMARK(BM_LogFiltered);
+
+static void BM_LogFilteredCall(benchmark::State& state) {
+  // the same filtered line, but calling into the library to check the level (as the LOG_*() macros used to), which
+  // evaluates the arguments and costs a function call
+  uint32_t i = 0;
+  for (auto _ : state) {
+    logging_log_impl(&_logging_logger, LOGGING_LEVEL_DEBUG, FILENAME, __LINE__, "Processed request (id=%" PRIu32 ")", i);
+    i++;
+  }
+}
+BENCHMARK(BM_LogFilteredCall);
+
+static void discard_write_function(const char* str) {
+  benchmark::DoNotOptimize(str);
+}
+
+static uint32_t zero_time_ms_function(void) {
+  return 0;
+}
+
+// Re-initializes logging the same way as main(), but with the specified deferred buffer
+static void init_logging(uint8_t* deferred_buffer, uint32_t deferred_buffer_size) {
+  const logging_init_t init_logging = {
+    .write_function = discard_write_function,
+    .raw_write_function = nullptr,
+    .lock_function = nullptr,
+    .time_ms_function = zero_time_ms_function,
+    .default_level = LOGGING_LEVEL_INFO,
+    .deferred_buffer = deferred_buffer,
+    .deferred_buffer_size = deferred_buffer_size,
+    .deferred_drop_policy = LOGGING_DEFERRED_DROP_NEWEST,
+  };
+  logging_init(&init_logging);
+}
+
+static void BM_LogDeferred(benchmark::State& state) {
+  // only the cost to the caller is measured, with the buffer being drained outside of the timing before it fills up
+  static uint8_t deferred_buffer[16 * 1024];
+  init_logging(deferred_buffer, sizeof(deferred_buffer));
+  uint32_t i = 0;
+  for (auto _ : state) {
+    LOG_INFO("Processed request (id=%" PRIu32 ", status=%s, value=0x%08" PRIx32 ")", i, "ok", i * 31);
+    if (++i % 64 == 0) {
+      state.PauseTiming();
+      logging_process_deferred(0);
+      state.ResumeTiming();
+    }
+  }
+  logging_process_deferred(0);
+  init_logging(nullptr, 0);
+}
+BENCHMARK(BM_LogDeferred);
+
+static void BM_LogDeferredDrain(benchmark::State& state) {
+  // the cost of formatting and writing out deferred records, which are logged in batches outside of the timing
+  static uint8_t deferred_buffer[16 * 1024];
+  init_logging(deferred_buffer, sizeof(deferred_buffer));
+  uint32_t i = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (int j = 0; j < 64; j++) {
+      LOG_INFO("Processed request (id=%" PRIu32 ", status=%s, value=0x%08" PRIx32 ")", i, "ok", i * 31);
+      i++;
+    }
+    state.ResumeTiming();
+    logging_process_deferred(0);
+  }
+  state.SetItemsProcessed(i);
+  init_logging(nullptr, 0);
+}
+BENCHMARK(BM_LogDeferredDrain);
+
+static std::mutex m_lock;
+static std::atomic<bool> m_drain_running;
+static std::thread m_drain_thread;
+
+static void lock_function(bool acquire) {
+  if (acquire) {
+    m_lock.lock();
+  } else {
+    m_lock.unlock();
+  }
+}
+
+static void init_contended_logging(void(*write_function)(const char*), uintptr_t* concurrent_buffer, uint32_t num_slots) {
+  const logging_init_t init_logging = {
+    .write_function = write_function,
+    .raw_write_function = nullptr,
+    .lock_function = lock_function,
+    .time_ms_function = zero_time_ms_function,
+    .default_level = LOGGING_LEVEL_INFO,
+    .deferred_buffer = nullptr,
+    .deferred_buffer_size = 0,
+    .deferred_drop_policy = LOGGING_DEFERRED_DROP_NEWEST,
+    .concurrent_buffer = concurrent_buffer,
+    .concurrent_num_slots = num_slots,
+  };
+  logging_init(&init_logging);
+  // cache the level up-front
+  LOG_DEBUG("");
+}
+
+static void contended_setup(const benchmark::State& state) {
+  init_contended_logging(discard_write_function, nullptr, 0);
+}
+
+static void contended_teardown(const benchmark::State& state) {
+  init_logging(nullptr, 0);
+}
+
+static void BM_LogContended(benchmark::State& state) {
+  // every thread formats and writes its lines under the global lock
+  uint32_t i = 0;
+  for (auto _ : state) {
+    LOG_INFO("Processed request (id=%" PRIu32 ", status=%s, value=0x%08" PRIx32 ")", i, "ok", i * 31);
+    i++;
+  }
+}
+BENCHMARK(BM_LogContended)->Setup(contended_setup)->Teardown(contended_teardown)->ThreadRange(1, 32)->UseRealTime();
+
+static std::atomic<uint32_t> m_num_logged;
+static std::atomic<uint32_t> m_num_written;
+
+static void counting_write_function(const char* str) {
+  benchmark::DoNotOptimize(str);
+  m_num_written.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void concurrent_setup(const benchmark::State& state) {
+  static uintptr_t concurrent_buffer[LOGGING_CONCURRENT_BUFFER_SIZE(4096)];
+  init_contended_logging(counting_write_function, concurrent_buffer, 4096);
+  m_num_logged = 0;
+  m_num_written = 0;
+  m_drain_running = true;
+  m_drain_thread = std::thread([]() {
+    while (m_drain_running) {
+      if (!logging_process_deferred(0)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+}
+
+static void concurrent_teardown(const benchmark::State& state) {
+  m_drain_running = false;
+  m_drain_thread.join();
+  logging_process_deferred(0);
+  init_logging(nullptr, 0);
+}
+
+static void BM_LogConcurrent(benchmark::State& state) {
+  // every thread formats its lines in parallel into the concurrent buffer, which a separate thread writes out, with the
+  // threads being throttled to the rate of the drain thread so that this measures the sustained rate without drops
+  uint32_t i = 0;
+  for (auto _ : state) {
+    if (++i % 64 == 0) {
+      m_num_logged.fetch_add(64, std::memory_order_relaxed);
+      while ((int32_t)(m_num_logged.load(std::memory_order_relaxed) - m_num_written.load(std::memory_order_relaxed)) > 1024) {
+        std::this_thread::yield();
+      }
+    }
+    LOG_INFO("Processed request (id=%" PRIu32 ", status=%s, value=0x%08" PRIx32 ")", i, "ok", i * 31);
+  }
+  if (state.thread_index() == 0) {
+    // this should always be 0 (approximate, as other threads may still be running)
+    logging_deferred_stats_t stats;
+    logging_deferred_get_and_clear_stats(&stats);
+    state.counters["dropped"] = stats.dropped;
+  }
+}
+BENCHMARK(BM_LogConcurrent)->Setup(concurrent_setup)->Teardown(concurrent_teardown)->ThreadRange(1, 32)->UseRealTime();
@@ -0,0 +1,174 @@
+#include "benchmark/benchmark.h"
+
+#include <cstring>
+#include <vector>
+
+extern "C" {
+
+#include "src/attribute/server.h"
+#include "src/common/crc16.h"
+#include "src/link_layer/receive.h"
+#include "src/link_layer/transmit.h"
+
+};
+
+// The link layer header and footer are 4 bytes in total
+#define LINK_LAYER_OVERHEAD 4
+#define FLAG_BYTE 0x7E
+#define ATTR_SIZE sizeof(uint32_t)
+// Attribute IDs are allocated starting here to stay clear of the control attributes
+#define FIRST_ATTR_ID 0x200
+
+static std::vector<uint8_t> m_encoded_data;
+static uint32_t m_num_received_packets;
+static uint32_t m_response_length;
+
+// Returns a payload where roughly the specified percent of bytes need to be escaped
+static std::vector<uint8_t> make_payload(uint32_t length, uint32_t escape_percent) {
+  std::vector<uint8_t> payload(length);
+  for (uint32_t i = 0; i < length; i++) {
+    // spread the special bytes throughout the payload (the other values never need escaping)
+    payload[i] = ((i * 37) % 100) < escape_percent ? FLAG_BYTE : (uint8_t)(i & 0x3f);
+  }
+  return payload;
+}
+
+static void discard_write_byte(uint8_t byte) {
+  benchmark::DoNotOptimize(byte);
+}
+
+static void capture_write_byte(uint8_t byte) {
+  m_encoded_data.push_back(byte);
+}
+
+static void send_packet(sonar_link_layer_transmit_handle_t handle, const std::vector<uint8_t>& payload) {
+  buffer_chain_entry_t entry = {};
+  buffer_chain_set_data(&entry, payload.data(), payload.size());
+  sonar_link_layer_transmit_send_packet(handle, false, false, 1, &entry);
+}
+
+static void packet_handler(void* handle, bool is_response, bool is_link_control, uint8_t sequence_num, const uint8_t* data, uint32_t length) {
+  m_num_received_packets++;
+}
+
+static void BM_Crc16(benchmark::State& state) {
+  const std::vector<uint8_t> data = make_payload(state.range(0), 0);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(crc16(data.data(), data.size(), CRC16_INITIAL_VALUE));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_Crc16)->Arg(16)->Arg(64)->Arg(256)->Arg(1024);
+
+// Args are the payload size and the percent of bytes which need to be escaped
+static void BM_LinkLayerTransmit(benchmark::State& state) {
+  const std::vector<uint8_t> payload = make_payload(state.range(0), state.range(1));
+  sonar_link_layer_transmit_context_t context;
+  const sonar_link_layer_transmit_init_t init = {
+    .is_server = false,
+    .write_byte_function = discard_write_byte,
+  };
+  sonar_link_layer_transmit_init(&context, &init);
+  for (auto _ : state) {
+    send_packet(&context, payload);
+  }
+  state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BM_LinkLayerTransmit)->ArgsProduct({{64, 1024}, {0, 10, 50, 100}});
+
+// Args are the payload size and the percent of bytes which need to be escaped
+static void BM_LinkLayerReceive(benchmark::State& state) {
+  const std::vector<uint8_t> payload = make_payload(state.range(0), state.range(1));
+  // encode the packet to be received using the transmit code
+  sonar_link_layer_transmit_context_t transmit_context;
+  const sonar_link_layer_transmit_init_t transmit_init = {
+    .is_server = false,
+    .write_byte_function = capture_write_byte,
+  };
+  sonar_link_layer_transmit_init(&transmit_context, &transmit_init);
+  m_encoded_data.clear();
+  send_packet(&transmit_context, payload);
+
+  std::vector<uint8_t> buffer(payload.size() + LINK_LAYER_OVERHEAD);
+  sonar_link_layer_receive_context_t context;
+  const sonar_link_layer_receive_init_t init = {
+    .is_server = true,
+    .buffer = buffer.data(),
+    .buffer_size = (uint32_t)buffer.size(),
+    .packet_handler = packet_handler,
+    .handler_handle = nullptr,
+  };
+  sonar_link_layer_receive_init(&context, &init);
+  m_num_received_packets = 0;
+  for (auto _ : state) {
+    sonar_link_layer_receive_process_data(&context, m_encoded_data.data(), m_encoded_data.size());
+  }
+  if (m_num_received_packets != state.iterations()) {
+    state.SkipWithError("Failed to receive packets");
+  }
+  state.SetBytesProcessed(state.iterations() * payload.size());
+  state.counters["encoded_bytes"] = m_encoded_data.size();
+}
+BENCHMARK(BM_LinkLayerReceive)->ArgsProduct({{64, 1024}, {0, 10, 50, 100}});
+
+static void read_response_handler(void* handle, const uint8_t* data, uint32_t length) {
+  m_response_length = length;
+}
+
+static uint32_t read_handler(void* handle, sonar_attribute_t attr, void* response_data, uint32_t response_max_size) {
+  memset(response_data, 0, ATTR_SIZE);
+  return ATTR_SIZE;
+}
+
+static bool write_handler(void* handle, sonar_attribute_t attr, const uint8_t* data, uint32_t length) {
+  return false;
+}
+
+static void notify_complete_handler(void* handle, bool success) {
+}
+
+// Arg is the number of registered attributes, which are read in a round-robin order
+static void BM_AttributeServerRead(benchmark::State& state) {
+  const uint32_t num_attrs = state.range(0);
+  static sonar_attribute_server_context_t context;
+  const sonar_attribute_server_init_t init = {
+    .send_notify_request_function = nullptr,
+    .send_notify_chain_request_function = nullptr,
+    .read_response_handler = read_response_handler,
+    .read_handler = read_handler,
+    .stream_read_handler = nullptr,
+    .write_handler = write_handler,
+    .notify_complete_handler = notify_complete_handler,
+    .handle = nullptr,
+  };
+  sonar_attribute_server_init(&context, &init);
+
+  // the attributes are normally defined statically via SONAR_ATTR_DEF(), but need to be created at runtime here
+  std::vector<uint8_t> buffers(num_attrs * ATTR_SIZE * 2);
+  std::vector<sonar_attribute_def_t> attrs;
+  attrs.reserve(num_attrs);
+  for (uint32_t i = 0; i < num_attrs; i++) {
+    attrs.push_back({
+      ._private = {0},
+      .attribute_id = (uint16_t)(FIRST_ATTR_ID + i),
+      .max_size = ATTR_SIZE,
+      .ops = SONAR_ATTRIBUTE_OPS_RW,
+      .request_buffer = &buffers[i * ATTR_SIZE * 2],
+      .response_buffer = &buffers[i * ATTR_SIZE * 2 + ATTR_SIZE],
+    });
+    sonar_attribute_server_register(&context, &attrs.back());
+  }
+
+  uint32_t index = 0;
+  for (auto _ : state) {
+    if (!sonar_attribute_server_handle_read_request(&context, FIRST_ATTR_ID + index)) {
+      state.SkipWithError("Read request failed");
+      break;
+    }
+    if (++index == num_attrs) {
+      index = 0;
+    }
+  }
+  benchmark::DoNotOptimize(m_response_length);
+}
+BENCHMARK(BM_AttributeServerRead)->Arg(10)->Arg(100)->Arg(1000);
@@ -0,0 +1,34 @@
+#include "benchmark/benchmark.h"
+
+extern "C" {
+#include "anchor/logging/logging.h"
+}
+
+// The log lines are formatted as normal but then discarded so the benchmarks measure the libraries rather than the
+// console they're run from
+static void logging_write_function(const char* str) {
+  benchmark::DoNotOptimize(str);
+}
+
+static uint32_t logging_time_ms_function(void) {
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  const logging_init_t init_logging = {
+    .write_function = logging_write_function,
+    .raw_write_function = nullptr,
+    .lock_function = nullptr,
+    .time_ms_function = logging_time_ms_function,
+    .default_level = LOGGING_LEVEL_INFO,
+  };
+  logging_init(&init_logging);
+
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+  ::benchmark::Shutdown();
+  return 0;
+}
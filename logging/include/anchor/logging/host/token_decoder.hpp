@@ -0,0 +1,96 @@
+#pragma once
+
+extern "C" {
+
+#include "anchor/logging/tokenized.h"
+
+};
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+// NOTE: This is a header-only C++ decoder for tokenized logs which is intended for hosted builds (i.e. tools which read
+// the logs from a device). It requires the logging sources to be linked in.
+
+namespace logging {
+
+class TokenDecoder {
+ public:
+  // The max length of a decoded line
+  static constexpr uint32_t kMaxLineLength = 512;
+
+  // Adds the entries from a token dictionary, which is the contents of the logging_tokens section of the device's
+  // binary (i.e. as extracted by `objcopy -O binary --only-section=logging_tokens`)
+  void AddDictionary(const void* data, size_t length) {
+    const char* str = (const char*)data;
+    const char* const end = str + length;
+    while (str < end) {
+      // the entries are null-terminated, but there may also be padding between them
+      const size_t entry_length = strnlen(str, end - str);
+      if (entry_length) {
+        AddEntry(std::string(str, entry_length));
+      }
+      str += entry_length + 1;
+    }
+  }
+
+  // Adds a single entry to the dictionary
+  void AddEntry(const std::string& entry) {
+    const uint32_t token = logging_token_hash(entry.data(), entry.size());
+    auto it = entries_.find(token);
+    if (it != entries_.end() && it->second != entry) {
+      // the same entry can come from multiple copies of an inline function, but otherwise this is a hash collision
+      num_collisions_++;
+      return;
+    }
+    entries_[token] = entry;
+  }
+
+  size_t num_entries() const {
+    return entries_.size();
+  }
+
+  size_t num_collisions() const {
+    return num_collisions_;
+  }
+
+  // Decodes the record at the start of the data into a log line which is appended to the output, returning the length
+  // of the record (or 0 if it's invalid or incomplete)
+  size_t DecodeRecord(const uint8_t* data, size_t length, std::string* output) const {
+    logging_tokenized_record_t record;
+    const uint32_t record_length = logging_tokenized_parse_record(data, length, &record);
+    if (!record_length) {
+      return 0;
+    }
+    auto it = entries_.find(record.token);
+    char line[kMaxLineLength];
+    if (it == entries_.end() ||
+        !logging_tokenized_format_line(line, sizeof(line), &record, it->second.data(), it->second.size())) {
+      snprintf(line, sizeof(line), "<unknown token 0x%08x>\n", record.token);
+    }
+    output->append(line);
+    return record_length;
+  }
+
+  // Decodes a stream of records which are appended to the output as log lines, returning the number of bytes which
+  // were consumed (any incomplete record at the end is left to be decoded with more data)
+  size_t Decode(const uint8_t* data, size_t length, std::string* output) const {
+    size_t offset = 0;
+    while (offset < length) {
+      const size_t record_length = DecodeRecord(&data[offset], length - offset, output);
+      if (!record_length) {
+        break;
+      }
+      offset += record_length;
+    }
+    return offset;
+  }
+
+ private:
+  std::unordered_map<uint32_t, std::string> entries_;
+  size_t num_collisions_ = 0;
+};
+
+} // namespace logging
@@ -1,5 +1,7 @@
 // We explicitly don't use include guards as this file should not be included recursively.
 
+#include "anchor/logging/tokenized.h"
+
 #include <inttypes.h>
 #include <stdbool.h>
 
@@ -9,9 +11,11 @@ extern "C" {
 
 #ifdef _MSC_VER
 #define _LOGGING_FORMAT_ATTR
+#define _LOGGING_SITE_FORMAT_ATTR
 #define _LOGGING_USED_ATTR
 #else
 #define _LOGGING_FORMAT_ATTR __attribute__((format(printf, 5, 6)))
+#define _LOGGING_SITE_FORMAT_ATTR __attribute__((format(printf, 6, 7)))
 #define _LOGGING_USED_ATTR __attribute__((used))
 #endif
 
@@ -25,7 +29,51 @@ extern "C" {
 #define FILENAME __FILE__
 #endif
 
+// LOGGING_TOKENIZED can be defined to 1 in order for the LOG_*() macros to write compact tokenized records (see the
+// README) rather than formatted log lines (requires GNU extensions and optimizations to be enabled)
+#ifndef LOGGING_TOKENIZED
+#define LOGGING_TOKENIZED 0
+#endif
+
+// LOGGING_RATE_LIMIT can be defined to 1 (globally or before including this header) in order for each LOG_*() call site
+// to be rate limited based on the rate_limit_* fields passed to logging_init() (see the README)
+#ifndef LOGGING_RATE_LIMIT
+#define LOGGING_RATE_LIMIT 0
+#endif
+
+// LOGGING_COMPILE_MIN_LEVEL can be defined to the numeric value of a level (1=DEBUG, 2=INFO, 3=WARN, 4=ERROR) in order
+// to compile out the LOG_*() calls below it, such that their arguments aren't evaluated and their strings aren't
+// included in the binary
+#ifndef LOGGING_COMPILE_MIN_LEVEL
+#define LOGGING_COMPILE_MIN_LEVEL 0
+#endif
+
+// LOGGING_STATS can be defined to 1 (globally, as it changes the size of each file's logger) in order to keep counters
+// for each module (see logging_get_and_clear_module_stats())
+#ifndef LOGGING_STATS
+#define LOGGING_STATS 0
+#endif
+
+// LOGGING_DEFERRED can be defined to 1 (globally, as it changes the size of the sink contexts) in order to support the
+// deferred / concurrent buffers and deferred sinks (see the README), which require C11 atomics
+#ifndef LOGGING_DEFERRED
+#define LOGGING_DEFERRED 0
+#endif
+
 // NOTE: LOGGING_MODULE_NAME can be defined before including this header in order to specify the module which the file belongs to
+#ifdef LOGGING_MODULE_NAME
+#define _LOGGING_MODULE_PREFIX LOGGING_MODULE_NAME ":"
+#else
+#define _LOGGING_MODULE_PREFIX ""
+#endif
+
+#if LOGGING_DEFERRED
+// The size of each slot in the concurrent buffer, which holds a formatted line along with some state
+#define _LOGGING_CONCURRENT_SLOT_SIZE (((LOGGING_MAX_MSG_LENGTH) + 128 + sizeof(uintptr_t) - 1) & ~(sizeof(uintptr_t) - 1))
+
+// The size (in uintptr_t's) of the concurrent_buffer which is needed for NUM_SLOTS slots (see logging_init_t)
+#define LOGGING_CONCURRENT_BUFFER_SIZE(NUM_SLOTS) ((NUM_SLOTS) * _LOGGING_CONCURRENT_SLOT_SIZE / sizeof(uintptr_t))
+#endif
 
 typedef enum {
     LOGGING_LEVEL_DEFAULT = 0, // Used to represent the default level specified to logging_init()
@@ -35,40 +83,258 @@ typedef enum {
     LOGGING_LEVEL_ERROR,
 } logging_level_t;
 
+#if LOGGING_COMPILE_MIN_LEVEL == 0
+// The preprocessor treats the name of a level as 0, so make sure LOGGING_COMPILE_MIN_LEVEL wasn't defined to one
+typedef char _logging_compile_min_level_must_be_a_number[(LOGGING_COMPILE_MIN_LEVEL) == 0 ? 1 : -1];
+#endif
+
+#if LOGGING_DEFERRED
+typedef enum {
+    LOGGING_DEFERRED_DROP_NEWEST = 0, // Drop the record which is being logged
+    LOGGING_DEFERRED_DROP_OLDEST, // Drop the oldest records which haven't been written yet to make room
+} logging_deferred_drop_policy_t;
+#endif
+
+typedef enum {
+    LOGGING_SINK_POLICY_SYNC = 0, // Write each line to the sink as it's logged
+#if LOGGING_DEFERRED
+    LOGGING_SINK_POLICY_DEFERRED_DROP_NEWEST, // Buffer lines to be written by logging_process_sink(), dropping new lines when full
+    LOGGING_SINK_POLICY_DEFERRED_DROP_OLDEST, // Buffer lines to be written by logging_process_sink(), dropping the oldest lines when full
+#endif
+} logging_sink_policy_t;
+
 typedef struct {
-    // Write function which gets passed a fully-formatted log line
+    // Write function which gets passed a fully-formatted log line (optional if sinks are registered instead)
     void(*write_function)(const char* str);
     // Write function which gets passed the level and module name split out in addition to the fully-formatted log line
     void(*raw_write_function)(logging_level_t level, const char* module_name, const char* str);
+    // Write function which gets passed each tokenized record (only required if LOGGING_TOKENIZED is used)
+    void(*tokenized_write_function)(const uint8_t* data, uint32_t length);
     // A lock function which is called to make the logging library thread-safe
     void(*lock_function)(bool acquire);
     // A function which is called to get the current system time in milliseconds
     uint32_t(*time_ms_function)(void);
     // The default logging level
     logging_level_t default_level;
+#if LOGGING_DEFERRED
+    // Buffer which log records are stored in to be formatted and written later by logging_process_deferred(), rather
+    // than from within the LOG_*() call (optional, the size must be a power of 2)
+    uint8_t* deferred_buffer;
+    uint32_t deferred_buffer_size;
+    // What to do when a record doesn't fit in the deferred buffer
+    logging_deferred_drop_policy_t deferred_drop_policy;
+    // Buffer of slots which callers format their lines into concurrently without the lock_function, and which are
+    // then written out in order by logging_process_deferred() (optional, should be sized using
+    // LOGGING_CONCURRENT_BUFFER_SIZE(), and can't be used along with the deferred_buffer)
+    uintptr_t* concurrent_buffer;
+    // The number of slots in the concurrent buffer (must be a power of 2)
+    uint32_t concurrent_num_slots;
+#endif
+    // The number of lines which each rate-limited call site can log in a burst (0 to disable rate limiting)
+    uint32_t rate_limit_burst;
+    // The number of lines per second which each rate-limited call site can log once its burst is used up
+    uint32_t rate_limit_per_sec;
+    // A function which returns a free-running cycle counter (i.e. the DWT cycle counter on a Cortex-M), which is used to
+    // measure the time spent formatting lines (optional, only used if LOGGING_STATS is set)
+    uint32_t(*cycle_count_function)(void);
 } logging_init_t;
 
+#if LOGGING_DEFERRED
+typedef struct {
+    // The number of records which were stored in the deferred (or concurrent) buffer
+    uint32_t records;
+    // The number of records which were dropped because the deferred (or concurrent) buffer was full
+    uint32_t dropped;
+    // The max number of bytes which were used in the deferred (or concurrent) buffer
+    uint32_t max_used;
+} logging_deferred_stats_t;
+#endif
+
 // Initialize the logging library
 bool logging_init(const logging_init_t* init);
 
+// Writes the "suppressed N similar messages" summary for each rate-limited call site whose bucket has refilled since it
+// suppressed lines (this also happens on every LOG_*() call, so it only needs to be called periodically if there might
+// be no other lines for a while)
+void logging_flush_rate_limits(void);
+
+#if LOGGING_DEFERRED
+// Formats and writes up to max_records (or all if 0) of the records in the deferred (or concurrent) buffer, returning
+// the number which were written
+// NOTE: This should be called from a single low-priority context (i.e. the idle loop)
+uint32_t logging_process_deferred(uint32_t max_records);
+
+// Gets (and clears) the stats for the deferred (or concurrent) buffer
+void logging_deferred_get_and_clear_stats(logging_deferred_stats_t* stats);
+#endif
+
+typedef struct {
+    // The min level of the lines which are written to the sink
+    logging_level_t level;
+    // How lines are written to the sink
+    logging_sink_policy_t policy;
+    // Write function which gets passed the level and module name along with each fully-formatted log line
+    void(*write_function)(logging_level_t level, const char* module_name, const char* str);
+} logging_sink_init_t;
+
+#define _LOGGING_SINK_CONTEXT_SIZE (sizeof(logging_sink_init_t) + \
+    (LOGGING_DEFERRED ? sizeof(void*) * 2 + sizeof(uint32_t) * 4 : sizeof(void*)))
+
+// Defines a sink object with a BUFFER_SIZE (must be a power of 2) buffer for its deferred lines, which is registered
+// with logging_add_sink()
+#if LOGGING_DEFERRED
+#define LOGGING_SINK_DEF(NAME, BUFFER_SIZE) \
+    static uint8_t _##NAME##_buffer[BUFFER_SIZE]; \
+    static logging_sink_context_t _##NAME##_context = { \
+        ._private = {0}, \
+        .buffer = _##NAME##_buffer, \
+        .buffer_size = sizeof(_##NAME##_buffer), \
+    }; \
+    static logging_sink_handle_t NAME = &_##NAME##_context;
+#else
+// NOTE: Only LOGGING_SINK_POLICY_SYNC sinks are supported without LOGGING_DEFERRED, so no buffer is allocated
+#define LOGGING_SINK_DEF(NAME, BUFFER_SIZE) \
+    static logging_sink_context_t _##NAME##_context = { \
+        ._private = {0}, \
+    }; \
+    static logging_sink_handle_t NAME = &_##NAME##_context;
+#endif
+
+typedef struct {
+    // Allocated space for private context to be used by the logging implementation only
+    uint8_t _private[_LOGGING_SINK_CONTEXT_SIZE];
+#if LOGGING_DEFERRED
+    // Buffer which deferred lines are stored in until they're written by logging_process_sink()
+    uint8_t* buffer;
+    uint32_t buffer_size;
+#endif
+} logging_sink_context_t;
+
+typedef logging_sink_context_t* logging_sink_handle_t;
+
+// Registers a sink which lines are written to in addition to the write functions passed to logging_init() (which
+// removes any sinks which were previously registered), returning false if the init is invalid or the sink is already
+// registered
+// NOTE: Lines are filtered by the module / default level before the sink's level, so the default level should be no
+// higher than the lowest sink level
+bool logging_add_sink(logging_sink_handle_t handle, const logging_sink_init_t* init);
+
+// Unregisters a sink, returning false if it wasn't registered (any lines which are still buffered for a deferred sink
+// can still be written with logging_process_sink())
+bool logging_remove_sink(logging_sink_handle_t handle);
+
+#if LOGGING_DEFERRED
+// Writes up to max_lines (or all if 0) of the lines which are buffered for a deferred sink, returning the number which
+// were written
+// NOTE: Each sink can be processed from a different context, but each one should only be processed from one at a time
+uint32_t logging_process_sink(logging_sink_handle_t handle, uint32_t max_lines);
+
+// Gets (and clears) the stats for a deferred sink
+void logging_sink_get_and_clear_stats(logging_sink_handle_t handle, logging_deferred_stats_t* stats);
+#endif
+
+typedef struct {
+    // The number of lines which were logged at each level (indexed by the level minus LOGGING_LEVEL_DEBUG)
+    uint32_t lines[LOGGING_LEVEL_ERROR];
+    // The number of lines which were dropped by the module / default level or by rate limiting
+    uint32_t filtered;
+    // The number of bytes of formatted lines (or tokenized records) which were produced
+    uint32_t bytes;
+    // The number of cycles (from the cycle_count_function) which were spent formatting lines (or encoding records)
+    uint64_t format_cycles;
+} logging_stats_t;
+
+typedef struct {
+    // The prefix of the module (i.e. "MODULE:"), or NULL for files which don't define LOGGING_MODULE_NAME
+    const char* module_prefix;
+    logging_stats_t stats;
+} logging_module_stats_t;
+
+#if LOGGING_STATS
+// Gets (and clears) the stats for up to max_modules of the modules which have logged since logging_init(), combining
+// all the files which belong to each module, and returning the number of modules
+// NOTE: The counters are updated without the lock_function (or atomics), so they're approximate if multiple threads
+// log from the same module at the same time
+uint32_t logging_get_and_clear_module_stats(logging_module_stats_t* stats, uint32_t max_modules);
+#endif
+
 // Internal type used to represent a logger
 typedef struct {
-    uint8_t _private[sizeof(logging_level_t)];
+    uint8_t _private[sizeof(void*) * 2];
     const char* const module_prefix;
+    // The level below which lines are dropped, which is cached on first use so the LOG_*() macros can check it inline
+    // (LOGGING_LEVEL_DEFAULT until then)
+    logging_level_t _effective_level;
+#if LOGGING_STATS
+    logging_stats_t _stats;
+#endif
 } logging_logger_t;
 
+// Internal type used to store the rate limiting state of a LOG_*() call site
+typedef struct {
+    uint8_t _private[sizeof(void*) * 3 + sizeof(uint32_t) * 6];
+} logging_site_t;
+
 // Change the logging threshold for the current module
-#define LOG_SET_LEVEL(LEVEL) logging_module_set_level_impl(&_logging_logger, LEVEL)
+#define LOG_SET_LEVEL(LEVEL) logging_set_level_impl(&_logging_logger, LEVEL)
 
 // Macros for logging at each level
+#if LOGGING_COMPILE_MIN_LEVEL <= 1
 #define LOG_DEBUG(...) _LOG_LEVEL_IMPL(LOGGING_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) _LOG_DISABLED_IMPL(__VA_ARGS__)
+#endif
+#if LOGGING_COMPILE_MIN_LEVEL <= 2
 #define LOG_INFO(...) _LOG_LEVEL_IMPL(LOGGING_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) _LOG_DISABLED_IMPL(__VA_ARGS__)
+#endif
+#if LOGGING_COMPILE_MIN_LEVEL <= 3
 #define LOG_WARN(...) _LOG_LEVEL_IMPL(LOGGING_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) _LOG_DISABLED_IMPL(__VA_ARGS__)
+#endif
+#if LOGGING_COMPILE_MIN_LEVEL <= 4
 #define LOG_ERROR(...) _LOG_LEVEL_IMPL(LOGGING_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) _LOG_DISABLED_IMPL(__VA_ARGS__)
+#endif
 
 // Internal implementation macros / functions which are called via the macros above
-#define _LOG_LEVEL_IMPL(LEVEL, ...) logging_log_impl(&_logging_logger, LEVEL, FILENAME, __LINE__, __VA_ARGS__)
+#if LOGGING_STATS
+#define _LOG_LEVEL_IMPL(LEVEL, ...) do { \
+        if ((LEVEL) >= _logging_logger._effective_level) { \
+            _LOG_WRITE_IMPL(LEVEL, __VA_ARGS__); \
+        } else { \
+            _logging_logger._stats.filtered++; \
+        } \
+    } while (0)
+#else
+#define _LOG_LEVEL_IMPL(LEVEL, ...) do { \
+        if ((LEVEL) >= _logging_logger._effective_level) { \
+            _LOG_WRITE_IMPL(LEVEL, __VA_ARGS__); \
+        } \
+    } while (0)
+#endif
+#if LOGGING_TOKENIZED
+#define _LOG_WRITE_IMPL(LEVEL, ...) _LOG_TOKENIZED_IMPL(LEVEL, __VA_ARGS__)
+#elif LOGGING_RATE_LIMIT
+#define _LOG_WRITE_IMPL(LEVEL, ...) do { \
+        static logging_site_t _logging_site; \
+        logging_log_rate_limited_impl(&_logging_logger, &_logging_site, LEVEL, FILENAME, __LINE__, __VA_ARGS__); \
+    } while (0)
+#else
+#define _LOG_WRITE_IMPL(LEVEL, ...) logging_log_impl(&_logging_logger, LEVEL, FILENAME, __LINE__, __VA_ARGS__)
+#endif
+// Compiled-out calls are still type-checked, but never evaluated
+#define _LOG_DISABLED_IMPL(...) do { \
+        if (0) { \
+            logging_log_impl(&_logging_logger, LOGGING_LEVEL_DEFAULT, FILENAME, __LINE__, __VA_ARGS__); \
+        } \
+    } while (0)
 void logging_log_impl(logging_logger_t* logger, logging_level_t level, const char* file, int line, const char* fmt, ...) _LOGGING_FORMAT_ATTR;
+void logging_log_rate_limited_impl(logging_logger_t* logger, logging_site_t* site, logging_level_t level, const char* file, int line, const char* fmt, ...) _LOGGING_SITE_FORMAT_ATTR;
+void logging_log_tokenized_impl(logging_logger_t* logger, logging_level_t level, uint32_t token, uint32_t arg_types, ...);
 void logging_set_level_impl(logging_logger_t* logger, logging_level_t level);
 
 // Per-file context object which we should create
@@ -79,6 +345,7 @@ static logging_logger_t _logging_logger _LOGGING_USED_ATTR = {
 #else
     .module_prefix = 0,
 #endif
+    ._effective_level = LOGGING_LEVEL_DEFAULT,
 };
 
 #ifdef __cplusplus
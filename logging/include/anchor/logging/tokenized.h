@@ -0,0 +1,284 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// NOTE: This header is included by logging.h, and defines the internals of the tokenized logging mode (see the
+// README). In this mode, each LOG_*() call site places an entry of the form "<MODULE:><FILE>\x1f<LINE>\x1f<FMT>"
+// into the logging_tokens section (which should not be loaded onto the device), and writes out a record which only
+// contains the 32-bit hash (token) of the entry along with the arguments. A record is encoded as:
+//   varint length (of the rest of the record)
+//   uint8_t level (with LOGGING_TOKENIZED_FLAG_HAS_TIME set if the time follows the token)
+//   uint32_t token (little-endian)
+//   varint time_ms (optional)
+//   the encoded arguments (see args.h)
+
+// The number of characters of an entry which are included in its hash (along with its total length)
+#define LOGGING_TOKEN_HASH_LENGTH           128
+// The max number of arguments which can be passed to a tokenized LOG_*() call
+#define LOGGING_TOKENIZED_MAX_ARGS          10
+// The separator between the fields of an entry
+#define LOGGING_TOKEN_ENTRY_SEPARATOR       '\x1f'
+#define LOGGING_TOKENIZED_FLAG_HAS_TIME     0x80
+#define LOGGING_TOKENIZED_LEVEL_MASK        0x7f
+
+// The type of each argument is encoded in LOGGING_ARG_TYPE_BITS bits, starting with the first one in the LSBs
+#define LOGGING_ARG_TYPE_BITS               3
+#define LOGGING_ARG_TYPE_END                0
+#define LOGGING_ARG_TYPE_INT32              1
+#define LOGGING_ARG_TYPE_UINT32             2
+#define LOGGING_ARG_TYPE_INT64              3
+#define LOGGING_ARG_TYPE_DOUBLE             4
+#define LOGGING_ARG_TYPE_LONG_DOUBLE        5
+#define LOGGING_ARG_TYPE_STRING             6
+#define LOGGING_ARG_TYPE_POINTER            7
+
+typedef struct {
+    uint8_t level;
+    bool has_time;
+    uint32_t token;
+    uint32_t time_ms;
+    const uint8_t* args;
+    uint32_t args_length;
+} logging_tokenized_record_t;
+
+// Calculates the token for an entry (this matches the value which is calculated at compile-time by the LOG_*() macros)
+uint32_t logging_token_hash(const char* str, uint32_t length);
+
+// Parses the record at the start of a stream of tokenized records, returning its total length (or 0 if it's invalid or
+// incomplete)
+uint32_t logging_tokenized_parse_record(const uint8_t* data, uint32_t length, logging_tokenized_record_t* record);
+
+// Formats a tokenized record back into a log line in the same format as the LOG_*() macros would have written it,
+// given the entry for its token, returning the length of the line
+uint32_t logging_tokenized_format_line(char* buffer, uint32_t size, const logging_tokenized_record_t* record, const char* entry, uint32_t entry_length);
+
+// Internal implementation macros / functions which are called via the LOG_*() macros
+#define _LOGGING_STRINGIFY(X) _LOGGING_STRINGIFY2(X)
+#define _LOGGING_STRINGIFY2(X) #X
+#define _LOGGING_TOKEN_ENTRY(FMT) _LOGGING_MODULE_PREFIX FILENAME "\x1f" _LOGGING_STRINGIFY(__LINE__) "\x1f" FMT
+#if defined(__APPLE__)
+#define _LOGGING_TOKEN_SECTION_ATTR __attribute__((section("__TEXT,logging_tokens"), used))
+#else
+#define _LOGGING_TOKEN_SECTION_ATTR __attribute__((section("logging_tokens"), used))
+#endif
+#define _LOG_TOKENIZED_IMPL(LEVEL, FMT, ...) do { \
+        static const char _logging_token_entry[] _LOGGING_TOKEN_SECTION_ATTR = _LOGGING_TOKEN_ENTRY(FMT); \
+        logging_log_tokenized_impl(&_logging_logger, LEVEL, _LOGGING_TOKEN_HASH(_LOGGING_TOKEN_ENTRY(FMT)), \
+            _LOGGING_ARG_TYPES(__VA_ARGS__), ##__VA_ARGS__); \
+    } while (0)
+
+// The hash is calculated as (length + sum(str[i] * 65599^i)) for the first LOGGING_TOKEN_HASH_LENGTH characters, such
+// that it can be evaluated at compile-time (with optimizations enabled) for a string literal, which then isn't included
+// in the binary
+#define _LOGGING_TOKEN_HASH_CHAR(STR, I, K) \
+    ((I) < sizeof(STR) - 1 ? (uint32_t)(K) * (uint8_t)(STR)[(I) < sizeof(STR) ? (I) : 0] : 0u)
+#define _LOGGING_TOKEN_HASH(STR) (uint32_t)((uint32_t)(sizeof(STR) - 1) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 0, 0x00000001u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 1, 0x0001003fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 2, 0x007e0f81u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 3, 0x2e86d0bfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 4, 0x43ec5f01u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 5, 0x162c613fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 6, 0xd62aee81u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 7, 0xa311b1bfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 8, 0xd319be01u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 9, 0xb156c23fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 10, 0x6698cd81u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 11, 0x0d1b92bfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 12, 0xcc881d01u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 13, 0x7280233fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 14, 0x50c7ac81u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 15, 0x8da473bfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 16, 0x4f377c01u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 17, 0xfaa8843fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 18, 0x33b78b81u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 19, 0x45ac54bfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 20, 0x7a27db01u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 21, 0xeacfe53fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 22, 0xae686a81u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 23, 0x563335bfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 24, 0x6c593a01u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 25, 0xe3f6463fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 26, 0x5fda4981u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 27, 0xe03916bfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 28, 0x44cb9901u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 29, 0x871ba73fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 30, 0xe70d2881u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 31, 0x04bdf7bfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 32, 0x227ef801u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 33, 0x7540083fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 34, 0xe3010781u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 35, 0xe4c1d8bfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 36, 0x24735701u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 37, 0x4f63693fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 38, 0xf2b5e681u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 39, 0xa144b9bfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 40, 0x69a8b601u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 41, 0xb685ca3fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 42, 0xb52bc581u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 43, 0x5b469abfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 44, 0x111f1501u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 45, 0x4ba72b3fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 46, 0xc962a481u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 47, 0x33c77bbfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 48, 0x39d67401u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 49, 0xafc78c3fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 50, 0xce5a8381u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 51, 0x4bc75cbfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 52, 0x02ced301u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 53, 0x83e6ed3fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 54, 0x63136281u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 55, 0xc4463dbfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 56, 0x8b083201u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 57, 0x69054e3fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 58, 0x268d4181u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 59, 0xbe441ebfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 60, 0xf1829101u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 61, 0x0022af3fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 62, 0xb7c82081u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 63, 0x5ac0ffbfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 64, 0x553df001u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 65, 0xea3f103fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 66, 0xb5c3ff81u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 67, 0xbabce0bfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 68, 0xd53a4f01u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 69, 0xc85a713fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 70, 0xbf80de81u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 71, 0xff37c1bfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 72, 0x9077ae01u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 73, 0x3b74d23fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 74, 0x73febd81u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 75, 0x4931a2bfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 76, 0xa5f60d01u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 77, 0xe48e333fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 78, 0x723d9c81u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 79, 0xb9aa83bfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 80, 0x34b56c01u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 81, 0x64a6943fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 82, 0x593d7b81u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 83, 0x71a264bfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 84, 0x5bb5cb01u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 85, 0x5cbdf53fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 86, 0xc7fe5a81u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 87, 0x921945bfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 88, 0x39f72a01u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 89, 0x6dd4563fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 90, 0x5d803981u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 91, 0x3c0f26bfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 92, 0xee798901u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 93, 0x38e9b73fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 94, 0xb8c31881u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 95, 0x908407bfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 96, 0x983ce801u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 97, 0x5efe183fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 98, 0x78c6f781u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 99, 0xb077e8bfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 100, 0x56414701u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 101, 0x8111793fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 102, 0x3c8bd681u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 103, 0xbceac9bfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 104, 0x4786a601u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 105, 0x4023da3fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 106, 0xa311b581u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 107, 0xd6dcaabfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 108, 0x8b0d0501u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 109, 0x3d353b3fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 110, 0x4b589481u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 111, 0x1f4d8bbfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 112, 0x3fd46401u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 113, 0x19459c3fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 114, 0xd4607381u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 115, 0xb73d6cbfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 116, 0x84dcc301u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 117, 0x7554fd3fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 118, 0xdd295281u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 119, 0xbfac4dbfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 120, 0x79262201u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 121, 0xf2635e3fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 122, 0x04b33181u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 123, 0x599a2ebfu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 124, 0x3bb08101u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 125, 0x3170bf3fu) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 126, 0xe9fe1081u) + \
+    _LOGGING_TOKEN_HASH_CHAR(STR, 127, 0xa6070fbfu))
+
+// Gets the LOGGING_ARG_TYPE_* values for up to LOGGING_TOKENIZED_MAX_ARGS arguments
+#define _LOGGING_ARG_COUNT(...) _LOGGING_ARG_COUNT_IMPL(_, ##__VA_ARGS__, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define _LOGGING_ARG_COUNT_IMPL(_, A1, A2, A3, A4, A5, A6, A7, A8, A9, A10, N, ...) N
+#define _LOGGING_CONCAT(A, B) _LOGGING_CONCAT2(A, B)
+#define _LOGGING_CONCAT2(A, B) A##B
+#define _LOGGING_ARG_TYPES(...) _LOGGING_CONCAT(_LOGGING_ARG_TYPES_, _LOGGING_ARG_COUNT(__VA_ARGS__))(__VA_ARGS__)
+#define _LOGGING_ARG_TYPES_0() 0u
+#define _LOGGING_ARG_TYPES_1(A) _LOGGING_ARG_TYPE(A)
+#define _LOGGING_ARG_TYPES_2(A, ...) (_LOGGING_ARG_TYPE(A) | (_LOGGING_ARG_TYPES_1(__VA_ARGS__) << LOGGING_ARG_TYPE_BITS))
+#define _LOGGING_ARG_TYPES_3(A, ...) (_LOGGING_ARG_TYPE(A) | (_LOGGING_ARG_TYPES_2(__VA_ARGS__) << LOGGING_ARG_TYPE_BITS))
+#define _LOGGING_ARG_TYPES_4(A, ...) (_LOGGING_ARG_TYPE(A) | (_LOGGING_ARG_TYPES_3(__VA_ARGS__) << LOGGING_ARG_TYPE_BITS))
+#define _LOGGING_ARG_TYPES_5(A, ...) (_LOGGING_ARG_TYPE(A) | (_LOGGING_ARG_TYPES_4(__VA_ARGS__) << LOGGING_ARG_TYPE_BITS))
+#define _LOGGING_ARG_TYPES_6(A, ...) (_LOGGING_ARG_TYPE(A) | (_LOGGING_ARG_TYPES_5(__VA_ARGS__) << LOGGING_ARG_TYPE_BITS))
+#define _LOGGING_ARG_TYPES_7(A, ...) (_LOGGING_ARG_TYPE(A) | (_LOGGING_ARG_TYPES_6(__VA_ARGS__) << LOGGING_ARG_TYPE_BITS))
+#define _LOGGING_ARG_TYPES_8(A, ...) (_LOGGING_ARG_TYPE(A) | (_LOGGING_ARG_TYPES_7(__VA_ARGS__) << LOGGING_ARG_TYPE_BITS))
+#define _LOGGING_ARG_TYPES_9(A, ...) (_LOGGING_ARG_TYPE(A) | (_LOGGING_ARG_TYPES_8(__VA_ARGS__) << LOGGING_ARG_TYPE_BITS))
+#define _LOGGING_ARG_TYPES_10(A, ...) (_LOGGING_ARG_TYPE(A) | (_LOGGING_ARG_TYPES_9(__VA_ARGS__) << LOGGING_ARG_TYPE_BITS))
+
+#ifdef __cplusplus
+}
+
+// The type of each argument is found via overload resolution in an unevaluated context (note that this may be
+// included from within an extern "C" block)
+extern "C++" {
+template <uint32_t TYPE>
+struct _logging_arg_type_t {
+    static constexpr uint32_t value = TYPE;
+};
+_logging_arg_type_t<LOGGING_ARG_TYPE_INT32> _logging_arg_type_of(bool);
+_logging_arg_type_t<LOGGING_ARG_TYPE_INT32> _logging_arg_type_of(char);
+_logging_arg_type_t<LOGGING_ARG_TYPE_INT32> _logging_arg_type_of(signed char);
+_logging_arg_type_t<LOGGING_ARG_TYPE_INT32> _logging_arg_type_of(unsigned char);
+_logging_arg_type_t<LOGGING_ARG_TYPE_INT32> _logging_arg_type_of(short);
+_logging_arg_type_t<LOGGING_ARG_TYPE_INT32> _logging_arg_type_of(unsigned short);
+_logging_arg_type_t<LOGGING_ARG_TYPE_INT32> _logging_arg_type_of(int);
+_logging_arg_type_t<LOGGING_ARG_TYPE_UINT32> _logging_arg_type_of(unsigned int);
+_logging_arg_type_t<(sizeof(long) > 4) ? LOGGING_ARG_TYPE_INT64 : LOGGING_ARG_TYPE_INT32> _logging_arg_type_of(long);
+_logging_arg_type_t<(sizeof(long) > 4) ? LOGGING_ARG_TYPE_INT64 : LOGGING_ARG_TYPE_UINT32> _logging_arg_type_of(unsigned long);
+_logging_arg_type_t<LOGGING_ARG_TYPE_INT64> _logging_arg_type_of(long long);
+_logging_arg_type_t<LOGGING_ARG_TYPE_INT64> _logging_arg_type_of(unsigned long long);
+_logging_arg_type_t<LOGGING_ARG_TYPE_DOUBLE> _logging_arg_type_of(float);
+_logging_arg_type_t<LOGGING_ARG_TYPE_DOUBLE> _logging_arg_type_of(double);
+_logging_arg_type_t<LOGGING_ARG_TYPE_LONG_DOUBLE> _logging_arg_type_of(long double);
+_logging_arg_type_t<LOGGING_ARG_TYPE_STRING> _logging_arg_type_of(char*);
+_logging_arg_type_t<LOGGING_ARG_TYPE_STRING> _logging_arg_type_of(const char*);
+_logging_arg_type_t<LOGGING_ARG_TYPE_POINTER> _logging_arg_type_of(decltype(nullptr));
+template <typename T>
+_logging_arg_type_t<LOGGING_ARG_TYPE_POINTER> _logging_arg_type_of(T*);
+}
+
+#define _LOGGING_ARG_TYPE(A) decltype(_logging_arg_type_of(A))::value
+
+#else
+
+#define _LOGGING_ARG_TYPE(A) _Generic((A), \
+    _Bool: LOGGING_ARG_TYPE_INT32, \
+    char: LOGGING_ARG_TYPE_INT32, \
+    signed char: LOGGING_ARG_TYPE_INT32, \
+    unsigned char: LOGGING_ARG_TYPE_INT32, \
+    short: LOGGING_ARG_TYPE_INT32, \
+    unsigned short: LOGGING_ARG_TYPE_INT32, \
+    int: LOGGING_ARG_TYPE_INT32, \
+    unsigned int: LOGGING_ARG_TYPE_UINT32, \
+    long: (sizeof(long) > 4 ? LOGGING_ARG_TYPE_INT64 : LOGGING_ARG_TYPE_INT32), \
+    unsigned long: (sizeof(long) > 4 ? LOGGING_ARG_TYPE_INT64 : LOGGING_ARG_TYPE_UINT32), \
+    long long: LOGGING_ARG_TYPE_INT64, \
+    unsigned long long: LOGGING_ARG_TYPE_INT64, \
+    float: LOGGING_ARG_TYPE_DOUBLE, \
+    double: LOGGING_ARG_TYPE_DOUBLE, \
+    long double: LOGGING_ARG_TYPE_LONG_DOUBLE, \
+    char*: LOGGING_ARG_TYPE_STRING, \
+    const char*: LOGGING_ARG_TYPE_STRING, \
+    default: LOGGING_ARG_TYPE_POINTER)
+
+#endif
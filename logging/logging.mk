@@ -0,0 +1,6 @@
+LOGGING_BASE_DIR := $(patsubst %/,%,$(dir $(lastword $(MAKEFILE_LIST))))
+
+LOGGING_C_SOURCES := \
+	$(LOGGING_BASE_DIR)/src/args.c \
+	$(LOGGING_BASE_DIR)/src/logging.c \
+	$(LOGGING_BASE_DIR)/src/tokenized.c
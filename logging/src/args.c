@@ -0,0 +1,558 @@
+#include "args.h"
+
+#include "anchor/logging/tokenized.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+// The max length of a single conversion specifier after the width and precision have been filled in
+#define MAX_SPEC_LENGTH 32
+
+typedef enum {
+    ARG_TYPE_NONE, // "%%" (or an invalid specifier)
+    ARG_TYPE_SIGNED,
+    ARG_TYPE_UNSIGNED,
+    ARG_TYPE_CHAR,
+    ARG_TYPE_DOUBLE,
+    ARG_TYPE_POINTER,
+    ARG_TYPE_STRING,
+    ARG_TYPE_COUNT, // "%n" (which is consumed but not supported)
+} arg_type_t;
+
+typedef enum {
+    LENGTH_NONE,
+    LENGTH_HH,
+    LENGTH_H,
+    LENGTH_L,
+    LENGTH_LL,
+    LENGTH_J,
+    LENGTH_Z,
+    LENGTH_T,
+    LENGTH_LONG_DOUBLE,
+} length_t;
+
+typedef struct {
+    arg_type_t type;
+    length_t length;
+    char conversion;
+    // The flags (i.e. "-0") which follow the '%'
+    const char* flags;
+    uint8_t flags_length;
+    // The width / precision (-1 if not specified, or if they're passed as arguments)
+    int32_t width;
+    int32_t precision;
+    bool width_is_arg;
+    bool precision_is_arg;
+} spec_t;
+
+typedef struct {
+    uint8_t* buffer;
+    uint32_t size;
+    uint32_t offset;
+    bool truncated;
+} writer_t;
+
+typedef struct {
+    const uint8_t* data;
+    uint32_t length;
+    uint32_t offset;
+} reader_t;
+
+static const char* parse_number(const char* fmt, int32_t* value) {
+    *value = 0;
+    while (*fmt >= '0' && *fmt <= '9') {
+        *value = *value * 10 + (*fmt++ - '0');
+    }
+    return fmt;
+}
+
+// Parses the conversion specifier which follows a '%', returning a pointer to the character after it
+static const char* parse_spec(const char* fmt, spec_t* spec) {
+    *spec = (spec_t){
+        .type = ARG_TYPE_NONE,
+        .length = LENGTH_NONE,
+        .flags = fmt,
+        .width = -1,
+        .precision = -1,
+    };
+    while (*fmt && strchr("-+ #0", *fmt)) {
+        fmt++;
+    }
+    spec->flags_length = fmt - spec->flags;
+    if (*fmt == '*') {
+        spec->width_is_arg = true;
+        fmt++;
+    } else if (*fmt >= '0' && *fmt <= '9') {
+        fmt = parse_number(fmt, &spec->width);
+    }
+    if (*fmt == '.') {
+        fmt++;
+        if (*fmt == '*') {
+            spec->precision_is_arg = true;
+            fmt++;
+        } else {
+            fmt = parse_number(fmt, &spec->precision);
+        }
+    }
+    switch (*fmt) {
+        case 'h':
+            fmt++;
+            spec->length = *fmt == 'h' ? LENGTH_HH : LENGTH_H;
+            fmt += spec->length == LENGTH_HH;
+            break;
+        case 'l':
+            fmt++;
+            spec->length = *fmt == 'l' ? LENGTH_LL : LENGTH_L;
+            fmt += spec->length == LENGTH_LL;
+            break;
+        case 'j':
+            spec->length = LENGTH_J;
+            fmt++;
+            break;
+        case 'z':
+            spec->length = LENGTH_Z;
+            fmt++;
+            break;
+        case 't':
+            spec->length = LENGTH_T;
+            fmt++;
+            break;
+        case 'L':
+            spec->length = LENGTH_LONG_DOUBLE;
+            fmt++;
+            break;
+        default:
+            break;
+    }
+    spec->conversion = *fmt;
+    switch (*fmt) {
+        case 'd':
+        case 'i':
+            spec->type = ARG_TYPE_SIGNED;
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            spec->type = ARG_TYPE_UNSIGNED;
+            break;
+        case 'c':
+            spec->type = ARG_TYPE_CHAR;
+            break;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            spec->type = ARG_TYPE_DOUBLE;
+            break;
+        case 'p':
+            spec->type = ARG_TYPE_POINTER;
+            break;
+        case 's':
+            spec->type = ARG_TYPE_STRING;
+            break;
+        case 'n':
+            spec->type = ARG_TYPE_COUNT;
+            break;
+        case '\0':
+            // don't go past the end of the string
+            return fmt;
+        default:
+            break;
+    }
+    return fmt + 1;
+}
+
+static void write_bytes(writer_t* writer, const void* data, uint32_t length) {
+    if (writer->truncated || writer->offset + length > writer->size) {
+        writer->truncated = true;
+        return;
+    }
+    memcpy(&writer->buffer[writer->offset], data, length);
+    writer->offset += length;
+}
+
+static void write_varint(writer_t* writer, uint64_t value) {
+    uint8_t bytes[ARGS_MAX_VARINT_LENGTH];
+    write_bytes(writer, bytes, args_write_varint(bytes, value));
+}
+
+static void write_signed(writer_t* writer, int64_t value) {
+    write_varint(writer, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static void write_double(writer_t* writer, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint8_t bytes[sizeof(bits)];
+    for (uint32_t i = 0; i < sizeof(bytes); i++) {
+        bytes[i] = bits >> (i * 8);
+    }
+    write_bytes(writer, bytes, sizeof(bytes));
+}
+
+// The string only needs to be terminated if there's no precision (max_length < 0), as with printf()
+static void write_string(writer_t* writer, const char* str, int64_t max_length) {
+    if (!str) {
+        str = "(null)";
+    }
+    uint32_t length;
+    if (max_length >= 0) {
+        // this is strnlen(), which isn't part of C99
+        const char* end = memchr(str, '\0', max_length);
+        length = end ? (uint32_t)(end - str) : (uint32_t)max_length;
+    } else {
+        length = strlen(str);
+    }
+    if (!writer->truncated && writer->offset + length + 1 > writer->size && writer->offset < writer->size) {
+        // write as much of the string as fits
+        const uint32_t partial_length = writer->size - writer->offset - 1;
+        memcpy(&writer->buffer[writer->offset], str, partial_length);
+        writer->buffer[writer->size - 1] = '\0';
+        writer->offset = writer->size;
+        writer->truncated = true;
+        return;
+    }
+    write_bytes(writer, str, length);
+    write_bytes(writer, "", 1);
+}
+
+static int64_t get_signed_arg(length_t length, va_list* args) {
+    switch (length) {
+        case LENGTH_HH:
+            return (signed char)va_arg(*args, int);
+        case LENGTH_H:
+            return (short)va_arg(*args, int);
+        case LENGTH_L:
+            return va_arg(*args, long);
+        case LENGTH_LL:
+            return va_arg(*args, long long);
+        case LENGTH_J:
+            return va_arg(*args, intmax_t);
+        case LENGTH_Z:
+        case LENGTH_T:
+            return va_arg(*args, ptrdiff_t);
+        default:
+            return va_arg(*args, int);
+    }
+}
+
+static uint64_t get_unsigned_arg(length_t length, va_list* args) {
+    switch (length) {
+        case LENGTH_HH:
+            return (unsigned char)va_arg(*args, unsigned int);
+        case LENGTH_H:
+            return (unsigned short)va_arg(*args, unsigned int);
+        case LENGTH_L:
+            return va_arg(*args, unsigned long);
+        case LENGTH_LL:
+            return va_arg(*args, unsigned long long);
+        case LENGTH_J:
+            return va_arg(*args, uintmax_t);
+        case LENGTH_Z:
+        case LENGTH_T:
+            return va_arg(*args, size_t);
+        default:
+            return va_arg(*args, unsigned int);
+    }
+}
+
+uint32_t args_encode(uint8_t* buffer, uint32_t size, const char* fmt, va_list args, bool* truncated) {
+    writer_t writer = {
+        .buffer = buffer,
+        .size = size,
+    };
+    va_list args_copy;
+    va_copy(args_copy, args);
+    while (*fmt && !writer.truncated) {
+        if (*fmt++ != '%') {
+            continue;
+        }
+        spec_t spec;
+        fmt = parse_spec(fmt, &spec);
+        if (spec.type == ARG_TYPE_NONE) {
+            continue;
+        }
+        if (spec.width_is_arg) {
+            write_signed(&writer, va_arg(args_copy, int));
+        }
+        int64_t precision = spec.precision;
+        if (spec.precision_is_arg) {
+            precision = va_arg(args_copy, int);
+            write_signed(&writer, precision);
+        }
+        switch (spec.type) {
+            case ARG_TYPE_SIGNED:
+                write_signed(&writer, get_signed_arg(spec.length, &args_copy));
+                break;
+            case ARG_TYPE_UNSIGNED:
+                write_signed(&writer, (int64_t)get_unsigned_arg(spec.length, &args_copy));
+                break;
+            case ARG_TYPE_CHAR:
+                write_signed(&writer, va_arg(args_copy, int));
+                break;
+            case ARG_TYPE_DOUBLE:
+                if (spec.length == LENGTH_LONG_DOUBLE) {
+                    write_double(&writer, (double)va_arg(args_copy, long double));
+                } else {
+                    write_double(&writer, va_arg(args_copy, double));
+                }
+                break;
+            case ARG_TYPE_POINTER:
+                write_signed(&writer, (int64_t)(uintptr_t)va_arg(args_copy, void*));
+                break;
+            case ARG_TYPE_STRING:
+                write_string(&writer, va_arg(args_copy, const char*), precision);
+                break;
+            case ARG_TYPE_COUNT:
+                (void)va_arg(args_copy, void*);
+                break;
+            case ARG_TYPE_NONE:
+                break;
+        }
+    }
+    va_end(args_copy);
+    *truncated = writer.truncated;
+    return writer.offset;
+}
+
+uint32_t args_encode_typed(uint8_t* buffer, uint32_t size, uint32_t arg_types, va_list args, bool* truncated) {
+    writer_t writer = {
+        .buffer = buffer,
+        .size = size,
+    };
+    va_list args_copy;
+    va_copy(args_copy, args);
+    for (; arg_types && !writer.truncated; arg_types >>= LOGGING_ARG_TYPE_BITS) {
+        switch (arg_types & ((1 << LOGGING_ARG_TYPE_BITS) - 1)) {
+            case LOGGING_ARG_TYPE_INT32:
+                write_signed(&writer, va_arg(args_copy, int));
+                break;
+            case LOGGING_ARG_TYPE_UINT32:
+                write_signed(&writer, va_arg(args_copy, unsigned int));
+                break;
+            case LOGGING_ARG_TYPE_INT64:
+                write_signed(&writer, va_arg(args_copy, long long));
+                break;
+            case LOGGING_ARG_TYPE_DOUBLE:
+                write_double(&writer, va_arg(args_copy, double));
+                break;
+            case LOGGING_ARG_TYPE_LONG_DOUBLE:
+                write_double(&writer, (double)va_arg(args_copy, long double));
+                break;
+            case LOGGING_ARG_TYPE_STRING:
+                // the format string isn't available here, so the string always needs to be terminated
+                write_string(&writer, va_arg(args_copy, const char*), -1);
+                break;
+            case LOGGING_ARG_TYPE_POINTER:
+                write_signed(&writer, (int64_t)(uintptr_t)va_arg(args_copy, void*));
+                break;
+            default:
+                break;
+        }
+    }
+    va_end(args_copy);
+    *truncated = writer.truncated;
+    return writer.offset;
+}
+
+uint32_t args_write_varint(uint8_t* buffer, uint64_t value) {
+    uint32_t length = 0;
+    do {
+        buffer[length] = value & 0x7f;
+        value >>= 7;
+        if (value) {
+            buffer[length] |= 0x80;
+        }
+        length++;
+    } while (value);
+    return length;
+}
+
+uint32_t args_read_varint(const uint8_t* data, uint32_t length, uint64_t* value) {
+    *value = 0;
+    for (uint32_t i = 0; i < length && i < ARGS_MAX_VARINT_LENGTH; i++) {
+        *value |= (uint64_t)(data[i] & 0x7f) << (i * 7);
+        if (!(data[i] & 0x80)) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+static bool read_varint(reader_t* reader, uint64_t* value) {
+    const uint32_t length = args_read_varint(&reader->data[reader->offset], reader->length - reader->offset, value);
+    reader->offset += length;
+    return length > 0;
+}
+
+static bool read_signed(reader_t* reader, int64_t* value) {
+    uint64_t encoded;
+    if (!read_varint(reader, &encoded)) {
+        return false;
+    }
+    *value = (int64_t)(encoded >> 1) ^ -(int64_t)(encoded & 1);
+    return true;
+}
+
+static bool read_double(reader_t* reader, double* value) {
+    if (reader->offset + sizeof(uint64_t) > reader->length) {
+        return false;
+    }
+    uint64_t bits = 0;
+    for (uint32_t i = 0; i < sizeof(bits); i++) {
+        bits |= (uint64_t)reader->data[reader->offset++] << (i * 8);
+    }
+    memcpy(value, &bits, sizeof(bits));
+    return true;
+}
+
+static bool read_string(reader_t* reader, const char** value) {
+    const uint8_t* end = memchr(&reader->data[reader->offset], '\0', reader->length - reader->offset);
+    if (!end) {
+        return false;
+    }
+    *value = (const char*)&reader->data[reader->offset];
+    reader->offset = end - reader->data + 1;
+    return true;
+}
+
+// Builds a conversion specifier which takes a single argument (i.e. with the width and precision filled in), using the
+// "ll" length modifier for integers since they're decoded as 64-bit values
+static bool build_spec(char* buffer, const spec_t* spec, bool has_width, int64_t width, int64_t precision) {
+    const char* length_modifier = (spec->type == ARG_TYPE_SIGNED || spec->type == ARG_TYPE_UNSIGNED) ? "ll" : "";
+    // a negative width (passed as an argument) means left-justified
+    const char* left_justify = (has_width && width < 0) ? "-" : "";
+    char width_str[12] = "";
+    if (has_width) {
+        snprintf(width_str, sizeof(width_str), "%d", (int)(width < 0 ? -width : width));
+    }
+    char precision_str[13] = "";
+    if (precision >= 0) {
+        snprintf(precision_str, sizeof(precision_str), ".%d", (int)precision);
+    }
+    const int length = snprintf(buffer, MAX_SPEC_LENGTH, "%%%.*s%s%s%s%s%c", spec->flags_length, spec->flags,
+        left_justify, width_str, precision_str, length_modifier, spec->conversion);
+    return length > 0 && length < MAX_SPEC_LENGTH;
+}
+
+// Reads the next argument from the reader and formats it with a conversion specifier, returning false if it's missing
+// NOTE: Integers without a length modifier are assumed to be 32 bits, as the encoder may be on a different machine
+static bool format_arg(char* buffer, uint32_t size, const char* spec_buffer, const spec_t* spec, reader_t* reader, int* result) {
+    int64_t signed_value;
+    double double_value;
+    const char* string_value;
+    switch (spec->type) {
+        case ARG_TYPE_SIGNED:
+            if (!read_signed(reader, &signed_value)) {
+                return false;
+            }
+            if (spec->length == LENGTH_HH) {
+                signed_value = (signed char)signed_value;
+            } else if (spec->length == LENGTH_H) {
+                signed_value = (int16_t)signed_value;
+            } else if (spec->length == LENGTH_NONE) {
+                signed_value = (int32_t)signed_value;
+            }
+            *result = snprintf(buffer, size, spec_buffer, (long long)signed_value);
+            return true;
+        case ARG_TYPE_UNSIGNED:
+            if (!read_signed(reader, &signed_value)) {
+                return false;
+            }
+            if (spec->length == LENGTH_HH) {
+                signed_value = (uint8_t)signed_value;
+            } else if (spec->length == LENGTH_H) {
+                signed_value = (uint16_t)signed_value;
+            } else if (spec->length == LENGTH_NONE) {
+                signed_value = (uint32_t)signed_value;
+            }
+            *result = snprintf(buffer, size, spec_buffer, (unsigned long long)signed_value);
+            return true;
+        case ARG_TYPE_CHAR:
+            if (!read_signed(reader, &signed_value)) {
+                return false;
+            }
+            *result = snprintf(buffer, size, spec_buffer, (int)signed_value);
+            return true;
+        case ARG_TYPE_DOUBLE:
+            if (!read_double(reader, &double_value)) {
+                return false;
+            }
+            *result = snprintf(buffer, size, spec_buffer, double_value);
+            return true;
+        case ARG_TYPE_POINTER:
+            if (!read_signed(reader, &signed_value)) {
+                return false;
+            }
+            *result = snprintf(buffer, size, spec_buffer, (void*)(uintptr_t)signed_value);
+            return true;
+        case ARG_TYPE_STRING:
+            if (!read_string(reader, &string_value)) {
+                return false;
+            }
+            *result = snprintf(buffer, size, spec_buffer, string_value);
+            return true;
+        case ARG_TYPE_COUNT:
+        case ARG_TYPE_NONE:
+        default:
+            *result = 0;
+            return true;
+    }
+}
+
+uint32_t args_format(char* buffer, uint32_t size, const char* fmt, const uint8_t* data, uint32_t length) {
+    if (!size) {
+        return 0;
+    }
+    reader_t reader = {
+        .data = data,
+        .length = length,
+    };
+    uint32_t offset = 0;
+    while (*fmt && offset < size - 1) {
+        if (*fmt != '%') {
+            buffer[offset++] = *fmt++;
+            continue;
+        }
+        fmt++;
+        spec_t spec;
+        fmt = parse_spec(fmt, &spec);
+        if (spec.type == ARG_TYPE_NONE) {
+            if (spec.conversion == '%') {
+                buffer[offset++] = '%';
+            }
+            continue;
+        }
+        int64_t width = spec.width;
+        int64_t precision = spec.precision;
+        if (spec.width_is_arg && !read_signed(&reader, &width)) {
+            break;
+        }
+        if (spec.precision_is_arg && !read_signed(&reader, &precision)) {
+            break;
+        }
+        if (spec.type == ARG_TYPE_COUNT) {
+            continue;
+        }
+        char spec_buffer[MAX_SPEC_LENGTH];
+        if (!build_spec(spec_buffer, &spec, spec.width_is_arg || spec.width >= 0, width, precision)) {
+            break;
+        }
+        const uint32_t remaining = size - offset;
+        int result;
+        if (!format_arg(&buffer[offset], remaining, spec_buffer, &spec, &reader, &result)) {
+            break;
+        }
+        if (result > 0) {
+            offset += (uint32_t)result < remaining ? (uint32_t)result : remaining - 1;
+        }
+    }
+    buffer[offset] = '\0';
+    return offset;
+}
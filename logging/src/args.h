@@ -0,0 +1,34 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+// The arguments of a printf-style format string are encoded in the order they're consumed by the format string:
+//   integers, pointers, and width / precision arguments - the value as a 64-bit integer (sign-extended if signed), as a
+//     zigzag-encoded LEB128 varint
+//   floating-point - 8 byte little-endian IEEE-754 double
+//   strings - the characters followed by a null-terminator
+// This encoding doesn't depend on the size of the native types, so the arguments can be decoded on a different machine.
+
+// The max length of an encoded varint
+#define ARGS_MAX_VARINT_LENGTH 10
+
+// Encodes the arguments for a format string into a buffer, returning the number of bytes written
+// NOTE: If the buffer is too small, the arguments which don't fit are dropped and *truncated is set
+uint32_t args_encode(uint8_t* buffer, uint32_t size, const char* fmt, va_list args, bool* truncated);
+
+// Encodes arguments into a buffer based on a set of LOGGING_ARG_TYPE_* values (see tokenized.h) rather than a format
+// string, returning the number of bytes written
+uint32_t args_encode_typed(uint8_t* buffer, uint32_t size, uint32_t arg_types, va_list args, bool* truncated);
+
+// Encodes a value as a LEB128 varint (the buffer must hold at least ARGS_MAX_VARINT_LENGTH bytes), returning its length
+uint32_t args_write_varint(uint8_t* buffer, uint64_t value);
+
+// Decodes a LEB128 varint, returning its length (or 0 if it's invalid or incomplete)
+uint32_t args_read_varint(const uint8_t* data, uint32_t length, uint64_t* value);
+
+// Formats a message into a buffer from a format string and the arguments which were encoded by args_encode(), stopping
+// at the first argument which is missing, and returning the length of the message (the buffer is always
+// null-terminated)
+uint32_t args_format(char* buffer, uint32_t size, const char* fmt, const uint8_t* data, uint32_t length);
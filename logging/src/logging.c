@@ -1,21 +1,113 @@
 #include "anchor/logging/logging.h"
 
+#include "args.h"
+
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#if LOGGING_DEFERRED
+#include <stdatomic.h>
+#endif
+
 #define LEVEL_PREFIX_LENGTH     6
 #define TIME_LENGTH             16
+#define MS_PER_SEC              1000
 #define FILE_NAME_LENGTH        32
 #define FULL_LOG_MAX_LENGTH     (LOGGING_MAX_MSG_LENGTH + LEVEL_PREFIX_LENGTH + TIME_LENGTH + FILE_NAME_LENGTH + 1)
 
 #define GET_IMPL(LOGGER) ((logger_impl_t*)LOGGER->_private)
 
 typedef struct {
+    // The next logger in the list of those which have cached their effective level
+    logging_logger_t* next;
     logging_level_t level;
 } logger_impl_t;
 _Static_assert(sizeof(logger_impl_t) == sizeof(((logging_logger_t*)0)->_private), "Invalid context size");
 
+#define MILLI_TOKENS_PER_TOKEN  1000
+
+// The token bucket of a rate-limited call site, which holds up to rate_limit_burst tokens, with 1 token being used per
+// line, and rate_limit_per_sec tokens being added every second (tracked in milli-tokens to avoid rounding)
+typedef struct {
+    // The details of the call site, which are filled in once it first suppresses a line, for writing the summary
+    logging_logger_t* logger;
+    const char* file;
+    // The next site in the list of those which have suppressed lines
+    logging_site_t* next_suppressed;
+    uint32_t time_ms;
+    uint32_t milli_tokens;
+    uint32_t suppressed;
+    int line;
+    logging_level_t level;
+    bool valid;
+} site_impl_t;
+_Static_assert(sizeof(site_impl_t) == sizeof(((logging_site_t*)0)->_private), "Invalid context size");
+
+#define GET_SINK_IMPL(HANDLE) ((sink_impl_t*)(HANDLE)->_private)
+
+typedef struct {
+    logging_sink_init_t init;
+    logging_sink_context_t* next;
+#if LOGGING_DEFERRED
+    _Atomic uint32_t head;
+    _Atomic uint32_t tail;
+    logging_deferred_stats_t stats;
+#endif
+} sink_impl_t;
+_Static_assert(sizeof(sink_impl_t) == sizeof(((logging_sink_context_t*)0)->_private), "Invalid context size");
+
+#if LOGGING_DEFERRED
+// The header of each line in a deferred sink's buffer, which is followed by the null-terminated line
+typedef struct {
+    uint32_t length;
+    logging_level_t level;
+    const logging_logger_t* logger;
+} sink_record_t;
+
+// The header of each record in the deferred buffer, which is followed by the encoded arguments
+typedef struct {
+    uint32_t length;
+    uint32_t time_ms;
+    logging_level_t level;
+    int line;
+    logging_logger_t* logger;
+    const char* file;
+    const char* fmt;
+} deferred_record_t;
+#endif
+
+// Writes a log line into a buffer, always leaving room for the trailing newline
+typedef struct {
+    char* buffer;
+    uint32_t size;
+    uint32_t length;
+} line_writer_t;
+
+// The formatted time of day (everything except the milliseconds) of the last line, which only changes once a second
+typedef struct {
+    bool valid;
+    uint32_t sec;
+    uint32_t length;
+    char str[TIME_LENGTH];
+} time_cache_t;
+
+#if LOGGING_DEFERRED
+// A slot in the concurrent buffer, which is owned by the caller which claimed it until its sequence is advanced
+typedef struct {
+    _Atomic uint32_t sequence;
+    logging_level_t level;
+    const logging_logger_t* logger;
+    time_cache_t time_cache;
+    char line[FULL_LOG_MAX_LENGTH];
+} concurrent_slot_t;
+_Static_assert(sizeof(concurrent_slot_t) <= _LOGGING_CONCURRENT_SLOT_SIZE, "Invalid slot size");
+
+#define GET_CONCURRENT_SLOT(INDEX) \
+    ((concurrent_slot_t*)((uint8_t*)m_init.concurrent_buffer + ((INDEX) & (m_init.concurrent_num_slots - 1)) * _LOGGING_CONCURRENT_SLOT_SIZE))
+#endif
+
 static const char* LEVEL_PREFIX[] = {
     [LOGGING_LEVEL_DEFAULT] =   "????? ", // should never be printed
     [LOGGING_LEVEL_DEBUG] =     "DEBUG ",
@@ -25,77 +117,825 @@ static const char* LEVEL_PREFIX[] = {
 };
 
 static logging_init_t m_init;
-static char m_line_time_buffer[TIME_LENGTH];
+// The registered sinks
+static logging_sink_context_t* m_sinks;
+// The loggers which have cached their effective level, which need to be invalidated if the default level changes
+static logging_logger_t* m_cached_loggers;
+// The rate-limited call sites which have suppressed lines that haven't been summarized yet
+static logging_site_t* m_suppressed_sites;
 static char m_write_buffer[FULL_LOG_MAX_LENGTH];
+static time_cache_t m_time_cache;
+#if LOGGING_DEFERRED
+// The deferred buffer is a lock-free ring with a single consumer (logging_process_deferred()) and producers which are
+// serialized by the lock function, where the indexes are free-running and only the tail is modified by both sides
+static _Atomic uint32_t m_deferred_head;
+static _Atomic uint32_t m_deferred_tail;
+static logging_deferred_stats_t m_deferred_stats;
+static char m_deferred_write_buffer[FULL_LOG_MAX_LENGTH];
+static time_cache_t m_deferred_time_cache;
+static uint8_t m_deferred_args_buffer[FULL_LOG_MAX_LENGTH];
+// The concurrent buffer is a bounded queue where each slot has a sequence number which indicates whether it's free
+// (equal to the enqueue position) or holds a line which is ready to be written (equal to the enqueue position + 1), so
+// callers only need to synchronize with each other to claim a slot, and then format their lines in parallel
+static _Atomic uint32_t m_concurrent_enqueue_pos;
+static _Atomic uint32_t m_concurrent_dequeue_pos;
+static _Atomic uint32_t m_concurrent_records;
+static _Atomic uint32_t m_concurrent_dropped;
+static _Atomic uint32_t m_concurrent_max_used_slots;
+#endif
+
+static void lock(bool acquire) {
+    if (m_init.lock_function) {
+        m_init.lock_function(acquire);
+    }
+}
+
+// Gets the level below which a logger drops lines, caching it in the logger for the LOG_*() macros to check
+static logging_level_t get_effective_level(logging_logger_t* logger) {
+    logger_impl_t* impl = GET_IMPL(logger);
+    if (logger->_effective_level != LOGGING_LEVEL_DEFAULT) {
+        return logger->_effective_level;
+    } else if (m_init.default_level == LOGGING_LEVEL_DEFAULT) {
+        // not initialized yet
+        return impl->level;
+    }
+    lock(true);
+    if (logger->_effective_level == LOGGING_LEVEL_DEFAULT) {
+        impl->next = m_cached_loggers;
+        m_cached_loggers = logger;
+        logger->_effective_level = impl->level == LOGGING_LEVEL_DEFAULT ? m_init.default_level : impl->level;
+    }
+    lock(false);
+    return logger->_effective_level;
+}
+
+// Gets the cycle count at the start of formatting a line (if stats are enabled)
+static uint32_t stats_start(void) {
+#if LOGGING_STATS
+    if (m_init.cycle_count_function) {
+        return m_init.cycle_count_function();
+    }
+#endif
+    return 0;
+}
+
+// Counts the bytes which were produced and the cycles which were spent formatting a line (if stats are enabled)
+static void stats_end(logging_logger_t* logger, uint32_t length, uint32_t start_cycles) {
+#if LOGGING_STATS
+    logger->_stats.bytes += length;
+    if (m_init.cycle_count_function) {
+        logger->_stats.format_cycles += m_init.cycle_count_function() - start_cycles;
+    }
+#endif
+}
+
+static void stats_count_line(logging_logger_t* logger, logging_level_t level) {
+#if LOGGING_STATS
+    logger->_stats.lines[level - LOGGING_LEVEL_DEBUG]++;
+#endif
+}
+
+static void stats_count_filtered(logging_logger_t* logger) {
+#if LOGGING_STATS
+    logger->_stats.filtered++;
+#endif
+}
+
+#if LOGGING_DEFERRED
+// The deferred buffer and deferred sinks are each a lock-free ring of variable-length records (each starting with its
+// uint32_t length) with a single consumer and producers which are serialized, where the indexes are free-running and
+// only the tail is modified by both sides (when dropping the oldest records)
+static void ring_copy_in(uint8_t* buffer, uint32_t size, uint32_t index, const void* data, uint32_t length) {
+    const uint32_t offset = index & (size - 1);
+    const uint32_t first_length = length < size - offset ? length : size - offset;
+    memcpy(&buffer[offset], data, first_length);
+    memcpy(buffer, (const uint8_t*)data + first_length, length - first_length);
+}
+
+static void ring_copy_out(const uint8_t* buffer, uint32_t size, uint32_t index, void* data, uint32_t length) {
+    const uint32_t offset = index & (size - 1);
+    const uint32_t first_length = length < size - offset ? length : size - offset;
+    memcpy(data, &buffer[offset], first_length);
+    memcpy((uint8_t*)data + first_length, buffer, length - first_length);
+}
+
+// Makes room for a record at the head of a ring, dropping the oldest records if allowed, and returning whether or not
+// there's room along with the resulting tail
+static bool ring_make_room(const uint8_t* buffer, uint32_t size, uint32_t head, _Atomic uint32_t* tail_ptr, uint32_t length, bool drop_oldest, uint32_t* tail, uint32_t* dropped) {
+    *tail = atomic_load_explicit(tail_ptr, memory_order_acquire);
+    while (size - (head - *tail) < length) {
+        if (!drop_oldest || head == *tail) {
+            (*dropped)++;
+            return false;
+        }
+        // drop the oldest record (racing with the consumer which may be writing it out)
+        uint32_t oldest_length;
+        ring_copy_out(buffer, size, *tail, &oldest_length, sizeof(oldest_length));
+        if (atomic_compare_exchange_weak_explicit(tail_ptr, tail, *tail + oldest_length, memory_order_acq_rel, memory_order_acquire)) {
+            (*dropped)++;
+            *tail += oldest_length;
+        }
+    }
+    return true;
+}
+#endif
+
+static void writer_init(line_writer_t* writer, char* buffer, uint32_t size) {
+    writer->buffer = buffer;
+    writer->size = size;
+    writer->length = 0;
+    buffer[0] = '\0';
+}
+
+// Gets the number of bytes available to write the rest of the line into (including the null-terminator)
+static uint32_t writer_available(const line_writer_t* writer) {
+    return writer->size - writer->length - 1;
+}
+
+static void writer_append(line_writer_t* writer, const char* str, uint32_t length) {
+    const uint32_t available = writer_available(writer) - 1;
+    if (length > available) {
+        length = available;
+    }
+    memcpy(&writer->buffer[writer->length], str, length);
+    writer->length += length;
+    writer->buffer[writer->length] = '\0';
+}
+
+static void writer_append_str(line_writer_t* writer, const char* str) {
+    writer_append(writer, str, strlen(str));
+}
+
+// Appends a decimal number which is padded with leading zeros to at least min_digits
+static void writer_append_uint(line_writer_t* writer, uint32_t value, uint32_t min_digits) {
+    char digits[10];
+    uint32_t num_digits = 0;
+    do {
+        digits[sizeof(digits) - ++num_digits] = '0' + value % 10;
+        value /= 10;
+    } while (value || num_digits < min_digits);
+    writer_append(writer, &digits[sizeof(digits) - num_digits], num_digits);
+}
+
+// Called after the message was written directly into the buffer
+static void writer_advance(line_writer_t* writer, uint32_t length) {
+    const uint32_t available = writer_available(writer) - 1;
+    writer->length += length < available ? length : available;
+}
+
+// Formats the prefix of a log line (everything before the message)
+static void format_prefix(line_writer_t* writer, time_cache_t* time_cache, bool has_time, uint32_t time_ms, logging_level_t level, const char* module_prefix, const char* file, int line) {
+    // time
+    if (has_time) {
+        const uint32_t sec = time_ms / MS_PER_SEC;
+        if (!time_cache->valid || time_cache->sec != sec) {
+            time_cache->valid = true;
+            time_cache->sec = sec;
+            time_cache->length = (uint32_t)snprintf(time_cache->str, sizeof(time_cache->str), "%3"PRIu32":%02"PRIu32":%02"PRIu32".", sec / 3600, (sec / 60) % 60, sec % 60);
+        }
+        writer_append(writer, time_cache->str, time_cache->length);
+        writer_append_uint(writer, time_ms % MS_PER_SEC, 3);
+        writer_append(writer, " ", 1);
+    }
+
+    // level
+    writer_append(writer, LEVEL_PREFIX[level], LEVEL_PREFIX_LENGTH);
+
+    // module (if set)
+    if (module_prefix) {
+        writer_append_str(writer, module_prefix);
+    }
+
+    // file name and line number
+    writer_append_str(writer, file);
+    writer_append(writer, ":", 1);
+    writer_append_uint(writer, line, 1);
+    writer_append(writer, ": ", 2);
+}
+
+// Appends the trailing newline (which there's always room for)
+static void writer_end_line(line_writer_t* writer) {
+    writer->buffer[writer->length++] = '\n';
+    writer->buffer[writer->length] = '\0';
+}
+
+#if LOGGING_DEFERRED
+static void sink_push(logging_sink_handle_t handle, const char* buffer, logging_level_t level, const logging_logger_t* logger) {
+    sink_impl_t* impl = GET_SINK_IMPL(handle);
+    const sink_record_t record = {
+        .length = sizeof(record) + strlen(buffer) + 1,
+        .level = level,
+        .logger = logger,
+    };
+    const uint32_t head = atomic_load_explicit(&impl->head, memory_order_relaxed);
+    uint32_t tail;
+    if (!ring_make_room(handle->buffer, handle->buffer_size, head, &impl->tail, record.length, impl->init.policy == LOGGING_SINK_POLICY_DEFERRED_DROP_OLDEST, &tail, &impl->stats.dropped)) {
+        return;
+    }
+    ring_copy_in(handle->buffer, handle->buffer_size, head, &record, sizeof(record));
+    ring_copy_in(handle->buffer, handle->buffer_size, head + sizeof(record), buffer, record.length - sizeof(record));
+    atomic_store_explicit(&impl->head, head + record.length, memory_order_release);
+    impl->stats.records++;
+    if (head + record.length - tail > impl->stats.max_used) {
+        impl->stats.max_used = head + record.length - tail;
+    }
+}
+#endif
+
+static void write_buffer(const char* buffer, logging_level_t level, const logging_logger_t* logger) {
+    if (m_init.write_function) {
+        m_init.write_function(buffer);
+    }
+    if (m_init.raw_write_function) {
+        m_init.raw_write_function(level, logger->module_prefix, buffer);
+    }
+    for (logging_sink_handle_t sink = m_sinks; sink; sink = GET_SINK_IMPL(sink)->next) {
+        const sink_impl_t* impl = GET_SINK_IMPL(sink);
+        if (level < impl->init.level) {
+            continue;
+        } else if (impl->init.policy == LOGGING_SINK_POLICY_SYNC) {
+            impl->init.write_function(level, logger->module_prefix, buffer);
+        }
+#if LOGGING_DEFERRED
+        else {
+            sink_push(sink, buffer, level, logger);
+        }
+#endif
+    }
+}
+
+static void format_line(line_writer_t* writer, time_cache_t* time_cache, uint32_t time_ms, logging_level_t level, const logging_logger_t* logger, const char* file, int line, const char* fmt, va_list args) {
+    format_prefix(writer, time_cache, m_init.time_ms_function != NULL, time_ms, level, logger->module_prefix, file, line);
+    const int msg_length = vsnprintf(&writer->buffer[writer->length], writer_available(writer), fmt, args);
+    if (msg_length > 0) {
+        writer_advance(writer, msg_length);
+    }
+}
+
+#if LOGGING_DEFERRED
+static void log_concurrent(logging_logger_t* logger, logging_level_t level, const char* file, int line, const char* fmt, va_list args) {
+    // claim a slot, reading the time each attempt so that it's ordered with the times of the lines in the previous slots
+    uint32_t pos = atomic_load_explicit(&m_concurrent_enqueue_pos, memory_order_relaxed);
+    concurrent_slot_t* slot;
+    uint32_t time_ms;
+    while (true) {
+        time_ms = m_init.time_ms_function ? m_init.time_ms_function() : 0;
+        slot = GET_CONCURRENT_SLOT(pos);
+        const int32_t diff = (int32_t)(atomic_load_explicit(&slot->sequence, memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&m_concurrent_enqueue_pos, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // the slot hasn't been written out yet, so the buffer is full
+            atomic_fetch_add_explicit(&m_concurrent_dropped, 1, memory_order_relaxed);
+            return;
+        } else {
+            // another caller claimed the slot first
+            pos = atomic_load_explicit(&m_concurrent_enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    const uint32_t start_cycles = stats_start();
+    line_writer_t writer;
+    writer_init(&writer, slot->line, sizeof(slot->line));
+    format_line(&writer, &slot->time_cache, time_ms, level, logger, file, line, fmt, args);
+    writer_end_line(&writer);
+    stats_end(logger, writer.length, start_cycles);
+    slot->level = level;
+    slot->logger = logger;
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+
+    atomic_fetch_add_explicit(&m_concurrent_records, 1, memory_order_relaxed);
+    const uint32_t used_slots = pos + 1 - atomic_load_explicit(&m_concurrent_dequeue_pos, memory_order_relaxed);
+    uint32_t max_used_slots = atomic_load_explicit(&m_concurrent_max_used_slots, memory_order_relaxed);
+    while (used_slots > max_used_slots &&
+            !atomic_compare_exchange_weak_explicit(&m_concurrent_max_used_slots, &max_used_slots, used_slots, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+static uint32_t process_concurrent(uint32_t max_records) {
+    uint32_t num_records = 0;
+    uint32_t pos = atomic_load_explicit(&m_concurrent_dequeue_pos, memory_order_relaxed);
+    while (!max_records || num_records < max_records) {
+        concurrent_slot_t* slot = GET_CONCURRENT_SLOT(pos);
+        if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != pos + 1) {
+            // the next line isn't ready yet (even if later ones are)
+            break;
+        }
+        write_buffer(slot->line, slot->level, slot->logger);
+        atomic_store_explicit(&slot->sequence, pos + m_init.concurrent_num_slots, memory_order_release);
+        pos++;
+        atomic_store_explicit(&m_concurrent_dequeue_pos, pos, memory_order_relaxed);
+        num_records++;
+    }
+    return num_records;
+}
+
+static void log_deferred(logging_logger_t* logger, logging_level_t level, const char* file, int line, const char* fmt, va_list args) {
+    lock(true);
+    deferred_record_t record = {
+        .time_ms = m_init.time_ms_function ? m_init.time_ms_function() : 0,
+        .level = level,
+        .line = line,
+        .logger = logger,
+        .file = file,
+        .fmt = fmt,
+    };
+    // the arguments are encoded into the write buffer, as it's not otherwise used in deferred mode (the line is counted
+    // once it's formatted)
+    const uint32_t start_cycles = stats_start();
+    bool truncated;
+    const uint32_t args_length = args_encode((uint8_t*)m_write_buffer, sizeof(m_write_buffer), fmt, args, &truncated);
+    stats_end(logger, 0, start_cycles);
+    record.length = sizeof(record) + args_length;
+
+    // make room for the record
+    const uint32_t head = atomic_load_explicit(&m_deferred_head, memory_order_relaxed);
+    uint32_t tail;
+    if (!ring_make_room(m_init.deferred_buffer, m_init.deferred_buffer_size, head, &m_deferred_tail, record.length, m_init.deferred_drop_policy == LOGGING_DEFERRED_DROP_OLDEST, &tail, &m_deferred_stats.dropped)) {
+        lock(false);
+        return;
+    }
+
+    ring_copy_in(m_init.deferred_buffer, m_init.deferred_buffer_size, head, &record, sizeof(record));
+    ring_copy_in(m_init.deferred_buffer, m_init.deferred_buffer_size, head + sizeof(record), m_write_buffer, args_length);
+    atomic_store_explicit(&m_deferred_head, head + record.length, memory_order_release);
+    m_deferred_stats.records++;
+    if (head + record.length - tail > m_deferred_stats.max_used) {
+        m_deferred_stats.max_used = head + record.length - tail;
+    }
+    lock(false);
+}
+#endif
 
 bool logging_init(const logging_init_t* init) {
-    if ((!init->write_function && !init->raw_write_function) || init->default_level == LOGGING_LEVEL_DEFAULT) {
+    if (init->default_level == LOGGING_LEVEL_DEFAULT) {
         return false;
     }
+#if LOGGING_DEFERRED
+    if (init->deferred_buffer) {
+        const uint32_t size = init->deferred_buffer_size;
+        if (size < sizeof(deferred_record_t) || (size & (size - 1))) {
+            return false;
+        }
+    }
+    if (init->concurrent_buffer) {
+        const uint32_t num_slots = init->concurrent_num_slots;
+        if (init->deferred_buffer || !num_slots || (num_slots & (num_slots - 1))) {
+            return false;
+        }
+    }
+#endif
     m_init = *init;
+    m_sinks = NULL;
+    // drop any pending summaries of suppressed lines
+    while (m_suppressed_sites) {
+        site_impl_t* impl = (site_impl_t*)m_suppressed_sites->_private;
+        m_suppressed_sites = impl->next_suppressed;
+        impl->next_suppressed = NULL;
+        impl->suppressed = 0;
+    }
+    // the default level may have changed
+    while (m_cached_loggers) {
+        logging_logger_t* logger = m_cached_loggers;
+        m_cached_loggers = GET_IMPL(logger)->next;
+        GET_IMPL(logger)->next = NULL;
+        logger->_effective_level = LOGGING_LEVEL_DEFAULT;
+#if LOGGING_STATS
+        memset(&logger->_stats, 0, sizeof(logger->_stats));
+#endif
+    }
+#if LOGGING_DEFERRED
+    atomic_store(&m_deferred_head, 0);
+    atomic_store(&m_deferred_tail, 0);
+    memset(&m_deferred_stats, 0, sizeof(m_deferred_stats));
+    for (uint32_t i = 0; i < m_init.concurrent_num_slots; i++) {
+        atomic_store(&GET_CONCURRENT_SLOT(i)->sequence, i);
+        GET_CONCURRENT_SLOT(i)->time_cache.valid = false;
+    }
+    atomic_store(&m_concurrent_enqueue_pos, 0);
+    atomic_store(&m_concurrent_dequeue_pos, 0);
+    atomic_store(&m_concurrent_records, 0);
+    atomic_store(&m_concurrent_dropped, 0);
+    atomic_store(&m_concurrent_max_used_slots, 0);
+#endif
     return true;
 }
 
-void logging_log_impl(logging_logger_t* logger, logging_level_t level, const char* file, int line, const char* fmt, ...) {
-    logger_impl_t* impl = GET_IMPL(logger);
-    const logging_level_t min_level = impl->level == LOGGING_LEVEL_DEFAULT ? m_init.default_level : impl->level;
-    if (level < min_level) {
+static void log_va(logging_logger_t* logger, logging_level_t level, const char* file, int line, const char* fmt, va_list args) {
+    stats_count_line(logger, level);
+#if LOGGING_DEFERRED
+    if (m_init.concurrent_buffer) {
+        log_concurrent(logger, level, file, line, fmt, args);
+        return;
+    } else if (m_init.deferred_buffer) {
+        log_deferred(logger, level, file, line, fmt, args);
         return;
     }
+#endif
 
-    if (m_init.lock_function) {
-        m_init.lock_function(true);
+    lock(true);
+
+    const uint32_t start_cycles = stats_start();
+    line_writer_t writer;
+    writer_init(&writer, m_write_buffer, sizeof(m_write_buffer));
+    format_line(&writer, &m_time_cache, m_init.time_ms_function ? m_init.time_ms_function() : 0, level, logger, file, line, fmt, args);
+    writer_end_line(&writer);
+    stats_end(logger, writer.length, start_cycles);
+    write_buffer(writer.buffer, level, logger);
+
+    lock(false);
+}
+
+static void log_fmt(logging_logger_t* logger, logging_level_t level, const char* file, int line, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    log_va(logger, level, file, line, fmt, args);
+    va_end(args);
+}
+
+// Refills a call site's bucket based on how much time has passed (1 token per second is 1 milli-token per ms)
+static void refill_bucket(site_impl_t* impl, uint32_t time_ms) {
+    const uint32_t max_milli_tokens = m_init.rate_limit_burst * MILLI_TOKENS_PER_TOKEN;
+    if (!impl->valid) {
+        // start with a full bucket
+        impl->valid = true;
+        impl->milli_tokens = max_milli_tokens;
+    } else {
+        const uint64_t refill = (uint64_t)(time_ms - impl->time_ms) * m_init.rate_limit_per_sec;
+        impl->milli_tokens = refill >= max_milli_tokens - impl->milli_tokens ? max_milli_tokens : impl->milli_tokens + (uint32_t)refill;
     }
+    impl->time_ms = time_ms;
+}
 
-    // time
-    if (m_init.time_ms_function) {
-        uint32_t current_time = m_init.time_ms_function();
-        const uint16_t ms = current_time % 1000;
-        current_time /= 1000;
-        const uint16_t sec = current_time % 60;
-        current_time /= 60;
-        const uint16_t min = current_time % 60;
-        current_time /= 60;
-        const uint16_t hours = current_time;
-        snprintf(m_write_buffer, FULL_LOG_MAX_LENGTH, "%3u:%02u:%02u.%03u ", hours, min, sec, ms);
+static void remove_suppressed_site(logging_site_t* site) {
+    for (logging_site_t** ptr = &m_suppressed_sites; *ptr; ptr = &((site_impl_t*)(*ptr)->_private)->next_suppressed) {
+        if (*ptr == site) {
+            site_impl_t* impl = (site_impl_t*)site->_private;
+            *ptr = impl->next_suppressed;
+            impl->next_suppressed = NULL;
+            return;
+        }
     }
+}
 
-    // level
-    snprintf(&m_write_buffer[strlen(m_write_buffer)], FULL_LOG_MAX_LENGTH-strlen(m_write_buffer), "%s", LEVEL_PREFIX[level]);
+// Takes a token from a call site's bucket, returning whether or not the line should be logged, along with the number of
+// lines which were suppressed since the last one which was
+static bool rate_limit(logging_site_t* site, logging_logger_t* logger, logging_level_t level, const char* file, int line, uint32_t* suppressed) {
+    *suppressed = 0;
+    if (!m_init.rate_limit_burst || !m_init.time_ms_function) {
+        return true;
+    }
+    site_impl_t* impl = (site_impl_t*)site->_private;
+    bool allowed = false;
+    lock(true);
+    refill_bucket(impl, m_init.time_ms_function());
+    if (impl->milli_tokens >= MILLI_TOKENS_PER_TOKEN) {
+        impl->milli_tokens -= MILLI_TOKENS_PER_TOKEN;
+        if (impl->suppressed) {
+            *suppressed = impl->suppressed;
+            impl->suppressed = 0;
+            remove_suppressed_site(site);
+        }
+        allowed = true;
+    } else if (impl->suppressed++ == 0) {
+        // track the site so its summary can be written once its bucket refills, even if it doesn't log again
+        impl->logger = logger;
+        impl->file = file;
+        impl->line = line;
+        impl->level = level;
+        impl->next_suppressed = m_suppressed_sites;
+        m_suppressed_sites = site;
+    }
+    lock(false);
+    return allowed;
+}
 
-    // module (if set)
-    if (logger->module_prefix) {
-        snprintf(&m_write_buffer[strlen(m_write_buffer)], FULL_LOG_MAX_LENGTH-strlen(m_write_buffer), "%s", logger->module_prefix);
+// Writes the summary for each call site whose bucket has refilled since it suppressed lines (without taking a token)
+static void flush_suppressed_sites(void) {
+    if (!m_suppressed_sites || !m_init.time_ms_function) {
+        return;
+    }
+    while (true) {
+        site_impl_t site;
+        bool found = false;
+        lock(true);
+        const uint32_t time_ms = m_init.time_ms_function();
+        for (logging_site_t* ptr = m_suppressed_sites; ptr; ptr = ((site_impl_t*)ptr->_private)->next_suppressed) {
+            site_impl_t* impl = (site_impl_t*)ptr->_private;
+            refill_bucket(impl, time_ms);
+            if (impl->milli_tokens >= MILLI_TOKENS_PER_TOKEN) {
+                site = *impl;
+                impl->suppressed = 0;
+                remove_suppressed_site(ptr);
+                found = true;
+                break;
+            }
+        }
+        lock(false);
+        if (!found) {
+            return;
+        }
+        // collapse the lines which were suppressed from this call site into a single line
+        log_fmt(site.logger, site.level, site.file, site.line, "suppressed %"PRIu32" similar messages", site.suppressed);
     }
+}
 
-    // file name
-    snprintf(&m_write_buffer[strlen(m_write_buffer)], FULL_LOG_MAX_LENGTH-strlen(m_write_buffer), "%s", file);
+void logging_flush_rate_limits(void) {
+    flush_suppressed_sites();
+}
 
-    // line number
-    snprintf(m_line_time_buffer, sizeof(m_line_time_buffer), ":%d: ", line);
-    snprintf(&m_write_buffer[strlen(m_write_buffer)], FULL_LOG_MAX_LENGTH-strlen(m_write_buffer), ":%d: ", line);
+void logging_log_impl(logging_logger_t* logger, logging_level_t level, const char* file, int line, const char* fmt, ...) {
+    if (level < get_effective_level(logger)) {
+        stats_count_filtered(logger);
+        return;
+    }
+    flush_suppressed_sites();
+    va_list args;
+    va_start(args, fmt);
+    log_va(logger, level, file, line, fmt, args);
+    va_end(args);
+}
 
-    // log message
+void logging_log_rate_limited_impl(logging_logger_t* logger, logging_site_t* site, logging_level_t level, const char* file, int line, const char* fmt, ...) {
+    if (level < get_effective_level(logger)) {
+        stats_count_filtered(logger);
+        return;
+    }
+    flush_suppressed_sites();
+    uint32_t suppressed;
+    if (!rate_limit(site, logger, level, file, line, &suppressed)) {
+        stats_count_filtered(logger);
+        return;
+    }
+    if (suppressed) {
+        // collapse the lines which were suppressed from this call site into a single line
+        log_fmt(logger, level, file, line, "suppressed %"PRIu32" similar messages", suppressed);
+    }
     va_list args;
     va_start(args, fmt);
-    vsnprintf(&m_write_buffer[strlen(m_write_buffer)], FULL_LOG_MAX_LENGTH-strlen(m_write_buffer), fmt, args);
+    log_va(logger, level, file, line, fmt, args);
     va_end(args);
+}
 
-    // newline
-    snprintf(&m_write_buffer[strlen(m_write_buffer)], FULL_LOG_MAX_LENGTH-strlen(m_write_buffer), "\n");
+void logging_log_tokenized_impl(logging_logger_t* logger, logging_level_t level, uint32_t token, uint32_t arg_types, ...) {
+    if (level < get_effective_level(logger)) {
+        stats_count_filtered(logger);
+        return;
+    } else if (!m_init.tokenized_write_function) {
+        return;
+    }
+    stats_count_line(logger, level);
 
-    if (m_init.write_function) {
-        m_init.write_function(m_write_buffer);
+    lock(true);
+
+    const uint32_t start_cycles = stats_start();
+
+    // the record is encoded after space for the length, which is then written immediately before it
+    uint8_t* const buffer = (uint8_t*)m_write_buffer;
+    uint32_t offset = ARGS_MAX_VARINT_LENGTH;
+    const bool has_time = m_init.time_ms_function != NULL;
+    buffer[offset++] = level | (has_time ? LOGGING_TOKENIZED_FLAG_HAS_TIME : 0);
+    for (uint32_t i = 0; i < sizeof(token); i++) {
+        buffer[offset++] = token >> (i * 8);
     }
-    if (m_init.raw_write_function) {
-        m_init.raw_write_function(level, logger->module_prefix, m_write_buffer);
+    if (has_time) {
+        offset += args_write_varint(&buffer[offset], m_init.time_ms_function());
     }
+    va_list args;
+    va_start(args, arg_types);
+    bool truncated;
+    offset += args_encode_typed(&buffer[offset], sizeof(m_write_buffer) - offset, arg_types, args, &truncated);
+    va_end(args);
 
-    if (m_init.lock_function) {
-        m_init.lock_function(false);
+    uint8_t length_buffer[ARGS_MAX_VARINT_LENGTH];
+    const uint32_t length_length = args_write_varint(length_buffer, offset - ARGS_MAX_VARINT_LENGTH);
+    uint8_t* const record = &buffer[ARGS_MAX_VARINT_LENGTH - length_length];
+    memcpy(record, length_buffer, length_length);
+    const uint32_t record_length = offset - ARGS_MAX_VARINT_LENGTH + length_length;
+    stats_end(logger, record_length, start_cycles);
+    m_init.tokenized_write_function(record, record_length);
+
+    lock(false);
+}
+
+uint32_t logging_tokenized_format_line(char* buffer, uint32_t size, const logging_tokenized_record_t* record, const char* entry, uint32_t entry_length) {
+    if (size < FULL_LOG_MAX_LENGTH || record->level <= LOGGING_LEVEL_DEFAULT || record->level > LOGGING_LEVEL_ERROR) {
+        return 0;
+    }
+    // split the entry into its fields
+    const char* line_str = memchr(entry, LOGGING_TOKEN_ENTRY_SEPARATOR, entry_length);
+    const char* fmt = line_str ? memchr(line_str + 1, LOGGING_TOKEN_ENTRY_SEPARATOR, entry_length - (line_str + 1 - entry)) : NULL;
+    if (!fmt) {
+        return 0;
+    }
+    char file[FILE_NAME_LENGTH * 2];
+    snprintf(file, sizeof(file), "%.*s", (int)(line_str - entry), entry);
+    const int line = atoi(line_str + 1);
+    fmt++;
+
+    line_writer_t writer;
+    writer_init(&writer, buffer, FULL_LOG_MAX_LENGTH);
+    time_cache_t time_cache = {0};
+    format_prefix(&writer, &time_cache, record->has_time, record->time_ms, record->level, NULL, file, line);
+    writer_advance(&writer, args_format(&buffer[writer.length], writer_available(&writer), fmt, record->args, record->args_length));
+    writer_end_line(&writer);
+    return writer.length;
+}
+
+#if LOGGING_DEFERRED
+uint32_t logging_process_deferred(uint32_t max_records) {
+    if (m_init.concurrent_buffer) {
+        return process_concurrent(max_records);
+    } else if (!m_init.deferred_buffer) {
+        return 0;
+    }
+    uint32_t num_records = 0;
+    while (!max_records || num_records < max_records) {
+        uint32_t tail = atomic_load_explicit(&m_deferred_tail, memory_order_acquire);
+        const uint32_t head = atomic_load_explicit(&m_deferred_head, memory_order_acquire);
+        if (tail == head) {
+            break;
+        }
+        // copy the record out before claiming it, as a producer might drop it (and overwrite it) in the meantime, in
+        // which case the copy is discarded
+        deferred_record_t record;
+        ring_copy_out(m_init.deferred_buffer, m_init.deferred_buffer_size, tail, &record, sizeof(record));
+        uint32_t args_length = record.length - sizeof(record);
+        if (record.length < sizeof(record) || args_length > sizeof(m_deferred_args_buffer)) {
+            args_length = 0;
+        }
+        ring_copy_out(m_init.deferred_buffer, m_init.deferred_buffer_size, tail + sizeof(record), m_deferred_args_buffer, args_length);
+        if (!atomic_compare_exchange_strong_explicit(&m_deferred_tail, &tail, tail + record.length, memory_order_acq_rel, memory_order_acquire)) {
+            continue;
+        }
+
+        const uint32_t start_cycles = stats_start();
+        line_writer_t writer;
+        writer_init(&writer, m_deferred_write_buffer, sizeof(m_deferred_write_buffer));
+        format_prefix(&writer, &m_deferred_time_cache, m_init.time_ms_function != NULL, record.time_ms, record.level, record.logger->module_prefix, record.file, record.line);
+        writer_advance(&writer, args_format(&m_deferred_write_buffer[writer.length], writer_available(&writer), record.fmt, m_deferred_args_buffer, args_length));
+        writer_end_line(&writer);
+        stats_end(record.logger, writer.length, start_cycles);
+        write_buffer(writer.buffer, record.level, record.logger);
+        num_records++;
+    }
+    return num_records;
+}
+
+void logging_deferred_get_and_clear_stats(logging_deferred_stats_t* stats) {
+    if (m_init.concurrent_buffer) {
+        *stats = (logging_deferred_stats_t){
+            .records = atomic_exchange_explicit(&m_concurrent_records, 0, memory_order_relaxed),
+            .dropped = atomic_exchange_explicit(&m_concurrent_dropped, 0, memory_order_relaxed),
+            .max_used = atomic_exchange_explicit(&m_concurrent_max_used_slots, 0, memory_order_relaxed) * _LOGGING_CONCURRENT_SLOT_SIZE,
+        };
+        return;
     }
+    lock(true);
+    *stats = m_deferred_stats;
+    memset(&m_deferred_stats, 0, sizeof(m_deferred_stats));
+    lock(false);
 }
+#endif
 
 void logging_set_level_impl(logging_logger_t* logger, logging_level_t level) {
+    lock(true);
     GET_IMPL(logger)->level = level;
+    if (logger->_effective_level != LOGGING_LEVEL_DEFAULT) {
+        logger->_effective_level = level == LOGGING_LEVEL_DEFAULT ? m_init.default_level : level;
+    }
+    lock(false);
+}
+
+bool logging_add_sink(logging_sink_handle_t handle, const logging_sink_init_t* init) {
+    if (!init->write_function || init->level == LOGGING_LEVEL_DEFAULT || init->level > LOGGING_LEVEL_ERROR) {
+        return false;
+    }
+#if LOGGING_DEFERRED
+    if (init->policy != LOGGING_SINK_POLICY_SYNC) {
+        const uint32_t size = handle->buffer_size;
+        if (size < sizeof(sink_record_t) || (size & (size - 1))) {
+            return false;
+        }
+    }
+#else
+    if (init->policy != LOGGING_SINK_POLICY_SYNC) {
+        return false;
+    }
+#endif
+    lock(true);
+    // add it to the end of the list so the sinks are written to in the order they were added
+    logging_sink_handle_t* next_ptr = &m_sinks;
+    while (*next_ptr) {
+        if (*next_ptr == handle) {
+            // it's already registered (and re-initializing it would corrupt the list)
+            lock(false);
+            return false;
+        }
+        next_ptr = &GET_SINK_IMPL(*next_ptr)->next;
+    }
+    sink_impl_t* impl = GET_SINK_IMPL(handle);
+    memset(impl, 0, sizeof(*impl));
+    impl->init = *init;
+    *next_ptr = handle;
+    lock(false);
+    return true;
+}
+
+bool logging_remove_sink(logging_sink_handle_t handle) {
+    bool found = false;
+    lock(true);
+    for (logging_sink_handle_t* next_ptr = &m_sinks; *next_ptr; next_ptr = &GET_SINK_IMPL(*next_ptr)->next) {
+        if (*next_ptr == handle) {
+            *next_ptr = GET_SINK_IMPL(handle)->next;
+            GET_SINK_IMPL(handle)->next = NULL;
+            found = true;
+            break;
+        }
+    }
+    lock(false);
+    return found;
+}
+
+#if LOGGING_DEFERRED
+uint32_t logging_process_sink(logging_sink_handle_t handle, uint32_t max_lines) {
+    sink_impl_t* impl = GET_SINK_IMPL(handle);
+    if (impl->init.policy == LOGGING_SINK_POLICY_SYNC) {
+        return 0;
+    }
+    uint32_t num_lines = 0;
+    char line[FULL_LOG_MAX_LENGTH];
+    while (!max_lines || num_lines < max_lines) {
+        uint32_t tail = atomic_load_explicit(&impl->tail, memory_order_acquire);
+        const uint32_t head = atomic_load_explicit(&impl->head, memory_order_acquire);
+        if (tail == head) {
+            break;
+        }
+        // copy the line out before claiming it, as it might be dropped in the meantime (see logging_process_deferred())
+        sink_record_t record;
+        ring_copy_out(handle->buffer, handle->buffer_size, tail, &record, sizeof(record));
+        uint32_t line_length = record.length - sizeof(record);
+        if (record.length < sizeof(record) || line_length > sizeof(line)) {
+            line_length = 0;
+        }
+        ring_copy_out(handle->buffer, handle->buffer_size, tail + sizeof(record), line, line_length);
+        if (!atomic_compare_exchange_strong_explicit(&impl->tail, &tail, tail + record.length, memory_order_acq_rel, memory_order_acquire)) {
+            continue;
+        }
+        if (line_length) {
+            line[line_length - 1] = '\0';
+            impl->init.write_function(record.level, record.logger->module_prefix, line);
+        }
+        num_lines++;
+    }
+    return num_lines;
+}
+
+void logging_sink_get_and_clear_stats(logging_sink_handle_t handle, logging_deferred_stats_t* stats) {
+    sink_impl_t* impl = GET_SINK_IMPL(handle);
+    lock(true);
+    *stats = impl->stats;
+    memset(&impl->stats, 0, sizeof(impl->stats));
+    lock(false);
+}
+#endif
+
+#if LOGGING_STATS
+uint32_t logging_get_and_clear_module_stats(logging_module_stats_t* stats, uint32_t max_modules) {
+    uint32_t num_modules = 0;
+    lock(true);
+    for (logging_logger_t* logger = m_cached_loggers; logger; logger = GET_IMPL(logger)->next) {
+        // combine the files which belong to the same module
+        logging_module_stats_t* entry = NULL;
+        for (uint32_t i = 0; i < num_modules; i++) {
+            const char* module_prefix = stats[i].module_prefix;
+            if (module_prefix == logger->module_prefix ||
+                    (module_prefix && logger->module_prefix && !strcmp(module_prefix, logger->module_prefix))) {
+                entry = &stats[i];
+                break;
+            }
+        }
+        if (!entry) {
+            if (num_modules == max_modules) {
+                // leave the stats for the next call
+                continue;
+            }
+            entry = &stats[num_modules++];
+            memset(entry, 0, sizeof(*entry));
+            entry->module_prefix = logger->module_prefix;
+        }
+        const logging_stats_t* logger_stats = &logger->_stats;
+        for (uint32_t i = 0; i < sizeof(logger_stats->lines) / sizeof(logger_stats->lines[0]); i++) {
+            entry->stats.lines[i] += logger_stats->lines[i];
+        }
+        entry->stats.filtered += logger_stats->filtered;
+        entry->stats.bytes += logger_stats->bytes;
+        entry->stats.format_cycles += logger_stats->format_cycles;
+        memset(&logger->_stats, 0, sizeof(logger->_stats));
+    }
+    lock(false);
+    return num_modules;
 }
+#endif
@@ -0,0 +1,45 @@
+#include "anchor/logging/tokenized.h"
+
+#include "args.h"
+
+#define HASH_COEFFICIENT 65599
+
+uint32_t logging_token_hash(const char* str, uint32_t length) {
+    uint32_t hash = length;
+    uint32_t coefficient = 1;
+    for (uint32_t i = 0; i < length && i < LOGGING_TOKEN_HASH_LENGTH; i++) {
+        hash += coefficient * (uint8_t)str[i];
+        coefficient *= HASH_COEFFICIENT;
+    }
+    return hash;
+}
+
+uint32_t logging_tokenized_parse_record(const uint8_t* data, uint32_t length, logging_tokenized_record_t* record) {
+    uint64_t record_length;
+    const uint32_t length_length = args_read_varint(data, length, &record_length);
+    if (!length_length || record_length > length - length_length || record_length < sizeof(uint8_t) + sizeof(uint32_t)) {
+        return 0;
+    }
+    const uint8_t* const end = &data[length_length + record_length];
+    data += length_length;
+    record->level = *data & LOGGING_TOKENIZED_LEVEL_MASK;
+    record->has_time = *data & LOGGING_TOKENIZED_FLAG_HAS_TIME;
+    data++;
+    record->token = 0;
+    for (uint32_t i = 0; i < sizeof(record->token); i++) {
+        record->token |= (uint32_t)*data++ << (i * 8);
+    }
+    record->time_ms = 0;
+    if (record->has_time) {
+        uint64_t time_ms;
+        const uint32_t time_length = args_read_varint(data, end - data, &time_ms);
+        if (!time_length) {
+            return 0;
+        }
+        record->time_ms = time_ms;
+        data += time_length;
+    }
+    record->args = data;
+    record->args_length = end - data;
+    return length_length + record_length;
+}
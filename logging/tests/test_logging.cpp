@@ -0,0 +1,498 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define LOGGING_MODULE_NAME "TEST"
+#include "anchor/logging/logging.h"
+
+extern "C" {
+
+#include "src/args.h"
+
+};
+
+static std::vector<std::string> m_lines;
+static uint32_t m_time_ms;
+
+static void write_function(const char* str) {
+  m_lines.push_back(str);
+}
+
+static uint32_t time_ms_function(void) {
+  return m_time_ms;
+}
+
+static std::string format_args(const char* fmt, ...) {
+  uint8_t encoded[128];
+  va_list args;
+  va_start(args, fmt);
+  bool truncated;
+  const uint32_t length = args_encode(encoded, sizeof(encoded), fmt, args, &truncated);
+  va_end(args);
+  EXPECT_FALSE(truncated);
+  char buffer[128];
+  args_format(buffer, sizeof(buffer), fmt, encoded, length);
+  return buffer;
+}
+
+static std::string expected_line(const char* level, int line, const char* msg) {
+  char buffer[256];
+  snprintf(buffer, sizeof(buffer), "  0:00:01.234 %sTEST:test_logging.cpp:%d: %s\n", level, line, msg);
+  return buffer;
+}
+
+class LoggingTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    m_lines.clear();
+    m_time_ms = 1234;
+    Init(nullptr, 0, LOGGING_DEFERRED_DROP_NEWEST);
+  }
+
+  void Init(uint8_t* deferred_buffer, uint32_t deferred_buffer_size, logging_deferred_drop_policy_t policy) {
+    const logging_init_t init = {
+      .write_function = write_function,
+      .raw_write_function = nullptr,
+      .lock_function = nullptr,
+      .time_ms_function = time_ms_function,
+      .default_level = LOGGING_LEVEL_INFO,
+      .deferred_buffer = deferred_buffer,
+      .deferred_buffer_size = deferred_buffer_size,
+      .deferred_drop_policy = policy,
+    };
+    ASSERT_TRUE(logging_init(&init));
+  }
+};
+
+TEST_F(LoggingTest, Basic) {
+  const int line = __LINE__ + 1;
+  LOG_INFO("value=%d", 5);
+  LOG_DEBUG("filtered");
+  ASSERT_EQ(m_lines.size(), 1);
+  EXPECT_EQ(m_lines[0], expected_line("INFO  ", line, "value=5"));
+}
+
+TEST_F(LoggingTest, Format) {
+  // the cached part of the time should be updated when the second changes
+  m_time_ms = 3600 * 1000 * 123 + 59 * 60 * 1000 + 59 * 1000 + 999;
+  LOG_INFO("a");
+  m_time_ms++;
+  LOG_INFO("b");
+  m_time_ms += 1;
+  LOG_INFO("c");
+  ASSERT_EQ(m_lines.size(), 3);
+  EXPECT_EQ(m_lines[0].substr(0, 13), "123:59:59.999");
+  EXPECT_EQ(m_lines[1].substr(0, 13), "124:00:00.000");
+  EXPECT_EQ(m_lines[2].substr(0, 13), "124:00:00.001");
+
+  // long messages should be truncated, but still end with a newline
+  const std::string long_msg(LOGGING_MAX_MSG_LENGTH * 2, 'x');
+  LOG_INFO("%s", long_msg.c_str());
+  ASSERT_EQ(m_lines.size(), 4);
+  EXPECT_EQ(m_lines[3].back(), '\n');
+  EXPECT_LT(m_lines[3].size(), long_msg.size());
+  EXPECT_GE(m_lines[3].size(), LOGGING_MAX_MSG_LENGTH);
+}
+
+TEST_F(LoggingTest, SetLevel) {
+  int num_evaluated = 0;
+  auto evaluate = [&](int value) {
+    num_evaluated++;
+    return value;
+  };
+  // the arguments of a filtered line shouldn't be evaluated once the logger's level is cached
+  LOG_INFO("%d", evaluate(1));
+  LOG_DEBUG("%d", evaluate(2));
+  EXPECT_EQ(num_evaluated, 1);
+  EXPECT_EQ(m_lines.size(), 1);
+
+  LOG_SET_LEVEL(LOGGING_LEVEL_DEBUG);
+  LOG_DEBUG("%d", evaluate(3));
+  EXPECT_EQ(num_evaluated, 2);
+  EXPECT_EQ(m_lines.size(), 2);
+
+  LOG_SET_LEVEL(LOGGING_LEVEL_ERROR);
+  LOG_WARN("%d", evaluate(4));
+  EXPECT_EQ(num_evaluated, 2);
+  EXPECT_EQ(m_lines.size(), 2);
+
+  // going back to the default level
+  LOG_SET_LEVEL(LOGGING_LEVEL_DEFAULT);
+  LOG_INFO("%d", evaluate(5));
+  LOG_DEBUG("%d", evaluate(6));
+  EXPECT_EQ(num_evaluated, 3);
+  EXPECT_EQ(m_lines.size(), 3);
+
+  // the cached level should be invalidated when the default level changes
+  const logging_init_t init = {
+    .write_function = write_function,
+    .raw_write_function = nullptr,
+    .lock_function = nullptr,
+    .time_ms_function = time_ms_function,
+    .default_level = LOGGING_LEVEL_DEBUG,
+  };
+  ASSERT_TRUE(logging_init(&init));
+  LOG_DEBUG("%d", evaluate(7));
+  EXPECT_EQ(num_evaluated, 4);
+  EXPECT_EQ(m_lines.size(), 4);
+}
+
+TEST_F(LoggingTest, Args) {
+  char str[] = "abc";
+  EXPECT_EQ(format_args("no args"), "no args");
+  EXPECT_EQ(format_args("%d %i %u %x %X %o", -5, 7, 4000000000u, 0xbeef, 0xbeef, 8), "-5 7 4000000000 beef BEEF 10");
+  EXPECT_EQ(format_args("%hhu %hd %ld %lld %llx", 300, 70000, -1L, -2LL, 0x123456789abcULL), "44 4464 -1 -2 123456789abc");
+  EXPECT_EQ(format_args("%zu %" PRIu64 " %" PRId32, (size_t)12, UINT64_MAX, INT32_MIN), "12 18446744073709551615 -2147483648");
+  EXPECT_EQ(format_args("[%5d] [%-5d] [%05d] [%+d] [%*d] [%-*d]", 1, 2, 3, 4, 3, 5, 3, 6), "[    1] [2    ] [00003] [+4] [  5] [6  ]");
+  EXPECT_EQ(format_args("[%*d] [%.*s]", -3, 7, 2, str), "[7  ] [ab]");
+  EXPECT_EQ(format_args("%.2f %e %g", 3.14159, 1e10, 0.5f), "3.14 1.000000e+10 0.5");
+  EXPECT_EQ(format_args("%s %c %% %s", str, 'z', (const char*)nullptr), "abc z % (null)");
+
+  // arguments which don't fit are dropped, and formatting stops at the first one
+  uint8_t encoded[4];
+  bool truncated;
+  uint32_t length;
+  [&](const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    length = args_encode(encoded, sizeof(encoded), fmt, args, &truncated);
+    va_end(args);
+  }("%d %s %d", 1, "abcdef", 2);
+  EXPECT_TRUE(truncated);
+  char buffer[32];
+  args_format(buffer, sizeof(buffer), "%d %s %d", encoded, length);
+  EXPECT_STREQ(buffer, "1 ab ");
+
+  // a string with a precision only needs to be terminated if it's shorter than the precision
+  const struct {
+    char str[4];
+    char guard[4];
+  } unterminated = {{'w', 'x', 'y', 'z'}, {'!', '!', '!', '\0'}};
+  uint8_t unterminated_encoded[16];
+  [&](const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    length = args_encode(unterminated_encoded, sizeof(unterminated_encoded), fmt, args, &truncated);
+    va_end(args);
+  }("[%.4s] [%.*s] [%.8s]", unterminated.str, 2, unterminated.str, str);
+  EXPECT_FALSE(truncated);
+  // each string is encoded with a terminator, along with the precision argument
+  EXPECT_EQ(length, 5 + 1 + 3 + 4);
+  args_format(buffer, sizeof(buffer), "[%.4s] [%.*s] [%.8s]", unterminated_encoded, length);
+  EXPECT_STREQ(buffer, "[wxyz] [wx] [abc]");
+}
+
+TEST_F(LoggingTest, Deferred) {
+  uint8_t deferred_buffer[1024];
+  Init(deferred_buffer, sizeof(deferred_buffer), LOGGING_DEFERRED_DROP_NEWEST);
+  char str[] = "hello";
+  const int line = __LINE__ + 1;
+  LOG_INFO("%s %d %.1f", str, 42, 2.5);
+  LOG_DEBUG("filtered");
+  m_time_ms = 2000;
+  LOG_ERROR("error %s", "here");
+  // the string is copied, so changing it shouldn't affect the log
+  str[0] = 'j';
+  EXPECT_EQ(m_lines.size(), 0);
+
+  EXPECT_EQ(logging_process_deferred(1), 1);
+  ASSERT_EQ(m_lines.size(), 1);
+  EXPECT_EQ(m_lines[0], expected_line("INFO  ", line, "hello 42 2.5"));
+  EXPECT_EQ(logging_process_deferred(0), 1);
+  ASSERT_EQ(m_lines.size(), 2);
+  // the time is captured when the line is logged rather than when it's written
+  EXPECT_EQ(m_lines[1].substr(0, 13), "  0:00:02.000");
+  EXPECT_EQ(logging_process_deferred(0), 0);
+
+  logging_deferred_stats_t stats;
+  logging_deferred_get_and_clear_stats(&stats);
+  EXPECT_EQ(stats.records, 2);
+  EXPECT_EQ(stats.dropped, 0);
+  EXPECT_GT(stats.max_used, 0);
+}
+
+TEST_F(LoggingTest, DeferredDropNewest) {
+  uint8_t deferred_buffer[256];
+  Init(deferred_buffer, sizeof(deferred_buffer), LOGGING_DEFERRED_DROP_NEWEST);
+  for (int i = 0; i < 20; i++) {
+    LOG_INFO("%d", i);
+  }
+  logging_deferred_stats_t stats;
+  logging_deferred_get_and_clear_stats(&stats);
+  EXPECT_GT(stats.dropped, 0);
+  EXPECT_EQ(stats.records + stats.dropped, 20);
+  EXPECT_LE(stats.max_used, sizeof(deferred_buffer));
+
+  // the oldest records should have been kept
+  EXPECT_EQ(logging_process_deferred(0), stats.records);
+  ASSERT_EQ(m_lines.size(), stats.records);
+  EXPECT_EQ(m_lines.front().back(), '\n');
+  EXPECT_NE(m_lines.front().find(": 0\n"), std::string::npos);
+
+  // there should be room again
+  LOG_INFO("again");
+  EXPECT_EQ(logging_process_deferred(0), 1);
+}
+
+TEST_F(LoggingTest, DeferredDropOldest) {
+  uint8_t deferred_buffer[256];
+  Init(deferred_buffer, sizeof(deferred_buffer), LOGGING_DEFERRED_DROP_OLDEST);
+  for (int i = 0; i < 20; i++) {
+    LOG_INFO("%d", i);
+  }
+  logging_deferred_stats_t stats;
+  logging_deferred_get_and_clear_stats(&stats);
+  EXPECT_GT(stats.dropped, 0);
+  EXPECT_EQ(stats.records, 20);
+
+  // the newest records should have been kept
+  EXPECT_EQ(logging_process_deferred(0), 20 - stats.dropped);
+  ASSERT_EQ(m_lines.size(), 20 - stats.dropped);
+  EXPECT_NE(m_lines.back().find(": 19\n"), std::string::npos);
+}
+
+TEST_F(LoggingTest, DeferredInvalidSize) {
+  uint8_t deferred_buffer[100];
+  const logging_init_t init = {
+    .write_function = write_function,
+    .raw_write_function = nullptr,
+    .lock_function = nullptr,
+    .time_ms_function = time_ms_function,
+    .default_level = LOGGING_LEVEL_INFO,
+    .deferred_buffer = deferred_buffer,
+    .deferred_buffer_size = sizeof(deferred_buffer),
+  };
+  EXPECT_FALSE(logging_init(&init));
+}
+
+static std::atomic<uint32_t> m_atomic_time_ms;
+
+static uint32_t atomic_time_ms_function(void) {
+  return m_atomic_time_ms++;
+}
+
+TEST_F(LoggingTest, Concurrent) {
+  static uintptr_t concurrent_buffer[LOGGING_CONCURRENT_BUFFER_SIZE(4)];
+  logging_init_t init = {
+    .write_function = write_function,
+    .raw_write_function = nullptr,
+    .lock_function = nullptr,
+    .time_ms_function = time_ms_function,
+    .default_level = LOGGING_LEVEL_INFO,
+    .concurrent_buffer = concurrent_buffer,
+    .concurrent_num_slots = 3,
+  };
+  // the number of slots must be a power of 2
+  EXPECT_FALSE(logging_init(&init));
+  init.concurrent_num_slots = 4;
+  ASSERT_TRUE(logging_init(&init));
+
+  const int line = __LINE__ + 1;
+  LOG_INFO("value=%d", 1);
+  LOG_DEBUG("filtered");
+  EXPECT_EQ(m_lines.size(), 0);
+  EXPECT_EQ(logging_process_deferred(0), 1);
+  ASSERT_EQ(m_lines.size(), 1);
+  EXPECT_EQ(m_lines[0], expected_line("INFO  ", line, "value=1"));
+
+  // lines are dropped once all the slots are used
+  for (int i = 0; i < 6; i++) {
+    LOG_INFO("%d", i);
+  }
+  logging_deferred_stats_t stats;
+  logging_deferred_get_and_clear_stats(&stats);
+  EXPECT_EQ(stats.records, 5);
+  EXPECT_EQ(stats.dropped, 2);
+  EXPECT_EQ(stats.max_used, sizeof(concurrent_buffer));
+  EXPECT_EQ(logging_process_deferred(3), 3);
+  EXPECT_EQ(logging_process_deferred(0), 1);
+  ASSERT_EQ(m_lines.size(), 5);
+  EXPECT_NE(m_lines[4].find(": 3\n"), std::string::npos);
+}
+
+TEST_F(LoggingTest, ConcurrentThreads) {
+  static uintptr_t concurrent_buffer[LOGGING_CONCURRENT_BUFFER_SIZE(64)];
+  const logging_init_t init = {
+    .write_function = write_function,
+    .raw_write_function = nullptr,
+    .lock_function = nullptr,
+    .time_ms_function = atomic_time_ms_function,
+    .default_level = LOGGING_LEVEL_INFO,
+    .concurrent_buffer = concurrent_buffer,
+    .concurrent_num_slots = 64,
+  };
+  ASSERT_TRUE(logging_init(&init));
+  m_atomic_time_ms = 0;
+  // cache the level before the threads start, as there's no lock function
+  LOG_DEBUG("filtered");
+
+  const int kNumThreads = 4;
+  const int kNumLines = 2000;
+  std::atomic<int> num_done(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([i, &num_done]() {
+      for (int j = 0; j < kNumLines; j++) {
+        LOG_INFO("%d %d", i, j);
+      }
+      num_done++;
+    });
+  }
+  while (num_done < kNumThreads) {
+    logging_process_deferred(0);
+  }
+  logging_process_deferred(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  logging_deferred_stats_t stats;
+  logging_deferred_get_and_clear_stats(&stats);
+  EXPECT_EQ(stats.records + stats.dropped, kNumThreads * kNumLines);
+  ASSERT_EQ(m_lines.size(), stats.records);
+
+  // the lines from each thread should be in order, and the timestamps should be in order across all of them
+  int last_line[kNumThreads];
+  for (int i = 0; i < kNumThreads; i++) {
+    last_line[i] = -1;
+  }
+  int last_time = -1;
+  for (const std::string& line : m_lines) {
+    unsigned int hours, min, sec, ms;
+    int thread, index;
+    ASSERT_EQ(sscanf(line.c_str(), "%u:%u:%u.%u", &hours, &min, &sec, &ms), 4);
+    ASSERT_EQ(sscanf(line.substr(line.rfind(": ") + 2).c_str(), "%d %d", &thread, &index), 2);
+    const int time = ((hours * 60 + min) * 60 + sec) * 1000 + ms;
+    EXPECT_GT(time, last_time);
+    last_time = time;
+    ASSERT_GE(thread, 0);
+    ASSERT_LT(thread, kNumThreads);
+    EXPECT_GT(index, last_line[thread]);
+    last_line[thread] = index;
+  }
+}
+
+static std::vector<std::string> m_uart_lines;
+static std::vector<std::string> m_ram_lines;
+static std::vector<std::string> m_file_lines;
+
+static void uart_write_function(logging_level_t level, const char* module_name, const char* str) {
+  EXPECT_EQ(level, LOGGING_LEVEL_ERROR);
+  EXPECT_STREQ(module_name, "TEST:");
+  m_uart_lines.push_back(str);
+}
+
+static void ram_write_function(logging_level_t level, const char* module_name, const char* str) {
+  m_ram_lines.push_back(str);
+}
+
+static void file_write_function(logging_level_t level, const char* module_name, const char* str) {
+  EXPECT_GE(level, LOGGING_LEVEL_INFO);
+  m_file_lines.push_back(str);
+}
+
+LOGGING_SINK_DEF(m_uart_sink, 1);
+LOGGING_SINK_DEF(m_ram_sink, 256);
+LOGGING_SINK_DEF(m_file_sink, 1024);
+
+TEST_F(LoggingTest, Sinks) {
+  m_uart_lines.clear();
+  m_ram_lines.clear();
+  m_file_lines.clear();
+  const logging_init_t init = {
+    .write_function = nullptr,
+    .raw_write_function = nullptr,
+    .lock_function = nullptr,
+    .time_ms_function = time_ms_function,
+    .default_level = LOGGING_LEVEL_DEBUG,
+  };
+  ASSERT_TRUE(logging_init(&init));
+
+  const logging_sink_init_t uart_init = {
+    .level = LOGGING_LEVEL_ERROR,
+    .policy = LOGGING_SINK_POLICY_SYNC,
+    .write_function = uart_write_function,
+  };
+  ASSERT_TRUE(logging_add_sink(m_uart_sink, &uart_init));
+  const logging_sink_init_t ram_init = {
+    .level = LOGGING_LEVEL_DEBUG,
+    .policy = LOGGING_SINK_POLICY_DEFERRED_DROP_OLDEST,
+    .write_function = ram_write_function,
+  };
+  ASSERT_TRUE(logging_add_sink(m_ram_sink, &ram_init));
+  const logging_sink_init_t file_init = {
+    .level = LOGGING_LEVEL_INFO,
+    .policy = LOGGING_SINK_POLICY_DEFERRED_DROP_NEWEST,
+    .write_function = file_write_function,
+  };
+  ASSERT_TRUE(logging_add_sink(m_file_sink, &file_init));
+  // a deferred sink needs a valid buffer
+  ASSERT_FALSE(logging_add_sink(m_uart_sink, &ram_init));
+
+  const int line = __LINE__ + 1;
+  LOG_DEBUG("debug");
+  LOG_INFO("info");
+  LOG_ERROR("error");
+  // only the synchronous sink should have been written to so far
+  ASSERT_EQ(m_uart_lines.size(), 1);
+  EXPECT_EQ(m_uart_lines[0], expected_line("ERROR ", line + 2, "error"));
+  EXPECT_EQ(m_ram_lines.size(), 0);
+  EXPECT_EQ(m_file_lines.size(), 0);
+
+  // each deferred sink is processed independently
+  EXPECT_EQ(logging_process_sink(m_file_sink, 0), 2);
+  ASSERT_EQ(m_file_lines.size(), 2);
+  EXPECT_EQ(m_file_lines[0], expected_line("INFO  ", line + 1, "info"));
+  EXPECT_EQ(m_ram_lines.size(), 0);
+  EXPECT_EQ(logging_process_sink(m_ram_sink, 1), 1);
+  ASSERT_EQ(m_ram_lines.size(), 1);
+  EXPECT_EQ(m_ram_lines[0], expected_line("DEBUG ", line, "debug"));
+  EXPECT_EQ(logging_process_sink(m_ram_sink, 0), 2);
+  EXPECT_EQ(logging_process_sink(m_uart_sink, 0), 0);
+
+  // the RAM sink should keep the newest lines when it fills up, without affecting the other sinks
+  for (int i = 0; i < 20; i++) {
+    LOG_DEBUG("%d", i);
+  }
+  logging_deferred_stats_t stats;
+  logging_sink_get_and_clear_stats(m_ram_sink, &stats);
+  EXPECT_EQ(stats.records, 23);
+  EXPECT_GT(stats.dropped, 0);
+  m_ram_lines.clear();
+  EXPECT_EQ(logging_process_sink(m_ram_sink, 0), 20 - stats.dropped);
+  EXPECT_NE(m_ram_lines.back().find(": 19\n"), std::string::npos);
+  logging_sink_get_and_clear_stats(m_file_sink, &stats);
+  EXPECT_EQ(stats.records, 2);
+  EXPECT_EQ(stats.dropped, 0);
+
+  // the file sink should drop new lines when it's not being processed
+  for (int i = 0; i < 20; i++) {
+    LOG_INFO("%d", i);
+  }
+  logging_sink_get_and_clear_stats(m_file_sink, &stats);
+  EXPECT_GT(stats.dropped, 0);
+  EXPECT_EQ(stats.records + stats.dropped, 20);
+  m_file_lines.clear();
+  EXPECT_EQ(logging_process_sink(m_file_sink, 0), stats.records);
+  EXPECT_NE(m_file_lines.front().find(": 0\n"), std::string::npos);
+  EXPECT_EQ(m_uart_lines.size(), 1);
+
+  // a sink can only be registered once
+  EXPECT_FALSE(logging_add_sink(m_uart_sink, &uart_init));
+  LOG_ERROR("error");
+  EXPECT_EQ(m_uart_lines.size(), 2);
+
+  // a removed sink should no longer be written to, and can be added again
+  EXPECT_TRUE(logging_remove_sink(m_uart_sink));
+  EXPECT_FALSE(logging_remove_sink(m_uart_sink));
+  LOG_ERROR("error");
+  EXPECT_EQ(m_uart_lines.size(), 2);
+  m_file_lines.clear();
+  EXPECT_EQ(logging_process_sink(m_file_sink, 0), 2);
+  EXPECT_TRUE(logging_add_sink(m_uart_sink, &uart_init));
+  LOG_ERROR("error");
+  EXPECT_EQ(m_uart_lines.size(), 3);
+}
@@ -0,0 +1,46 @@
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#define LOGGING_MODULE_NAME "MIN"
+#define LOGGING_COMPILE_MIN_LEVEL 3
+#include "anchor/logging/logging.h"
+
+static std::vector<std::string> m_lines;
+static int m_num_evaluated;
+
+static void write_function(const char* str) {
+  m_lines.push_back(str);
+}
+
+static int evaluate(int value) {
+  m_num_evaluated++;
+  return value;
+}
+
+TEST(LoggingMinLevelTest, CompiledOut) {
+  m_lines.clear();
+  m_num_evaluated = 0;
+  const logging_init_t init = {
+    .write_function = write_function,
+    .raw_write_function = nullptr,
+    .lock_function = nullptr,
+    .time_ms_function = nullptr,
+    .default_level = LOGGING_LEVEL_DEBUG,
+  };
+  ASSERT_TRUE(logging_init(&init));
+
+  // the levels below the compile-time min level shouldn't evaluate their arguments, even though they're enabled
+  LOG_DEBUG("%d", evaluate(1));
+  LOG_INFO("%d", evaluate(2));
+  EXPECT_EQ(m_num_evaluated, 0);
+  EXPECT_EQ(m_lines.size(), 0);
+
+  const int line = __LINE__ + 1;
+  LOG_WARN("%d", evaluate(3));
+  LOG_ERROR("%d", evaluate(4));
+  EXPECT_EQ(m_num_evaluated, 2);
+  ASSERT_EQ(m_lines.size(), 2);
+  EXPECT_EQ(m_lines[0], "WARN  MIN:test_logging_min_level.cpp:" + std::to_string(line) + ": 3\n");
+}
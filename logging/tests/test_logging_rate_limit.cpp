@@ -0,0 +1,133 @@
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#define LOGGING_MODULE_NAME "RATE"
+#define LOGGING_RATE_LIMIT 1
+#include "anchor/logging/logging.h"
+
+static std::vector<std::string> m_lines;
+static uint32_t m_time_ms;
+
+static void write_function(const char* str) {
+  m_lines.push_back(str);
+}
+
+static uint32_t time_ms_function(void) {
+  return m_time_ms;
+}
+
+static void log_storm(int value) {
+  LOG_ERROR("Invalid packet: bad CRC (%d)", value);
+}
+
+static void log_other(void) {
+  LOG_ERROR("Other");
+}
+
+class LoggingRateLimitTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    m_lines.clear();
+    m_time_ms = 1000;
+    Init(3, 2);
+  }
+
+  void Init(uint32_t burst, uint32_t per_sec) {
+    const logging_init_t init = {
+      .write_function = write_function,
+      .raw_write_function = nullptr,
+      .lock_function = nullptr,
+      .time_ms_function = time_ms_function,
+      .default_level = LOGGING_LEVEL_INFO,
+      .rate_limit_burst = burst,
+      .rate_limit_per_sec = per_sec,
+    };
+    ASSERT_TRUE(logging_init(&init));
+  }
+};
+
+TEST_F(LoggingRateLimitTest, Burst) {
+  // only the burst should be logged
+  for (int i = 0; i < 100; i++) {
+    log_storm(i);
+  }
+  ASSERT_EQ(m_lines.size(), 3);
+  EXPECT_NE(m_lines[2].find("bad CRC (2)\n"), std::string::npos);
+
+  // each call site is limited separately
+  log_other();
+  ASSERT_EQ(m_lines.size(), 4);
+
+  // after 500ms, there should be a token for one more line, which is preceded by the number which were suppressed
+  m_time_ms += 499;
+  log_storm(100);
+  EXPECT_EQ(m_lines.size(), 4);
+  m_time_ms += 1;
+  log_storm(101);
+  ASSERT_EQ(m_lines.size(), 6);
+  EXPECT_NE(m_lines[4].find(": suppressed 98 similar messages\n"), std::string::npos);
+  EXPECT_NE(m_lines[5].find("bad CRC (101)\n"), std::string::npos);
+  log_storm(102);
+  EXPECT_EQ(m_lines.size(), 6);
+
+  // the bucket should refill up to the burst after a long time
+  m_time_ms += 1000000;
+  for (int i = 0; i < 10; i++) {
+    log_storm(i);
+  }
+  ASSERT_EQ(m_lines.size(), 10);
+  EXPECT_NE(m_lines[6].find(": suppressed 1 similar messages\n"), std::string::npos);
+}
+
+TEST_F(LoggingRateLimitTest, Flush) {
+  for (int i = 0; i < 10; i++) {
+    log_storm(i);
+  }
+  ASSERT_EQ(m_lines.size(), 3);
+
+  // nothing should be written until the call site's bucket has refilled
+  logging_flush_rate_limits();
+  log_other();
+  ASSERT_EQ(m_lines.size(), 4);
+  m_time_ms += 500;
+
+  // the summary should be written by a line from another call site
+  log_other();
+  ASSERT_EQ(m_lines.size(), 6);
+  EXPECT_NE(m_lines[4].find(": suppressed 7 similar messages\n"), std::string::npos);
+  EXPECT_NE(m_lines[5].find("Other\n"), std::string::npos);
+  logging_flush_rate_limits();
+  EXPECT_EQ(m_lines.size(), 6);
+
+  // or by an explicit flush, without using up the call site's token
+  for (int i = 0; i < 3; i++) {
+    log_storm(i);
+  }
+  ASSERT_EQ(m_lines.size(), 7);
+  m_time_ms += 500;
+  logging_flush_rate_limits();
+  ASSERT_EQ(m_lines.size(), 8);
+  EXPECT_NE(m_lines[7].find(": suppressed 2 similar messages\n"), std::string::npos);
+  log_storm(3);
+  ASSERT_EQ(m_lines.size(), 9);
+  EXPECT_NE(m_lines[8].find("bad CRC (3)\n"), std::string::npos);
+
+  // pending summaries should be dropped by logging_init()
+  for (int i = 0; i < 3; i++) {
+    log_storm(i);
+  }
+  Init(3, 2);
+  m_time_ms += 500;
+  logging_flush_rate_limits();
+  EXPECT_EQ(m_lines.size(), 9);
+}
+
+TEST_F(LoggingRateLimitTest, Disabled) {
+  Init(0, 0);
+  for (int i = 0; i < 100; i++) {
+    log_storm(i);
+  }
+  EXPECT_EQ(m_lines.size(), 100);
+}
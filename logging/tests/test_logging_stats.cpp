@@ -0,0 +1,110 @@
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#define LOGGING_MODULE_NAME "STATS"
+#include "anchor/logging/logging.h"
+
+#define CYCLES_PER_CALL 10
+
+static std::vector<std::string> m_lines;
+static uint32_t m_cycle_count;
+
+static void write_function(const char* str) {
+  m_lines.push_back(str);
+}
+
+static uint32_t cycle_count_function(void) {
+  m_cycle_count += CYCLES_PER_CALL;
+  return m_cycle_count;
+}
+
+class LoggingStatsTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    m_lines.clear();
+    m_cycle_count = 0;
+  }
+
+  void Init(uint8_t* deferred_buffer, uint32_t deferred_buffer_size) {
+    const logging_init_t init = {
+      .write_function = write_function,
+      .raw_write_function = nullptr,
+      .lock_function = nullptr,
+      .time_ms_function = nullptr,
+      .default_level = LOGGING_LEVEL_INFO,
+      .deferred_buffer = deferred_buffer,
+      .deferred_buffer_size = deferred_buffer_size,
+      .cycle_count_function = cycle_count_function,
+    };
+    ASSERT_TRUE(logging_init(&init));
+  }
+
+  uint32_t GetBytes() {
+    uint32_t bytes = 0;
+    for (const std::string& line : m_lines) {
+      bytes += line.size();
+    }
+    return bytes;
+  }
+};
+
+TEST_F(LoggingStatsTest, Module) {
+  Init(nullptr, 0);
+  // the first line is filtered by the library and the second by the LOG_DEBUG() macro itself
+  LOG_DEBUG("debug %d", 1);
+  LOG_DEBUG("debug %d", 2);
+  LOG_INFO("info %d", 1);
+  LOG_INFO("info %d", 2);
+  LOG_INFO("info %d", 3);
+  LOG_ERROR("error");
+  ASSERT_EQ(m_lines.size(), 4);
+
+  logging_module_stats_t stats[2];
+  // there's no room for the module, so its stats should be left alone
+  EXPECT_EQ(logging_get_and_clear_module_stats(stats, 0), 0);
+  ASSERT_EQ(logging_get_and_clear_module_stats(stats, 2), 1);
+  EXPECT_STREQ(stats[0].module_prefix, "STATS:");
+  EXPECT_EQ(stats[0].stats.lines[LOGGING_LEVEL_DEBUG - LOGGING_LEVEL_DEBUG], 0);
+  EXPECT_EQ(stats[0].stats.lines[LOGGING_LEVEL_INFO - LOGGING_LEVEL_DEBUG], 3);
+  EXPECT_EQ(stats[0].stats.lines[LOGGING_LEVEL_WARN - LOGGING_LEVEL_DEBUG], 0);
+  EXPECT_EQ(stats[0].stats.lines[LOGGING_LEVEL_ERROR - LOGGING_LEVEL_DEBUG], 1);
+  EXPECT_EQ(stats[0].stats.filtered, 2);
+  EXPECT_EQ(stats[0].stats.bytes, GetBytes());
+  EXPECT_EQ(stats[0].stats.format_cycles, 4 * CYCLES_PER_CALL);
+
+  // the stats should have been cleared
+  LOG_DEBUG("debug %d", 3);
+  ASSERT_EQ(logging_get_and_clear_module_stats(stats, 2), 1);
+  EXPECT_EQ(stats[0].stats.lines[LOGGING_LEVEL_INFO - LOGGING_LEVEL_DEBUG], 0);
+  EXPECT_EQ(stats[0].stats.filtered, 1);
+  EXPECT_EQ(stats[0].stats.bytes, 0);
+
+  // re-initializing should clear the modules
+  Init(nullptr, 0);
+  EXPECT_EQ(logging_get_and_clear_module_stats(stats, 2), 0);
+}
+
+TEST_F(LoggingStatsTest, Deferred) {
+  uint8_t deferred_buffer[1024];
+  Init(deferred_buffer, sizeof(deferred_buffer));
+  LOG_INFO("info %d", 1);
+  LOG_WARN("warn %s", "str");
+
+  // the bytes aren't known until the lines are formatted
+  logging_module_stats_t stats;
+  ASSERT_EQ(logging_get_and_clear_module_stats(&stats, 1), 1);
+  EXPECT_EQ(stats.stats.lines[LOGGING_LEVEL_INFO - LOGGING_LEVEL_DEBUG], 1);
+  EXPECT_EQ(stats.stats.lines[LOGGING_LEVEL_WARN - LOGGING_LEVEL_DEBUG], 1);
+  EXPECT_EQ(stats.stats.bytes, 0);
+  EXPECT_EQ(stats.stats.format_cycles, 2 * CYCLES_PER_CALL);
+
+  // formatting the lines should be counted against the module which logged them
+  EXPECT_EQ(logging_process_deferred(0), 2);
+  ASSERT_EQ(m_lines.size(), 2);
+  ASSERT_EQ(logging_get_and_clear_module_stats(&stats, 1), 1);
+  EXPECT_EQ(stats.stats.lines[LOGGING_LEVEL_INFO - LOGGING_LEVEL_DEBUG], 0);
+  EXPECT_EQ(stats.stats.bytes, GetBytes());
+  EXPECT_EQ(stats.stats.format_cycles, 2 * CYCLES_PER_CALL);
+}
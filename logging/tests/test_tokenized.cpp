@@ -0,0 +1,135 @@
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#define LOGGING_MODULE_NAME "TOK"
+#define LOGGING_TOKENIZED 1
+#include "anchor/logging/logging.h"
+#include "anchor/logging/host/token_decoder.hpp"
+
+// The linker defines these for the section which the tokenized entries are placed in
+extern "C" const char __start_logging_tokens[];
+extern "C" const char __stop_logging_tokens[];
+
+static std::vector<uint8_t> m_records;
+static std::vector<std::string> m_lines;
+static uint32_t m_time_ms;
+
+static void write_function(const char* str) {
+  m_lines.push_back(str);
+}
+
+static void tokenized_write_function(const uint8_t* data, uint32_t length) {
+  m_records.insert(m_records.end(), data, data + length);
+}
+
+static uint32_t time_ms_function(void) {
+  return m_time_ms;
+}
+
+static std::string expected_line(const char* level, int line, const char* msg) {
+  char buffer[256];
+  snprintf(buffer, sizeof(buffer), "  0:01:01.234 %sTOK:test_tokenized.cpp:%d: %s\n", level, line, msg);
+  return buffer;
+}
+
+class TokenizedTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    m_records.clear();
+    m_lines.clear();
+    m_time_ms = 61234;
+    const logging_init_t init = {
+      .write_function = write_function,
+      .raw_write_function = nullptr,
+      .tokenized_write_function = tokenized_write_function,
+      .lock_function = nullptr,
+      .time_ms_function = time_ms_function,
+      .default_level = LOGGING_LEVEL_INFO,
+    };
+    ASSERT_TRUE(logging_init(&init));
+    m_decoder.AddDictionary(__start_logging_tokens, __stop_logging_tokens - __start_logging_tokens);
+  }
+
+  std::string Decode() {
+    std::string output;
+    EXPECT_EQ(m_decoder.Decode(m_records.data(), m_records.size(), &output), m_records.size());
+    return output;
+  }
+
+  logging::TokenDecoder m_decoder;
+};
+
+TEST_F(TokenizedTest, Hash) {
+  // the compile-time hash should match the runtime one, including for strings which are longer than the hashed length
+  static const char kShort[] = "a\x1f" "1\x1f" "b";
+  EXPECT_EQ(_LOGGING_TOKEN_HASH(kShort), logging_token_hash(kShort, sizeof(kShort) - 1));
+  EXPECT_EQ(_LOGGING_TOKEN_HASH("abc"), logging_token_hash("abc", 3));
+  EXPECT_NE(_LOGGING_TOKEN_HASH("abc"), _LOGGING_TOKEN_HASH("abd"));
+  EXPECT_EQ(_LOGGING_TOKEN_HASH(""), 0);
+#define X10 "xxxxxxxxxx"
+  static const char kLong[] = X10 X10 X10 X10 X10 X10 X10 X10 X10 X10 X10 X10 X10 X10 X10;
+#undef X10
+  static_assert(sizeof(kLong) - 1 > LOGGING_TOKEN_HASH_LENGTH, "String isn't longer than the hashed length");
+  EXPECT_EQ(_LOGGING_TOKEN_HASH(kLong), logging_token_hash(kLong, sizeof(kLong) - 1));
+}
+
+TEST_F(TokenizedTest, ArgTypes) {
+  int i = 0;
+  unsigned int u = 0;
+  const char* str = "";
+  EXPECT_EQ(_LOGGING_ARG_TYPES(), 0);
+  EXPECT_EQ(_LOGGING_ARG_TYPES(i), LOGGING_ARG_TYPE_INT32);
+  EXPECT_EQ(_LOGGING_ARG_TYPES(i, u, str, 1.0, &i, (uint64_t)1, 'c'),
+      LOGGING_ARG_TYPE_INT32 |
+      (LOGGING_ARG_TYPE_UINT32 << 3) |
+      (LOGGING_ARG_TYPE_STRING << 6) |
+      (LOGGING_ARG_TYPE_DOUBLE << 9) |
+      (LOGGING_ARG_TYPE_POINTER << 12) |
+      (LOGGING_ARG_TYPE_INT64 << 15) |
+      (LOGGING_ARG_TYPE_INT32 << 18));
+}
+
+TEST_F(TokenizedTest, Decode) {
+  char str[] = "world";
+  const int line = __LINE__ + 1;
+  LOG_INFO("hello %s", str);
+  LOG_DEBUG("filtered");
+  LOG_WARN("no args");
+  LOG_ERROR("%d %u %x %lld %.2f %c", -1, 4000000000u, 0xbeef, (long long)-5, 1.5, 'z');
+  // nothing should be written as text
+  EXPECT_EQ(m_lines.size(), 0);
+
+  EXPECT_EQ(Decode(),
+    expected_line("INFO  ", line, "hello world") +
+    expected_line("WARN  ", line + 2, "no args") +
+    expected_line("ERROR ", line + 3, "-1 4000000000 beef -5 1.50 z"));
+}
+
+TEST_F(TokenizedTest, Size) {
+  // the records should be much smaller than the text lines
+  const int line = __LINE__ + 1;
+  LOG_ERROR("Invalid packet: Response sequence number does not match request");
+  const std::string text = expected_line("ERROR ", line, "Invalid packet: Response sequence number does not match request");
+  EXPECT_EQ(Decode(), text);
+  EXPECT_LE(m_records.size() * 5, text.size());
+}
+
+TEST_F(TokenizedTest, UnknownAndIncomplete) {
+  LOG_INFO("value=%d", 1234);
+  const std::vector<uint8_t> record = m_records;
+
+  // an incomplete record should be left to be decoded with more data
+  std::string output;
+  EXPECT_EQ(m_decoder.Decode(record.data(), record.size() - 1, &output), 0);
+  EXPECT_EQ(output, "");
+
+  logging::TokenDecoder empty_decoder;
+  EXPECT_EQ(empty_decoder.Decode(record.data(), record.size(), &output), record.size());
+  logging_tokenized_record_t parsed;
+  ASSERT_EQ(logging_tokenized_parse_record(record.data(), record.size(), &parsed), record.size());
+  char expected[64];
+  snprintf(expected, sizeof(expected), "<unknown token 0x%08x>\n", parsed.token);
+  EXPECT_EQ(output, expected);
+}
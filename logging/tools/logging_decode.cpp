@@ -0,0 +1,73 @@
+// Tool for decoding tokenized logs (see tokenized.h) back into text.
+//
+// Usage: logging_decode DICTIONARY [LOG]
+// The dictionary is the contents of the logging_tokens section of the binary which produced the logs, which can be
+// extracted with `objcopy -O binary --only-section=logging_tokens firmware.elf tokens.bin`. The log is read from stdin
+// if no file is specified, and is decoded as it's read, so the tool can be placed directly after whatever is reading
+// from the device.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "anchor/logging/host/token_decoder.hpp"
+
+static bool read_file(const char* path, std::vector<uint8_t>* data) {
+  FILE* file = fopen(path, "rb");
+  if (!file) {
+    fprintf(stderr, "Failed to open %s\n", path);
+    return false;
+  }
+  uint8_t buffer[4096];
+  size_t length;
+  while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data->insert(data->end(), buffer, buffer + length);
+  }
+  fclose(file);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 2 && argc != 3) {
+    fprintf(stderr, "Usage: %s DICTIONARY [LOG]\n", argv[0]);
+    return 1;
+  }
+  std::vector<uint8_t> dictionary;
+  if (!read_file(argv[1], &dictionary)) {
+    return 1;
+  }
+  logging::TokenDecoder decoder;
+  decoder.AddDictionary(dictionary.data(), dictionary.size());
+  if (decoder.num_collisions()) {
+    fprintf(stderr, "Warning: %zu dictionary entries have colliding tokens and can't be decoded\n",
+      decoder.num_collisions());
+  }
+
+  FILE* log = stdin;
+  if (argc == 3) {
+    log = fopen(argv[2], "rb");
+    if (!log) {
+      fprintf(stderr, "Failed to open %s\n", argv[2]);
+      return 1;
+    }
+  }
+  std::vector<uint8_t> pending;
+  uint8_t buffer[4096];
+  size_t length;
+  while ((length = fread(buffer, 1, sizeof(buffer), log)) > 0) {
+    pending.insert(pending.end(), buffer, buffer + length);
+    std::string output;
+    const size_t consumed = decoder.Decode(pending.data(), pending.size(), &output);
+    pending.erase(pending.begin(), pending.begin() + consumed);
+    fputs(output.c_str(), stdout);
+    fflush(stdout);
+  }
+  if (log != stdin) {
+    fclose(log);
+  }
+  if (!pending.empty()) {
+    fprintf(stderr, "%zu bytes at the end of the log couldn't be decoded\n", pending.size());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+// The data of every channel is sent as-is, except for the escape byte (DLE), which starts one of these sequences:
+//   DLE, MUX_CHANNEL_BYTE(channel) - the following data belongs to the channel
+//   DLE, DLE - a DLE byte which belongs to the current channel
+// Any other byte after a DLE is treated as data of the current channel (along with the DLE itself). The channel bytes
+// are non-printing control characters, so a plain terminal on the default channel (0) doesn't show the switches.
+#define MUX_ESCAPE_BYTE         0x10
+#define MUX_CHANNEL_BYTE_BASE   0x1c
+#define MUX_CHANNEL_BYTE(CHANNEL) (MUX_CHANNEL_BYTE_BASE + (CHANNEL))
+
+// The number of channels (up to 4)
+#ifndef MUX_NUM_CHANNELS
+#define MUX_NUM_CHANNELS 4
+#endif
+
+typedef struct {
+    // Write function which writes data out to the physical layer (i.e. a UART)
+    void(*write_function)(const uint8_t* data, uint32_t length);
+    // Handlers which get passed the data which is received for each channel (NULL to drop the channel's data)
+    void(*receive_handlers[MUX_NUM_CHANNELS])(const uint8_t* data, uint32_t length);
+    // A lock function which is called to make mux_write() thread-safe (optional)
+    void(*lock_function)(bool acquire);
+} mux_init_t;
+
+// Initializes the mux library
+bool mux_init(const mux_init_t* init);
+
+// Writes data for a channel, switching the channel first if it's not the one which was last written to
+// NOTE: Writes to different channels can be interleaved at any point (i.e. a log line in the middle of a SONAR frame)
+void mux_write(uint8_t channel, const void* data, uint32_t length);
+
+// Processes received data, passing the data of each channel to its receive handler
+void mux_process(const uint8_t* data, uint32_t length);
@@ -0,0 +1,91 @@
+#include "anchor/mux/mux.h"
+
+#include <string.h>
+
+// The transmit channel before the first write, which makes sure the receiver is always told the channel up front (i.e.
+// in case it was left on a different channel before this side was reset)
+#define CHANNEL_UNKNOWN 0xff
+
+_Static_assert(MUX_NUM_CHANNELS > 0 && MUX_NUM_CHANNELS <= 4, "Invalid number of channels");
+
+static const uint8_t ESCAPE_BYTE[] = {MUX_ESCAPE_BYTE};
+
+static mux_init_t m_init;
+static uint8_t m_tx_channel;
+static uint8_t m_rx_channel;
+static bool m_rx_is_escape;
+
+static void lock(bool acquire) {
+    if (m_init.lock_function) {
+        m_init.lock_function(acquire);
+    }
+}
+
+static void receive(const uint8_t* data, uint32_t length) {
+    if (length && m_init.receive_handlers[m_rx_channel]) {
+        m_init.receive_handlers[m_rx_channel](data, length);
+    }
+}
+
+bool mux_init(const mux_init_t* init) {
+    if (!init->write_function) {
+        return false;
+    }
+    m_init = *init;
+    m_tx_channel = CHANNEL_UNKNOWN;
+    m_rx_channel = 0;
+    m_rx_is_escape = false;
+    return true;
+}
+
+void mux_write(uint8_t channel, const void* data, uint32_t length) {
+    if (channel >= MUX_NUM_CHANNELS) {
+        return;
+    }
+    const uint8_t* bytes = data;
+    lock(true);
+    if (channel != m_tx_channel) {
+        const uint8_t switch_sequence[] = {MUX_ESCAPE_BYTE, MUX_CHANNEL_BYTE(channel)};
+        m_init.write_function(switch_sequence, sizeof(switch_sequence));
+        m_tx_channel = channel;
+    }
+    // write the data directly in runs which end with an escape byte, which is then escaped by writing it again
+    while (length) {
+        const uint8_t* escape = memchr(bytes, MUX_ESCAPE_BYTE, length);
+        const uint32_t run_length = escape ? (uint32_t)(escape - bytes) + 1 : length;
+        m_init.write_function(bytes, run_length);
+        if (escape) {
+            m_init.write_function(ESCAPE_BYTE, sizeof(ESCAPE_BYTE));
+        }
+        bytes += run_length;
+        length -= run_length;
+    }
+    lock(false);
+}
+
+void mux_process(const uint8_t* data, uint32_t length) {
+    // pass the data along in runs which belong to the same channel, without copying it
+    uint32_t run_start = 0;
+    for (uint32_t i = 0; i < length; i++) {
+        const uint8_t byte = data[i];
+        if (m_rx_is_escape) {
+            m_rx_is_escape = false;
+            if (byte >= MUX_CHANNEL_BYTE_BASE && byte < MUX_CHANNEL_BYTE(MUX_NUM_CHANNELS)) {
+                m_rx_channel = byte - MUX_CHANNEL_BYTE_BASE;
+                run_start = i + 1;
+                continue;
+            } else if (byte != MUX_ESCAPE_BYTE) {
+                // not a valid sequence (i.e. it was typed into a terminal), so the escape byte is just data
+                receive(ESCAPE_BYTE, sizeof(ESCAPE_BYTE));
+            }
+            // the byte is data which starts the next run
+            run_start = i;
+        } else if (byte == MUX_ESCAPE_BYTE) {
+            receive(&data[run_start], i - run_start);
+            m_rx_is_escape = true;
+        }
+    }
+    if (!m_rx_is_escape) {
+        receive(&data[run_start], length - run_start);
+    }
+}
@@ -0,0 +1,117 @@
+#include "gtest/gtest.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+extern "C" {
+
+#include "anchor/mux/mux.h"
+
+};
+
+#define CONSOLE_CHANNEL 0
+#define LOGGING_CHANNEL 1
+#define SONAR_CHANNEL 2
+
+static std::string m_write_data;
+static std::vector<std::string> m_received;
+
+static void write_function(const uint8_t* data, uint32_t length) {
+  m_write_data.append((const char*)data, length);
+}
+
+static void console_receive_handler(const uint8_t* data, uint32_t length) {
+  m_received[CONSOLE_CHANNEL].append((const char*)data, length);
+}
+
+static void logging_receive_handler(const uint8_t* data, uint32_t length) {
+  m_received[LOGGING_CHANNEL].append((const char*)data, length);
+}
+
+static void sonar_receive_handler(const uint8_t* data, uint32_t length) {
+  m_received[SONAR_CHANNEL].append((const char*)data, length);
+}
+
+class MuxTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    m_write_data.clear();
+    m_received.assign(MUX_NUM_CHANNELS, std::string());
+    const mux_init_t init = {
+      .write_function = write_function,
+      .receive_handlers = {
+        [CONSOLE_CHANNEL] = console_receive_handler,
+        [LOGGING_CHANNEL] = logging_receive_handler,
+        [SONAR_CHANNEL] = sonar_receive_handler,
+      },
+      .lock_function = nullptr,
+    };
+    ASSERT_TRUE(mux_init(&init));
+  }
+
+  void Write(uint8_t channel, const std::string& data) {
+    mux_write(channel, data.data(), data.size());
+  }
+
+  void Process(const std::string& data) {
+    mux_process((const uint8_t*)data.data(), data.size());
+  }
+};
+
+TEST_F(MuxTest, Write) {
+  // the channel should only be switched when it changes (and before the first write)
+  Write(CONSOLE_CHANNEL, "> ");
+  Write(CONSOLE_CHANNEL, "help\n");
+  EXPECT_EQ(m_write_data, std::string("\x10\x1c> help\n"));
+  m_write_data.clear();
+  Write(SONAR_CHANNEL, "\x7e\x01\x10\x7e");
+  Write(LOGGING_CHANNEL, "INFO\n");
+  Write(SONAR_CHANNEL, "\x7e");
+  EXPECT_EQ(m_write_data, std::string("\x10\x1e\x7e\x01\x10\x10\x7e\x10\x1dINFO\n\x10\x1e\x7e"));
+
+  // invalid channels should be dropped
+  m_write_data.clear();
+  Write(MUX_NUM_CHANNELS, "invalid");
+  EXPECT_TRUE(m_write_data.empty());
+}
+
+TEST_F(MuxTest, Process) {
+  // a plain terminal should never need to switch channels
+  Process("help\n");
+  EXPECT_EQ(m_received[CONSOLE_CHANNEL], "help\n");
+  Process(std::string("\x10\x1e\x7e\x01\x10\x10\x7e\x10\x1cls\n", 12));
+  EXPECT_EQ(m_received[SONAR_CHANNEL], std::string("\x7e\x01\x10\x7e"));
+  EXPECT_EQ(m_received[CONSOLE_CHANNEL], "help\nls\n");
+
+  // an escape byte which isn't part of a valid sequence should be passed along as data
+  m_received[CONSOLE_CHANNEL].clear();
+  Process("a\x10" "b\x10");
+  Process("\x1f" "c");
+  EXPECT_EQ(m_received[CONSOLE_CHANNEL], "a\x10" "b");
+  // channel 3 doesn't have a handler
+  EXPECT_TRUE(m_received[3].empty());
+}
+
+TEST_F(MuxTest, Loopback) {
+  // interleave random writes to each channel and then process the result in random chunks
+  std::mt19937 rng(1234);
+  std::vector<std::string> expected(MUX_NUM_CHANNELS);
+  for (int i = 0; i < 1000; i++) {
+    const uint8_t channel = rng() % (SONAR_CHANNEL + 1);
+    std::string data(rng() % 8, '\0');
+    for (char& c : data) {
+      // use a small range of bytes so that the escape and channel bytes come up often
+      c = MUX_ESCAPE_BYTE + rng() % 16;
+    }
+    Write(channel, data);
+    expected[channel] += data;
+  }
+  size_t offset = 0;
+  while (offset < m_write_data.size()) {
+    const size_t length = std::min<size_t>(rng() % 16, m_write_data.size() - offset);
+    Process(m_write_data.substr(offset, length));
+    offset += length;
+  }
+  EXPECT_EQ(m_received, expected);
+}
@@ -0,0 +1,301 @@
+// Throughput and latency benchmark for the SONAR client and server. The two are wired together in-process through an
+// in-memory channel and driven from a single thread with a simulated clock, which is held fixed while measuring so no
+// link maintenance traffic or timeouts perturb the results. Reads, writes, and notifies are measured for a range of
+// attribute sizes, reporting the request rate, goodput (attribute data bytes per second), and the p50 / p99 latency
+// from issuing each request until its completion handler is called.
+//
+// Usage: loopback_benchmark [--json PATH]
+// The results are printed as a table, and also written as JSON to PATH if specified (use "-" for stdout).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+extern "C" {
+
+#include "anchor/logging/logging.h"
+#include "anchor/sonar/client.h"
+#include "anchor/sonar/server.h"
+
+};
+
+#define MAX_ATTR_SIZE 1024
+#define NUM_REQUESTS 20000
+#define NUM_WARMUP_REQUESTS 1000
+// Bound on the number of times the channel is pumped for a single request before it's considered stuck
+#define MAX_PUMP_ITERATIONS 100
+
+typedef std::chrono::steady_clock benchmark_clock_t;
+
+#define TEST_ATTR_DEF(SIZE) \
+  SONAR_ATTR_DEF(CLIENT_ATTR_##SIZE, 0x100 + SIZE, SIZE, RWN); \
+  SONAR_SERVER_ATTR_DEF(Attr##SIZE, SERVER_ATTR_##SIZE, 0x100 + SIZE, SIZE, RWN); \
+  static bool Attr##SIZE##_write_handler(const void* data, uint32_t length) { \
+    memcpy(m_attr_value, data, length); \
+    return true; \
+  } \
+  static uint32_t Attr##SIZE##_read_handler(void* response_data, uint32_t response_max_size) { \
+    memcpy(response_data, m_attr_value, SIZE); \
+    return SIZE; \
+  }
+
+typedef enum {
+  OP_READ,
+  OP_WRITE,
+  OP_NOTIFY,
+  NUM_OPS,
+} op_t;
+
+static const char* const OP_NAMES[NUM_OPS] = {"read", "write", "notify"};
+
+typedef struct {
+  op_t op;
+  uint32_t attr_size;
+  double requests_per_s;
+  double goodput_bytes_per_s;
+  double p50_latency_us;
+  double p99_latency_us;
+} result_t;
+
+SONAR_CLIENT_DEF(m_client, MAX_ATTR_SIZE);
+SONAR_SERVER_DEF(m_server, MAX_ATTR_SIZE);
+
+static uint8_t m_attr_value[MAX_ATTR_SIZE];
+static std::vector<uint8_t> m_client_write_data;
+static std::vector<uint8_t> m_server_write_data;
+static uint64_t m_system_time;
+static bool m_is_complete;
+static bool m_is_success;
+
+TEST_ATTR_DEF(4);
+TEST_ATTR_DEF(64);
+TEST_ATTR_DEF(256);
+TEST_ATTR_DEF(1024);
+
+static const struct {
+  uint32_t size;
+  sonar_attribute_t client_attr;
+  sonar_server_attribute_t server_attr;
+} ATTRS[] = {
+  {4, CLIENT_ATTR_4, SERVER_ATTR_4},
+  {64, CLIENT_ATTR_64, SERVER_ATTR_64},
+  {256, CLIENT_ATTR_256, SERVER_ATTR_256},
+  {1024, CLIENT_ATTR_1024, SERVER_ATTR_1024},
+};
+
+static void logging_write_function(const char* str) {
+  fputs(str, stderr);
+}
+
+static uint32_t logging_time_ms_function(void) {
+  return 0;
+}
+
+static uint64_t get_system_time_ms(void) {
+  return m_system_time;
+}
+
+static void client_write_byte(uint8_t byte) {
+  m_client_write_data.push_back(byte);
+}
+
+static void server_write_byte(uint8_t byte) {
+  m_server_write_data.push_back(byte);
+}
+
+static void client_connection_changed_callback(bool connected) {
+}
+
+static void complete(bool success) {
+  m_is_complete = true;
+  m_is_success = success;
+}
+
+static void client_read_complete_handler(bool success, const void* data, uint32_t length) {
+  complete(success);
+}
+
+static void client_write_complete_handler(bool success) {
+  complete(success);
+}
+
+static bool client_notify_handler(sonar_attribute_t attr, const void* data, uint32_t length) {
+  return true;
+}
+
+static void server_connection_changed_callback(sonar_server_handle_t handle, bool connected) {
+}
+
+static void server_notify_complete_handler(sonar_server_handle_t handle, bool success) {
+  complete(success);
+}
+
+// Passes the data which each side wrote to the other side (once each)
+static void pump(void) {
+  static std::vector<uint8_t> data;
+  data.swap(m_server_write_data);
+  sonar_client_process(m_client, data.data(), data.size());
+  data.clear();
+  data.swap(m_client_write_data);
+  sonar_server_process(m_server, data.data(), data.size());
+  data.clear();
+}
+
+static bool issue(op_t op, uint32_t attr_index) {
+  const uint32_t size = ATTRS[attr_index].size;
+  switch (op) {
+    case OP_READ:
+      return sonar_client_read(m_client, ATTRS[attr_index].client_attr);
+    case OP_WRITE:
+      return sonar_client_write(m_client, ATTRS[attr_index].client_attr, m_attr_value, size);
+    case OP_NOTIFY:
+      return sonar_server_notify(m_server, ATTRS[attr_index].server_attr, m_attr_value, size);
+    default:
+      return false;
+  }
+}
+
+static bool run_request(op_t op, uint32_t attr_index) {
+  m_is_complete = false;
+  if (!issue(op, attr_index)) {
+    return false;
+  }
+  for (int i = 0; i < MAX_PUMP_ITERATIONS && !m_is_complete; i++) {
+    pump();
+  }
+  return m_is_complete && m_is_success;
+}
+
+static double percentile_us(std::vector<uint64_t>& latencies_ns, double percentile) {
+  const size_t index = std::min(latencies_ns.size() - 1, (size_t)(latencies_ns.size() * percentile));
+  std::nth_element(latencies_ns.begin(), latencies_ns.begin() + index, latencies_ns.end());
+  return latencies_ns[index] / 1e3;
+}
+
+static result_t run(op_t op, uint32_t attr_index) {
+  for (int i = 0; i < NUM_WARMUP_REQUESTS; i++) {
+    if (!run_request(op, attr_index)) {
+      fprintf(stderr, "Warmup %s request failed\n", OP_NAMES[op]);
+      exit(1);
+    }
+  }
+
+  std::vector<uint64_t> latencies_ns;
+  latencies_ns.reserve(NUM_REQUESTS);
+  const benchmark_clock_t::time_point start_time = benchmark_clock_t::now();
+  benchmark_clock_t::time_point request_start_time = start_time;
+  for (int i = 0; i < NUM_REQUESTS; i++) {
+    if (!run_request(op, attr_index)) {
+      fprintf(stderr, "%s request failed\n", OP_NAMES[op]);
+      exit(1);
+    }
+    const benchmark_clock_t::time_point now = benchmark_clock_t::now();
+    latencies_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(now - request_start_time).count());
+    request_start_time = now;
+  }
+  const double duration_s = std::chrono::duration<double>(benchmark_clock_t::now() - start_time).count();
+
+  result_t result;
+  result.op = op;
+  result.attr_size = ATTRS[attr_index].size;
+  result.requests_per_s = NUM_REQUESTS / duration_s;
+  result.goodput_bytes_per_s = result.requests_per_s * result.attr_size;
+  result.p50_latency_us = percentile_us(latencies_ns, 0.5);
+  result.p99_latency_us = percentile_us(latencies_ns, 0.99);
+  return result;
+}
+
+static void write_json(FILE* file, const std::vector<result_t>& results) {
+  fprintf(file, "{\n  \"benchmark\": \"loopback\",\n  \"num_requests\": %d,\n  \"results\": [\n", NUM_REQUESTS);
+  for (size_t i = 0; i < results.size(); i++) {
+    const result_t& result = results[i];
+    fprintf(file, "    {\"op\": \"%s\", \"attr_size\": %u, \"requests_per_s\": %.1f, \"goodput_bytes_per_s\": %.1f, "
+        "\"p50_latency_us\": %.3f, \"p99_latency_us\": %.3f}%s\n", OP_NAMES[result.op], result.attr_size,
+        result.requests_per_s, result.goodput_bytes_per_s, result.p50_latency_us, result.p99_latency_us,
+        i + 1 < results.size() ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+}
+
+int main(int argc, char **argv) {
+  const char* json_path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--json") && i + 1 < argc) {
+      json_path = argv[++i];
+    } else {
+      fprintf(stderr, "Usage: %s [--json PATH]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  const logging_init_t init_logging = {
+    .write_function = logging_write_function,
+    .raw_write_function = nullptr,
+    .lock_function = nullptr,
+    .time_ms_function = logging_time_ms_function,
+    .default_level = LOGGING_LEVEL_WARN,
+  };
+  logging_init(&init_logging);
+
+  const sonar_client_init_t init_client = {
+    .write_byte = client_write_byte,
+    .get_system_time_ms = get_system_time_ms,
+    .connection_changed_callback = client_connection_changed_callback,
+    .attribute_read_complete_handler = client_read_complete_handler,
+    .attribute_write_complete_handler = client_write_complete_handler,
+    .attribute_notify_handler = client_notify_handler,
+  };
+  sonar_client_init(m_client, &init_client);
+  const sonar_server_init_t init_server = {
+    .write_byte = server_write_byte,
+    .get_system_time_ms = get_system_time_ms,
+    .connection_changed_callback = server_connection_changed_callback,
+    .attribute_notify_complete_handler = server_notify_complete_handler,
+  };
+  sonar_server_init(m_server, &init_server);
+  for (const auto& attr : ATTRS) {
+    sonar_client_register(m_client, attr.client_attr);
+    sonar_server_register(m_server, attr.server_attr);
+  }
+  for (size_t i = 0; i < sizeof(m_attr_value); i++) {
+    m_attr_value[i] = (uint8_t)i;
+  }
+
+  // the clock only moves while connecting
+  for (int i = 0; i < 10 && !sonar_client_is_connected(m_client); i++) {
+    m_system_time += 10;
+    pump();
+  }
+  if (!sonar_client_is_connected(m_client) || !sonar_server_is_connected(m_server)) {
+    fprintf(stderr, "Failed to connect\n");
+    return 1;
+  }
+
+  std::vector<result_t> results;
+  printf("%-7s %10s %12s %16s %12s %12s\n", "op", "attr size", "requests/s", "goodput (B/s)", "p50 (us)", "p99 (us)");
+  for (int op = 0; op < NUM_OPS; op++) {
+    for (uint32_t i = 0; i < sizeof(ATTRS) / sizeof(ATTRS[0]); i++) {
+      const result_t result = run((op_t)op, i);
+      printf("%-7s %10u %12.0f %16.0f %12.2f %12.2f\n", OP_NAMES[op], result.attr_size, result.requests_per_s,
+          result.goodput_bytes_per_s, result.p50_latency_us, result.p99_latency_us);
+      results.push_back(result);
+    }
+  }
+
+  if (json_path) {
+    FILE* file = strcmp(json_path, "-") ? fopen(json_path, "w") : stdout;
+    if (!file) {
+      perror(json_path);
+      return 1;
+    }
+    write_json(file, results);
+    if (file != stdout) {
+      fclose(file);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,292 @@
+// Goodput and tail latency benchmark for the SONAR client and server over a lossy serial link. The two are connected
+// through the channel simulator and driven from a single thread in simulated time, so the results reflect the protocol
+// and its timers (i.e. retries and timeouts) rather than the speed of the host. Back-to-back reads of a 64 byte
+// attribute are measured for a range of channel configurations, reporting the goodput (attribute data bytes per
+// simulated second), the p50 / p99 / max latency, the number of failed requests, and the number of retries.
+//
+// Usage: lossy_link_benchmark [--json PATH]
+// The results are printed as a table, and also written as JSON to PATH if specified (use "-" for stdout).
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+
+#include "anchor/logging/logging.h"
+#include "anchor/sonar/client.h"
+#include "anchor/sonar/server.h"
+#include "anchor/sonar/host/channel_sim.h"
+
+};
+
+#define ATTR_SIZE 64
+#define NUM_REQUESTS 2000
+#define TICK_US 50
+// Bound on the simulated time for a single request before it's considered stuck
+#define MAX_REQUEST_TIME_US 5000000
+#define CLIENT_TO_SERVER SONAR_CHANNEL_SIM_DIR_A_TO_B
+#define SERVER_TO_CLIENT SONAR_CHANNEL_SIM_DIR_B_TO_A
+
+typedef struct {
+  const char* name;
+  sonar_channel_sim_config_t config;
+} scenario_t;
+
+typedef struct {
+  const char* name;
+  double goodput_bytes_per_s;
+  double p50_latency_ms;
+  double p99_latency_ms;
+  double max_latency_ms;
+  uint32_t num_failed;
+  uint32_t num_retries;
+} result_t;
+
+static sonar_channel_sim_config_t make_config(double byte_drop_rate, double bit_error_rate, bool half_duplex) {
+  sonar_channel_sim_config_t config = {};
+  config.bit_error_rate = bit_error_rate;
+  config.byte_drop_rate = byte_drop_rate;
+  config.latency_us = 1000;
+  config.baud_rate = 115200;
+  config.half_duplex = half_duplex;
+  config.turnaround_us = half_duplex ? 2000 : 0;
+  config.seed = 1;
+  return config;
+}
+
+static sonar_channel_sim_config_t make_burst_config(void) {
+  sonar_channel_sim_config_t config = make_config(0.0, 0.0, false);
+  config.burst_start_rate = 0.0005;
+  config.burst_end_rate = 0.05;
+  return config;
+}
+
+static const scenario_t SCENARIOS[] = {
+  {"ideal", make_config(0.0, 0.0, false)},
+  {"drop 0.1%", make_config(0.001, 0.0, false)},
+  {"drop 0.5%", make_config(0.005, 0.0, false)},
+  {"drop 1%", make_config(0.01, 0.0, false)},
+  {"ber 1e-4", make_config(0.0, 0.0001, false)},
+  {"burst", make_burst_config()},
+  {"half-duplex", make_config(0.0, 0.0, true)},
+  {"half-duplex 0.5%", make_config(0.005, 0.0, true)},
+};
+
+SONAR_CHANNEL_SIM_DEF(m_channel, 4096);
+SONAR_CLIENT_DEF(m_client, ATTR_SIZE);
+SONAR_SERVER_DEF(m_server, ATTR_SIZE);
+SONAR_ATTR_DEF(CLIENT_TEST_ATTR, 0x100, ATTR_SIZE, RW);
+SONAR_SERVER_ATTR_DEF(TestAttr, SERVER_TEST_ATTR, 0x100, ATTR_SIZE, RW);
+
+static uint8_t m_attr_value[ATTR_SIZE];
+static uint64_t m_time_us;
+static bool m_is_complete;
+static bool m_is_success;
+
+static void logging_write_function(const char* str) {
+  // the link errors caused by the simulated channel are expected, so the logs are discarded
+}
+
+static uint32_t logging_time_ms_function(void) {
+  return (uint32_t)(m_time_us / 1000);
+}
+
+static uint64_t get_system_time_ms(void) {
+  return m_time_us / 1000;
+}
+
+static void client_write_byte(uint8_t byte) {
+  sonar_channel_sim_write(m_channel, CLIENT_TO_SERVER, byte, m_time_us);
+}
+
+static void server_write_byte(uint8_t byte) {
+  sonar_channel_sim_write(m_channel, SERVER_TO_CLIENT, byte, m_time_us);
+}
+
+static void client_connection_changed_callback(bool connected) {
+}
+
+static void client_read_complete_handler(bool success, const void* data, uint32_t length) {
+  m_is_complete = true;
+  m_is_success = success && length == ATTR_SIZE && !memcmp(data, m_attr_value, ATTR_SIZE);
+}
+
+static void client_write_complete_handler(bool success) {
+}
+
+static bool client_notify_handler(sonar_attribute_t attr, const void* data, uint32_t length) {
+  return false;
+}
+
+static void server_connection_changed_callback(sonar_server_handle_t handle, bool connected) {
+}
+
+static void server_notify_complete_handler(sonar_server_handle_t handle, bool success) {
+}
+
+static bool TestAttr_write_handler(const void* data, uint32_t length) {
+  return false;
+}
+
+static uint32_t TestAttr_read_handler(void* response_data, uint32_t response_max_size) {
+  memcpy(response_data, m_attr_value, ATTR_SIZE);
+  return ATTR_SIZE;
+}
+
+// Advances the simulated time by one tick, passing any delivered bytes to the client and server
+static void tick(void) {
+  m_time_us += TICK_US;
+  uint8_t buffer[512];
+  const uint32_t client_length = sonar_channel_sim_read(m_channel, SERVER_TO_CLIENT, m_time_us, buffer, sizeof(buffer));
+  sonar_client_process(m_client, buffer, client_length);
+  const uint32_t server_length = sonar_channel_sim_read(m_channel, CLIENT_TO_SERVER, m_time_us, buffer, sizeof(buffer));
+  sonar_server_process(m_server, buffer, server_length);
+}
+
+static void init(const sonar_channel_sim_config_t* config) {
+  m_time_us = 0;
+  sonar_channel_sim_init(m_channel, config);
+  const sonar_client_init_t init_client = {
+    .write_byte = client_write_byte,
+    .get_system_time_ms = get_system_time_ms,
+    .connection_changed_callback = client_connection_changed_callback,
+    .attribute_read_complete_handler = client_read_complete_handler,
+    .attribute_write_complete_handler = client_write_complete_handler,
+    .attribute_notify_handler = client_notify_handler,
+  };
+  sonar_client_init(m_client, &init_client);
+  sonar_client_register(m_client, CLIENT_TEST_ATTR);
+  const sonar_server_init_t init_server = {
+    .write_byte = server_write_byte,
+    .get_system_time_ms = get_system_time_ms,
+    .connection_changed_callback = server_connection_changed_callback,
+    .attribute_notify_complete_handler = server_notify_complete_handler,
+  };
+  sonar_server_init(m_server, &init_server);
+  sonar_server_register(m_server, SERVER_TEST_ATTR);
+}
+
+static double percentile_ms(std::vector<uint64_t>& latencies_us, double percentile) {
+  const size_t index = std::min(latencies_us.size() - 1, (size_t)(latencies_us.size() * percentile));
+  std::nth_element(latencies_us.begin(), latencies_us.begin() + index, latencies_us.end());
+  return latencies_us[index] / 1e3;
+}
+
+static result_t run(const scenario_t* scenario) {
+  init(&scenario->config);
+  while (!sonar_client_is_connected(m_client) || !sonar_server_is_connected(m_server)) {
+    if (m_time_us > MAX_REQUEST_TIME_US) {
+      fprintf(stderr, "Failed to connect (%s)\n", scenario->name);
+      exit(1);
+    }
+    tick();
+  }
+  sonar_errors_t errors;
+  sonar_client_get_and_clear_errors(m_client, &errors);
+
+  result_t result = {};
+  result.name = scenario->name;
+  std::vector<uint64_t> latencies_us;
+  latencies_us.reserve(NUM_REQUESTS);
+  const uint64_t start_time_us = m_time_us;
+  uint32_t num_success = 0;
+  for (int i = 0; i < NUM_REQUESTS; i++) {
+    const uint64_t request_start_time_us = m_time_us;
+    // the client may have to reconnect after a severe loss
+    while (!sonar_client_read(m_client, CLIENT_TEST_ATTR)) {
+      if (m_time_us - request_start_time_us > MAX_REQUEST_TIME_US) {
+        fprintf(stderr, "Failed to send request (%s)\n", scenario->name);
+        exit(1);
+      }
+      tick();
+    }
+    m_is_complete = false;
+    while (!m_is_complete) {
+      if (m_time_us - request_start_time_us > MAX_REQUEST_TIME_US) {
+        fprintf(stderr, "Request never completed (%s)\n", scenario->name);
+        exit(1);
+      }
+      tick();
+    }
+    latencies_us.push_back(m_time_us - request_start_time_us);
+    if (m_is_success) {
+      num_success++;
+    } else {
+      result.num_failed++;
+    }
+  }
+  const double duration_s = (m_time_us - start_time_us) / 1e6;
+
+  sonar_client_get_and_clear_errors(m_client, &errors);
+  result.num_retries = errors.link_layer.retries;
+  sonar_server_get_and_clear_errors(m_server, &errors);
+  result.num_retries += errors.link_layer.retries;
+  result.goodput_bytes_per_s = num_success * ATTR_SIZE / duration_s;
+  result.p50_latency_ms = percentile_ms(latencies_us, 0.5);
+  result.p99_latency_ms = percentile_ms(latencies_us, 0.99);
+  result.max_latency_ms = *std::max_element(latencies_us.begin(), latencies_us.end()) / 1e3;
+  return result;
+}
+
+static void write_json(FILE* file, const std::vector<result_t>& results) {
+  fprintf(file, "{\n  \"benchmark\": \"lossy_link\",\n  \"num_requests\": %d,\n  \"attr_size\": %d,\n  \"results\": [\n",
+      NUM_REQUESTS, ATTR_SIZE);
+  for (size_t i = 0; i < results.size(); i++) {
+    const result_t& result = results[i];
+    fprintf(file, "    {\"channel\": \"%s\", \"goodput_bytes_per_s\": %.1f, \"p50_latency_ms\": %.3f, "
+        "\"p99_latency_ms\": %.3f, \"max_latency_ms\": %.3f, \"failed\": %u, \"retries\": %u}%s\n", result.name,
+        result.goodput_bytes_per_s, result.p50_latency_ms, result.p99_latency_ms, result.max_latency_ms,
+        result.num_failed, result.num_retries, i + 1 < results.size() ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+}
+
+int main(int argc, char **argv) {
+  const char* json_path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--json") && i + 1 < argc) {
+      json_path = argv[++i];
+    } else {
+      fprintf(stderr, "Usage: %s [--json PATH]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  const logging_init_t init_logging = {
+    .write_function = logging_write_function,
+    .raw_write_function = nullptr,
+    .lock_function = nullptr,
+    .time_ms_function = logging_time_ms_function,
+    .default_level = LOGGING_LEVEL_ERROR,
+  };
+  logging_init(&init_logging);
+  for (size_t i = 0; i < sizeof(m_attr_value); i++) {
+    m_attr_value[i] = (uint8_t)i;
+  }
+
+  std::vector<result_t> results;
+  printf("%-18s %14s %10s %10s %10s %8s %8s\n", "channel", "goodput (B/s)", "p50 (ms)", "p99 (ms)", "max (ms)",
+      "failed", "retries");
+  for (const scenario_t& scenario : SCENARIOS) {
+    const result_t result = run(&scenario);
+    printf("%-18s %14.0f %10.2f %10.2f %10.2f %8u %8u\n", result.name, result.goodput_bytes_per_s,
+        result.p50_latency_ms, result.p99_latency_ms, result.max_latency_ms, result.num_failed, result.num_retries);
+    results.push_back(result);
+  }
+
+  if (json_path) {
+    FILE* file = strcmp(json_path, "-") ? fopen(json_path, "w") : stdout;
+    if (!file) {
+      perror(json_path);
+      return 1;
+    }
+    write_json(file, results);
+    if (file != stdout) {
+      fclose(file);
+    }
+  }
+  return 0;
+}
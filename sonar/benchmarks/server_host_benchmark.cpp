@@ -0,0 +1,267 @@
+// CPU usage benchmark for the SONAR server host. Each link is a socketpair with a SONAR client on the other end which
+// is driven by a separate client thread. The CPU time used by the host thread is measured while the clients are idle
+// (only sending connection maintenance requests) and while they're each continuously issuing read requests.
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+extern "C" {
+
+#include "anchor/logging/logging.h"
+#include "anchor/sonar/client.h"
+#include "anchor/sonar/host/server_host.h"
+
+};
+
+#define MAX_ATTR_SIZE 64
+#define PHASE_DURATION_MS 2000
+
+SONAR_SERVER_ATTR_DEF(TestAttr, SERVER_TEST_ATTR, 0x100, sizeof(uint32_t), RW);
+
+typedef enum {
+  PHASE_CONNECT,
+  PHASE_IDLE,
+  PHASE_LOAD,
+  PHASE_DONE,
+  NUM_PHASES,
+} phase_t;
+
+typedef struct {
+  sonar_client_context_t context;
+  uint8_t receive_buffer[MAX_ATTR_SIZE + 6];
+  uint8_t request_buffer[sizeof(uint32_t)];
+  uint8_t response_buffer[sizeof(uint32_t)];
+  std::unique_ptr<sonar_attribute_def_t> attr;
+  std::vector<uint8_t> write_data;
+  int fd;
+  bool is_read_pending;
+} client_t;
+
+static std::atomic<int> m_phase;
+static std::vector<std::unique_ptr<client_t>> m_clients;
+// the client which is currently being called into (only accessed from the client thread)
+static client_t* m_active_client;
+static std::atomic<uint64_t> m_num_reads;
+static std::atomic<int> m_num_connected;
+static uint32_t m_attr_value;
+
+static void logging_write_function(const char* str) {
+  // the clients' reads regularly collide with their own connection maintenance requests (and are retried), which logs
+  // an error, so the output is dropped
+}
+
+static uint32_t logging_time_ms_function(void) {
+  return 0;
+}
+
+static uint64_t get_time_ns(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t get_system_time_ms(void) {
+  return get_time_ns(CLOCK_MONOTONIC) / 1000000;
+}
+
+static bool TestAttr_write_handler(const void* data, uint32_t length) {
+  return false;
+}
+
+static uint32_t TestAttr_read_handler(void* response_data, uint32_t response_max_size) {
+  m_attr_value++;
+  memcpy(response_data, &m_attr_value, sizeof(m_attr_value));
+  return sizeof(m_attr_value);
+}
+
+static void client_write_byte(uint8_t byte) {
+  m_active_client->write_data.push_back(byte);
+}
+
+static void client_connection_changed_callback(bool connected) {
+}
+
+static void client_read_complete_handler(bool success, const void* data, uint32_t length) {
+  m_active_client->is_read_pending = false;
+  m_num_reads++;
+}
+
+static void client_write_complete_handler(bool success) {
+}
+
+static bool client_notify_handler(sonar_attribute_t attr, const void* data, uint32_t length) {
+  return false;
+}
+
+static void create_client(int fd) {
+  std::unique_ptr<client_t> client(new client_t());
+  client->fd = fd;
+  client->context.receive_buffer = client->receive_buffer;
+  client->context.receive_buffer_size = sizeof(client->receive_buffer);
+  const sonar_attribute_def_t attr = {
+    ._private = {0},
+    .attribute_id = 0x100,
+    .max_size = sizeof(uint32_t),
+    .ops = SONAR_ATTRIBUTE_OPS_RW,
+    .request_buffer = client->request_buffer,
+    .response_buffer = client->response_buffer,
+  };
+  client->attr.reset(new sonar_attribute_def_t(attr));
+
+  const sonar_client_init_t init_client = {
+    .write_byte = client_write_byte,
+    .get_system_time_ms = get_system_time_ms,
+    .connection_changed_callback = client_connection_changed_callback,
+    .attribute_read_complete_handler = client_read_complete_handler,
+    .attribute_write_complete_handler = client_write_complete_handler,
+    .attribute_notify_handler = client_notify_handler,
+  };
+  sonar_client_init(&client->context, &init_client);
+  sonar_client_register(&client->context, client->attr.get());
+  m_clients.push_back(std::move(client));
+}
+
+static void process_client(client_t* client, const uint8_t* data, uint32_t length) {
+  m_active_client = client;
+  sonar_client_process(&client->context, data, length);
+  if (m_phase == PHASE_LOAD && !client->is_read_pending && sonar_client_is_connected(&client->context)) {
+    client->is_read_pending = sonar_client_read(&client->context, client->attr.get());
+  }
+  m_active_client = nullptr;
+  if (!client->write_data.empty()) {
+    if (write(client->fd, client->write_data.data(), client->write_data.size()) != (ssize_t)client->write_data.size()) {
+      fprintf(stderr, "Failed to write client data\n");
+    }
+    client->write_data.clear();
+  }
+}
+
+static void client_thread() {
+  std::vector<struct pollfd> fds(m_clients.size());
+  for (size_t i = 0; i < m_clients.size(); i++) {
+    fds[i] = {.fd = m_clients[i]->fd, .events = POLLIN, .revents = 0};
+  }
+  while (m_phase != PHASE_DONE) {
+    poll(fds.data(), fds.size(), 10);
+    for (size_t i = 0; i < m_clients.size(); i++) {
+      uint8_t buffer[512];
+      ssize_t length = 0;
+      if (fds[i].revents & POLLIN) {
+        length = read(m_clients[i]->fd, buffer, sizeof(buffer));
+      }
+      process_client(m_clients[i].get(), buffer, length > 0 ? length : 0);
+    }
+  }
+}
+
+static void host_thread(sonar_server_host_handle_t host, uint64_t* cpu_ns) {
+  uint64_t last_cpu_ns = get_time_ns(CLOCK_THREAD_CPUTIME_ID);
+  while (m_phase != PHASE_DONE) {
+    sonar_server_host_run_once(host, 100);
+    const uint64_t now_cpu_ns = get_time_ns(CLOCK_THREAD_CPUTIME_ID);
+    cpu_ns[m_phase] += now_cpu_ns - last_cpu_ns;
+    last_cpu_ns = now_cpu_ns;
+  }
+}
+
+static void connection_changed_callback(sonar_server_host_handle_t handle, uint32_t link_index, bool connected) {
+  m_num_connected += connected ? 1 : -1;
+}
+
+static void print_result(uint32_t num_links, const char* phase_name, uint64_t cpu_ns, uint64_t duration_ns, uint64_t num_reads) {
+  const double duration_s = duration_ns / 1e9;
+  printf("%5u %6s %10.2f %16.1f %14.0f\n", num_links, phase_name, 100.0 * cpu_ns / duration_ns,
+      cpu_ns / 1e3 / duration_s / num_links, num_reads / duration_s);
+}
+
+static void run(uint32_t num_links) {
+  std::vector<int> server_fds(num_links);
+  m_clients.clear();
+  m_num_connected = 0;
+  for (uint32_t i = 0; i < num_links; i++) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) {
+      perror("socketpair");
+      exit(1);
+    }
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    create_client(fds[0]);
+    server_fds[i] = fds[1];
+  }
+  static const sonar_server_attribute_t attrs[] = {SERVER_TEST_ATTR};
+  const sonar_server_host_init_t init_host = {
+    .fds = server_fds.data(),
+    .num_links = num_links,
+    .attrs = attrs,
+    .num_attrs = 1,
+    .max_attr_size = MAX_ATTR_SIZE,
+    .connection_changed_callback = connection_changed_callback,
+    .attribute_notify_complete_handler = nullptr,
+  };
+  sonar_server_host_handle_t host = sonar_server_host_create(&init_host);
+  if (!host) {
+    fprintf(stderr, "Failed to create the host\n");
+    exit(1);
+  }
+
+  uint64_t cpu_ns[NUM_PHASES] = {};
+  m_phase = PHASE_CONNECT;
+  std::thread host_thread_handle(host_thread, host, cpu_ns);
+  std::thread client_thread_handle(client_thread);
+  while (m_num_connected != (int)num_links) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  uint64_t start_ns = get_time_ns(CLOCK_MONOTONIC);
+  m_phase = PHASE_IDLE;
+  std::this_thread::sleep_for(std::chrono::milliseconds(PHASE_DURATION_MS));
+  const uint64_t idle_duration_ns = get_time_ns(CLOCK_MONOTONIC) - start_ns;
+
+  start_ns = get_time_ns(CLOCK_MONOTONIC);
+  const uint64_t start_num_reads = m_num_reads;
+  m_phase = PHASE_LOAD;
+  std::this_thread::sleep_for(std::chrono::milliseconds(PHASE_DURATION_MS));
+  const uint64_t load_duration_ns = get_time_ns(CLOCK_MONOTONIC) - start_ns;
+  const uint64_t num_reads = m_num_reads - start_num_reads;
+
+  m_phase = PHASE_DONE;
+  host_thread_handle.join();
+  client_thread_handle.join();
+  print_result(num_links, "idle", cpu_ns[PHASE_IDLE], idle_duration_ns, 0);
+  print_result(num_links, "load", cpu_ns[PHASE_LOAD], load_duration_ns, num_reads);
+
+  sonar_server_host_destroy(host);
+  for (uint32_t i = 0; i < num_links; i++) {
+    close(server_fds[i]);
+    close(m_clients[i]->fd);
+  }
+}
+
+int main(int argc, char **argv) {
+  const logging_init_t init_logging = {
+    .write_function = logging_write_function,
+    .raw_write_function = nullptr,
+    .lock_function = nullptr,
+    .time_ms_function = logging_time_ms_function,
+    .default_level = LOGGING_LEVEL_WARN,
+  };
+  logging_init(&init_logging);
+
+  printf("%5s %6s %10s %16s %14s\n", "links", "phase", "host CPU %", "CPU us/link/s", "requests/s");
+  const uint32_t link_counts[] = {1, 8, 32};
+  for (uint32_t num_links : link_counts) {
+    run(num_links);
+  }
+  return 0;
+}
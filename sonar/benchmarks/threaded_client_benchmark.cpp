@@ -0,0 +1,196 @@
+// Multithreaded stress and latency benchmark for the threaded SONAR client. A server and client are connected over an
+// in-memory loopback which is driven by a single process thread, while 1 or more application threads submit reads /
+// writes through their own channel and measure the time until each request's completion is polled.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+extern "C" {
+
+#include "anchor/logging/logging.h"
+#include "anchor/sonar/host/threaded_client.h"
+#include "anchor/sonar/server.h"
+
+};
+
+#define MAX_THREADS 8
+#define QUEUE_DEPTH 16
+#define ATTR_SIZE 64
+
+typedef std::chrono::steady_clock benchmark_clock_t;
+
+SONAR_THREADED_CLIENT_DEF(m_client, ATTR_SIZE, MAX_THREADS, QUEUE_DEPTH);
+SONAR_SERVER_DEF(m_server, ATTR_SIZE);
+SONAR_ATTR_DEF(CLIENT_TEST_ATTR, 0x100, ATTR_SIZE, RW);
+SONAR_SERVER_ATTR_DEF(TestAttr, SERVER_TEST_ATTR, 0x100, ATTR_SIZE, RW);
+
+// only accessed from the process thread
+static std::vector<uint8_t> m_client_write_data;
+static std::vector<uint8_t> m_server_write_data;
+static uint8_t m_attr_value[ATTR_SIZE];
+
+static void logging_write_function(const char* str) {
+  fputs(str, stderr);
+}
+
+static uint32_t logging_time_ms_function(void) {
+  return 0;
+}
+
+static void client_write_byte(uint8_t byte) {
+  m_client_write_data.push_back(byte);
+}
+
+static void server_write_byte(uint8_t byte) {
+  m_server_write_data.push_back(byte);
+}
+
+static uint64_t get_system_time_ms(void) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(benchmark_clock_t::now().time_since_epoch()).count();
+}
+
+static bool TestAttr_write_handler(const void* data, uint32_t length) {
+  memcpy(m_attr_value, data, std::min<uint32_t>(length, sizeof(m_attr_value)));
+  return true;
+}
+
+static uint32_t TestAttr_read_handler(void* response_data, uint32_t response_max_size) {
+  memcpy(response_data, m_attr_value, sizeof(m_attr_value));
+  return sizeof(m_attr_value);
+}
+
+static void server_connection_changed_callback(sonar_server_handle_t handle, bool connected) {
+}
+
+static void server_attribute_notify_complete_handler(sonar_server_handle_t handle, bool success) {
+}
+
+static void process() {
+  std::vector<uint8_t> data;
+  data.swap(m_client_write_data);
+  sonar_server_process(m_server, data.data(), data.size());
+  data.clear();
+  data.swap(m_server_write_data);
+  sonar_threaded_client_process(m_client, data.data(), data.size());
+}
+
+static void init() {
+  const sonar_server_init_t init_server = {
+    .write_byte = server_write_byte,
+    .get_system_time_ms = get_system_time_ms,
+    .connection_changed_callback = server_connection_changed_callback,
+    .attribute_notify_complete_handler = server_attribute_notify_complete_handler,
+  };
+  sonar_server_init(m_server, &init_server);
+  sonar_server_register(m_server, SERVER_TEST_ATTR);
+
+  const sonar_threaded_client_init_t init_client = {
+    .write_byte = client_write_byte,
+    .get_system_time_ms = get_system_time_ms,
+    .connection_changed_callback = nullptr,
+    .attribute_notify_handler = nullptr,
+  };
+  sonar_threaded_client_init(m_client, &init_client);
+  sonar_threaded_client_register(m_client, CLIENT_TEST_ATTR);
+
+  m_client_write_data.clear();
+  m_server_write_data.clear();
+  while (!sonar_threaded_client_is_connected(m_client)) {
+    process();
+  }
+}
+
+static void producer_thread(uint32_t index, uint32_t num_requests, std::vector<double>* latencies_us, uint32_t* num_failures) {
+  sonar_threaded_client_channel_t channel = sonar_threaded_client_get_channel(m_client, index);
+  std::vector<benchmark_clock_t::time_point> submit_times(num_requests);
+  uint8_t data[ATTR_SIZE];
+  memset(data, index, sizeof(data));
+  uint32_t num_submitted = 0;
+  uint32_t num_completed = 0;
+  while (num_completed < num_requests) {
+    // keep the channel's queue full
+    while (num_submitted < num_requests) {
+      void* context = (void*)(uintptr_t)num_submitted;
+      submit_times[num_submitted] = benchmark_clock_t::now();
+      const bool submitted = (num_submitted % 2) ?
+          sonar_threaded_client_submit_read(channel, CLIENT_TEST_ATTR, context) :
+          sonar_threaded_client_submit_write(channel, CLIENT_TEST_ATTR, data, sizeof(data), context);
+      if (!submitted) {
+        break;
+      }
+      num_submitted++;
+    }
+    sonar_threaded_client_completion_t completion;
+    while (sonar_threaded_client_poll_completion(channel, &completion)) {
+      const benchmark_clock_t::duration latency = benchmark_clock_t::now() - submit_times[(uintptr_t)completion.context];
+      latencies_us->push_back(std::chrono::duration<double, std::micro>(latency).count());
+      if (!completion.success) {
+        (*num_failures)++;
+      }
+      num_completed++;
+    }
+    std::this_thread::yield();
+  }
+}
+
+static void run(uint32_t num_threads, uint32_t num_requests) {
+  init();
+
+  std::atomic<bool> done(false);
+  std::thread process_thread([&done]() {
+    while (!done.load(std::memory_order_relaxed)) {
+      process();
+      std::this_thread::yield();
+    }
+  });
+
+  std::vector<std::vector<double>> latencies_us(num_threads);
+  std::vector<uint32_t> num_failures(num_threads);
+  std::vector<std::thread> threads;
+  const benchmark_clock_t::time_point start_time = benchmark_clock_t::now();
+  for (uint32_t i = 0; i < num_threads; i++) {
+    latencies_us[i].reserve(num_requests);
+    threads.emplace_back(producer_thread, i, num_requests, &latencies_us[i], &num_failures[i]);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const double duration_s = std::chrono::duration<double>(benchmark_clock_t::now() - start_time).count();
+  done = true;
+  process_thread.join();
+
+  std::vector<double> all_latencies_us;
+  uint32_t total_failures = 0;
+  for (uint32_t i = 0; i < num_threads; i++) {
+    all_latencies_us.insert(all_latencies_us.end(), latencies_us[i].begin(), latencies_us[i].end());
+    total_failures += num_failures[i];
+  }
+  std::sort(all_latencies_us.begin(), all_latencies_us.end());
+  const size_t count = all_latencies_us.size();
+  printf("%7u %10zu %12.0f %10.1f %10.1f %10.1f %9u\n", num_threads, count, count / duration_s,
+      all_latencies_us[count / 2], all_latencies_us[count * 99 / 100], all_latencies_us[count - 1], total_failures);
+}
+
+int main(int argc, char **argv) {
+  const logging_init_t init_logging = {
+    .write_function = logging_write_function,
+    .raw_write_function = nullptr,
+    .lock_function = nullptr,
+    .time_ms_function = logging_time_ms_function,
+    .default_level = LOGGING_LEVEL_WARN,
+  };
+  logging_init(&init_logging);
+
+  const uint32_t num_requests = (argc > 1) ? strtoul(argv[1], NULL, 0) : 20000;
+  printf("%7s %10s %12s %10s %10s %10s %9s\n", "threads", "requests", "requests/s", "p50 (us)", "p99 (us)", "max (us)", "failures");
+  for (uint32_t num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2) {
+    run(num_threads, num_requests);
+  }
+  return 0;
+}
@@ -0,0 +1,179 @@
+// Throughput benchmark for the SONAR transports. A SONAR client and server are connected over a socketpair and driven
+// from a single thread, with the client continuously issuing read requests. This is run both with a naive write_byte
+// function which calls write() for every byte and with the transports (which write each frame with a single call), and
+// reports the number of syscalls per frame along with the achievable frames / requests per second.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+extern "C" {
+
+#include "anchor/logging/logging.h"
+#include "anchor/sonar/client.h"
+#include "anchor/sonar/server.h"
+#include "anchor/sonar/host/transport.h"
+
+};
+
+#define DURATION_MS 2000
+
+SONAR_TRANSPORT_DEF(m_client_transport, 256);
+SONAR_TRANSPORT_DEF(m_server_transport, 256);
+SONAR_CLIENT_DEF(m_client, 64);
+SONAR_SERVER_DEF(m_server, 64);
+SONAR_ATTR_DEF(CLIENT_TEST_ATTR, 0x100, sizeof(uint32_t), RW);
+SONAR_SERVER_ATTR_DEF(TestAttr, SERVER_TEST_ATTR, 0x100, sizeof(uint32_t), RW);
+
+static int m_client_fd;
+static int m_server_fd;
+static uint64_t m_num_reads;
+static uint64_t m_direct_write_calls;
+static uint32_t m_attr_value;
+
+static void logging_write_function(const char* str) {
+  fputs(str, stderr);
+}
+
+static uint32_t logging_time_ms_function(void) {
+  return 0;
+}
+
+static uint64_t get_time_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t get_system_time_ms(void) {
+  return get_time_ns() / 1000000;
+}
+
+static void direct_write_byte(int fd, uint8_t byte) {
+  m_direct_write_calls++;
+  if (write(fd, &byte, sizeof(byte)) != 1) {
+    fprintf(stderr, "Failed to write\n");
+    exit(1);
+  }
+}
+
+static void client_direct_write_byte(uint8_t byte) {
+  direct_write_byte(m_client_fd, byte);
+}
+
+static void server_direct_write_byte(uint8_t byte) {
+  direct_write_byte(m_server_fd, byte);
+}
+
+static void client_connection_changed_callback(bool connected) {
+}
+
+static void client_read_complete_handler(bool success, const void* data, uint32_t length) {
+  m_num_reads++;
+}
+
+static void client_write_complete_handler(bool success) {
+}
+
+static bool client_notify_handler(sonar_attribute_t attr, const void* data, uint32_t length) {
+  return false;
+}
+
+static void server_connection_changed_callback(sonar_server_handle_t handle, bool connected) {
+}
+
+static void server_notify_complete_handler(sonar_server_handle_t handle, bool success) {
+}
+
+static bool TestAttr_write_handler(const void* data, uint32_t length) {
+  return false;
+}
+
+static uint32_t TestAttr_read_handler(void* response_data, uint32_t response_max_size) {
+  m_attr_value++;
+  memcpy(response_data, &m_attr_value, sizeof(m_attr_value));
+  return sizeof(m_attr_value);
+}
+
+static void run(const char* name, bool use_transport) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) {
+    perror("socketpair");
+    exit(1);
+  }
+  m_client_fd = fds[0];
+  m_server_fd = fds[1];
+  sonar_transport_init(m_client_transport, m_client_fd);
+  sonar_transport_init(m_server_transport, m_server_fd);
+  m_num_reads = 0;
+  m_direct_write_calls = 0;
+
+  const sonar_client_init_t init_client = {
+    .write_byte = use_transport ? m_client_transport_write_byte : client_direct_write_byte,
+    .get_system_time_ms = get_system_time_ms,
+    .connection_changed_callback = client_connection_changed_callback,
+    .attribute_read_complete_handler = client_read_complete_handler,
+    .attribute_write_complete_handler = client_write_complete_handler,
+    .attribute_notify_handler = client_notify_handler,
+  };
+  sonar_client_init(m_client, &init_client);
+  sonar_client_register(m_client, CLIENT_TEST_ATTR);
+  const sonar_server_init_t init_server = {
+    .write_byte = use_transport ? m_server_transport_write_byte : server_direct_write_byte,
+    .get_system_time_ms = get_system_time_ms,
+    .connection_changed_callback = server_connection_changed_callback,
+    .attribute_notify_complete_handler = server_notify_complete_handler,
+  };
+  sonar_server_init(m_server, &init_server);
+  sonar_server_register(m_server, SERVER_TEST_ATTR);
+
+  // both sides read through the transports so the read side is the same for both runs
+  const uint64_t start_ns = get_time_ns();
+  uint64_t end_ns;
+  do {
+    uint8_t buffer[4096];
+    int32_t length = sonar_transport_receive(m_client_transport, buffer, sizeof(buffer));
+    sonar_client_process(m_client, buffer, length > 0 ? length : 0);
+    if (sonar_client_is_connected(m_client)) {
+      sonar_client_read(m_client, CLIENT_TEST_ATTR);
+    }
+    length = sonar_transport_receive(m_server_transport, buffer, sizeof(buffer));
+    sonar_server_process(m_server, buffer, length > 0 ? length : 0);
+    end_ns = get_time_ns();
+  } while (end_ns - start_ns < DURATION_MS * 1000000ULL);
+
+  sonar_transport_stats_t client_stats;
+  sonar_transport_stats_t server_stats;
+  sonar_transport_get_stats(m_client_transport, &client_stats);
+  sonar_transport_get_stats(m_server_transport, &server_stats);
+  // every read is a request and response frame
+  const uint64_t num_frames = m_num_reads * 2;
+  const uint64_t write_calls = use_transport ? client_stats.write_calls + server_stats.write_calls : m_direct_write_calls;
+  const uint64_t read_calls = client_stats.read_calls + server_stats.read_calls;
+  const double duration_s = (end_ns - start_ns) / 1e9;
+  printf("%-10s %12.0f %12.0f %14.2f %14.2f\n", name, num_frames / duration_s, m_num_reads / duration_s,
+      (double)write_calls / num_frames, (double)read_calls / num_frames);
+
+  close(m_client_fd);
+  close(m_server_fd);
+}
+
+int main(int argc, char **argv) {
+  const logging_init_t init_logging = {
+    .write_function = logging_write_function,
+    .raw_write_function = nullptr,
+    .lock_function = nullptr,
+    .time_ms_function = logging_time_ms_function,
+    .default_level = LOGGING_LEVEL_WARN,
+  };
+  logging_init(&init_logging);
+
+  printf("%-10s %12s %12s %14s %14s\n", "mode", "frames/s", "requests/s", "writes/frame", "reads/frame");
+  run("per-byte", false);
+  run("transport", true);
+  return 0;
+}
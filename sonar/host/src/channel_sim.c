@@ -0,0 +1,158 @@
+#include "anchor/sonar/host/channel_sim.h"
+
+#include <stddef.h>
+#include <string.h>
+
+// Each byte is serialized with a start bit, 8 data bits, and a stop bit
+#define BITS_PER_BYTE 10
+#define NS_PER_S 1000000000ULL
+#define NS_PER_US 1000ULL
+// xorshift requires a non-zero state, so this is used if the seed is 0
+#define DEFAULT_SEED 0x9E3779B97F4A7C15ULL
+
+typedef struct {
+    sonar_channel_sim_stats_t stats;
+    // The index of the oldest byte in the queue and the number of bytes in it
+    uint32_t head;
+    uint32_t count;
+    // The time at which the transmitter finishes serializing the last byte which was written
+    uint64_t tx_end_time_ns;
+    bool is_in_burst;
+} direction_impl_t;
+
+typedef struct {
+    sonar_channel_sim_config_t config;
+    direction_impl_t dirs[SONAR_CHANNEL_SIM_NUM_DIRS];
+    uint64_t rng_state;
+    uint64_t byte_time_ns;
+    // The direction which last transmitted on a half-duplex line
+    sonar_channel_sim_dir_t line_dir;
+    bool is_line_used;
+} channel_sim_impl_t;
+_Static_assert(sizeof(((sonar_channel_sim_handle_t)0)->_private) >= sizeof(channel_sim_impl_t), "Invalid context size");
+
+static double random_uniform(channel_sim_impl_t* impl) {
+    // xorshift64*
+    impl->rng_state ^= impl->rng_state >> 12;
+    impl->rng_state ^= impl->rng_state << 25;
+    impl->rng_state ^= impl->rng_state >> 27;
+    const uint64_t value = impl->rng_state * 0x2545F4914F6CDD1DULL;
+    // use the upper 53 bits to get a double in [0, 1)
+    return (double)(value >> 11) * (1.0 / (double)(1ULL << 53));
+}
+
+static bool random_event(channel_sim_impl_t* impl, double probability) {
+    // don't consume a random number for disabled events so they don't change the sequence of the others
+    return probability > 0.0 && random_uniform(impl) < probability;
+}
+
+// Returns whether or not the byte should be dropped
+static bool apply_loss(channel_sim_impl_t* impl, direction_impl_t* dir_impl) {
+    if (dir_impl->is_in_burst) {
+        if (random_event(impl, impl->config.burst_end_rate)) {
+            dir_impl->is_in_burst = false;
+        }
+    } else if (random_event(impl, impl->config.burst_start_rate)) {
+        dir_impl->is_in_burst = true;
+    }
+    if (dir_impl->is_in_burst) {
+        dir_impl->stats.burst_bytes_dropped++;
+        return true;
+    }
+    return random_event(impl, impl->config.byte_drop_rate);
+}
+
+static uint8_t apply_bit_errors(channel_sim_impl_t* impl, direction_impl_t* dir_impl, uint8_t byte) {
+    for (uint32_t i = 0; i < 8; i++) {
+        if (random_event(impl, impl->config.bit_error_rate)) {
+            byte ^= 1 << i;
+            dir_impl->stats.bits_flipped++;
+        }
+    }
+    return byte;
+}
+
+// Returns the time at which the transmitter finishes serializing a byte which is written at the current time
+static uint64_t serialize(channel_sim_impl_t* impl, sonar_channel_sim_dir_t dir, uint64_t now_us) {
+    direction_impl_t* dir_impl = &impl->dirs[dir];
+    uint64_t start_time_ns = now_us * NS_PER_US;
+    if (dir_impl->tx_end_time_ns > start_time_ns) {
+        start_time_ns = dir_impl->tx_end_time_ns;
+    }
+    if (impl->config.half_duplex && impl->is_line_used) {
+        // the line is shared, so wait for the other direction to finish transmitting and then turn the line around
+        const uint64_t other_end_time_ns = impl->dirs[1 - dir].tx_end_time_ns;
+        uint64_t line_free_time_ns = other_end_time_ns;
+        if (impl->line_dir != dir) {
+            line_free_time_ns += (uint64_t)impl->config.turnaround_us * NS_PER_US;
+        }
+        if (line_free_time_ns > start_time_ns) {
+            start_time_ns = line_free_time_ns;
+        }
+    }
+    impl->line_dir = dir;
+    impl->is_line_used = true;
+    dir_impl->tx_end_time_ns = start_time_ns + impl->byte_time_ns;
+    return dir_impl->tx_end_time_ns;
+}
+
+void sonar_channel_sim_init(sonar_channel_sim_handle_t handle, const sonar_channel_sim_config_t* config) {
+    channel_sim_impl_t* impl = (channel_sim_impl_t*)handle->_private;
+    memset(impl, 0, sizeof(*impl));
+    impl->config = *config;
+    impl->rng_state = config->seed ? config->seed : DEFAULT_SEED;
+    impl->byte_time_ns = config->baud_rate ? (BITS_PER_BYTE * NS_PER_S) / config->baud_rate : 0;
+}
+
+void sonar_channel_sim_write(sonar_channel_sim_handle_t handle, sonar_channel_sim_dir_t dir, uint8_t byte, uint64_t now_us) {
+    channel_sim_impl_t* impl = (channel_sim_impl_t*)handle->_private;
+    direction_impl_t* dir_impl = &impl->dirs[dir];
+    dir_impl->stats.bytes_written++;
+    // dropped bytes still take up time on the line
+    const uint64_t tx_end_time_ns = serialize(impl, dir, now_us);
+    if (apply_loss(impl, dir_impl)) {
+        dir_impl->stats.bytes_dropped++;
+        return;
+    }
+    byte = apply_bit_errors(impl, dir_impl, byte);
+    if (dir_impl->count == handle->queue_size) {
+        dir_impl->stats.queue_overflows++;
+        return;
+    }
+    // the delivery time is rounded up to the next microsecond
+    const uint64_t delivery_time_us = (tx_end_time_ns + NS_PER_US - 1) / NS_PER_US + impl->config.latency_us;
+    sonar_channel_sim_entry_t* queue = &handle->queue_buffer[dir * handle->queue_size];
+    sonar_channel_sim_entry_t* entry = &queue[(dir_impl->head + dir_impl->count) % handle->queue_size];
+    entry->delivery_time_us = delivery_time_us;
+    entry->byte = byte;
+    dir_impl->count++;
+}
+
+uint32_t sonar_channel_sim_read(sonar_channel_sim_handle_t handle, sonar_channel_sim_dir_t dir, uint64_t now_us, uint8_t* buffer, uint32_t size) {
+    channel_sim_impl_t* impl = (channel_sim_impl_t*)handle->_private;
+    direction_impl_t* dir_impl = &impl->dirs[dir];
+    const sonar_channel_sim_entry_t* queue = &handle->queue_buffer[dir * handle->queue_size];
+    uint32_t num_read = 0;
+    // the delivery times are in increasing order since every byte has the same latency
+    while (num_read < size && dir_impl->count && queue[dir_impl->head].delivery_time_us <= now_us) {
+        buffer[num_read++] = queue[dir_impl->head].byte;
+        dir_impl->head = (dir_impl->head + 1) % handle->queue_size;
+        dir_impl->count--;
+    }
+    dir_impl->stats.bytes_delivered += num_read;
+    return num_read;
+}
+
+uint64_t sonar_channel_sim_get_next_delivery_us(sonar_channel_sim_handle_t handle, sonar_channel_sim_dir_t dir) {
+    channel_sim_impl_t* impl = (channel_sim_impl_t*)handle->_private;
+    const direction_impl_t* dir_impl = &impl->dirs[dir];
+    if (!dir_impl->count) {
+        return UINT64_MAX;
+    }
+    return handle->queue_buffer[dir * handle->queue_size + dir_impl->head].delivery_time_us;
+}
+
+void sonar_channel_sim_get_stats(sonar_channel_sim_handle_t handle, sonar_channel_sim_dir_t dir, sonar_channel_sim_stats_t* stats) {
+    channel_sim_impl_t* impl = (channel_sim_impl_t*)handle->_private;
+    *stats = impl->dirs[dir].stats;
+}
@@ -0,0 +1,92 @@
+#include "anchor/sonar/host/replay.h"
+
+// Bound on the number of deadlines which are handled at the same time before giving up on the deadline advancing
+#define MAX_DEADLINES_PER_TIME 16
+
+typedef struct {
+    const sonar_replay_init_t* init;
+    sonar_replay_result_t* result;
+    uint64_t time_ms;
+} replay_state_t;
+
+static void set_time(replay_state_t* state, uint64_t time_ms) {
+    state->time_ms = time_ms;
+    state->init->set_time_ms(state->init->handle, time_ms);
+}
+
+// Handles all the deadlines before the specified time (or up to and including it if inclusive is set) and then sets
+// the virtual clock to it
+// NOTE: Deadlines at the time of received data are handled by the same process call as the data
+static void run_until(replay_state_t* state, uint64_t time_ms, bool inclusive) {
+    uint32_t num_at_time = 0;
+    while (true) {
+        uint64_t deadline_ms = state->init->get_next_deadline_ms(state->init->handle);
+        if (deadline_ms > time_ms || (deadline_ms == time_ms && !inclusive)) {
+            break;
+        }
+        if (deadline_ms <= state->time_ms) {
+            // the deadline has already been reached, so guard against it never advancing
+            if (++num_at_time > MAX_DEADLINES_PER_TIME) {
+                break;
+            }
+            deadline_ms = state->time_ms;
+        } else {
+            num_at_time = 0;
+        }
+        set_time(state, deadline_ms);
+        state->init->process(state->init->handle, NULL, 0);
+        state->result->num_deadlines++;
+    }
+    set_time(state, time_ms);
+}
+
+uint64_t sonar_replay_get_start_time_ms(const uint8_t* trace, uint32_t length) {
+    sonar_capture_record_t record;
+    if (!sonar_capture_parse_record(trace, length, &record)) {
+        return 0;
+    }
+    return record.time_ms;
+}
+
+bool sonar_replay_run(const uint8_t* trace, uint32_t length, const sonar_replay_init_t* init, sonar_replay_result_t* result) {
+    *result = (sonar_replay_result_t){0};
+    replay_state_t state = {
+        .init = init,
+        .result = result,
+    };
+    uint32_t prev_time_ms = 0;
+    uint32_t offset = 0;
+    while (offset < length) {
+        sonar_capture_record_t record;
+        const uint32_t record_length = sonar_capture_parse_record(&trace[offset], length - offset, &record);
+        if (!record_length) {
+            return false;
+        }
+        offset += record_length;
+
+        // the record only has the lower 32 bits of the time, so extend it based on the previous one
+        uint64_t time_ms;
+        if (!result->num_records) {
+            time_ms = record.time_ms;
+            result->is_server = record.is_server;
+            result->start_time_ms = time_ms;
+            set_time(&state, time_ms);
+        } else {
+            time_ms = state.time_ms + (uint32_t)(record.time_ms - prev_time_ms);
+        }
+        prev_time_ms = record.time_ms;
+        result->num_records++;
+        result->end_time_ms = time_ms;
+
+        run_until(&state, time_ms, false);
+        if (record.type == SONAR_CAPTURE_TYPE_RX_RAW) {
+            init->process(init->handle, record.data, record.length);
+            result->num_rx_chunks++;
+            result->num_rx_bytes += record.length;
+        } else if (record.type == SONAR_CAPTURE_TYPE_TX_FRAME) {
+            result->num_tx_frames++;
+        }
+    }
+    run_until(&state, result->end_time_ms, true);
+    return true;
+}
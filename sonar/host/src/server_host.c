@@ -0,0 +1,412 @@
+// clock_gettime() is POSIX rather than ISO C
+#if !defined(_POSIX_C_SOURCE) && !defined(_GNU_SOURCE)
+#define _POSIX_C_SOURCE 199309L
+#endif
+#include "anchor/sonar/host/server_host.h"
+
+#define LOGGING_MODULE_NAME "SONAR"
+#include "anchor/logging/logging.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_EPOLL_EVENTS        32
+#define READ_BUFFER_SIZE        512
+#define INITIAL_TX_BUFFER_SIZE  256
+
+typedef struct {
+    sonar_attribute_def_t def;
+    struct sonar_server_attribute server_attr;
+} attr_copy_t;
+
+typedef struct {
+    sonar_server_host_handle_t host;
+    uint32_t index;
+    int fd;
+    bool is_open;
+    bool is_waiting_for_writable;
+    struct sonar_server_context server;
+    attr_copy_t* attrs;
+    // Buffer of data which was written by the server but hasn't been written to the fd yet
+    uint8_t* tx_buffer;
+    uint32_t tx_buffer_size;
+    uint32_t tx_length;
+} link_impl_t;
+
+struct sonar_server_host {
+    sonar_server_host_init_t init;
+    int epoll_fd;
+    link_impl_t* links;
+    // Buffers which are allocated for all links in a single allocation
+    uint8_t* buffers;
+};
+
+// The server's write_byte() function doesn't get passed a handle, so the link which is currently calling into its
+// server is tracked here
+static _Thread_local link_impl_t* m_active_link;
+
+static uint64_t get_system_time_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static link_impl_t* get_link_from_server(sonar_server_handle_t server) {
+    return (link_impl_t*)((uint8_t*)server - offsetof(link_impl_t, server));
+}
+
+static void write_byte(uint8_t byte) {
+    link_impl_t* link = m_active_link;
+    if (!link) {
+        LOG_ERROR("Write from outside of the server host");
+        return;
+    }
+    if (link->tx_length == link->tx_buffer_size) {
+        const uint32_t new_size = link->tx_buffer_size ? link->tx_buffer_size * 2 : INITIAL_TX_BUFFER_SIZE;
+        uint8_t* new_buffer = realloc(link->tx_buffer, new_size);
+        if (!new_buffer) {
+            LOG_ERROR("Failed to grow the TX buffer");
+            return;
+        }
+        link->tx_buffer = new_buffer;
+        link->tx_buffer_size = new_size;
+    }
+    link->tx_buffer[link->tx_length++] = byte;
+}
+
+static void connection_changed_callback(sonar_server_handle_t handle, bool connected) {
+    link_impl_t* link = get_link_from_server(handle);
+    if (link->host->init.connection_changed_callback) {
+        link->host->init.connection_changed_callback(link->host, link->index, connected);
+    }
+}
+
+static void attribute_notify_complete_handler(sonar_server_handle_t handle, bool success) {
+    link_impl_t* link = get_link_from_server(handle);
+    if (link->host->init.attribute_notify_complete_handler) {
+        link->host->init.attribute_notify_complete_handler(link->host, link->index, success);
+    }
+}
+
+static sonar_server_attribute_t get_template_attr(link_impl_t* link, sonar_server_attribute_t server_attr) {
+    const attr_copy_t* copy = (const attr_copy_t*)((uint8_t*)server_attr - offsetof(attr_copy_t, server_attr));
+    return link->host->init.attrs[copy - link->attrs];
+}
+
+static uint32_t attribute_read_handler(sonar_server_handle_t handle, sonar_server_attribute_t attr, void* response_data, uint32_t response_max_size) {
+    link_impl_t* link = get_link_from_server(handle);
+    if (link->host->init.attribute_read_handler) {
+        return link->host->init.attribute_read_handler(link->host, link->index, get_template_attr(link, attr), response_data, response_max_size);
+    }
+    return attr->read_handler(response_data, response_max_size);
+}
+
+static bool attribute_write_handler(sonar_server_handle_t handle, sonar_server_attribute_t attr, const void* data, uint32_t length) {
+    link_impl_t* link = get_link_from_server(handle);
+    if (link->host->init.attribute_write_handler) {
+        return link->host->init.attribute_write_handler(link->host, link->index, get_template_attr(link, attr), data, length);
+    }
+    return attr->write_handler(data, length);
+}
+
+static bool update_epoll_events(sonar_server_host_handle_t host, link_impl_t* link, int op) {
+    struct epoll_event event = {
+        .events = EPOLLIN | (link->is_waiting_for_writable ? EPOLLOUT : 0),
+        .data.ptr = link,
+    };
+    if (epoll_ctl(host->epoll_fd, op, link->fd, &event)) {
+        LOG_ERROR("Failed to update epoll for link %"PRIu32" (%d)", link->index, errno);
+        return false;
+    }
+    return true;
+}
+
+static void close_link(sonar_server_host_handle_t host, link_impl_t* link) {
+    // the caller owns the fd, so just stop polling it
+    epoll_ctl(host->epoll_fd, EPOLL_CTL_DEL, link->fd, NULL);
+    link->is_open = false;
+    link->tx_length = 0;
+}
+
+static void flush_tx(sonar_server_host_handle_t host, link_impl_t* link) {
+    uint32_t offset = 0;
+    while (offset < link->tx_length) {
+        const ssize_t result = write(link->fd, &link->tx_buffer[offset], link->tx_length - offset);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR("Failed to write to link %"PRIu32" (%d)", link->index, errno);
+                close_link(host, link);
+                return;
+            }
+            break;
+        }
+        offset += result;
+    }
+    // keep whatever we couldn't write and wait for the fd to be writable again
+    memmove(link->tx_buffer, &link->tx_buffer[offset], link->tx_length - offset);
+    link->tx_length -= offset;
+    const bool should_wait_for_writable = link->tx_length > 0;
+    if (should_wait_for_writable != link->is_waiting_for_writable) {
+        link->is_waiting_for_writable = should_wait_for_writable;
+        update_epoll_events(host, link, EPOLL_CTL_MOD);
+    }
+}
+
+static void process_link(sonar_server_host_handle_t host, link_impl_t* link, const uint8_t* data, uint32_t length) {
+    m_active_link = link;
+    sonar_server_process(&link->server, data, length);
+    m_active_link = NULL;
+    flush_tx(host, link);
+}
+
+static void handle_readable(sonar_server_host_handle_t host, link_impl_t* link) {
+    uint8_t buffer[READ_BUFFER_SIZE];
+    while (link->is_open) {
+        const ssize_t result = read(link->fd, buffer, sizeof(buffer));
+        if (result > 0) {
+            process_link(host, link, buffer, result);
+        } else if (result == 0) {
+            LOG_WARN("Link %"PRIu32" was closed", link->index);
+            close_link(host, link);
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR("Failed to read from link %"PRIu32" (%d)", link->index, errno);
+                close_link(host, link);
+            }
+            break;
+        }
+    }
+}
+
+static void init_attr_copy(attr_copy_t* copy, sonar_server_attribute_t template_attr, uint8_t** buffers) {
+    const sonar_attribute_def_t* template_def = template_attr->attr;
+    const uint32_t size = template_def->max_size;
+    // allocate the same buffers as the template attribute has
+    uint8_t* request_buffer = NULL;
+    if (template_def->request_buffer) {
+        request_buffer = *buffers;
+        *buffers += size;
+    }
+    uint8_t* response_buffer = NULL;
+    if (template_def->response_buffer) {
+        response_buffer = *buffers;
+        *buffers += size;
+    }
+#if SONAR_ATTR_DELTA_NOTIFY
+    uint8_t* delta_buffer = NULL;
+    if (template_def->delta_buffer) {
+        delta_buffer = *buffers;
+        *buffers += size;
+    }
+#endif
+    // the definition has const fields, so needs to be copied in
+    const sonar_attribute_def_t def = {
+        ._private = {0},
+        .attribute_id = template_def->attribute_id,
+        .max_size = size,
+        .ops = template_def->ops,
+        .request_buffer = request_buffer,
+        .response_buffer = response_buffer,
+#if SONAR_ATTR_DELTA_NOTIFY
+        .delta_buffer = delta_buffer,
+#endif
+    };
+    memcpy(&copy->def, &def, sizeof(def));
+    copy->server_attr = (struct sonar_server_attribute){
+        .attr = &copy->def,
+        .read_handler = template_attr->read_handler,
+        .write_handler = template_attr->write_handler,
+        .stream_read_handler = template_attr->stream_read_handler,
+    };
+}
+
+static uint32_t get_attr_buffers_size(sonar_server_attribute_t template_attr) {
+    const sonar_attribute_def_t* def = template_attr->attr;
+    uint32_t num_buffers = (def->request_buffer ? 1 : 0) + (def->response_buffer ? 1 : 0);
+#if SONAR_ATTR_DELTA_NOTIFY
+    num_buffers += def->delta_buffer ? 1 : 0;
+#endif
+    return num_buffers * def->max_size;
+}
+
+static uint32_t get_link_buffers_size(const sonar_server_host_init_t* init) {
+    uint32_t size = init->max_attr_size + 6;
+#if SONAR_ATTR_SHARED_BUFFERS
+    size += init->max_attr_size * 2;
+#endif
+    for (uint32_t i = 0; i < init->num_attrs; i++) {
+        size += get_attr_buffers_size(init->attrs[i]);
+    }
+    return size;
+}
+
+sonar_server_host_handle_t sonar_server_host_create(const sonar_server_host_init_t* init) {
+    for (uint32_t i = 0; i < init->num_attrs; i++) {
+        if (init->attrs[i]->attr->max_size > init->max_attr_size) {
+            LOG_ERROR("Attribute is larger than the max attribute size (0x%x)", init->attrs[i]->attr->attribute_id);
+            return NULL;
+        }
+    }
+
+    sonar_server_host_handle_t host = calloc(1, sizeof(struct sonar_server_host));
+    if (!host) {
+        return NULL;
+    }
+    host->init = *init;
+    host->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    host->links = calloc(init->num_links, sizeof(link_impl_t));
+    const uint32_t link_buffers_size = get_link_buffers_size(init);
+    host->buffers = calloc(init->num_links, link_buffers_size);
+    if (host->epoll_fd < 0 || !host->links || !host->buffers) {
+        LOG_ERROR("Failed to allocate the server host");
+        sonar_server_host_destroy(host);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < init->num_links; i++) {
+        link_impl_t* link = &host->links[i];
+        uint8_t* buffers = &host->buffers[i * link_buffers_size];
+        link->host = host;
+        link->index = i;
+        link->fd = init->fds[i];
+        link->attrs = calloc(init->num_attrs, sizeof(attr_copy_t));
+        if (!link->attrs) {
+            sonar_server_host_destroy(host);
+            return NULL;
+        }
+
+        link->server.receive_buffer = buffers;
+        link->server.receive_buffer_size = init->max_attr_size + 6;
+        buffers += link->server.receive_buffer_size;
+#if SONAR_ATTR_SHARED_BUFFERS
+        link->server.shared_request_buffer = buffers;
+        buffers += init->max_attr_size;
+        link->server.shared_response_buffer = buffers;
+        buffers += init->max_attr_size;
+        link->server.shared_buffer_size = init->max_attr_size;
+#endif
+        const sonar_server_init_t init_server = {
+            .write_byte = write_byte,
+            .get_system_time_ms = get_system_time_ms,
+            .connection_changed_callback = connection_changed_callback,
+            .attribute_notify_complete_handler = attribute_notify_complete_handler,
+            .attribute_read_handler = attribute_read_handler,
+            .attribute_write_handler = attribute_write_handler,
+        };
+        sonar_server_init(&link->server, &init_server);
+        for (uint32_t j = 0; j < init->num_attrs; j++) {
+            init_attr_copy(&link->attrs[j], init->attrs[j], &buffers);
+            sonar_server_register(&link->server, &link->attrs[j].server_attr);
+        }
+
+        const int flags = fcntl(link->fd, F_GETFL);
+        if (flags < 0 || fcntl(link->fd, F_SETFL, flags | O_NONBLOCK) || !update_epoll_events(host, link, EPOLL_CTL_ADD)) {
+            LOG_ERROR("Failed to set up link %"PRIu32, i);
+            sonar_server_host_destroy(host);
+            return NULL;
+        }
+        link->is_open = true;
+    }
+    return host;
+}
+
+void sonar_server_host_destroy(sonar_server_host_handle_t host) {
+    if (host->links) {
+        for (uint32_t i = 0; i < host->init.num_links; i++) {
+            free(host->links[i].attrs);
+            free(host->links[i].tx_buffer);
+        }
+    }
+    if (host->epoll_fd >= 0) {
+        close(host->epoll_fd);
+    }
+    free(host->links);
+    free(host->buffers);
+    free(host);
+}
+
+bool sonar_server_host_run_once(sonar_server_host_handle_t host, int timeout_ms) {
+    // wait until the next deadline of any of the servers at the latest
+    uint64_t next_deadline_ms = UINT64_MAX;
+    for (uint32_t i = 0; i < host->init.num_links; i++) {
+        const uint64_t deadline_ms = sonar_server_get_next_deadline_ms(&host->links[i].server);
+        if (host->links[i].is_open && deadline_ms < next_deadline_ms) {
+            next_deadline_ms = deadline_ms;
+        }
+    }
+    if (next_deadline_ms != UINT64_MAX) {
+        const uint64_t time_ms = get_system_time_ms();
+        const uint64_t ms_until_deadline = next_deadline_ms > time_ms ? next_deadline_ms - time_ms : 0;
+        if (timeout_ms < 0 || ms_until_deadline < (uint64_t)timeout_ms) {
+            timeout_ms = ms_until_deadline;
+        }
+    }
+
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    const int num_events = epoll_wait(host->epoll_fd, events, MAX_EPOLL_EVENTS, timeout_ms);
+    if (num_events < 0) {
+        if (errno == EINTR) {
+            return true;
+        }
+        LOG_ERROR("Failed to wait for events (%d)", errno);
+        return false;
+    }
+    for (int i = 0; i < num_events; i++) {
+        link_impl_t* link = events[i].data.ptr;
+        if (link->is_open && (events[i].events & EPOLLOUT)) {
+            flush_tx(host, link);
+        }
+        if (link->is_open && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+            handle_readable(host, link);
+        }
+    }
+
+    // process any links whose deadline has passed
+    if (next_deadline_ms != UINT64_MAX) {
+        const uint64_t time_ms = get_system_time_ms();
+        for (uint32_t i = 0; i < host->init.num_links; i++) {
+            link_impl_t* link = &host->links[i];
+            if (link->is_open && sonar_server_get_next_deadline_ms(&link->server) <= time_ms) {
+                process_link(host, link, NULL, 0);
+            }
+        }
+    }
+    return true;
+}
+
+sonar_server_handle_t sonar_server_host_get_server(sonar_server_host_handle_t host, uint32_t link_index) {
+    if (link_index >= host->init.num_links) {
+        LOG_ERROR("Invalid link index (%"PRIu32")", link_index);
+        return NULL;
+    }
+    return &host->links[link_index].server;
+}
+
+bool sonar_server_host_notify(sonar_server_host_handle_t host, uint32_t link_index, sonar_server_attribute_t attr, const void* data, uint32_t length) {
+    if (link_index >= host->init.num_links || !host->links[link_index].is_open) {
+        LOG_ERROR("Invalid link index (%"PRIu32")", link_index);
+        return false;
+    }
+    link_impl_t* link = &host->links[link_index];
+    for (uint32_t i = 0; i < host->init.num_attrs; i++) {
+        if (host->init.attrs[i] == attr) {
+            m_active_link = link;
+            const bool result = sonar_server_notify(&link->server, &link->attrs[i].server_attr, data, length);
+            m_active_link = NULL;
+            flush_tx(host, link);
+            return result;
+        }
+    }
+    LOG_ERROR("Unknown attribute for notify");
+    return false;
+}
@@ -0,0 +1,51 @@
+#include "spsc_queue.h"
+
+static uint32_t next_index(const spsc_queue_t* queue, uint32_t index) {
+    index++;
+    return index == queue->num_slots ? 0 : index;
+}
+
+void spsc_queue_init(spsc_queue_t* queue, uint8_t* buffer, uint32_t slot_size, uint32_t num_slots) {
+    *queue = (spsc_queue_t){
+        .buffer = buffer,
+        .slot_size = slot_size,
+        .num_slots = num_slots,
+    };
+    atomic_init(&queue->write_index, 0);
+    atomic_init(&queue->read_index, 0);
+}
+
+void* spsc_queue_reserve(spsc_queue_t* queue) {
+    const uint32_t write_index = atomic_load_explicit(&queue->write_index, memory_order_relaxed);
+    const uint32_t next_write_index = next_index(queue, write_index);
+    if (next_write_index == queue->cached_read_index) {
+        // only go to the shared read index when our cached copy says we're full
+        queue->cached_read_index = atomic_load_explicit(&queue->read_index, memory_order_acquire);
+        if (next_write_index == queue->cached_read_index) {
+            return NULL;
+        }
+    }
+    return &queue->buffer[write_index * queue->slot_size];
+}
+
+void spsc_queue_commit(spsc_queue_t* queue) {
+    const uint32_t write_index = atomic_load_explicit(&queue->write_index, memory_order_relaxed);
+    atomic_store_explicit(&queue->write_index, next_index(queue, write_index), memory_order_release);
+}
+
+void* spsc_queue_peek(spsc_queue_t* queue) {
+    const uint32_t read_index = atomic_load_explicit(&queue->read_index, memory_order_relaxed);
+    if (read_index == queue->cached_write_index) {
+        // only go to the shared write index when our cached copy says we're empty
+        queue->cached_write_index = atomic_load_explicit(&queue->write_index, memory_order_acquire);
+        if (read_index == queue->cached_write_index) {
+            return NULL;
+        }
+    }
+    return &queue->buffer[read_index * queue->slot_size];
+}
+
+void spsc_queue_pop(spsc_queue_t* queue) {
+    const uint32_t read_index = atomic_load_explicit(&queue->read_index, memory_order_relaxed);
+    atomic_store_explicit(&queue->read_index, next_index(queue, read_index), memory_order_release);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// The assumed size of a cache line, used to keep the producer and consumer state from sharing one
+#define SPSC_QUEUE_CACHE_LINE_SIZE 64
+
+// A lock-free single-producer / single-consumer queue of fixed-size slots. One slot is always left empty to distinguish
+// a full queue from an empty one, so the buffer must contain (depth + 1) slots.
+typedef struct {
+    uint8_t* buffer;
+    uint32_t slot_size;
+    uint32_t num_slots;
+    uint8_t _pad0[SPSC_QUEUE_CACHE_LINE_SIZE];
+    // Owned by the producer
+    _Atomic uint32_t write_index;
+    uint32_t cached_read_index;
+    uint8_t _pad1[SPSC_QUEUE_CACHE_LINE_SIZE];
+    // Owned by the consumer
+    _Atomic uint32_t read_index;
+    uint32_t cached_write_index;
+    uint8_t _pad2[SPSC_QUEUE_CACHE_LINE_SIZE];
+} spsc_queue_t;
+
+// Initializes the queue with a buffer of (slot_size * num_slots) bytes
+void spsc_queue_init(spsc_queue_t* queue, uint8_t* buffer, uint32_t slot_size, uint32_t num_slots);
+
+// Gets the next free slot to be written by the producer (or NULL if the queue is full)
+void* spsc_queue_reserve(spsc_queue_t* queue);
+
+// Makes the slot returned by spsc_queue_reserve() available to the consumer
+void spsc_queue_commit(spsc_queue_t* queue);
+
+// Gets the oldest slot to be read by the consumer (or NULL if the queue is empty)
+void* spsc_queue_peek(spsc_queue_t* queue);
+
+// Releases the slot returned by spsc_queue_peek() back to the producer
+void spsc_queue_pop(spsc_queue_t* queue);
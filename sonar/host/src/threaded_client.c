@@ -0,0 +1,237 @@
+#include "anchor/sonar/host/threaded_client.h"
+
+#include "spsc_queue.h"
+
+#define LOGGING_MODULE_NAME "SONAR"
+#include "anchor/logging/logging.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+typedef struct {
+    // Requests from the application thread to the process thread
+    spsc_queue_t request_queue;
+    // Completions from the process thread to the application thread
+    spsc_queue_t completion_queue;
+    uint32_t max_data_size;
+    // Whether or not the application thread still holds the oldest completion (only accessed by the application thread)
+    bool is_completion_held;
+} channel_impl_t;
+_Static_assert(sizeof(((sonar_threaded_client_channel_t)0)->_private) >= sizeof(channel_impl_t), "Invalid channel context size");
+
+typedef struct {
+    sonar_threaded_client_init_t init;
+    // The channel which the in-flight request came from (NULL if there isn't one)
+    channel_impl_t* active_channel;
+    sonar_threaded_client_completion_t active_request;
+    uint32_t next_channel_index;
+    atomic_bool is_connected;
+} instance_impl_t;
+_Static_assert(sizeof(((sonar_threaded_client_handle_t)0)->_private) >= sizeof(instance_impl_t), "Invalid context size");
+
+static channel_impl_t* get_channel(sonar_threaded_client_handle_t handle, uint32_t index) {
+    return (channel_impl_t*)handle->channels[index]._private;
+}
+
+static uint8_t* get_slot_data(sonar_threaded_client_completion_t* slot) {
+    return (uint8_t*)&slot[1];
+}
+
+static void push_completion(instance_impl_t* inst, bool success, const void* data, uint32_t length) {
+    channel_impl_t* channel = inst->active_channel;
+    // space for this was guaranteed before the request was issued
+    sonar_threaded_client_completion_t* slot = spsc_queue_reserve(&channel->completion_queue);
+    if (!slot) {
+        LOG_ERROR("Completion queue is full");
+        return;
+    }
+    *slot = inst->active_request;
+    slot->success = success;
+    slot->data = NULL;
+    slot->length = 0;
+    if (success && data && length <= channel->max_data_size) {
+        memcpy(get_slot_data(slot), data, length);
+        slot->length = length;
+    }
+    spsc_queue_commit(&channel->completion_queue);
+}
+
+static bool issue_request(sonar_threaded_client_handle_t handle, const sonar_threaded_client_completion_t* request) {
+    switch (request->op) {
+        case SONAR_THREADED_CLIENT_OP_READ:
+            return sonar_client_read(handle->client, request->attr);
+        case SONAR_THREADED_CLIENT_OP_WRITE:
+            return sonar_client_write(handle->client, request->attr, &request[1], request->length);
+        default:
+            LOG_ERROR("Invalid op (%d)", request->op);
+            return false;
+    }
+}
+
+static void issue_next_request(sonar_threaded_client_handle_t handle, instance_impl_t* inst) {
+    // go through the channels in a round-robin order so a single busy channel can't starve the others
+    for (uint32_t i = 0; i < handle->num_channels && !inst->active_channel; i++) {
+        const uint32_t index = inst->next_channel_index;
+        inst->next_channel_index = (index + 1) % handle->num_channels;
+        channel_impl_t* channel = get_channel(handle, index);
+        sonar_threaded_client_completion_t* request = spsc_queue_peek(&channel->request_queue);
+        if (!request) {
+            continue;
+        }
+        // don't issue a request until there's space for its completion
+        if (!spsc_queue_reserve(&channel->completion_queue)) {
+            continue;
+        }
+        inst->active_channel = channel;
+        inst->active_request = *request;
+        // the underlying client copies the data for writes, so the request can be popped right away
+        const bool issued = issue_request(handle, request);
+        spsc_queue_pop(&channel->request_queue);
+        if (!issued) {
+            // fail it right away
+            push_completion(inst, false, NULL, 0);
+            inst->active_channel = NULL;
+        }
+    }
+}
+
+void sonar_threaded_client_init(sonar_threaded_client_handle_t handle, const sonar_threaded_client_init_t* init) {
+    instance_impl_t* inst = (instance_impl_t*)handle->_private;
+    *inst = (instance_impl_t){
+        .init = *init,
+    };
+    atomic_init(&inst->is_connected, false);
+
+    const uint32_t slot_size = _SONAR_THREADED_CLIENT_SLOT_SIZE(handle->max_attr_size);
+    const uint32_t num_slots = handle->queue_depth + 1;
+    uint8_t* queue_buffer = (uint8_t*)handle->queue_buffer;
+    for (uint32_t i = 0; i < handle->num_channels; i++) {
+        channel_impl_t* channel = get_channel(handle, i);
+        *channel = (channel_impl_t){
+            .max_data_size = handle->max_attr_size,
+        };
+        spsc_queue_init(&channel->request_queue, queue_buffer, slot_size, num_slots);
+        queue_buffer += slot_size * num_slots;
+        spsc_queue_init(&channel->completion_queue, queue_buffer, slot_size, num_slots);
+        queue_buffer += slot_size * num_slots;
+    }
+
+    sonar_client_init_t init_client = handle->client_handlers;
+    init_client.write_byte = init->write_byte;
+    init_client.get_system_time_ms = init->get_system_time_ms;
+    sonar_client_init(handle->client, &init_client);
+}
+
+void sonar_threaded_client_register(sonar_threaded_client_handle_t handle, sonar_attribute_t attr) {
+    sonar_client_register(handle->client, attr);
+}
+
+void sonar_threaded_client_process(sonar_threaded_client_handle_t handle, const uint8_t* received_data, uint32_t received_data_length) {
+    instance_impl_t* inst = (instance_impl_t*)handle->_private;
+    sonar_client_process(handle->client, received_data, received_data_length);
+    issue_next_request(handle, inst);
+}
+
+bool sonar_threaded_client_is_connected(sonar_threaded_client_handle_t handle) {
+    instance_impl_t* inst = (instance_impl_t*)handle->_private;
+    return atomic_load_explicit(&inst->is_connected, memory_order_acquire);
+}
+
+sonar_threaded_client_channel_t sonar_threaded_client_get_channel(sonar_threaded_client_handle_t handle, uint32_t index) {
+    if (index >= handle->num_channels) {
+        LOG_ERROR("Invalid channel index (%"PRIu32")", index);
+        return NULL;
+    }
+    return &handle->channels[index];
+}
+
+bool sonar_threaded_client_submit_read(sonar_threaded_client_channel_t channel_handle, sonar_attribute_t attr, void* context) {
+    channel_impl_t* channel = (channel_impl_t*)channel_handle->_private;
+    sonar_threaded_client_completion_t* slot = spsc_queue_reserve(&channel->request_queue);
+    if (!slot) {
+        return false;
+    }
+    *slot = (sonar_threaded_client_completion_t){
+        .attr = attr,
+        .context = context,
+        .op = SONAR_THREADED_CLIENT_OP_READ,
+    };
+    spsc_queue_commit(&channel->request_queue);
+    return true;
+}
+
+bool sonar_threaded_client_submit_write(sonar_threaded_client_channel_t channel_handle, sonar_attribute_t attr, const void* data, uint32_t length, void* context) {
+    channel_impl_t* channel = (channel_impl_t*)channel_handle->_private;
+    if (length > channel->max_data_size) {
+        LOG_ERROR("Write data is too large (%"PRIu32")", length);
+        return false;
+    }
+    sonar_threaded_client_completion_t* slot = spsc_queue_reserve(&channel->request_queue);
+    if (!slot) {
+        return false;
+    }
+    *slot = (sonar_threaded_client_completion_t){
+        .attr = attr,
+        .context = context,
+        .op = SONAR_THREADED_CLIENT_OP_WRITE,
+        .length = length,
+    };
+    memcpy(get_slot_data(slot), data, length);
+    spsc_queue_commit(&channel->request_queue);
+    return true;
+}
+
+bool sonar_threaded_client_poll_completion(sonar_threaded_client_channel_t channel_handle, sonar_threaded_client_completion_t* completion) {
+    channel_impl_t* channel = (channel_impl_t*)channel_handle->_private;
+    if (channel->is_completion_held) {
+        // the data of the previous completion is no longer needed
+        spsc_queue_pop(&channel->completion_queue);
+        channel->is_completion_held = false;
+    }
+    sonar_threaded_client_completion_t* slot = spsc_queue_peek(&channel->completion_queue);
+    if (!slot) {
+        return false;
+    }
+    *completion = *slot;
+    if (completion->length) {
+        completion->data = get_slot_data(slot);
+    }
+    channel->is_completion_held = true;
+    return true;
+}
+
+void _sonar_threaded_client_connection_changed_callback(sonar_threaded_client_handle_t handle, bool connected) {
+    instance_impl_t* inst = (instance_impl_t*)handle->_private;
+    atomic_store_explicit(&inst->is_connected, connected, memory_order_release);
+    if (inst->init.connection_changed_callback) {
+        inst->init.connection_changed_callback(connected);
+    }
+}
+
+void _sonar_threaded_client_read_complete_handler(sonar_threaded_client_handle_t handle, bool success, const void* data, uint32_t length) {
+    instance_impl_t* inst = (instance_impl_t*)handle->_private;
+    if (!inst->active_channel) {
+        LOG_ERROR("Unexpected read complete");
+        return;
+    }
+    push_completion(inst, success, data, length);
+    inst->active_channel = NULL;
+}
+
+void _sonar_threaded_client_write_complete_handler(sonar_threaded_client_handle_t handle, bool success) {
+    instance_impl_t* inst = (instance_impl_t*)handle->_private;
+    if (!inst->active_channel) {
+        LOG_ERROR("Unexpected write complete");
+        return;
+    }
+    push_completion(inst, success, NULL, 0);
+    inst->active_channel = NULL;
+}
+
+bool _sonar_threaded_client_notify_handler(sonar_threaded_client_handle_t handle, sonar_attribute_t attr, const void* data, uint32_t length) {
+    instance_impl_t* inst = (instance_impl_t*)handle->_private;
+    if (!inst->init.attribute_notify_handler) {
+        return false;
+    }
+    return inst->init.attribute_notify_handler(attr, data, length);
+}
@@ -0,0 +1,281 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "anchor/sonar/host/transport.h"
+
+#define LOGGING_MODULE_NAME "SONAR"
+#include "anchor/logging/logging.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <unistd.h>
+
+// This matches SONAR_ENCODING_FLAG_BYTE, which starts and ends every frame
+#define FLAG_BYTE 0x7E
+
+typedef struct {
+    sonar_transport_stats_t stats;
+    int fd;
+    uint32_t tx_length;
+    // The offset of the current frame's opening flag in the TX buffer (0 if part of it was already written)
+    uint32_t frame_start;
+    // Whether or not the TX buffer currently ends in the middle of a frame
+    bool is_in_frame;
+    // Whether or not the rest of the current frame is being dropped because part of it didn't fit in the TX buffer
+    bool is_dropping_frame;
+} transport_impl_t;
+_Static_assert(sizeof(((sonar_transport_handle_t)0)->_private) >= sizeof(transport_impl_t), "Invalid context size");
+
+static bool set_non_blocking(int fd) {
+    const int flags = fcntl(fd, F_GETFL);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static bool get_speed(uint32_t baud_rate, speed_t* speed) {
+    switch (baud_rate) {
+        case 9600: *speed = B9600; return true;
+        case 19200: *speed = B19200; return true;
+        case 38400: *speed = B38400; return true;
+        case 57600: *speed = B57600; return true;
+        case 115200: *speed = B115200; return true;
+        case 230400: *speed = B230400; return true;
+        case 460800: *speed = B460800; return true;
+        case 921600: *speed = B921600; return true;
+        case 1000000: *speed = B1000000; return true;
+        case 2000000: *speed = B2000000; return true;
+        case 3000000: *speed = B3000000; return true;
+        case 4000000: *speed = B4000000; return true;
+        default: return false;
+    }
+}
+
+static bool configure_raw(int fd, uint32_t baud_rate) {
+    struct termios tty;
+    if (tcgetattr(fd, &tty)) {
+        return false;
+    }
+    cfmakeraw(&tty);
+    tty.c_cflag |= CLOCAL | CREAD;
+    // reads never block waiting for a minimum number of bytes
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 0;
+    if (baud_rate) {
+        speed_t speed;
+        if (!get_speed(baud_rate, &speed)) {
+            LOG_ERROR("Unsupported baud rate (%u)", baud_rate);
+            return false;
+        }
+        cfsetispeed(&tty, speed);
+        cfsetospeed(&tty, speed);
+    }
+    return tcsetattr(fd, TCSANOW, &tty) == 0;
+}
+
+static int finish_open(int fd, const char* name) {
+    if (fd < 0) {
+        LOG_ERROR("Failed to open %s (%s)", name, strerror(errno));
+        return -1;
+    }
+    if (!set_non_blocking(fd)) {
+        LOG_ERROR("Failed to make %s non-blocking (%s)", name, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int sonar_transport_open_serial(const char* path, uint32_t baud_rate) {
+    const int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd >= 0 && !configure_raw(fd, baud_rate)) {
+        LOG_ERROR("Failed to configure %s", path);
+        close(fd);
+        return -1;
+    }
+    return finish_open(fd, path);
+}
+
+int sonar_transport_open_pty(char* peer_path, size_t peer_path_size) {
+    const int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        return finish_open(fd, "pty");
+    }
+    if (grantpt(fd) || unlockpt(fd) || ptsname_r(fd, peer_path, peer_path_size) || !configure_raw(fd, 0)) {
+        LOG_ERROR("Failed to set up pty (%s)", strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return finish_open(fd, "pty");
+}
+
+int sonar_transport_connect_unix(const char* path) {
+    struct sockaddr_un addr = {
+        .sun_family = AF_UNIX,
+    };
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        LOG_ERROR("Socket path is too long");
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, (const struct sockaddr*)&addr, sizeof(addr))) {
+        close(fd);
+        return finish_open(-1, path);
+    }
+    return finish_open(fd, path);
+}
+
+int sonar_transport_connect_tcp(const char* host, uint16_t port) {
+    char port_str[6];
+    snprintf(port_str, sizeof(port_str), "%u", port);
+    const struct addrinfo hints = {
+        .ai_family = AF_UNSPEC,
+        .ai_socktype = SOCK_STREAM,
+    };
+    struct addrinfo* result;
+    if (getaddrinfo(host, port_str, &hints, &result)) {
+        LOG_ERROR("Failed to resolve %s", host);
+        return -1;
+    }
+    int fd = -1;
+    for (const struct addrinfo* info = result; info; info = info->ai_next) {
+        fd = socket(info->ai_family, info->ai_socktype | SOCK_CLOEXEC, info->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        if (connect(fd, info->ai_addr, info->ai_addrlen) == 0) {
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    if (fd >= 0) {
+        // frames are already written in a single call, so there's no benefit to delaying them
+        const int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    }
+    return finish_open(fd, host);
+}
+
+void sonar_transport_init(sonar_transport_handle_t handle, int fd) {
+    transport_impl_t* inst = (transport_impl_t*)handle->_private;
+    memset(inst, 0, sizeof(*inst));
+    inst->fd = fd;
+    if (!set_non_blocking(fd)) {
+        LOG_ERROR("Failed to make fd non-blocking (%s)", strerror(errno));
+    }
+}
+
+static void drop_byte(transport_impl_t* inst, uint8_t byte) {
+    inst->stats.tx_dropped_bytes++;
+    if (byte == FLAG_BYTE && inst->is_in_frame) {
+        // this was the closing flag, so the next flag starts a new frame which can be sent normally
+        inst->is_in_frame = false;
+        inst->is_dropping_frame = false;
+    } else if (byte == FLAG_BYTE || inst->is_in_frame) {
+        // drop the rest of the frame up to and including its closing flag
+        inst->is_in_frame = true;
+        inst->is_dropping_frame = true;
+    }
+}
+
+void sonar_transport_write_byte(sonar_transport_handle_t handle, uint8_t byte) {
+    transport_impl_t* inst = (transport_impl_t*)handle->_private;
+    if (inst->is_dropping_frame) {
+        drop_byte(inst, byte);
+        return;
+    }
+    if (inst->tx_length == handle->tx_buffer_size) {
+        // the frame is larger than the TX buffer or the fd isn't keeping up, so try to make some room
+        sonar_transport_flush(handle);
+        if (inst->tx_length == handle->tx_buffer_size) {
+            if (inst->is_in_frame) {
+                // drop whatever is still buffered of the partial frame, as the peer would just discard it (if some of
+                // it was already written, the peer will resync on the flag which starts the next frame)
+                inst->stats.tx_dropped_bytes += inst->tx_length - inst->frame_start;
+                inst->tx_length = inst->frame_start;
+            }
+            drop_byte(inst, byte);
+            return;
+        }
+    }
+    if (byte == FLAG_BYTE && !inst->is_in_frame) {
+        inst->frame_start = inst->tx_length;
+    }
+    handle->tx_buffer[inst->tx_length++] = byte;
+    if (byte != FLAG_BYTE) {
+        return;
+    }
+    inst->is_in_frame = !inst->is_in_frame;
+    if (!inst->is_in_frame) {
+        // this was the closing flag, so write out the entire frame at once
+        inst->stats.frames_written++;
+        sonar_transport_flush(handle);
+    }
+}
+
+bool sonar_transport_flush(sonar_transport_handle_t handle) {
+    transport_impl_t* inst = (transport_impl_t*)handle->_private;
+    uint32_t offset = 0;
+    while (offset < inst->tx_length) {
+        const ssize_t result = write(inst->fd, &handle->tx_buffer[offset], inst->tx_length - offset);
+        inst->stats.write_calls++;
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            LOG_ERROR("Failed to write (%s)", strerror(errno));
+            inst->tx_length = 0;
+            inst->frame_start = 0;
+            return false;
+        }
+        offset += result;
+        inst->stats.bytes_written += result;
+    }
+    // keep whatever couldn't be written for next time
+    memmove(handle->tx_buffer, &handle->tx_buffer[offset], inst->tx_length - offset);
+    inst->tx_length -= offset;
+    inst->frame_start = inst->frame_start > offset ? inst->frame_start - offset : 0;
+    return true;
+}
+
+bool sonar_transport_has_pending_tx(sonar_transport_handle_t handle) {
+    transport_impl_t* inst = (transport_impl_t*)handle->_private;
+    return inst->tx_length > 0;
+}
+
+int32_t sonar_transport_receive(sonar_transport_handle_t handle, uint8_t* buffer, uint32_t size) {
+    transport_impl_t* inst = (transport_impl_t*)handle->_private;
+    while (true) {
+        const ssize_t result = read(inst->fd, buffer, size);
+        inst->stats.read_calls++;
+        if (result > 0) {
+            inst->stats.bytes_read += result;
+            return (int32_t)result;
+        } else if (result == 0) {
+            // a pty / serial port with VMIN=0 returns 0 when there's no data, but for sockets it means the peer closed
+            return size && isatty(inst->fd) ? 0 : -1;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0;
+        } else if (errno != EINTR) {
+            LOG_ERROR("Failed to read (%s)", strerror(errno));
+            return -1;
+        }
+    }
+}
+
+void sonar_transport_get_stats(sonar_transport_handle_t handle, sonar_transport_stats_t* stats) {
+    transport_impl_t* inst = (transport_impl_t*)handle->_private;
+    *stats = inst->stats;
+}
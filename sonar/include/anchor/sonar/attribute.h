@@ -1,6 +1,52 @@
 #pragma once
 
 #include <inttypes.h>
+#include <stddef.h>
+
+// SONAR_ATTR_CACHE can optionally be set to 1 to have the client cache the most recent value of each attribute (see
+// sonar_client_read_cached())
+#ifndef SONAR_ATTR_CACHE
+#define SONAR_ATTR_CACHE 0
+#endif
+
+// SONAR_ATTR_DELTA_NOTIFY can optionally be set to 1 to send notifies as a delta against the last value which the
+// client acknowledged for notify attributes with a max size of at least SONAR_ATTR_DELTA_NOTIFY_MIN_SIZE
+#ifndef SONAR_ATTR_DELTA_NOTIFY
+#define SONAR_ATTR_DELTA_NOTIFY 0
+#endif
+#ifndef SONAR_ATTR_DELTA_NOTIFY_MIN_SIZE
+#define SONAR_ATTR_DELTA_NOTIFY_MIN_SIZE 32
+#endif
+
+// SONAR_ATTR_SHARED_BUFFERS can optionally be set to 1 to have attributes borrow request and response buffers which
+// are shared by the server / client (and sized by SONAR_SERVER_DEF() / SONAR_CLIENT_DEF()) rather than each attribute
+// statically allocating its own. Only one request and one response can be in flight at a time, so this can
+// significantly reduce the RAM used when there are many attributes.
+// NOTE: The client still allocates a response buffer per attribute to hold the cached value if SONAR_ATTR_CACHE is set
+#ifndef SONAR_ATTR_SHARED_BUFFERS
+#define SONAR_ATTR_SHARED_BUFFERS 0
+#endif
+
+// SONAR_STATS can optionally be set to 1 to keep link statistics (traffic, RTT / request latency histograms, retries,
+// and connection time) along with per-attribute operation counts (see sonar_client_get_and_clear_stats() /
+// sonar_server_get_and_clear_stats()). These are all fixed-size counters which are cheap to update.
+#ifndef SONAR_STATS
+#define SONAR_STATS 0
+#endif
+
+// SONAR_CAPTURE can optionally be set to 1 to allow a capture object to be attached to a SONAR client or server (see
+// sonar_client_set_capture() / sonar_server_set_capture()) in order to record a binary trace of the link which can be
+// replayed later (see anchor/sonar/host/replay.h).
+#ifndef SONAR_CAPTURE
+#define SONAR_CAPTURE 0
+#endif
+
+// The private context size depends on which optional features are enabled
+#define _SONAR_ATTR_PRIVATE_SIZE ( \
+    sizeof(void*) * 2 + \
+    (SONAR_ATTR_CACHE ? sizeof(uint32_t) * 2 : 0) + \
+    (SONAR_ATTR_DELTA_NOTIFY ? sizeof(uint32_t) * 2 : 0) + \
+    (SONAR_STATS ? sizeof(uint32_t) * 4 : 0))
 
 struct sonar_attribute_def;
 typedef struct sonar_attribute_def sonar_attribute_def_t;
@@ -21,7 +67,7 @@ typedef enum {
 
 struct sonar_attribute_def {
     // Allocated private context space - should only be accessed by the SONAR implementation
-    uint8_t _private[sizeof(void*) * 2];
+    uint8_t _private[_SONAR_ATTR_PRIVATE_SIZE];
     // The ID of the attribute
     const uint16_t attribute_id:12;
     // The maximum size of the attribute data
@@ -29,9 +75,17 @@ struct sonar_attribute_def {
     // Which operations the attribute supports
     const sonar_attribute_ops_t ops;
     // Pointer to a statically-allocated data buffer for the attribute which is used internally by SONAR for requests
+    // (NULL if SONAR_ATTR_SHARED_BUFFERS is set)
     uint8_t* const request_buffer;
     // Pointer to a statically-allocated data buffer for the attribute which is used internally by SONAR for responses
+    // (and to store the cached value on the client if SONAR_ATTR_CACHE is enabled)
+    // (NULL if SONAR_ATTR_SHARED_BUFFERS is set and SONAR_ATTR_CACHE isn't)
     uint8_t* const response_buffer;
+#if SONAR_ATTR_DELTA_NOTIFY
+    // Pointer to a statically-allocated data buffer for the attribute which holds the last value acknowledged by the
+    // client for delta notifies (NULL if delta notifies aren't used for the attribute)
+    uint8_t* const delta_buffer;
+#endif
 };
 
 
@@ -50,14 +104,58 @@ struct sonar_attribute_def {
  * NOTE: MSVC doesn't allow for zero-sized buffers, so we make sure the size is 1 in those cases.
  */
 #define SONAR_ATTR_DEF(NAME, ID, MAX_SIZE, OPS) \
-    static uint8_t _##NAME##_request_buffer[(MAX_SIZE) ? (MAX_SIZE) : 1] SONAR_ATTR_BUFFER_ATTRIBUTES; \
-    static uint8_t _##NAME##_response_buffer[(MAX_SIZE) ? (MAX_SIZE) : 1] SONAR_ATTR_BUFFER_ATTRIBUTES; \
+    _SONAR_ATTR_DEF_IMPL(NAME, ID, MAX_SIZE, OPS, MAX_SIZE, MAX_SIZE)
+
+// Helper macros for SONAR_ATTR_DEF()
+// NOTE: The response buffer is omitted (set to NULL) if RESPONSE_BUFFER_SIZE is 0. Similarly, the request buffer is
+// omitted if REQUEST_BUFFER_SIZE is 0, along with the delta buffer (since delta notifies are built from the request
+// buffer), which is only valid for attributes which are never written and only notified via
+// sonar_attribute_server_notify_chain().
+#define _SONAR_ATTR_DEF_IMPL(NAME, ID, MAX_SIZE, OPS, REQUEST_BUFFER_SIZE, RESPONSE_BUFFER_SIZE) \
+    _SONAR_ATTR_REQUEST_BUFFER_DEF(NAME, REQUEST_BUFFER_SIZE) \
+    _SONAR_ATTR_RESPONSE_BUFFER_DEF(NAME, RESPONSE_BUFFER_SIZE) \
+    _SONAR_ATTR_DELTA_BUFFER_DEF(NAME, REQUEST_BUFFER_SIZE, OPS) \
     static sonar_attribute_def_t _##NAME##_def = { \
         ._private = {0}, \
         .attribute_id = ID, \
         .max_size = MAX_SIZE, \
         .ops = SONAR_ATTRIBUTE_OPS_##OPS, \
-        .request_buffer = _##NAME##_request_buffer, \
-        .response_buffer = _##NAME##_response_buffer, \
+        _SONAR_ATTR_REQUEST_BUFFER_INIT(NAME, REQUEST_BUFFER_SIZE) \
+        _SONAR_ATTR_RESPONSE_BUFFER_INIT(NAME, RESPONSE_BUFFER_SIZE) \
+        _SONAR_ATTR_DELTA_BUFFER_INIT(NAME, REQUEST_BUFFER_SIZE, OPS) \
     }; \
     static const sonar_attribute_t NAME = &_##NAME##_def;
+
+#if SONAR_ATTR_SHARED_BUFFERS
+#define _SONAR_ATTR_REQUEST_BUFFER_DEF(NAME, SIZE)
+#define _SONAR_ATTR_REQUEST_BUFFER_INIT(NAME, SIZE) \
+    .request_buffer = NULL,
+#else
+#define _SONAR_ATTR_REQUEST_BUFFER_DEF(NAME, SIZE) \
+    static uint8_t _##NAME##_request_buffer[(SIZE) ? (SIZE) : 1] SONAR_ATTR_BUFFER_ATTRIBUTES;
+#define _SONAR_ATTR_REQUEST_BUFFER_INIT(NAME, SIZE) \
+    .request_buffer = (SIZE) ? _##NAME##_request_buffer : NULL,
+#endif
+
+#if SONAR_ATTR_SHARED_BUFFERS && !SONAR_ATTR_CACHE
+#define _SONAR_ATTR_RESPONSE_BUFFER_DEF(NAME, SIZE)
+#define _SONAR_ATTR_RESPONSE_BUFFER_INIT(NAME, SIZE) \
+    .response_buffer = NULL,
+#else
+#define _SONAR_ATTR_RESPONSE_BUFFER_DEF(NAME, SIZE) \
+    static uint8_t _##NAME##_response_buffer[(SIZE) ? (SIZE) : 1] SONAR_ATTR_BUFFER_ATTRIBUTES;
+#define _SONAR_ATTR_RESPONSE_BUFFER_INIT(NAME, SIZE) \
+    .response_buffer = (SIZE) ? _##NAME##_response_buffer : NULL,
+#endif
+
+#if SONAR_ATTR_DELTA_NOTIFY
+#define _SONAR_ATTR_DELTA_BUFFER_SIZE(MAX_SIZE, OPS) \
+    (((SONAR_ATTRIBUTE_OPS_##OPS & SONAR_ATTRIBUTE_OPS_N) && (MAX_SIZE) >= SONAR_ATTR_DELTA_NOTIFY_MIN_SIZE) ? (MAX_SIZE) : 0)
+#define _SONAR_ATTR_DELTA_BUFFER_DEF(NAME, MAX_SIZE, OPS) \
+    static uint8_t _##NAME##_delta_buffer[_SONAR_ATTR_DELTA_BUFFER_SIZE(MAX_SIZE, OPS) ? _SONAR_ATTR_DELTA_BUFFER_SIZE(MAX_SIZE, OPS) : 1] SONAR_ATTR_BUFFER_ATTRIBUTES;
+#define _SONAR_ATTR_DELTA_BUFFER_INIT(NAME, MAX_SIZE, OPS) \
+    .delta_buffer = _SONAR_ATTR_DELTA_BUFFER_SIZE(MAX_SIZE, OPS) ? _##NAME##_delta_buffer : NULL,
+#else
+#define _SONAR_ATTR_DELTA_BUFFER_DEF(NAME, MAX_SIZE, OPS)
+#define _SONAR_ATTR_DELTA_BUFFER_INIT(NAME, MAX_SIZE, OPS)
+#endif
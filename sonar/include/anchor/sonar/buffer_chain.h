@@ -0,0 +1,16 @@
+#pragma once
+
+#include <inttypes.h>
+
+// An entry in a chain of buffers which together represent a single (scatter/gather) block of data
+typedef struct sonar_buffer_chain_entry {
+    // Next entry in the chain
+    struct sonar_buffer_chain_entry* next;
+    // The data buffer represented by this entry
+    const uint8_t* data;
+    // The length of the data buffer represented by this entry
+    uint32_t length;
+} sonar_buffer_chain_entry_t;
+
+// Callback which is called once SONAR no longer references a caller-owned buffer chain (or the data it represents)
+typedef void (*sonar_buffer_chain_release_callback_t)(void* handle);
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "anchor/sonar/attribute.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+// A trace is a sequence of records, each of which consists of a header followed by `length` bytes of data:
+//   uint8_t type (SONAR_CAPTURE_TYPE_* | SONAR_CAPTURE_FLAG_*)
+//   uint16_t length (little-endian)
+//   uint32_t time_ms (little-endian, the lower 32 bits of the system time)
+#define SONAR_CAPTURE_RECORD_HEADER_SIZE    7
+#define SONAR_CAPTURE_TYPE_MASK             0x0f
+#define SONAR_CAPTURE_FLAG_TRUNCATED        0x40
+#define SONAR_CAPTURE_FLAG_IS_SERVER        0x80
+
+#define _SONAR_CAPTURE_CONTEXT_SIZE (sizeof(sonar_capture_init_t) + sizeof(uint32_t) * 4)
+
+// Defines a capture object which stores up to BUFFER_SIZE bytes of records in a ring buffer (dropping the oldest
+// records when it's full) and can capture transmitted frames of up to MAX_FRAME_SIZE bytes (after encoding)
+#define SONAR_CAPTURE_DEF(NAME, BUFFER_SIZE, MAX_FRAME_SIZE) \
+    static uint8_t _##NAME##_buffer[BUFFER_SIZE]; \
+    static uint8_t _##NAME##_frame_buffer[MAX_FRAME_SIZE]; \
+    static sonar_capture_context_t _##NAME##_context = { \
+        ._private = {0}, \
+        .buffer = _##NAME##_buffer, \
+        .buffer_size = sizeof(_##NAME##_buffer), \
+        .frame_buffer = _##NAME##_frame_buffer, \
+        .frame_buffer_size = sizeof(_##NAME##_frame_buffer), \
+    }; \
+    static sonar_capture_handle_t NAME = &_##NAME##_context
+
+typedef enum {
+    // Raw data which was passed to sonar_client_process() / sonar_server_process()
+    SONAR_CAPTURE_TYPE_RX_RAW = 1,
+    // Raw data of a transmitted frame (including the flag bytes)
+    SONAR_CAPTURE_TYPE_TX_RAW = 2,
+    // A valid received frame after decoding (the link layer header followed by the data, without the CRC)
+    SONAR_CAPTURE_TYPE_RX_FRAME = 3,
+    // A transmitted frame before encoding (the link layer header followed by the data, without the CRC)
+    SONAR_CAPTURE_TYPE_TX_FRAME = 4,
+} sonar_capture_type_t;
+
+typedef struct {
+    // Function which returns the current system time in ms
+    uint64_t (*get_system_time_ms)(void);
+    // Function which is called with the data of each record as it's captured (i.e. to write it to a file), in which
+    // case the ring buffer isn't used (optional)
+    void (*write_function)(const uint8_t* data, uint32_t length);
+} sonar_capture_init_t;
+
+typedef struct {
+    sonar_capture_type_t type;
+    // Whether or not the record was captured by a server (vs. client)
+    bool is_server;
+    // Whether or not the data was truncated because the frame was too big
+    bool is_truncated;
+    uint32_t time_ms;
+    const uint8_t* data;
+    uint16_t length;
+} sonar_capture_record_t;
+
+typedef struct {
+    // Allocated space for private context to be used by the SONAR implementation only
+    uint8_t _private[_SONAR_CAPTURE_CONTEXT_SIZE];
+    // Ring buffer which the records are stored in
+    uint8_t* buffer;
+    uint32_t buffer_size;
+    // Buffer which holds a frame while it's being transmitted
+    uint8_t* frame_buffer;
+    uint32_t frame_buffer_size;
+} sonar_capture_context_t;
+
+typedef sonar_capture_context_t* sonar_capture_handle_t;
+
+// Initializes (or resets) a capture object
+void sonar_capture_init(sonar_capture_handle_t handle, const sonar_capture_init_t* init);
+
+// Reads as many complete records as fit in the buffer out of the ring buffer, returning the number of bytes read
+uint32_t sonar_capture_read(sonar_capture_handle_t handle, uint8_t* buffer, uint32_t size);
+
+// Gets the number of records which were dropped because the ring buffer was full
+uint32_t sonar_capture_get_num_dropped(sonar_capture_handle_t handle);
+
+// Parses the record at the start of a trace, returning its total length (or 0 if it's invalid or incomplete)
+uint32_t sonar_capture_parse_record(const uint8_t* data, uint32_t length, sonar_capture_record_t* record);
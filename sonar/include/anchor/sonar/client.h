@@ -2,27 +2,49 @@
 
 #include "anchor/sonar/error_types.h"
 #include "anchor/sonar/attribute.h"
+#include "anchor/sonar/buffer_chain.h"
+#include "anchor/sonar/capture.h"
+#include "anchor/sonar/stats.h"
 
 #include <inttypes.h>
 #include <stdbool.h>
 
 // The context size depends on whether we're compiling for a 64-bit or 32-bit system due to struct padding
-#define _SONAR_CLIENT_CONTEXT_SIZE_32   340
-#define _SONAR_CLIENT_CONTEXT_SIZE_64   560
+#define _SONAR_CLIENT_CONTEXT_SIZE_32   384
+#define _SONAR_CLIENT_CONTEXT_SIZE_64   648
 #define _SONAR_CLIENT_CONTEXT_SIZE ( \
     sizeof(sonar_client_init_t) + \
-    ((sizeof(uintptr_t) == 8) ? _SONAR_CLIENT_CONTEXT_SIZE_64 : _SONAR_CLIENT_CONTEXT_SIZE_32))
+    ((sizeof(uintptr_t) == 8) ? _SONAR_CLIENT_CONTEXT_SIZE_64 : _SONAR_CLIENT_CONTEXT_SIZE_32) + \
+    (SONAR_ATTR_DELTA_NOTIFY ? sizeof(void*) : 0) + \
+    (SONAR_ATTR_SHARED_BUFFERS ? sizeof(void*) * 2 : 0) + \
+    (SONAR_STATS ? _SONAR_STATS_CONTEXT_SIZE : 0) + \
+    (SONAR_CAPTURE ? sizeof(void*) * 2 : 0))
 
 // Defines a SONAR client object which can support attributes of up to MAX_ATTR_SIZE
 #define SONAR_CLIENT_DEF(NAME, MAX_ATTR_SIZE) \
     static uint8_t _##NAME##_receive_buffer[MAX_ATTR_SIZE + 6]; \
+    _SONAR_CLIENT_SHARED_BUFFERS_DEF(NAME, MAX_ATTR_SIZE) \
     static sonar_client_context_t _##NAME##_context = { \
         ._private = {0}, \
         .receive_buffer = _##NAME##_receive_buffer, \
         .receive_buffer_size = sizeof(_##NAME##_receive_buffer), \
+        _SONAR_CLIENT_SHARED_BUFFERS_INIT(NAME, MAX_ATTR_SIZE) \
     }; \
     static sonar_client_handle_t NAME = &_##NAME##_context
 
+// Helper macros for SONAR_CLIENT_DEF()
+// NOTE: The client only sends requests using attribute buffers, so doesn't need a shared response buffer
+#if SONAR_ATTR_SHARED_BUFFERS
+#define _SONAR_CLIENT_SHARED_BUFFERS_DEF(NAME, MAX_ATTR_SIZE) \
+    static uint8_t _##NAME##_shared_request_buffer[(MAX_ATTR_SIZE) ? (MAX_ATTR_SIZE) : 1] SONAR_ATTR_BUFFER_ATTRIBUTES;
+#define _SONAR_CLIENT_SHARED_BUFFERS_INIT(NAME, MAX_ATTR_SIZE) \
+    .shared_request_buffer = _##NAME##_shared_request_buffer, \
+    .shared_buffer_size = MAX_ATTR_SIZE,
+#else
+#define _SONAR_CLIENT_SHARED_BUFFERS_DEF(NAME, MAX_ATTR_SIZE)
+#define _SONAR_CLIENT_SHARED_BUFFERS_INIT(NAME, MAX_ATTR_SIZE)
+#endif
+
 typedef struct {
     // A function which writes a single byte over the physical layer
     void (*write_byte)(uint8_t byte);
@@ -45,6 +67,12 @@ typedef struct {
     uint8_t* receive_buffer;
     // The size of the receive buffer in bytes
     uint32_t receive_buffer_size;
+#if SONAR_ATTR_SHARED_BUFFERS
+    // Buffer which is shared by all attributes for requests (see SONAR_ATTR_SHARED_BUFFERS)
+    uint8_t* shared_request_buffer;
+    // The size of the shared buffer in bytes (the max size of any attribute registered with the client)
+    uint32_t shared_buffer_size;
+#endif
 } sonar_client_context_t;
 
 typedef sonar_client_context_t* sonar_client_handle_t;
@@ -56,6 +84,11 @@ void sonar_client_init(sonar_client_handle_t handle, const sonar_client_init_t*
 // This should be called regularly even if there's no received data
 void sonar_client_process(sonar_client_handle_t handle, const uint8_t* received_data, uint32_t received_data_length);
 
+// Gets the system time at which sonar_client_process() next needs to be called to handle a timeout or retry (or
+// UINT64_MAX if there isn't one), assuming no data is received before then. This allows an event-driven application to
+// only call sonar_client_process() when data is received or this deadline is reached.
+uint64_t sonar_client_get_next_deadline_ms(sonar_client_handle_t handle);
+
 // Returns whether or not a client is connected to the SONAR client
 bool sonar_client_is_connected(sonar_client_handle_t handle);
 
@@ -68,5 +101,32 @@ bool sonar_client_read(sonar_client_handle_t handle, sonar_attribute_t attr);
 // Sends a write request for the specified attribute
 bool sonar_client_write(sonar_client_handle_t handle, sonar_attribute_t attr, const void* data, uint32_t length);
 
+// Sends a write request for the specified attribute with the data referenced by a caller-owned buffer chain, which is
+// sent directly from the caller's buffers without being copied
+// NOTE: If this returns true, the buffer chain (and its data) must remain valid until release_callback (if not NULL) is
+// called with release_handle, which happens right before attribute_write_complete_handler() is called
+bool sonar_client_write_chain(sonar_client_handle_t handle, sonar_attribute_t attr, const sonar_buffer_chain_entry_t* data, sonar_buffer_chain_release_callback_t release_callback, void* release_handle);
+
+#if SONAR_ATTR_CACHE
+// Gets the cached value of the specified attribute if it was updated by a read response or notify request within the
+// last max_age_ms, in which case the data pointer remains valid until the next call to sonar_client_process()
+// NOTE: This never sends a request, so sonar_client_read() should be used if this returns false
+bool sonar_client_read_cached(sonar_client_handle_t handle, sonar_attribute_t attr, uint32_t max_age_ms, const void** data, uint32_t* length);
+#endif
+
 // Gets the error counters and then clears them
 void sonar_client_get_and_clear_errors(sonar_client_handle_t handle, sonar_errors_t* errors);
+
+#if SONAR_STATS
+// Gets the link stats and then clears them
+void sonar_client_get_and_clear_stats(sonar_client_handle_t handle, sonar_stats_t* stats);
+
+// Gets the operation counts for the specified attribute and then clears them
+void sonar_client_get_and_clear_attribute_stats(sonar_client_handle_t handle, sonar_attribute_t attr, sonar_attribute_stats_t* stats);
+#endif
+
+#if SONAR_CAPTURE
+// Sets the capture object which all data received and transmitted over the link is recorded to (or NULL to stop
+// capturing)
+void sonar_client_set_capture(sonar_client_handle_t handle, sonar_capture_handle_t capture);
+#endif
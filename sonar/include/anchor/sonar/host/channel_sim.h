@@ -0,0 +1,101 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+// NOTE: The channel simulator is intended for tests and benchmarks on hosted builds, and its sources are listed in
+// SONAR_HOST_C_SOURCES. All times are in microseconds of simulated time, which is provided by the caller.
+
+#define _SONAR_CHANNEL_SIM_CONTEXT_SIZE ( \
+    sizeof(sonar_channel_sim_config_t) + \
+    sizeof(sonar_channel_sim_stats_t) * 2 + \
+    sizeof(uint64_t) * 8 + \
+    sizeof(uint32_t) * 8)
+
+// Defines a channel simulator object which can hold up to QUEUE_SIZE bytes in flight in each direction
+#define SONAR_CHANNEL_SIM_DEF(NAME, QUEUE_SIZE) \
+    static sonar_channel_sim_entry_t _##NAME##_queue_buffer[(QUEUE_SIZE) * 2]; \
+    static sonar_channel_sim_context_t _##NAME##_context = { \
+        ._private = {0}, \
+        .queue_buffer = _##NAME##_queue_buffer, \
+        .queue_size = QUEUE_SIZE, \
+    }; \
+    static sonar_channel_sim_handle_t NAME = &_##NAME##_context
+
+// The two directions of the channel (i.e. client to server and server to client)
+typedef enum {
+    SONAR_CHANNEL_SIM_DIR_A_TO_B,
+    SONAR_CHANNEL_SIM_DIR_B_TO_A,
+    SONAR_CHANNEL_SIM_NUM_DIRS,
+} sonar_channel_sim_dir_t;
+
+typedef struct {
+    // The probability of each bit being flipped
+    double bit_error_rate;
+    // The probability of each byte being dropped
+    double byte_drop_rate;
+    // Burst loss is modelled with two states (Gilbert-Elliott), where every byte is dropped while in the burst state:
+    // The probability of entering the burst state before each byte (0 to disable burst loss)
+    double burst_start_rate;
+    // The probability of leaving the burst state before each byte (i.e. 1 / the mean burst length in bytes)
+    double burst_end_rate;
+    // Fixed latency which is added to every byte after it's been serialized (i.e. propagation or buffering delay)
+    uint32_t latency_us;
+    // The baud rate used to calculate the time it takes to serialize each byte with a start and stop bit (0 for
+    // no serialization delay)
+    uint32_t baud_rate;
+    // Whether or not the channel is half-duplex, in which case both directions share the line
+    bool half_duplex;
+    // The time it takes for a half-duplex line to switch directions
+    uint32_t turnaround_us;
+    // The seed for the random number generator, which makes the results reproducible
+    uint64_t seed;
+} sonar_channel_sim_config_t;
+
+typedef struct {
+    // The number of bytes which were written into the channel
+    uint32_t bytes_written;
+    // The number of bytes which were delivered out of the channel
+    uint32_t bytes_delivered;
+    // The number of bytes which were dropped (randomly or due to a burst)
+    uint32_t bytes_dropped;
+    // The number of bytes which were dropped because of a burst
+    uint32_t burst_bytes_dropped;
+    // The number of bits which were flipped
+    uint32_t bits_flipped;
+    // The number of bytes which were dropped because the queue was full
+    uint32_t queue_overflows;
+} sonar_channel_sim_stats_t;
+
+typedef struct {
+    // The time at which the byte is delivered
+    uint64_t delivery_time_us;
+    uint8_t byte;
+} sonar_channel_sim_entry_t;
+
+typedef struct {
+    // Allocated space for private context to be used by the SONAR implementation only
+    uint8_t _private[_SONAR_CHANNEL_SIM_CONTEXT_SIZE];
+    // Buffer which holds the bytes in flight (queue_size entries for each direction)
+    sonar_channel_sim_entry_t* queue_buffer;
+    // The max number of bytes in flight in each direction
+    uint32_t queue_size;
+} sonar_channel_sim_context_t;
+
+typedef sonar_channel_sim_context_t* sonar_channel_sim_handle_t;
+
+// Initializes (or resets) the channel simulator
+void sonar_channel_sim_init(sonar_channel_sim_handle_t handle, const sonar_channel_sim_config_t* config);
+
+// Writes a byte into one direction of the channel at the current time
+void sonar_channel_sim_write(sonar_channel_sim_handle_t handle, sonar_channel_sim_dir_t dir, uint8_t byte, uint64_t now_us);
+
+// Reads up to size bytes which have been delivered by the current time out of one direction of the channel, returning
+// the number of bytes read
+uint32_t sonar_channel_sim_read(sonar_channel_sim_handle_t handle, sonar_channel_sim_dir_t dir, uint64_t now_us, uint8_t* buffer, uint32_t size);
+
+// Gets the time at which the next byte is delivered in one direction of the channel (or UINT64_MAX if it's empty)
+uint64_t sonar_channel_sim_get_next_delivery_us(sonar_channel_sim_handle_t handle, sonar_channel_sim_dir_t dir);
+
+// Gets the stats for one direction of the channel
+void sonar_channel_sim_get_stats(sonar_channel_sim_handle_t handle, sonar_channel_sim_dir_t dir, sonar_channel_sim_stats_t* stats);
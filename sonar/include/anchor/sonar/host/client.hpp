@@ -0,0 +1,596 @@
+#pragma once
+
+extern "C" {
+
+#include "anchor/sonar/client.h"
+
+}
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// NOTE: This is a header-only C++ (C++14 or later) wrapper around the SONAR client which is intended for hosted builds.
+// Unlike the C API, each client instance owns its own context and callbacks, so any number of clients can be created
+// at runtime without needing a separate set of handler functions for each one.
+
+// SONAR_CPP_NANOPB can optionally be set to 1 to enable sonar::NanopbCodec (requires nanopb 0.4 or later)
+#ifndef SONAR_CPP_NANOPB
+#define SONAR_CPP_NANOPB 0
+#endif
+
+#if SONAR_CPP_NANOPB
+#include <pb_decode.h>
+#include <pb_encode.h>
+
+// Defines a sonar::Attribute named NAME for the specified protobuf message type (just like SONAR_PROTO_ATTR_DEF())
+#define SONAR_CPP_PROTO_ATTR_DEF(PROTO_MSG_TYPE, NAME) \
+    _SONAR_CPP_PROTO_ATTR_DEF_IMPL(PROTO_MSG_TYPE, NAME, PROTO_MSG_TYPE##_ops)
+#define _SONAR_CPP_PROTO_ATTR_DEF_IMPL(PROTO_MSG_TYPE, NAME, OPS) \
+    _SONAR_CPP_PROTO_ATTR_DEF_IMPL2(PROTO_MSG_TYPE, NAME, OPS)
+#define _SONAR_CPP_PROTO_ATTR_DEF_IMPL2(PROTO_MSG_TYPE, NAME, OPS) \
+    sonar::Attribute<PROTO_MSG_TYPE, sonar::NanopbCodec<PROTO_MSG_TYPE, PROTO_MSG_TYPE##_size>> NAME{ \
+        PROTO_MSG_TYPE##_msgid, SONAR_ATTRIBUTE_OPS_##OPS}
+#endif
+
+namespace sonar {
+
+// Codec for trivially-copyable types, which are sent as their raw bytes
+template <typename T>
+struct RawCodec {
+  static_assert(std::is_trivially_copyable<T>::value, "RawCodec requires a trivially-copyable type");
+  static constexpr uint32_t kMaxSize = sizeof(T);
+
+  static bool encode(const T& value, uint8_t* buffer, uint32_t buffer_size, uint32_t* length) {
+    memcpy(buffer, &value, sizeof(T));
+    *length = sizeof(T);
+    return true;
+  }
+
+  static bool decode(const void* data, uint32_t length, T* value) {
+    if (length != sizeof(T)) {
+      return false;
+    }
+    memcpy(value, data, sizeof(T));
+    return true;
+  }
+};
+
+#if SONAR_CPP_NANOPB
+// Codec for nanopb-generated message types
+template <typename T, uint32_t MaxSize>
+struct NanopbCodec {
+  static constexpr uint32_t kMaxSize = MaxSize;
+
+  static bool encode(const T& value, uint8_t* buffer, uint32_t buffer_size, uint32_t* length) {
+    pb_ostream_t stream = pb_ostream_from_buffer(buffer, buffer_size);
+    if (!pb_encode(&stream, nanopb::MessageDescriptor<T>::fields(), &value)) {
+      return false;
+    }
+    *length = stream.bytes_written;
+    return true;
+  }
+
+  static bool decode(const void* data, uint32_t length, T* value) {
+    T temp = {};
+    pb_istream_t stream = pb_istream_from_buffer(static_cast<const pb_byte_t*>(data), length);
+    if (!pb_decode(&stream, nanopb::MessageDescriptor<T>::fields(), &temp)) {
+      return false;
+    }
+    *value = temp;
+    return true;
+  }
+};
+#endif
+
+// The result of a read request which was issued via the future-based API
+template <typename T>
+struct ReadResult {
+  bool success;
+  T value;
+};
+
+namespace detail {
+
+// A callable with a fixed amount of inline storage, which (unlike std::function) never allocates
+template <typename Signature, size_t Size>
+class InlineFunction;
+
+template <typename R, typename... Args, size_t Size>
+class InlineFunction<R(Args...), Size> {
+ public:
+  InlineFunction() = default;
+  InlineFunction(const InlineFunction&) = delete;
+  InlineFunction& operator=(const InlineFunction&) = delete;
+  ~InlineFunction() { reset(); }
+
+  template <typename F>
+  void emplace(F&& function) {
+    using Callable = typename std::decay<F>::type;
+    static_assert(sizeof(Callable) <= Size, "Callable is too large to store inline");
+    static_assert(alignof(Callable) <= alignof(std::max_align_t), "Callable is over-aligned");
+    reset();
+    new (&storage_) Callable(std::forward<F>(function));
+    ops_ = OpsFor<Callable>::get();
+  }
+
+  // Moves the callable from another instance (leaving it empty)
+  void take(InlineFunction& other) {
+    reset();
+    if (other.ops_) {
+      other.ops_->move(&storage_, &other.storage_);
+      ops_ = other.ops_;
+      other.ops_ = nullptr;
+    }
+  }
+
+  void reset() {
+    if (ops_) {
+      ops_->destroy(&storage_);
+      ops_ = nullptr;
+    }
+  }
+
+  explicit operator bool() const { return ops_ != nullptr; }
+
+  R operator()(Args... args) { return ops_->invoke(&storage_, std::forward<Args>(args)...); }
+
+ private:
+  struct Ops {
+    R (*invoke)(void* storage, Args... args);
+    void (*move)(void* dst, void* src);
+    void (*destroy)(void* storage);
+  };
+
+  template <typename Callable>
+  struct OpsFor {
+    static R invoke(void* storage, Args... args) {
+      return (*static_cast<Callable*>(storage))(std::forward<Args>(args)...);
+    }
+    static void move(void* dst, void* src) {
+      new (dst) Callable(std::move(*static_cast<Callable*>(src)));
+      static_cast<Callable*>(src)->~Callable();
+    }
+    static void destroy(void* storage) { static_cast<Callable*>(storage)->~Callable(); }
+    static const Ops* get() {
+      static const Ops ops = {invoke, move, destroy};
+      return &ops;
+    }
+  };
+
+  typename std::aligned_storage<Size, alignof(std::max_align_t)>::type storage_;
+  const Ops* ops_ = nullptr;
+};
+
+// A fixed pool of blocks which the shared state of futures is allocated from, falling back to the heap if it's
+// exhausted (i.e. if the application holds on to more than NumBlocks futures at once)
+template <size_t BlockSize, size_t NumBlocks>
+class BlockPool {
+ public:
+  BlockPool() {
+    for (size_t i = 0; i < NumBlocks; i++) {
+      free_blocks_[i] = &blocks_[i];
+    }
+    num_free_ = NumBlocks;
+  }
+  BlockPool(const BlockPool&) = delete;
+  BlockPool& operator=(const BlockPool&) = delete;
+
+  void* allocate(size_t size) {
+    if (size <= BlockSize) {
+      // the shared state may be released from any thread
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (num_free_) {
+        return free_blocks_[--num_free_];
+      }
+    }
+    num_heap_allocations_++;
+    return ::operator new(size);
+  }
+
+  void deallocate(void* ptr) {
+    if (ptr >= static_cast<void*>(&blocks_[0]) && ptr < static_cast<void*>(&blocks_[NumBlocks])) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      free_blocks_[num_free_++] = static_cast<Block*>(ptr);
+    } else {
+      ::operator delete(ptr);
+    }
+  }
+
+  size_t num_heap_allocations() const { return num_heap_allocations_; }
+
+ private:
+  struct Block {
+    alignas(std::max_align_t) uint8_t data[BlockSize];
+  };
+  Block blocks_[NumBlocks];
+  Block* free_blocks_[NumBlocks];
+  size_t num_free_;
+  std::atomic<size_t> num_heap_allocations_{0};
+  std::mutex mutex_;
+};
+
+// A standard allocator which allocates from a BlockPool, keeping it alive for as long as anything allocated from it
+// may still be around (i.e. a future which outlives its client)
+template <typename T, typename Pool>
+struct PoolAllocator {
+  using value_type = T;
+
+  explicit PoolAllocator(std::shared_ptr<Pool> pool) : pool(std::move(pool)) {}
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U, Pool>& other) : pool(other.pool) {}
+
+  T* allocate(size_t n) { return static_cast<T*>(pool->allocate(n * sizeof(T))); }
+  void deallocate(T* ptr, size_t n) { pool->deallocate(ptr); }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U, Pool>& other) const { return pool == other.pool; }
+  template <typename U>
+  bool operator!=(const PoolAllocator<U, Pool>& other) const { return pool != other.pool; }
+
+  std::shared_ptr<Pool> pool;
+};
+
+// Inline buffers for an attribute, which are only allocated if they're used with the enabled options
+template <uint32_t MaxSize>
+struct AttributeBuffers {
+  uint8_t request_buffer_[SONAR_ATTR_SHARED_BUFFERS ? 1 : MaxSize];
+  uint8_t response_buffer_[(SONAR_ATTR_SHARED_BUFFERS && !SONAR_ATTR_CACHE) ? 1 : MaxSize];
+#if SONAR_ATTR_DELTA_NOTIFY
+  uint8_t delta_buffer_[MaxSize >= SONAR_ATTR_DELTA_NOTIFY_MIN_SIZE ? MaxSize : 1];
+#endif
+};
+
+class ClientBase;
+
+// Something which is waiting for the next notify of an attribute (i.e. a coroutine)
+struct NotifyWaiter {
+  NotifyWaiter* next;
+  // Called with the notify data, returning whether or not it was accepted (otherwise the waiter keeps waiting)
+  bool (*deliver)(NotifyWaiter* waiter, const void* data, uint32_t length);
+};
+
+// The part of an attribute which doesn't depend on its type
+class AttributeBase {
+ public:
+  AttributeBase(const AttributeBase&) = delete;
+  AttributeBase& operator=(const AttributeBase&) = delete;
+
+  // Gets the underlying SONAR attribute
+  sonar_attribute_t get() { return &def_; }
+
+  // Adds a waiter which is delivered the next notify (in addition to the notify handler)
+  void add_notify_waiter(NotifyWaiter* waiter) {
+    waiter->next = notify_waiters_;
+    notify_waiters_ = waiter;
+  }
+
+  // Removes a waiter which hasn't been delivered a notify yet
+  void remove_notify_waiter(NotifyWaiter* waiter) {
+    for (NotifyWaiter** ptr = &notify_waiters_; *ptr; ptr = &(*ptr)->next) {
+      if (*ptr == waiter) {
+        *ptr = waiter->next;
+        return;
+      }
+    }
+  }
+
+ protected:
+  AttributeBase(uint16_t id, uint32_t max_size, sonar_attribute_ops_t ops, uint8_t* request_buffer,
+      uint8_t* response_buffer, uint8_t* delta_buffer) :
+      def_{
+        {0},
+        id,
+        max_size,
+        ops,
+        SONAR_ATTR_SHARED_BUFFERS ? nullptr : request_buffer,
+        (SONAR_ATTR_SHARED_BUFFERS && !SONAR_ATTR_CACHE) ? nullptr : response_buffer,
+#if SONAR_ATTR_DELTA_NOTIFY
+        ((ops & SONAR_ATTRIBUTE_OPS_N) && max_size >= SONAR_ATTR_DELTA_NOTIFY_MIN_SIZE) ? delta_buffer : nullptr,
+#endif
+      } {}
+
+  bool handle_notify(const void* data, uint32_t length) {
+    bool accepted = false;
+    // every current waiter gets this notify, but any which are added while delivering it wait for the next one
+    NotifyWaiter* waiter = notify_waiters_;
+    notify_waiters_ = nullptr;
+    while (waiter) {
+      NotifyWaiter* next = waiter->next;
+      if (waiter->deliver(waiter, data, length)) {
+        accepted = true;
+      } else {
+        add_notify_waiter(waiter);
+      }
+      waiter = next;
+    }
+    if (notify_handler_) {
+      accepted = notify_handler_(data, length) || accepted;
+    }
+    return accepted;
+  }
+
+  sonar_attribute_def_t def_;
+  // Handles notifies for the attribute, taking care of decoding the data
+  InlineFunction<bool(const void*, uint32_t), 64> notify_handler_;
+
+ private:
+  // The next attribute which is registered with the same client
+  AttributeBase* next_ = nullptr;
+  NotifyWaiter* notify_waiters_ = nullptr;
+
+  friend class ClientBase;
+};
+
+// The part of a client which doesn't depend on its template parameters
+class ClientBase {
+ public:
+  ClientBase(const ClientBase&) = delete;
+  ClientBase& operator=(const ClientBase&) = delete;
+
+  // Registers an attribute with the client (which must outlive the client)
+  void register_attr(AttributeBase& attr) {
+    attr.next_ = attrs_;
+    attrs_ = &attr;
+    sonar_client_register(&context_, attr.get());
+  }
+
+  // Processes data received since the last call, which should be called regularly even if there's no received data
+  void process(const uint8_t* received_data, uint32_t received_data_length) {
+    ActiveScope scope(this);
+    sonar_client_process(&context_, received_data, received_data_length);
+  }
+
+  // Gets the system time at which process() next needs to be called (see sonar_client_get_next_deadline_ms())
+  uint64_t next_deadline_ms() { return sonar_client_get_next_deadline_ms(&context_); }
+
+  bool is_connected() { return sonar_client_is_connected(&context_); }
+
+  // Returns whether or not a request is pending (only one request can be pending at a time)
+  bool is_request_pending() const { return static_cast<bool>(pending_); }
+
+  void get_and_clear_errors(sonar_errors_t* errors) { sonar_client_get_and_clear_errors(&context_, errors); }
+
+  // Gets the underlying SONAR client
+  sonar_client_handle_t get() { return &context_; }
+
+ protected:
+  using WriteByteFunction = std::function<void(uint8_t)>;
+  using ConnectionChangedFunction = std::function<void(bool)>;
+  using CompletionFunction = InlineFunction<void(bool, const void*, uint32_t), 64>;
+
+  ClientBase() : context_() {}
+
+  void init(WriteByteFunction write_byte, uint64_t (*get_system_time_ms)(void),
+      ConnectionChangedFunction connection_changed) {
+    write_byte_ = std::move(write_byte);
+    connection_changed_ = std::move(connection_changed);
+    // designated initializers aren't part of C++ until C++20
+    sonar_client_init_t init_client = {};
+    init_client.write_byte = write_byte_handler;
+    init_client.get_system_time_ms = get_system_time_ms;
+    init_client.connection_changed_callback = connection_changed_handler;
+    init_client.attribute_read_complete_handler = read_complete_handler;
+    init_client.attribute_write_complete_handler = write_complete_handler;
+    init_client.attribute_notify_handler = notify_handler;
+    sonar_client_init(&context_, &init_client);
+  }
+
+  template <typename F>
+  bool issue_read(sonar_attribute_t attr, F&& completion) {
+    if (pending_) {
+      return false;
+    }
+    pending_.emplace(std::forward<F>(completion));
+    ActiveScope scope(this);
+    if (!sonar_client_read(&context_, attr)) {
+      pending_.reset();
+      return false;
+    }
+    return true;
+  }
+
+  template <typename F>
+  bool issue_write(sonar_attribute_t attr, const void* data, uint32_t length, F&& completion) {
+    if (pending_) {
+      return false;
+    }
+    pending_.emplace(std::forward<F>(completion));
+    ActiveScope scope(this);
+    if (!sonar_client_write(&context_, attr, data, length)) {
+      pending_.reset();
+      return false;
+    }
+    return true;
+  }
+
+  sonar_client_context_t context_;
+
+ private:
+  // The SONAR client callbacks don't get passed a handle, so the client which is currently calling into the C API on
+  // this thread is tracked here
+  class ActiveScope {
+   public:
+    explicit ActiveScope(ClientBase* client) : prev_(active()) { active() = client; }
+    ~ActiveScope() { active() = prev_; }
+
+   private:
+    ClientBase* prev_;
+  };
+
+  static ClientBase*& active() {
+    static thread_local ClientBase* client = nullptr;
+    return client;
+  }
+
+  static void write_byte_handler(uint8_t byte) {
+    active()->write_byte_(byte);
+  }
+
+  static void connection_changed_handler(bool connected) {
+    ClientBase* client = active();
+    if (client->connection_changed_) {
+      client->connection_changed_(connected);
+    }
+  }
+
+  static void complete(bool success, const void* data, uint32_t length) {
+    ClientBase* client = active();
+    if (!client->pending_) {
+      return;
+    }
+    // the completion may issue another request, so move it out of the pending slot first
+    CompletionFunction completion;
+    completion.take(client->pending_);
+    completion(success, data, length);
+  }
+
+  static void read_complete_handler(bool success, const void* data, uint32_t length) {
+    complete(success, data, length);
+  }
+
+  static void write_complete_handler(bool success) {
+    complete(success, nullptr, 0);
+  }
+
+  static bool notify_handler(sonar_attribute_t attr, const void* data, uint32_t length) {
+    for (AttributeBase* client_attr = active()->attrs_; client_attr; client_attr = client_attr->next_) {
+      if (client_attr->get() == attr) {
+        return client_attr->handle_notify(data, length);
+      }
+    }
+    return false;
+  }
+
+  WriteByteFunction write_byte_;
+  ConnectionChangedFunction connection_changed_;
+  CompletionFunction pending_;
+  AttributeBase* attrs_ = nullptr;
+};
+
+} // namespace detail
+
+// A typed client attribute, which encodes / decodes its values using the specified codec
+// NOTE: Attributes can't be copied or moved once created, since they're referenced by the client
+template <typename T, typename Codec = RawCodec<T>>
+class Attribute : private detail::AttributeBuffers<Codec::kMaxSize>, public detail::AttributeBase {
+ public:
+  using ValueType = T;
+  using CodecType = Codec;
+
+  Attribute(uint16_t id, sonar_attribute_ops_t ops) :
+      detail::AttributeBase(id, Codec::kMaxSize, ops, this->request_buffer_, this->response_buffer_,
+#if SONAR_ATTR_DELTA_NOTIFY
+          this->delta_buffer_
+#else
+          nullptr
+#endif
+      ) {}
+
+  // Sets the handler for notifies, which is passed the decoded value and returns whether or not it was accepted
+  template <typename F>
+  void set_notify_handler(F&& handler) {
+    notify_handler_.emplace([handler = std::forward<F>(handler)](const void* data, uint32_t length) mutable {
+      T value{};
+      return Codec::decode(data, length, &value) && handler(static_cast<const T&>(value));
+    });
+  }
+};
+
+// A SONAR client which can support attributes of up to MaxAttrSize, and which allocates the shared state of up to
+// NumFutures outstanding futures from an internal pool
+// NOTE: A client must only be used from a single thread (although the futures it returns may be passed to any thread)
+template <uint32_t MaxAttrSize, size_t NumFutures = 8>
+class Client : public detail::ClientBase {
+ public:
+  // Creates a client, where write_byte writes a byte over the physical layer, get_system_time_ms gets the current
+  // system time in ms, and connection_changed (optional) is called when the connection state changes
+  Client(WriteByteFunction write_byte, uint64_t (*get_system_time_ms)(void),
+      ConnectionChangedFunction connection_changed = nullptr) {
+    context_.receive_buffer = receive_buffer_;
+    context_.receive_buffer_size = sizeof(receive_buffer_);
+#if SONAR_ATTR_SHARED_BUFFERS
+    context_.shared_request_buffer = shared_request_buffer_;
+    context_.shared_buffer_size = MaxAttrSize;
+#endif
+    init(std::move(write_byte), get_system_time_ms, std::move(connection_changed));
+  }
+
+  // Sends a read request, calling callback(bool success, const T& value) once it completes, and returning false if
+  // the request couldn't be sent (i.e. another request is pending)
+  template <typename T, typename Codec, typename F>
+  bool read(Attribute<T, Codec>& attr, F&& callback) {
+    return issue_read(attr.get(),
+        [callback = std::forward<F>(callback)](bool success, const void* data, uint32_t length) mutable {
+          T value{};
+          success = success && Codec::decode(data, length, &value);
+          callback(success, static_cast<const T&>(value));
+        });
+  }
+
+  // Sends a read request, returning a future for the result, or an invalid future (i.e. valid() returns false) if the
+  // request couldn't be sent
+  template <typename T, typename Codec>
+  std::future<ReadResult<T>> read(Attribute<T, Codec>& attr) {
+    std::promise<ReadResult<T>> promise(std::allocator_arg, Allocator<ReadResult<T>>(future_pool_));
+    std::future<ReadResult<T>> future = promise.get_future();
+    const bool result = read(attr, [promise = std::move(promise)](bool success, const T& value) mutable {
+      promise.set_value(ReadResult<T>{success, value});
+    });
+    return result ? std::move(future) : std::future<ReadResult<T>>();
+  }
+
+  // Sends a write request, calling callback(bool success) once it completes, and returning false if the request
+  // couldn't be sent (i.e. another request is pending or the value failed to encode)
+  template <typename T, typename Codec, typename F>
+  bool write(Attribute<T, Codec>& attr, const T& value, F&& callback) {
+    uint8_t buffer[Codec::kMaxSize ? Codec::kMaxSize : 1];
+    uint32_t length;
+    if (!Codec::encode(value, buffer, Codec::kMaxSize, &length)) {
+      return false;
+    }
+    return issue_write(attr.get(), buffer, length,
+        [callback = std::forward<F>(callback)](bool success, const void*, uint32_t) mutable {
+          callback(success);
+        });
+  }
+
+  // Sends a write request, returning a future for whether or not it succeeded, or an invalid future (i.e. valid()
+  // returns false) if the request couldn't be sent
+  template <typename T, typename Codec>
+  std::future<bool> write(Attribute<T, Codec>& attr, const T& value) {
+    std::promise<bool> promise(std::allocator_arg, Allocator<bool>(future_pool_));
+    std::future<bool> future = promise.get_future();
+    const bool result = write(attr, value, [promise = std::move(promise)](bool success) mutable {
+      promise.set_value(success);
+    });
+    return result ? std::move(future) : std::future<bool>();
+  }
+
+  // Gets the number of times the shared state of a future had to be allocated from the heap because the pool was
+  // exhausted
+  size_t num_future_heap_allocations() const { return future_pool_->num_heap_allocations(); }
+
+ private:
+  // Each promise allocates its shared state (which holds a mutex / condition variable and some bookkeeping) and the
+  // storage for its result separately
+  using FuturePool = detail::BlockPool<256, NumFutures * 2>;
+  template <typename T>
+  using Allocator = detail::PoolAllocator<T, FuturePool>;
+
+  uint8_t receive_buffer_[MaxAttrSize + 6];
+#if SONAR_ATTR_SHARED_BUFFERS
+  uint8_t shared_request_buffer_[MaxAttrSize ? MaxAttrSize : 1];
+#endif
+  // This is allocated once along with the client and shared with the futures' shared state
+  std::shared_ptr<FuturePool> future_pool_ = std::make_shared<FuturePool>();
+};
+
+} // namespace sonar
@@ -0,0 +1,520 @@
+#pragma once
+
+#include "anchor/sonar/host/client.hpp"
+
+#include <concepts>
+#include <coroutine>
+#include <exception>
+#include <optional>
+
+// NOTE: This is a header-only C++20 coroutine API built on top of the C++ client (see client.hpp). Requests are
+// issued via `co_await client.read(attr)` / `co_await client.write(attr, value)` and notifies are waited for via
+// `co_await client.next_notify(attr)`, with the coroutines being resumed from CoroutineClient::process().
+
+namespace sonar {
+
+// An allocator for coroutine frames which hands out blocks from a fixed buffer. Freed blocks are kept on a free list
+// and reused for frames of exactly the same size (which all frames of a given coroutine function are), and the heap
+// is only used once the buffer is exhausted.
+class CoroutineArena {
+ public:
+  CoroutineArena(uint8_t* buffer, size_t size) : buffer_(buffer), size_(size) {}
+  CoroutineArena(const CoroutineArena&) = delete;
+  CoroutineArena& operator=(const CoroutineArena&) = delete;
+
+  void* allocate(size_t size) {
+    size = align(size);
+    for (FreeBlock** ptr = &free_list_; *ptr; ptr = &(*ptr)->next) {
+      if ((*ptr)->size == size) {
+        FreeBlock* block = *ptr;
+        *ptr = block->next;
+        return block;
+      }
+    }
+    if (size_ - used_ >= size) {
+      void* block = &buffer_[used_];
+      used_ += size;
+      return block;
+    }
+    num_heap_allocations_++;
+    return ::operator new(size);
+  }
+
+  void deallocate(void* ptr, size_t size) {
+    if (ptr < static_cast<void*>(buffer_) || ptr >= static_cast<void*>(&buffer_[size_])) {
+      ::operator delete(ptr);
+      return;
+    }
+    FreeBlock* block = static_cast<FreeBlock*>(ptr);
+    block->next = free_list_;
+    block->size = align(size);
+    free_list_ = block;
+  }
+
+  // Gets the number of bytes of the buffer which have been handed out (including ones which are on the free list)
+  size_t used() const { return used_; }
+
+  // Gets the number of frames which had to be allocated from the heap because the buffer was exhausted
+  size_t num_heap_allocations() const { return num_heap_allocations_; }
+
+  // Allocates a coroutine frame from an arena (or the heap if it's NULL), storing the arena in a header before it
+  static void* allocate_frame(CoroutineArena* arena, size_t size) {
+    uint8_t* block = static_cast<uint8_t*>(arena ? arena->allocate(size + kHeaderSize) : ::operator new(size + kHeaderSize));
+    *reinterpret_cast<CoroutineArena**>(block) = arena;
+    return block + kHeaderSize;
+  }
+
+  static void deallocate_frame(void* ptr, size_t size) {
+    uint8_t* block = static_cast<uint8_t*>(ptr) - kHeaderSize;
+    CoroutineArena* arena = *reinterpret_cast<CoroutineArena**>(block);
+    if (arena) {
+      arena->deallocate(block, size + kHeaderSize);
+    } else {
+      ::operator delete(block);
+    }
+  }
+
+ private:
+  static constexpr size_t kHeaderSize = alignof(std::max_align_t);
+
+  struct FreeBlock {
+    FreeBlock* next;
+    size_t size;
+  };
+
+  static size_t align(size_t size) {
+    return (size + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+  }
+
+  uint8_t* buffer_;
+  size_t size_;
+  size_t used_ = 0;
+  FreeBlock* free_list_ = nullptr;
+  size_t num_heap_allocations_ = 0;
+};
+
+// Anything which provides a CoroutineArena for the frames of coroutines which take it as their first argument
+template <typename T>
+concept CoroutineArenaProvider = requires(T& provider) {
+  { provider.coroutine_arena() } -> std::same_as<CoroutineArena&>;
+};
+
+namespace detail {
+
+struct TaskPromiseBase {
+  // The frame comes from the arena of the first argument if it's a CoroutineArenaProvider (i.e. the client the
+  // coroutine is running on), otherwise the heap
+  template <CoroutineArenaProvider Provider, typename... Args>
+  static void* operator new(size_t size, Provider& provider, Args&...) {
+    return CoroutineArena::allocate_frame(&provider.coroutine_arena(), size);
+  }
+  static void* operator new(size_t size) {
+    return CoroutineArena::allocate_frame(nullptr, size);
+  }
+  static void operator delete(void* ptr, size_t size) {
+    CoroutineArena::deallocate_frame(ptr, size);
+  }
+
+  // Resumes whatever was awaiting the task once it completes
+  struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+      std::coroutine_handle<> continuation = handle.promise().continuation;
+      return continuation ? continuation : std::noop_coroutine();
+    }
+    void await_resume() noexcept {}
+  };
+
+  std::suspend_always initial_suspend() noexcept { return {}; }
+  FinalAwaiter final_suspend() noexcept { return {}; }
+  void unhandled_exception() { exception = std::current_exception(); }
+
+  std::coroutine_handle<> continuation;
+  std::exception_ptr exception;
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+  void return_value(T result) { value.emplace(std::move(result)); }
+  T take_result() {
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+    return std::move(*value);
+  }
+  std::optional<T> value;
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+  void return_void() {}
+  void take_result() {
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+  }
+};
+
+} // namespace detail
+
+// A lazily-started coroutine which can either be awaited by another coroutine or started as a top-level task
+// NOTE: Destroying a task destroys its coroutine frame, even if it's still suspended
+template <typename T = void>
+class [[nodiscard]] Task {
+ public:
+  struct promise_type : detail::TaskPromise<T> {
+    Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+  };
+
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      reset();
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+  ~Task() { reset(); }
+
+  // Starts running a top-level task up until its first suspension point
+  void start() {
+    if (handle_ && !handle_.done()) {
+      handle_.resume();
+    }
+  }
+
+  // Returns whether or not the task has run to completion
+  bool done() const { return !handle_ || handle_.done(); }
+
+  // Gets the result of a completed task (rethrowing any exception which escaped it)
+  T result() { return handle_.promise().take_result(); }
+
+  // Awaiting a task starts it and resumes the awaiting coroutine once it completes
+  auto operator co_await() noexcept {
+    struct Awaiter {
+      bool await_ready() noexcept { return !handle || handle.done(); }
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+      }
+      T await_resume() { return handle.promise().take_result(); }
+      std::coroutine_handle<promise_type> handle;
+    };
+    return Awaiter{handle_};
+  }
+
+ private:
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+  void reset() {
+    if (handle_) {
+      handle_.destroy();
+      handle_ = nullptr;
+    }
+  }
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+// A C++ client which supports awaitable requests and notifies. Each client has an arena of ArenaSize bytes which the
+// frames of coroutines that take the client as their first argument are allocated from.
+// NOTE: Any number of coroutines can await requests on a client at once - they're sent one at a time in the order they
+// were awaited. All tasks using a client must be destroyed before it.
+template <uint32_t MaxAttrSize, size_t ArenaSize = 16384, size_t NumFutures = 8>
+class CoroutineClient : public Client<MaxAttrSize, NumFutures> {
+  using Base = Client<MaxAttrSize, NumFutures>;
+
+ public:
+  using Base::Base;
+  // the callback-based overloads are still available, although they'll fail while an awaited request is in flight
+  using Base::read;
+  using Base::write;
+
+  CoroutineArena& coroutine_arena() { return arena_; }
+
+  // Processes received data (see ClientBase::process()) and then resumes any coroutines whose requests completed or
+  // which received a notify
+  void process(const uint8_t* received_data, uint32_t received_data_length) {
+    Base::process(received_data, received_data_length);
+    run_ready();
+  }
+
+ private:
+  // Something which is waiting to be resumed from process()
+  struct Resumable {
+    Resumable* next_ready = nullptr;
+    std::coroutine_handle<> handle;
+  };
+
+  // An awaited read or write request
+  struct RequestAwaiter : Resumable {
+    explicit RequestAwaiter(CoroutineClient* client) : client(client) {}
+    RequestAwaiter(const RequestAwaiter&) = delete;
+    RequestAwaiter& operator=(const RequestAwaiter&) = delete;
+    virtual ~RequestAwaiter() {
+      if (is_waiting) {
+        client->cancel_request(this);
+      }
+    }
+
+    bool await_ready() { return false; }
+    bool await_suspend(std::coroutine_handle<> awaiting) {
+      this->handle = awaiting;
+      return client->suspend_request(this);
+    }
+
+    // The completion callback which is stored by the client while the request is in flight (this may outlive the
+    // awaiter if the coroutine is destroyed, so the awaiter is only dereferenced by the client once it's been checked)
+    struct Completion {
+      void operator()(bool success, const void* data, uint32_t length) {
+        client->on_complete(awaiter, success, data, length);
+      }
+      CoroutineClient* client;
+      RequestAwaiter* awaiter;
+    };
+
+    // Sends the request, returning false if it couldn't be sent
+    virtual bool issue() = 0;
+    // Stores the result of the request
+    virtual void complete(bool success, const void* data, uint32_t length) = 0;
+
+    CoroutineClient* client;
+    RequestAwaiter* next_queued = nullptr;
+    bool is_waiting = false;
+  };
+
+ public:
+  template <typename T, typename Codec>
+  class ReadAwaiter : public RequestAwaiter {
+   public:
+    ReadAwaiter(CoroutineClient* client, Attribute<T, Codec>* attr) : RequestAwaiter(client), attr_(attr) {}
+    ReadResult<T> await_resume() {
+      this->is_waiting = false;
+      return result_;
+    }
+
+   private:
+    bool issue() override {
+      return this->client->issue_read(attr_->get(), typename RequestAwaiter::Completion{this->client, this});
+    }
+    void complete(bool success, const void* data, uint32_t length) override {
+      result_.success = success && Codec::decode(data, length, &result_.value);
+    }
+
+    Attribute<T, Codec>* attr_;
+    ReadResult<T> result_ = {false, T{}};
+  };
+
+  template <typename T, typename Codec>
+  class WriteAwaiter : public RequestAwaiter {
+   public:
+    WriteAwaiter(CoroutineClient* client, Attribute<T, Codec>* attr, const T& value) :
+        RequestAwaiter(client), attr_(attr), value_(value) {}
+    bool await_resume() {
+      this->is_waiting = false;
+      return success_;
+    }
+
+   private:
+    bool issue() override {
+      uint8_t buffer[Codec::kMaxSize ? Codec::kMaxSize : 1];
+      uint32_t length;
+      if (!Codec::encode(value_, buffer, Codec::kMaxSize, &length)) {
+        return false;
+      }
+      return this->client->issue_write(attr_->get(), buffer, length,
+          typename RequestAwaiter::Completion{this->client, this});
+    }
+    void complete(bool success, const void* data, uint32_t length) override { success_ = success; }
+
+    Attribute<T, Codec>* attr_;
+    // the value is only encoded once the request is actually sent
+    T value_;
+    bool success_ = false;
+  };
+
+  template <typename T, typename Codec>
+  class NotifyAwaiter : private Resumable, private detail::NotifyWaiter {
+   public:
+    NotifyAwaiter(CoroutineClient* client, Attribute<T, Codec>* attr) :
+        detail::NotifyWaiter{nullptr, deliver}, client_(client), attr_(attr) {}
+    NotifyAwaiter(const NotifyAwaiter&) = delete;
+    NotifyAwaiter& operator=(const NotifyAwaiter&) = delete;
+    ~NotifyAwaiter() {
+      if (is_waiting_) {
+        attr_->remove_notify_waiter(this);
+      } else if (is_ready_) {
+        client_->remove_ready(this);
+      }
+    }
+
+    bool await_ready() { return false; }
+    void await_suspend(std::coroutine_handle<> awaiting) {
+      this->handle = awaiting;
+      is_waiting_ = true;
+      attr_->add_notify_waiter(this);
+    }
+    T await_resume() {
+      is_ready_ = false;
+      return value_;
+    }
+
+   private:
+    static bool deliver(detail::NotifyWaiter* waiter, const void* data, uint32_t length) {
+      NotifyAwaiter* self = static_cast<NotifyAwaiter*>(waiter);
+      if (!Codec::decode(data, length, &self->value_)) {
+        return false;
+      }
+      self->is_waiting_ = false;
+      self->is_ready_ = true;
+      self->client_->push_ready(self);
+      return true;
+    }
+
+    CoroutineClient* client_;
+    Attribute<T, Codec>* attr_;
+    T value_{};
+    bool is_waiting_ = false;
+    bool is_ready_ = false;
+  };
+
+  // Returns an awaitable which sends a read request and resumes with its ReadResult<T>
+  template <typename T, typename Codec>
+  ReadAwaiter<T, Codec> read(Attribute<T, Codec>& attr) { return ReadAwaiter<T, Codec>(this, &attr); }
+
+  // Returns an awaitable which sends a write request and resumes with whether or not it succeeded
+  template <typename T, typename Codec>
+  WriteAwaiter<T, Codec> write(Attribute<T, Codec>& attr, const T& value) {
+    return WriteAwaiter<T, Codec>(this, &attr, value);
+  }
+
+  // Returns an awaitable which resumes with the value of the next notify for the attribute
+  template <typename T, typename Codec>
+  NotifyAwaiter<T, Codec> next_notify(Attribute<T, Codec>& attr) { return NotifyAwaiter<T, Codec>(this, &attr); }
+
+ private:
+  friend struct RequestAwaiter;
+
+  // Returns whether or not the awaiting coroutine should be suspended
+  bool suspend_request(RequestAwaiter* awaiter) {
+    if (!in_flight_ && !queue_head_ && !this->is_request_pending()) {
+      if (!issue(awaiter)) {
+        // resume right away with the failure
+        awaiter->complete(false, nullptr, 0);
+        return false;
+      }
+    } else {
+      if (queue_tail_) {
+        queue_tail_->next_queued = awaiter;
+      } else {
+        queue_head_ = awaiter;
+      }
+      queue_tail_ = awaiter;
+    }
+    awaiter->is_waiting = true;
+    return true;
+  }
+
+  bool issue(RequestAwaiter* awaiter) {
+    in_flight_ = awaiter;
+    if (!awaiter->issue()) {
+      in_flight_ = nullptr;
+      return false;
+    }
+    return true;
+  }
+
+  void on_complete(RequestAwaiter* awaiter, bool success, const void* data, uint32_t length) {
+    if (in_flight_ != awaiter) {
+      // the awaiting coroutine was destroyed
+      return;
+    }
+    in_flight_ = nullptr;
+    awaiter->complete(success, data, length);
+    push_ready(awaiter);
+  }
+
+  void issue_queued() {
+    while (queue_head_ && !in_flight_ && !this->is_request_pending()) {
+      RequestAwaiter* awaiter = queue_head_;
+      queue_head_ = awaiter->next_queued;
+      if (!queue_head_) {
+        queue_tail_ = nullptr;
+      }
+      awaiter->next_queued = nullptr;
+      if (!issue(awaiter)) {
+        awaiter->complete(false, nullptr, 0);
+        push_ready(awaiter);
+      }
+    }
+  }
+
+  void cancel_request(RequestAwaiter* awaiter) {
+    if (in_flight_ == awaiter) {
+      in_flight_ = nullptr;
+    }
+    RequestAwaiter* prev = nullptr;
+    for (RequestAwaiter* queued = queue_head_; queued; prev = queued, queued = queued->next_queued) {
+      if (queued == awaiter) {
+        (prev ? prev->next_queued : queue_head_) = awaiter->next_queued;
+        if (queue_tail_ == awaiter) {
+          queue_tail_ = prev;
+        }
+        break;
+      }
+    }
+    remove_ready(awaiter);
+  }
+
+  void push_ready(Resumable* resumable) {
+    resumable->next_ready = nullptr;
+    if (ready_tail_) {
+      ready_tail_->next_ready = resumable;
+    } else {
+      ready_head_ = resumable;
+    }
+    ready_tail_ = resumable;
+  }
+
+  void remove_ready(Resumable* resumable) {
+    Resumable* prev = nullptr;
+    for (Resumable* ready = ready_head_; ready; prev = ready, ready = ready->next_ready) {
+      if (ready == resumable) {
+        (prev ? prev->next_ready : ready_head_) = resumable->next_ready;
+        if (ready_tail_ == resumable) {
+          ready_tail_ = prev;
+        }
+        return;
+      }
+    }
+  }
+
+  void run_ready() {
+    while (true) {
+      issue_queued();
+      Resumable* resumable = ready_head_;
+      if (!resumable) {
+        break;
+      }
+      ready_head_ = resumable->next_ready;
+      if (!ready_head_) {
+        ready_tail_ = nullptr;
+      }
+      resumable->handle.resume();
+    }
+  }
+
+  uint8_t arena_buffer_[ArenaSize];
+  CoroutineArena arena_{arena_buffer_, ArenaSize};
+  // The request which has been sent and is waiting for a response
+  RequestAwaiter* in_flight_ = nullptr;
+  // Requests which are waiting to be sent
+  RequestAwaiter* queue_head_ = nullptr;
+  RequestAwaiter* queue_tail_ = nullptr;
+  // Coroutines which are ready to be resumed
+  Resumable* ready_head_ = nullptr;
+  Resumable* ready_tail_ = nullptr;
+};
+
+} // namespace sonar
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "anchor/sonar/capture.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+// NOTE: The replay code is intended for tests and tools on hosted builds, and its sources are listed in
+// SONAR_HOST_C_SOURCES.
+
+typedef struct {
+    // Function which sets the virtual clock which the client or server's get_system_time_ms() function returns
+    void (*set_time_ms)(void* handle, uint64_t time_ms);
+    // Function which calls sonar_client_process() / sonar_server_process() with the received data (if any)
+    void (*process)(void* handle, const uint8_t* data, uint32_t length);
+    // Function which calls sonar_client_get_next_deadline_ms() / sonar_server_get_next_deadline_ms()
+    uint64_t (*get_next_deadline_ms)(void* handle);
+    // Handle which is passed to the functions
+    void* handle;
+} sonar_replay_init_t;
+
+typedef struct {
+    // Whether or not the trace was captured by a server (vs. client)
+    bool is_server;
+    // The number of records in the trace
+    uint32_t num_records;
+    // The number of RX_RAW records which were replayed and the total number of bytes in them
+    uint32_t num_rx_chunks;
+    uint32_t num_rx_bytes;
+    // The number of frames which were transmitted when the trace was captured
+    uint32_t num_tx_frames;
+    // The number of times the process function was called to handle a deadline (vs. received data)
+    uint32_t num_deadlines;
+    // The virtual time of the first and last records
+    uint64_t start_time_ms;
+    uint64_t end_time_ms;
+} sonar_replay_result_t;
+
+// Gets the time of the first record of a trace (or 0 if it's empty), which the virtual clock should be set to before
+// initializing the client or server which the trace is replayed into
+uint64_t sonar_replay_get_start_time_ms(const uint8_t* trace, uint32_t length);
+
+// Replays a trace into a client or server, passing it the data which was received at the same (virtual) time as when
+// it was captured, and also calling the process function whenever a deadline is reached in between, returning false if
+// the trace is invalid
+// NOTE: A capture object can be attached to the client or server in order to compare what it transmits with the trace
+bool sonar_replay_run(const uint8_t* trace, uint32_t length, const sonar_replay_init_t* init, sonar_replay_result_t* result);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "anchor/sonar/server.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+// NOTE: The server host is only intended for Linux builds (it uses epoll), and its sources are listed separately in
+// SONAR_HOST_C_SOURCES.
+
+struct sonar_server_host;
+typedef struct sonar_server_host* sonar_server_host_handle_t;
+
+typedef struct {
+    // The file descriptors for each link (i.e. serial ports, ptys, or sockets), which are owned by the caller but are
+    // set to be non-blocking
+    const int* fds;
+    // The number of links
+    uint32_t num_links;
+    // The attributes which are registered with the server for every link - these are only used as a template (each
+    // link gets its own copy) so they shouldn't be registered with any other server
+    const sonar_server_attribute_t* attrs;
+    // The number of attributes
+    uint32_t num_attrs;
+    // The max size of any of the attributes
+    uint32_t max_attr_size;
+    // Callback when the connection state of a link changes (optional)
+    void (*connection_changed_callback)(sonar_server_host_handle_t handle, uint32_t link_index, bool connected);
+    // Callback when a notify request on a link completes (optional)
+    void (*attribute_notify_complete_handler)(sonar_server_host_handle_t handle, uint32_t link_index, bool success);
+    // Handlers for read / write requests on any link, which are passed the link and the attribute (as it was passed in
+    // attrs) and are called instead of the read / write handlers of the attribute if set (optional)
+    uint32_t (*attribute_read_handler)(sonar_server_host_handle_t handle, uint32_t link_index, sonar_server_attribute_t attr, void* response_data, uint32_t response_max_size);
+    bool (*attribute_write_handler)(sonar_server_host_handle_t handle, uint32_t link_index, sonar_server_attribute_t attr, const void* data, uint32_t length);
+} sonar_server_host_init_t;
+
+// Creates a server host with a SONAR server for each link, returning NULL on failure
+sonar_server_host_handle_t sonar_server_host_create(const sonar_server_host_init_t* init);
+
+// Destroys a server host (the file descriptors are not closed)
+void sonar_server_host_destroy(sonar_server_host_handle_t handle);
+
+// Runs a single iteration of the event loop, waiting for up to timeout_ms (or indefinitely if negative) for data to be
+// received on any of the links or for the next deadline of any of the servers, and then processes the links which need
+// it. Returns false if an error occurred.
+bool sonar_server_host_run_once(sonar_server_host_handle_t handle, int timeout_ms);
+
+// Gets the SONAR server for a link (i.e. to check its connection status or errors)
+// NOTE: sonar_server_host_notify() must be used instead of calling sonar_server_notify() on this server directly
+sonar_server_handle_t sonar_server_host_get_server(sonar_server_host_handle_t handle, uint32_t link_index);
+
+// Sends a notify request for one of the attributes which was passed to sonar_server_host_create() on a link (the data is
+// copied, so doesn't need to remain valid once this returns)
+bool sonar_server_host_notify(sonar_server_host_handle_t handle, uint32_t link_index, sonar_server_attribute_t attr, const void* data, uint32_t length);
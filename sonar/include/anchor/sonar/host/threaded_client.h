@@ -0,0 +1,162 @@
+#pragma once
+
+#include "anchor/sonar/client.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+// NOTE: The threaded client is only intended for hosted (i.e. Linux / macOS) builds with C11 atomics, and its sources
+// are listed separately in SONAR_HOST_C_SOURCES.
+
+#define _SONAR_THREADED_CLIENT_CONTEXT_SIZE ( \
+    sizeof(sonar_threaded_client_init_t) + \
+    sizeof(void*) + \
+    sizeof(sonar_threaded_client_completion_t) + \
+    sizeof(uint32_t) * 2)
+#define _SONAR_THREADED_CLIENT_CHANNEL_SIZE (64 * 8)
+
+// The size of each queue slot, which holds a request / completion along with its data
+#define _SONAR_THREADED_CLIENT_SLOT_SIZE(MAX_ATTR_SIZE) \
+    ((sizeof(sonar_threaded_client_completion_t) + (MAX_ATTR_SIZE) + sizeof(uintptr_t) - 1) & ~(sizeof(uintptr_t) - 1))
+
+// Each channel has a request queue and a completion queue which each need one extra slot
+#define _SONAR_THREADED_CLIENT_QUEUE_BUFFER_SIZE(MAX_ATTR_SIZE, NUM_CHANNELS, QUEUE_DEPTH) \
+    ((NUM_CHANNELS) * 2 * ((QUEUE_DEPTH) + 1) * _SONAR_THREADED_CLIENT_SLOT_SIZE(MAX_ATTR_SIZE) / sizeof(uintptr_t))
+
+// Defines a threaded SONAR client object (along with its underlying SONAR client) which can support attributes of up
+// to MAX_ATTR_SIZE, with NUM_CHANNELS producer channels which can each have up to QUEUE_DEPTH pending requests
+#define SONAR_THREADED_CLIENT_DEF(NAME, MAX_ATTR_SIZE, NUM_CHANNELS, QUEUE_DEPTH) \
+    static uint8_t NAME##_client_receive_buffer_[MAX_ATTR_SIZE + 6]; \
+    _SONAR_CLIENT_SHARED_BUFFERS_DEF(NAME##_client, MAX_ATTR_SIZE) \
+    static sonar_client_context_t NAME##_client_context_ = { \
+        ._private = {0}, \
+        .receive_buffer = NAME##_client_receive_buffer_, \
+        .receive_buffer_size = sizeof(NAME##_client_receive_buffer_), \
+        _SONAR_CLIENT_SHARED_BUFFERS_INIT(NAME##_client, MAX_ATTR_SIZE) \
+    }; \
+    static uintptr_t _##NAME##_queue_buffer[_SONAR_THREADED_CLIENT_QUEUE_BUFFER_SIZE(MAX_ATTR_SIZE, NUM_CHANNELS, QUEUE_DEPTH)]; \
+    static struct sonar_threaded_client_channel _##NAME##_channels[NUM_CHANNELS]; \
+    static void _##NAME##_connection_changed_callback(bool connected); \
+    static void _##NAME##_read_complete_handler(bool success, const void* data, uint32_t length); \
+    static void _##NAME##_write_complete_handler(bool success); \
+    static bool _##NAME##_notify_handler(sonar_attribute_t attr, const void* data, uint32_t length); \
+    static sonar_threaded_client_context_t _##NAME##_context = { \
+        ._private = {0}, \
+        .client = &NAME##_client_context_, \
+        .client_handlers = { \
+            .connection_changed_callback = _##NAME##_connection_changed_callback, \
+            .attribute_read_complete_handler = _##NAME##_read_complete_handler, \
+            .attribute_write_complete_handler = _##NAME##_write_complete_handler, \
+            .attribute_notify_handler = _##NAME##_notify_handler, \
+        }, \
+        .channels = _##NAME##_channels, \
+        .num_channels = NUM_CHANNELS, \
+        .queue_buffer = _##NAME##_queue_buffer, \
+        .queue_depth = QUEUE_DEPTH, \
+        .max_attr_size = MAX_ATTR_SIZE, \
+    }; \
+    static sonar_threaded_client_handle_t NAME = &_##NAME##_context; \
+    static void _##NAME##_connection_changed_callback(bool connected) { \
+        _sonar_threaded_client_connection_changed_callback(NAME, connected); \
+    } \
+    static void _##NAME##_read_complete_handler(bool success, const void* data, uint32_t length) { \
+        _sonar_threaded_client_read_complete_handler(NAME, success, data, length); \
+    } \
+    static void _##NAME##_write_complete_handler(bool success) { \
+        _sonar_threaded_client_write_complete_handler(NAME, success); \
+    } \
+    static bool _##NAME##_notify_handler(sonar_attribute_t attr, const void* data, uint32_t length) { \
+        return _sonar_threaded_client_notify_handler(NAME, attr, data, length); \
+    }
+
+typedef enum {
+    SONAR_THREADED_CLIENT_OP_READ,
+    SONAR_THREADED_CLIENT_OP_WRITE,
+} sonar_threaded_client_op_t;
+
+typedef struct {
+    // The attribute the request was for
+    sonar_attribute_t attr;
+    // The context which was passed when the request was submitted
+    void* context;
+    // The type of request
+    sonar_threaded_client_op_t op;
+    // Whether or not the request succeeded
+    bool success;
+    // The data which was read (only valid for successful reads until the next call to
+    // sonar_threaded_client_poll_completion() for the channel)
+    const void* data;
+    // The length of the data which was read
+    uint32_t length;
+} sonar_threaded_client_completion_t;
+
+typedef struct {
+    // A function which writes a single byte over the physical layer
+    void (*write_byte)(uint8_t byte);
+    // A function which gets the current system time in ms
+    uint64_t (*get_system_time_ms)(void);
+    // Callback when the connection state changes (called from the process thread)
+    void (*connection_changed_callback)(bool connected);
+    // Callback when a notify request is received (called from the process thread)
+    bool (*attribute_notify_handler)(sonar_attribute_t attr, const void* data, uint32_t length);
+} sonar_threaded_client_init_t;
+
+struct sonar_threaded_client_channel {
+    // Allocated space for private context to be used by the SONAR implementation only
+    uint8_t _private[_SONAR_THREADED_CLIENT_CHANNEL_SIZE];
+};
+
+typedef struct sonar_threaded_client_channel* sonar_threaded_client_channel_t;
+
+typedef struct {
+    // Allocated space for private context to be used by the SONAR implementation only
+    uint8_t _private[_SONAR_THREADED_CLIENT_CONTEXT_SIZE];
+    // The underlying SONAR client which is only accessed from the process thread
+    sonar_client_handle_t client;
+    // Handlers for the underlying SONAR client which forward to the threaded client
+    sonar_client_init_t client_handlers;
+    // The producer channels
+    struct sonar_threaded_client_channel* channels;
+    // The number of producer channels
+    uint32_t num_channels;
+    // Buffer used for the request and completion queues of all the channels
+    uintptr_t* queue_buffer;
+    // The max number of pending requests for each channel
+    uint32_t queue_depth;
+    // The max size of any attribute registered with the client
+    uint32_t max_attr_size;
+} sonar_threaded_client_context_t;
+
+typedef sonar_threaded_client_context_t* sonar_threaded_client_handle_t;
+
+// Initialize the threaded SONAR client
+void sonar_threaded_client_init(sonar_threaded_client_handle_t handle, const sonar_threaded_client_init_t* init);
+
+// Register a SONAR client attribute (must be done before the process thread is started)
+void sonar_threaded_client_register(sonar_threaded_client_handle_t handle, sonar_attribute_t attr);
+
+// The main process function which should be called regularly from a single process thread (just like
+// sonar_client_process()) and issues pending requests from the channels
+void sonar_threaded_client_process(sonar_threaded_client_handle_t handle, const uint8_t* received_data, uint32_t received_data_length);
+
+// Returns whether or not the client is connected to the server (may be called from any thread)
+bool sonar_threaded_client_is_connected(sonar_threaded_client_handle_t handle);
+
+// Gets a producer channel, each of which may be used by one application thread at a time
+sonar_threaded_client_channel_t sonar_threaded_client_get_channel(sonar_threaded_client_handle_t handle, uint32_t index);
+
+// Submits a read request, returning false if the channel's queue is full (never blocks)
+bool sonar_threaded_client_submit_read(sonar_threaded_client_channel_t channel, sonar_attribute_t attr, void* context);
+
+// Submits a write request with a copy of the data, returning false if the channel's queue is full or the data is too
+// large (never blocks)
+bool sonar_threaded_client_submit_write(sonar_threaded_client_channel_t channel, sonar_attribute_t attr, const void* data, uint32_t length, void* context);
+
+// Gets the next completed request for the channel, returning false if there isn't one (never blocks)
+bool sonar_threaded_client_poll_completion(sonar_threaded_client_channel_t channel, sonar_threaded_client_completion_t* completion);
+
+// Handlers for the underlying SONAR client which are used by SONAR_THREADED_CLIENT_DEF() only
+void _sonar_threaded_client_connection_changed_callback(sonar_threaded_client_handle_t handle, bool connected);
+void _sonar_threaded_client_read_complete_handler(sonar_threaded_client_handle_t handle, bool success, const void* data, uint32_t length);
+void _sonar_threaded_client_write_complete_handler(sonar_threaded_client_handle_t handle, bool success);
+bool _sonar_threaded_client_notify_handler(sonar_threaded_client_handle_t handle, sonar_attribute_t attr, const void* data, uint32_t length);
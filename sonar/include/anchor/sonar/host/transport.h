@@ -0,0 +1,90 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// NOTE: The transports are only intended for Linux builds (they use termios and POSIX sockets), and their sources are
+// listed separately in SONAR_HOST_C_SOURCES.
+
+#define _SONAR_TRANSPORT_CONTEXT_SIZE ( \
+    sizeof(sonar_transport_stats_t) + \
+    sizeof(uint32_t) * 3 + \
+    sizeof(int) * 2)
+
+// Defines a transport object which buffers up to TX_BUFFER_SIZE bytes of outgoing data, along with a NAME_write_byte()
+// function which can be passed as the write_byte function of a SONAR client or server
+#define SONAR_TRANSPORT_DEF(NAME, TX_BUFFER_SIZE) \
+    static uint8_t _##NAME##_tx_buffer[TX_BUFFER_SIZE]; \
+    static sonar_transport_context_t _##NAME##_context = { \
+        ._private = {0}, \
+        .tx_buffer = _##NAME##_tx_buffer, \
+        .tx_buffer_size = TX_BUFFER_SIZE, \
+    }; \
+    static sonar_transport_handle_t NAME = &_##NAME##_context; \
+    static void NAME##_write_byte(uint8_t byte) { \
+        sonar_transport_write_byte(NAME, byte); \
+    }
+
+typedef struct {
+    // The number of read() calls which were made
+    uint64_t read_calls;
+    // The number of write() calls which were made
+    uint64_t write_calls;
+    // The number of bytes which were read
+    uint64_t bytes_read;
+    // The number of bytes which were written
+    uint64_t bytes_written;
+    // The number of complete frames which were passed to sonar_transport_write_byte()
+    uint64_t frames_written;
+    // The number of bytes which were dropped because the TX buffer was full (once a byte of a frame is dropped, the
+    // rest of the frame is dropped along with whatever part of it is still buffered)
+    uint64_t tx_dropped_bytes;
+} sonar_transport_stats_t;
+
+typedef struct {
+    // Allocated space for private context to be used by the SONAR implementation only
+    uint8_t _private[_SONAR_TRANSPORT_CONTEXT_SIZE];
+    // Buffer which outgoing data is collected in until a complete frame can be written
+    uint8_t* tx_buffer;
+    // The size of the TX buffer (should be at least as large as the largest encoded frame)
+    uint32_t tx_buffer_size;
+} sonar_transport_context_t;
+
+typedef sonar_transport_context_t* sonar_transport_handle_t;
+
+// Opens a serial port in raw mode with the specified baud rate, returning the (non-blocking) file descriptor or -1 on
+// failure
+int sonar_transport_open_serial(const char* path, uint32_t baud_rate);
+
+// Opens a new pseudo-terminal in raw mode, returning the (non-blocking) file descriptor for the master side or -1 on
+// failure, and writing the path of the slave side (which the peer should open) to peer_path
+int sonar_transport_open_pty(char* peer_path, size_t peer_path_size);
+
+// Connects to a UNIX domain stream socket, returning the (non-blocking) file descriptor or -1 on failure
+int sonar_transport_connect_unix(const char* path);
+
+// Connects to a TCP socket with Nagle's algorithm disabled, returning the (non-blocking) file descriptor or -1 on
+// failure
+int sonar_transport_connect_tcp(const char* host, uint16_t port);
+
+// Initializes a transport for the specified file descriptor (which is owned by the caller and set to be non-blocking)
+void sonar_transport_init(sonar_transport_handle_t handle, int fd);
+
+// Adds a byte to the TX buffer, writing out the buffer once it holds a complete frame (this should be passed as the
+// write_byte function of the SONAR client / server, generally through the NAME_write_byte() trampoline)
+void sonar_transport_write_byte(sonar_transport_handle_t handle, uint8_t byte);
+
+// Writes out any data in the TX buffer which couldn't be written previously (i.e. because the file descriptor wasn't
+// writable), returning false if an error occurred
+bool sonar_transport_flush(sonar_transport_handle_t handle);
+
+// Returns whether or not there is data in the TX buffer waiting for the file descriptor to become writable
+bool sonar_transport_has_pending_tx(sonar_transport_handle_t handle);
+
+// Reads as much data as is available (up to size bytes) without blocking, returning the number of bytes read, 0 if
+// there was no data available, or -1 if the file descriptor was closed or an error occurred
+int32_t sonar_transport_receive(sonar_transport_handle_t handle, uint8_t* buffer, uint32_t size);
+
+// Gets the I/O stats for the transport
+void sonar_transport_get_stats(sonar_transport_handle_t handle, sonar_transport_stats_t* stats);
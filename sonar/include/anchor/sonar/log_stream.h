@@ -0,0 +1,104 @@
+#pragma once
+
+#include "anchor/sonar/buffer_chain.h"
+#include "anchor/sonar/server.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+// A log stream carries the output of the logging library (either raw log lines or tokenized records) from a server to
+// the client as batched notifies on a reserved attribute, so that a single link can carry both logs and the
+// application's own attributes. Each write is kept intact within a single notify, so the client can decode each notify
+// on its own.
+
+// The ID of the attribute which the logs are notified on, which is reserved in the README's list of attribute IDs (can
+// be defined globally to move it if it collides with one of the application's attributes)
+#ifndef SONAR_LOG_STREAM_ATTR_ID
+#define SONAR_LOG_STREAM_ATTR_ID 0x1f0
+#endif
+
+// NOTE: This is rounded up to a multiple of 8 bytes to account for padding on targets which 8-byte align uint64_t
+#define _SONAR_LOG_STREAM_CONTEXT_SIZE (( \
+    sizeof(uint64_t) + \
+    sizeof(sonar_log_stream_init_t) + \
+    sizeof(sonar_buffer_chain_entry_t) + \
+    sizeof(uint32_t) * 3 + \
+    sizeof(sonar_log_stream_stats_t) + 7) & ~(size_t)7)
+
+// Defines a log stream object which sends notifies of up to BATCH_SIZE bytes (there are two batches so that one can be
+// filled while the other is being sent)
+// NOTE: The notifies are sent directly from the batches, so the attribute doesn't need its own request, response or
+// delta buffers
+#define SONAR_LOG_STREAM_DEF(NAME, BATCH_SIZE) \
+    _SONAR_ATTR_DEF_IMPL(_##NAME##_attr, SONAR_LOG_STREAM_ATTR_ID, BATCH_SIZE, N, 0, 0); \
+    static struct sonar_server_attribute _##NAME##_server_attr = { \
+        ._private = {0}, \
+        .attr = _##NAME##_attr, \
+        .read_handler = NULL, \
+        .write_handler = NULL, \
+    }; \
+    static uint8_t _##NAME##_buffer[(BATCH_SIZE) * 2]; \
+    static sonar_log_stream_context_t _##NAME##_context = { \
+        ._private = {0}, \
+        .attr = &_##NAME##_server_attr, \
+        .buffer = _##NAME##_buffer, \
+        .batch_size = BATCH_SIZE, \
+    }; \
+    static sonar_log_stream_handle_t NAME = &_##NAME##_context
+
+typedef struct {
+    // The server which the logs are sent by
+    sonar_server_handle_t server;
+    // Function which returns the current system time in ms
+    uint64_t (*get_system_time_ms)(void);
+    // The number of buffered bytes at which a batch is sent (the batch size if 0)
+    uint32_t flush_size;
+    // The max time in ms which data is buffered for before its batch is sent (0 to only send batches once they reach
+    // the flush size)
+    uint32_t flush_age_ms;
+} sonar_log_stream_init_t;
+
+typedef struct {
+    // The number of writes which were buffered
+    uint32_t writes;
+    // The number of writes which were dropped because the batches were full, the write was bigger than a batch, or the
+    // batch it was buffered into couldn't be sent
+    uint32_t dropped;
+    // The number of notifies which were sent
+    uint32_t notifies;
+    // The number of times a batch was ready to be sent but the link was busy (or no client was connected)
+    uint32_t busy;
+} sonar_log_stream_stats_t;
+
+typedef struct {
+    // Allocated space for private context to be used by the SONAR implementation only
+    uint8_t _private[_SONAR_LOG_STREAM_CONTEXT_SIZE];
+    // The attribute which the logs are notified on
+    sonar_server_attribute_t attr;
+    // Buffer which holds both batches
+    uint8_t* buffer;
+    // The size of each batch (and the max size of the attribute)
+    uint32_t batch_size;
+} sonar_log_stream_context_t;
+
+typedef sonar_log_stream_context_t* sonar_log_stream_handle_t;
+
+// Initializes a log stream and registers its attribute with the server
+void sonar_log_stream_init(sonar_log_stream_handle_t handle, const sonar_log_stream_init_t* init);
+
+// Buffers data (i.e. a log line or a tokenized record) to be sent, returning false if it was dropped because the link
+// can't keep up (or the data is bigger than a batch)
+// NOTE: This doesn't send anything itself, so it should be called from the same context as (or be serialized with)
+// sonar_log_stream_process()
+bool sonar_log_stream_write(sonar_log_stream_handle_t handle, const void* data, uint32_t length);
+
+// Sends the current batch if it has reached the flush size or age and the link isn't busy - should be called along with
+// sonar_server_process()
+void sonar_log_stream_process(sonar_log_stream_handle_t handle);
+
+// Gets the system time at which sonar_log_stream_process() next needs to be called to send the current batch based on
+// its age (or UINT64_MAX if there isn't one)
+uint64_t sonar_log_stream_get_next_deadline_ms(sonar_log_stream_handle_t handle);
+
+// Gets the stats and then clears them
+void sonar_log_stream_get_and_clear_stats(sonar_log_stream_handle_t handle, sonar_log_stream_stats_t* stats);
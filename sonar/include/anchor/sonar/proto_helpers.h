@@ -28,6 +28,14 @@
 #define _SONAR_SERVER_PROTO_ATTR_DEF_COPY_IMPL2(NAME, PROTO_MSG_TYPE, OPS) \
     SONAR_SERVER_ATTR_DEF_NO_PROTOTYPES(PROTO_MSG_TYPE##_ATTR, NAME, PROTO_MSG_TYPE##_msgid, PROTO_MSG_TYPE##_size, OPS)
 
+// Same as SONAR_SERVER_PROTO_ATTR_DEF(), except that read responses are encoded directly into the link layer as they're
+// transmitted (see SONAR_SERVER_STREAM_ATTR_DEF()) rather than into a response buffer. This avoids both the need for a
+// response buffer of the message's max size and the extra pass over the encoded data. The message type must support
+// the R op, and the read / write handler prototypes are the same as for SONAR_SERVER_PROTO_ATTR_DEF().
+// NOTE: The read handler is called each time the response is transmitted (including retransmissions)
+#define SONAR_SERVER_PROTO_STREAM_ATTR_DEF(PROTO_MSG_TYPE, NAME) \
+    _SONAR_SERVER_PROTO_STREAM_ATTR_DEF_IMPL(NAME, PROTO_MSG_TYPE, PROTO_MSG_TYPE##_ops)
+
 // Helper macros for SONAR_SERVER_ATTR_*()
 #define _SONAR_SERVER_PROTO_ATTR_DEF_IMPL(NAME, PROTO_MSG_TYPE, OPS) \
     _SONAR_SERVER_PROTO_ATTR_DEF_IMPL2(NAME, PROTO_MSG_TYPE, OPS)
@@ -49,6 +57,22 @@
 #define _SONAR_SERVER_PROTO_ATTR_DEF_IMPL_RWN(PROTO_MSG_TYPE) \
     _SONAR_SERVER_PROTO_ATTR_DEF_IMPL_RW(PROTO_MSG_TYPE)
 
+// Helper macros for SONAR_SERVER_PROTO_STREAM_ATTR_DEF()
+#define _SONAR_SERVER_PROTO_STREAM_ATTR_DEF_IMPL(NAME, PROTO_MSG_TYPE, OPS) \
+    _SONAR_SERVER_PROTO_STREAM_ATTR_DEF_IMPL2(NAME, PROTO_MSG_TYPE, OPS)
+#define _SONAR_SERVER_PROTO_STREAM_ATTR_DEF_IMPL2(NAME, PROTO_MSG_TYPE, OPS) \
+    _SONAR_SERVER_PROTO_STREAM_ATTR_DEF_IMPL_##OPS(PROTO_MSG_TYPE) \
+    SONAR_SERVER_STREAM_ATTR_DEF(PROTO_MSG_TYPE##_ATTR, NAME, PROTO_MSG_TYPE##_msgid, PROTO_MSG_TYPE##_size, OPS)
+#define _SONAR_SERVER_PROTO_STREAM_ATTR_DEF_IMPL_R(PROTO_MSG_TYPE) \
+    _SONAR_SERVER_PROTO_STREAM_READ_HANDLER_DEF(PROTO_MSG_TYPE)
+#define _SONAR_SERVER_PROTO_STREAM_ATTR_DEF_IMPL_RW(PROTO_MSG_TYPE) \
+    _SONAR_SERVER_PROTO_STREAM_ATTR_DEF_IMPL_R(PROTO_MSG_TYPE) \
+    _SONAR_SERVER_PROTO_ATTR_DEF_IMPL_W(PROTO_MSG_TYPE)
+#define _SONAR_SERVER_PROTO_STREAM_ATTR_DEF_IMPL_RN(PROTO_MSG_TYPE) \
+    _SONAR_SERVER_PROTO_STREAM_ATTR_DEF_IMPL_R(PROTO_MSG_TYPE)
+#define _SONAR_SERVER_PROTO_STREAM_ATTR_DEF_IMPL_RWN(PROTO_MSG_TYPE) \
+    _SONAR_SERVER_PROTO_STREAM_ATTR_DEF_IMPL_RW(PROTO_MSG_TYPE)
+
 #define _SONAR_SERVER_PROTO_READ_HANDLER_DEF(PROTO_MSG_TYPE) \
     static bool PROTO_MSG_TYPE##_read_handler(PROTO_MSG_TYPE* msg); \
     static uint32_t PROTO_MSG_TYPE##_ATTR_read_handler(void* response_data, uint32_t response_max_size) { \
@@ -68,6 +92,19 @@
         return PROTO_MSG_TYPE##_write_handler(&msg); \
     }
 
+#define _SONAR_SERVER_PROTO_STREAM_READ_HANDLER_DEF(PROTO_MSG_TYPE) \
+    static bool PROTO_MSG_TYPE##_read_handler(PROTO_MSG_TYPE* msg); \
+    static bool PROTO_MSG_TYPE##_ATTR_stream_callback(pb_ostream_t* stream, const pb_byte_t* buf, size_t count) { \
+        return sonar_server_write_response_data((sonar_server_handle_t)stream->state, buf, count); \
+    } \
+    static bool PROTO_MSG_TYPE##_ATTR_stream_read_handler(sonar_server_handle_t handle, uint32_t response_max_size) { \
+        PROTO_MSG_TYPE msg = {}; \
+        if (!PROTO_MSG_TYPE##_read_handler(&msg)) { \
+            return false; \
+        }; \
+        return SONAR_PROTO_ATTR_ENCODE_STREAM(PROTO_MSG_TYPE, &msg, PROTO_MSG_TYPE##_ATTR_stream_callback, handle, response_max_size); \
+    }
+
 #define SONAR_PROTO_ATTR_ENCODE(PROTO_MSG_TYPE, MSG_PTR, BUFFER, BUFFER_SIZE) ({ \
         uint32_t _result; \
         pb_ostream_t _stream = pb_ostream_from_buffer(BUFFER, BUFFER_SIZE); \
@@ -80,6 +117,29 @@
         _result; \
     })
 
+// Encodes a message via a pb_ostream_t callback, using pb_get_encoded_size() to check that it fits within MAX_SIZE
+// before anything is written
+#define SONAR_PROTO_ATTR_ENCODE_STREAM(PROTO_MSG_TYPE, MSG_PTR, CALLBACK, STATE, MAX_SIZE) ({ \
+        bool _result = false; \
+        size_t _size; \
+        if (!pb_get_encoded_size(&_size, PROTO_MSG_TYPE##_fields, MSG_PTR)) { \
+            LOG_ERROR("Failed to get the encoded size of %s", #PROTO_MSG_TYPE); \
+        } else if (_size > (MAX_SIZE)) { \
+            LOG_ERROR("Encoded %s is too big (%u)", #PROTO_MSG_TYPE, (unsigned)_size); \
+        } else { \
+            pb_ostream_t _stream = { \
+                .callback = CALLBACK, \
+                .state = STATE, \
+                .max_size = _size, \
+            }; \
+            _result = pb_encode(&_stream, PROTO_MSG_TYPE##_fields, MSG_PTR); \
+            if (!_result) { \
+                LOG_ERROR("Failed to encode %s", #PROTO_MSG_TYPE); \
+            } \
+        } \
+        _result; \
+    })
+
 #define SONAR_PROTO_ATTR_DECODE(PROTO_MSG_TYPE, BUFFER, BUFFER_LEN, MSG_PTR) ({ \
         PROTO_MSG_TYPE _temp_msg; \
         pb_istream_t _stream = pb_istream_from_buffer(BUFFER, BUFFER_LEN); \
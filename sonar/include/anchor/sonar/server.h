@@ -2,28 +2,51 @@
 
 #include "anchor/sonar/error_types.h"
 #include "anchor/sonar/attribute.h"
+#include "anchor/sonar/buffer_chain.h"
+#include "anchor/sonar/capture.h"
+#include "anchor/sonar/stats.h"
 
 #include <inttypes.h>
 #include <stdbool.h>
 
 // The context size depends on whether we're compiling for a 64-bit or 32-bit system due to struct padding
 // TODO: haven't figured out the correct 32-bit value yet
-#define _SONAR_SERVER_CONTEXT_SIZE_32   352
-#define _SONAR_SERVER_CONTEXT_SIZE_64   576
+#define _SONAR_SERVER_CONTEXT_SIZE_32   408
+#define _SONAR_SERVER_CONTEXT_SIZE_64   688
 #define _SONAR_SERVER_CONTEXT_SIZE ( \
     sizeof(sonar_server_init_t) + \
-    ((sizeof(uintptr_t) == 8) ? _SONAR_SERVER_CONTEXT_SIZE_64 : _SONAR_SERVER_CONTEXT_SIZE_32))
+    ((sizeof(uintptr_t) == 8) ? _SONAR_SERVER_CONTEXT_SIZE_64 : _SONAR_SERVER_CONTEXT_SIZE_32) + \
+    (SONAR_ATTR_DELTA_NOTIFY ? sizeof(void*) * 3 + sizeof(uint32_t) * 2 : 0) + \
+    (SONAR_ATTR_SHARED_BUFFERS ? sizeof(void*) * 4 : 0) + \
+    (SONAR_STATS ? _SONAR_STATS_CONTEXT_SIZE : 0) + \
+    (SONAR_CAPTURE ? sizeof(void*) * 2 : 0))
 
 // Defines a SONAR server object which can support attributes of up to MAX_ATTR_SIZE
 #define SONAR_SERVER_DEF(NAME, MAX_ATTR_SIZE) \
     static uint8_t _##NAME##_receive_buffer[MAX_ATTR_SIZE + 6 /* protocol overhead */]; \
+    _SONAR_SERVER_SHARED_BUFFERS_DEF(NAME, MAX_ATTR_SIZE) \
     static struct sonar_server_context _##NAME##_context = { \
         ._private = {0}, \
         .receive_buffer = _##NAME##_receive_buffer, \
         .receive_buffer_size = sizeof(_##NAME##_receive_buffer), \
+        _SONAR_SERVER_SHARED_BUFFERS_INIT(NAME, MAX_ATTR_SIZE) \
     }; \
     static sonar_server_handle_t NAME = &_##NAME##_context;
 
+// Helper macros for SONAR_SERVER_DEF()
+#if SONAR_ATTR_SHARED_BUFFERS
+#define _SONAR_SERVER_SHARED_BUFFERS_DEF(NAME, MAX_ATTR_SIZE) \
+    static uint8_t _##NAME##_shared_request_buffer[(MAX_ATTR_SIZE) ? (MAX_ATTR_SIZE) : 1] SONAR_ATTR_BUFFER_ATTRIBUTES; \
+    static uint8_t _##NAME##_shared_response_buffer[(MAX_ATTR_SIZE) ? (MAX_ATTR_SIZE) : 1] SONAR_ATTR_BUFFER_ATTRIBUTES;
+#define _SONAR_SERVER_SHARED_BUFFERS_INIT(NAME, MAX_ATTR_SIZE) \
+    .shared_request_buffer = _##NAME##_shared_request_buffer, \
+    .shared_response_buffer = _##NAME##_shared_response_buffer, \
+    .shared_buffer_size = MAX_ATTR_SIZE,
+#else
+#define _SONAR_SERVER_SHARED_BUFFERS_DEF(NAME, MAX_ATTR_SIZE)
+#define _SONAR_SERVER_SHARED_BUFFERS_INIT(NAME, MAX_ATTR_SIZE)
+#endif
+
 // Defines a SONAR server attribute object
 #define SONAR_SERVER_ATTR_DEF(ATTR_NAME, VAR_NAME, ID, MAX_SIZE, OPS) \
     _SONAR_SERVER_ATTR_HANDLERS_##OPS(ATTR_NAME) \
@@ -38,6 +61,24 @@
     }; \
     static sonar_server_attribute_t VAR_NAME = &_##VAR_NAME##_server_attr
 
+// Defines a SONAR server attribute object whose read responses are written by a stream read handler directly into the
+// link layer as they're transmitted, so no response buffer is allocated for it. This requires the R op and changes the
+// read handler prototype to be:
+//   static bool <ATTR_NAME>_stream_read_handler(sonar_server_handle_t handle, uint32_t response_max_size);
+#define SONAR_SERVER_STREAM_ATTR_DEF(ATTR_NAME, VAR_NAME, ID, MAX_SIZE, OPS) \
+    _SONAR_SERVER_STREAM_ATTR_HANDLERS_##OPS(ATTR_NAME) \
+    SONAR_SERVER_STREAM_ATTR_DEF_NO_PROTOTYPES(ATTR_NAME, VAR_NAME, ID, MAX_SIZE, OPS)
+#define SONAR_SERVER_STREAM_ATTR_DEF_NO_PROTOTYPES(ATTR_NAME, VAR_NAME, ID, MAX_SIZE, OPS) \
+    _SONAR_ATTR_DEF_IMPL(_##VAR_NAME##_attr, ID, MAX_SIZE, OPS, MAX_SIZE, 0); \
+    static struct sonar_server_attribute _##VAR_NAME##_server_attr = { \
+        ._private = {0}, \
+        .attr = _##VAR_NAME##_attr, \
+        .read_handler = NULL, \
+        .write_handler = ATTR_NAME##_write_handler, \
+        .stream_read_handler = ATTR_NAME##_stream_read_handler, \
+    }; \
+    static sonar_server_attribute_t VAR_NAME = &_##VAR_NAME##_server_attr
+
 // Helper macros for SONAR_SERVER_ATTR_DEF()
 #define _SONAR_SERVER_ATTR_HANDLERS_R(NAME) \
     static uint32_t NAME##_read_handler(void* response_data, uint32_t response_max_size); \
@@ -55,6 +96,16 @@
 #define _SONAR_SERVER_ATTR_HANDLERS_WN(NAME) _SONAR_SERVER_ATTR_HANDLERS_W(NAME)
 #define _SONAR_SERVER_ATTR_HANDLERS_RWN(NAME) _SONAR_SERVER_ATTR_HANDLERS_RW(NAME)
 
+// Helper macros for SONAR_SERVER_STREAM_ATTR_DEF()
+#define _SONAR_SERVER_STREAM_ATTR_HANDLERS_R(NAME) \
+    static bool NAME##_stream_read_handler(sonar_server_handle_t handle, uint32_t response_max_size); \
+    static const void* const NAME##_write_handler = NULL;
+#define _SONAR_SERVER_STREAM_ATTR_HANDLERS_RW(NAME) \
+    static bool NAME##_stream_read_handler(sonar_server_handle_t handle, uint32_t response_max_size); \
+    static bool NAME##_write_handler(const void* data, uint32_t length);
+#define _SONAR_SERVER_STREAM_ATTR_HANDLERS_RN(NAME) _SONAR_SERVER_STREAM_ATTR_HANDLERS_R(NAME)
+#define _SONAR_SERVER_STREAM_ATTR_HANDLERS_RWN(NAME) _SONAR_SERVER_STREAM_ATTR_HANDLERS_RW(NAME)
+
 // forward-declare some types
 struct sonar_server_context;
 typedef struct sonar_server_context* sonar_server_handle_t;
@@ -70,6 +121,10 @@ typedef struct {
     void (*connection_changed_callback)(sonar_server_handle_t handle, bool connected);
     // Attribute notify complete handler
     void (*attribute_notify_complete_handler)(sonar_server_handle_t handle, bool success);
+    // Handlers which are passed the server and attribute of read / write requests, and are called instead of the read /
+    // write handlers of the attribute if set (optional)
+    uint32_t (*attribute_read_handler)(sonar_server_handle_t handle, sonar_server_attribute_t attr, void* response_data, uint32_t response_max_size);
+    bool (*attribute_write_handler)(sonar_server_handle_t handle, sonar_server_attribute_t attr, const void* data, uint32_t length);
 } sonar_server_init_t;
 
 // Function prototype for attribute read handlers
@@ -78,6 +133,10 @@ typedef uint32_t (*sonar_server_attribute_read_handler_t)(void* response_data, u
 // Function prototype for attribute write handlers
 typedef bool (*sonar_server_attribute_write_handler_t)(const void* data, uint32_t length);
 
+// Function prototype for attribute stream read handlers, which write the response via sonar_server_write_response_data()
+// NOTE: This is called each time the response is transmitted (including retransmissions)
+typedef bool (*sonar_server_attribute_stream_read_handler_t)(sonar_server_handle_t handle, uint32_t response_max_size);
+
 // A wrapper around an attribute for use by a server
 struct sonar_server_attribute {
     // Allocated space for private context to be used by the SONAR server implementation only
@@ -88,6 +147,8 @@ struct sonar_server_attribute {
     sonar_server_attribute_read_handler_t read_handler;
     // Write handler for the attribute
     sonar_server_attribute_write_handler_t write_handler;
+    // Stream read handler for the attribute (used instead of the read handler if set)
+    sonar_server_attribute_stream_read_handler_t stream_read_handler;
 };
 
 struct sonar_server_context {
@@ -97,6 +158,13 @@ struct sonar_server_context {
     uint8_t* receive_buffer;
     // The size of the receive buffer in bytes
     uint32_t receive_buffer_size;
+#if SONAR_ATTR_SHARED_BUFFERS
+    // Buffers which are shared by all attributes for requests and responses (see SONAR_ATTR_SHARED_BUFFERS)
+    uint8_t* shared_request_buffer;
+    uint8_t* shared_response_buffer;
+    // The size of each of the shared buffers in bytes (the max size of any attribute registered with the server)
+    uint32_t shared_buffer_size;
+#endif
 };
 
 // Initialize the SONAR server
@@ -106,18 +174,53 @@ void sonar_server_init(sonar_server_handle_t handle, const sonar_server_init_t*
 // This should be called regularly even if there's no received data
 void sonar_server_process(sonar_server_handle_t handle, const uint8_t* received_data, uint32_t received_data_length);
 
+// Gets the system time at which sonar_server_process() next needs to be called to handle a timeout or retry (or
+// UINT64_MAX if there isn't one), assuming no data is received before then. This allows an event-driven application to
+// only call sonar_server_process() when data is received or this deadline is reached.
+uint64_t sonar_server_get_next_deadline_ms(sonar_server_handle_t handle);
+
 // Returns whether or not a client is connected to the SONAR server
 bool sonar_server_is_connected(sonar_server_handle_t handle);
 
 // Function to register a SONAR server attribute which was defined with `SONAR_SERVER_ATTR_DEF()`
 void sonar_server_register(sonar_server_handle_t handle, sonar_server_attribute_t attr);
 
+// Returns whether or not a notify request can be sent right now (i.e. a client is connected and no other notify request
+// is pending)
+bool sonar_server_can_notify(sonar_server_handle_t handle);
+
 // Sends a notify request for the specified attribute
 // NOTE: the data passed to this function must remain valid until attribute_notify_complete_handler() is called
 bool sonar_server_notify(sonar_server_handle_t handle, sonar_server_attribute_t attr, const void* data, uint32_t length);
 
+// Sends a notify request for the specified attribute with the data referenced by a caller-owned buffer chain, which is
+// sent directly from the caller's buffers without being copied
+// NOTE: If this returns true, the buffer chain (and its data) must remain valid until release_callback (if not NULL) is
+// called with release_handle, which happens right before attribute_notify_complete_handler() is called. These notifies
+// are never sent as a delta.
+bool sonar_server_notify_chain(sonar_server_handle_t handle, sonar_server_attribute_t attr, const sonar_buffer_chain_entry_t* data, sonar_buffer_chain_release_callback_t release_callback, void* release_handle);
+
 // Sends a notify request for the specified attribute based on the data returned by the attribute_read_handler()
+// NOTE: This isn't supported for attributes defined with SONAR_SERVER_STREAM_ATTR_DEF()
 bool sonar_server_notify_read_data(sonar_server_handle_t handle, sonar_server_attribute_t attr);
 
+// Writes the next chunk of data for a read response - should only be called from an attribute stream read handler (and
+// returns false otherwise)
+bool sonar_server_write_response_data(sonar_server_handle_t handle, const void* data, uint32_t length);
+
 // Gets the error counters and then clears them
 void sonar_server_get_and_clear_errors(sonar_server_handle_t handle, sonar_errors_t* errors);
+
+#if SONAR_STATS
+// Gets the link stats and then clears them
+void sonar_server_get_and_clear_stats(sonar_server_handle_t handle, sonar_stats_t* stats);
+
+// Gets the operation counts for the specified attribute and then clears them
+void sonar_server_get_and_clear_attribute_stats(sonar_server_handle_t handle, sonar_server_attribute_t attr, sonar_attribute_stats_t* stats);
+#endif
+
+#if SONAR_CAPTURE
+// Sets the capture object which all data received and transmitted over the link is recorded to (or NULL to stop
+// capturing)
+void sonar_server_set_capture(sonar_server_handle_t handle, sonar_capture_handle_t capture);
+#endif
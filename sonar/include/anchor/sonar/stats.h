@@ -0,0 +1,63 @@
+#pragma once
+
+#include "anchor/sonar/attribute.h"
+
+#include <inttypes.h>
+
+// The number of buckets in each latency histogram. Bucket 0 counts values of 0ms, and bucket N counts values in the
+// range [2^(N-1), 2^N) ms, with the last bucket also counting everything larger than that.
+#define SONAR_STATS_LATENCY_BUCKETS 12
+
+// The number of buckets in the retries histogram, where bucket N counts requests which were retried N times (with the
+// last bucket also counting anything larger)
+#define SONAR_STATS_RETRY_BUCKETS 4
+
+typedef struct {
+    struct {
+        // Frames sent / received (only valid frames are counted as received)
+        uint32_t frames_sent;
+        uint32_t frames_received;
+        // Bytes sent / received on the physical link (including the framing and escape bytes)
+        uint32_t raw_bytes_sent;
+        uint32_t raw_bytes_received;
+        // Bytes of link layer packets sent / received before encoding / after decoding
+        uint32_t decoded_bytes_sent;
+        uint32_t decoded_bytes_received;
+    } link_layer;
+    struct {
+        // Requests which completed successfully (link control requests aren't counted)
+        uint32_t completed;
+        // Requests which failed due to a timeout or a disconnection
+        uint32_t failed;
+        // Histogram of the number of times each request was retried
+        uint32_t retries[SONAR_STATS_RETRY_BUCKETS];
+        // Histogram of the time from a request (or link control request) being sent to its response being received
+        uint32_t rtt_ms[SONAR_STATS_LATENCY_BUCKETS];
+        // Histogram of the time from a request being issued to it completing successfully (including any retries)
+        uint32_t latency_ms[SONAR_STATS_LATENCY_BUCKETS];
+    } requests;
+    struct {
+        // The number of times the link connected / disconnected
+        uint32_t connects;
+        uint32_t disconnects;
+        // The total time spent connected / disconnected
+        uint64_t connected_ms;
+        uint64_t disconnected_ms;
+    } connection;
+} sonar_stats_t;
+
+typedef struct {
+    // Successful reads / writes / notifies of the attribute
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t notifies;
+    // Failed or rejected operations on the attribute
+    uint32_t failures;
+} sonar_attribute_stats_t;
+
+// The size of the additional link layer context when SONAR_STATS is enabled (used internally by SONAR)
+#define _SONAR_STATS_CONTEXT_SIZE (sizeof(sonar_stats_t) + sizeof(uint64_t) + sizeof(uint32_t) * 4)
+
+// Gets the given percentile (0-100) of a latency histogram, as the upper bound of the bucket which contains it (or
+// UINT64_MAX if it's in the last bucket, and 0 if the histogram is empty)
+uint64_t sonar_stats_get_percentile_ms(const uint32_t histogram[SONAR_STATS_LATENCY_BUCKETS], uint32_t percentile);
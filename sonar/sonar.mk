@@ -2,12 +2,26 @@ SONAR_BASE_DIR := $(patsubst %/,%,$(dir $(lastword $(MAKEFILE_LIST))))
 
 SONAR_C_SOURCES := \
 	$(SONAR_BASE_DIR)/src/client.c \
+	$(SONAR_BASE_DIR)/src/log_stream.c \
 	$(SONAR_BASE_DIR)/src/server.c \
 	$(SONAR_BASE_DIR)/src/common/buffer_chain.c \
+	$(SONAR_BASE_DIR)/src/common/capture.c \
 	$(SONAR_BASE_DIR)/src/common/crc16.c \
+	$(SONAR_BASE_DIR)/src/common/delta.c \
+	$(SONAR_BASE_DIR)/src/common/stats.c \
 	$(SONAR_BASE_DIR)/src/link_layer/link_layer.c \
 	$(SONAR_BASE_DIR)/src/link_layer/receive.c \
 	$(SONAR_BASE_DIR)/src/link_layer/transmit.c \
 	$(SONAR_BASE_DIR)/src/application_layer/application_layer.c \
 	$(SONAR_BASE_DIR)/src/attribute/attribute_server.c \
 	$(SONAR_BASE_DIR)/src/attribute/attribute_client.c
+
+# Sources which are only supported on hosted (i.e. Linux / macOS) builds - the server host requires Linux
+# NOTE: These are kept in host/src rather than src so that they aren't picked up by embedded builds which compile src
+SONAR_HOST_C_SOURCES := \
+	$(SONAR_BASE_DIR)/host/src/channel_sim.c \
+	$(SONAR_BASE_DIR)/host/src/replay.c \
+	$(SONAR_BASE_DIR)/host/src/server_host.c \
+	$(SONAR_BASE_DIR)/host/src/spsc_queue.c \
+	$(SONAR_BASE_DIR)/host/src/threaded_client.c \
+	$(SONAR_BASE_DIR)/host/src/transport.c
@@ -9,10 +9,12 @@
 
 typedef struct {
     bool is_active;
-    bool pending_read_response;
+    bool pending_response;
     sonar_application_layer_header_t header;
     buffer_chain_entry_t header_buffer_chain;
     buffer_chain_entry_t data_buffer_chain;
+    sonar_buffer_chain_release_callback_t release_callback;
+    void* release_handle;
 } pending_request_info_t;
 
 typedef struct {
@@ -21,7 +23,7 @@ typedef struct {
 } instance_impl_t;
 _Static_assert(sizeof(sonar_application_layer_context_t) == sizeof(instance_impl_t), "Invalid context size");
 
-static bool issue_request(instance_impl_t* inst, uint16_t attribute_id, uint16_t op, const uint8_t* data, uint32_t length) {
+static bool issue_request(instance_impl_t* inst, uint16_t attribute_id, uint16_t op, const buffer_chain_entry_t* data, sonar_buffer_chain_release_callback_t release_callback, void* release_handle) {
     if (inst->request.is_active) {
         LOG_ERROR("Application layer request already pending");
         return false;
@@ -37,6 +39,7 @@ static bool issue_request(instance_impl_t* inst, uint16_t attribute_id, uint16_t
         is_invalid_op = inst->init.is_server;
         break;
     case SONAR_APPLICATION_ATTRIBUTE_ID_OP_NOTIFY:
+    case SONAR_APPLICATION_ATTRIBUTE_ID_OP_NOTIFY_DELTA:
         is_invalid_op = !inst->init.is_server;
         break;
     default:
@@ -53,36 +56,63 @@ static bool issue_request(instance_impl_t* inst, uint16_t attribute_id, uint16_t
     inst->request.header = (sonar_application_layer_header_t) {
         .attribute_id = attribute_id | op,
     };
-    buffer_chain_set_data(&inst->request.data_buffer_chain, data, length);
+    // the data chain is never modified, it's just sent after the header
+    inst->request.header_buffer_chain.next = (buffer_chain_entry_t*)data;
     if (!inst->init.send_data_function(inst->init.send_data_handle, &inst->request.header_buffer_chain)) {
         inst->request.is_active = false;
         return false;
     }
+    inst->request.release_callback = release_callback;
+    inst->request.release_handle = release_handle;
     return true;
 }
 
+static bool issue_request_data(instance_impl_t* inst, uint16_t attribute_id, uint16_t op, const uint8_t* data, uint32_t length) {
+    if (inst->request.is_active) {
+        // don't touch the data buffer chain of the pending request
+        LOG_ERROR("Application layer request already pending");
+        return false;
+    }
+    buffer_chain_set_data(&inst->request.data_buffer_chain, data, length);
+    return issue_request(inst, attribute_id, op, &inst->request.data_buffer_chain, NULL, NULL);
+}
+
 void sonar_application_layer_init(sonar_application_layer_handle_t handle, const sonar_application_layer_init_t* init) {
     instance_impl_t* inst = (instance_impl_t*)handle;
     *inst = (instance_impl_t){
         .init = *init,
     };
     buffer_chain_set_data(&inst->request.header_buffer_chain, (const uint8_t*)&inst->request.header, sizeof(inst->request.header));
-    buffer_chain_push_back(&inst->request.header_buffer_chain, &inst->request.data_buffer_chain);
 }
 
 bool sonar_application_layer_read_request(sonar_application_layer_handle_t handle, uint16_t attribute_id) {
     instance_impl_t* inst = (instance_impl_t*)handle;
-    return issue_request(inst, attribute_id, SONAR_APPLICATION_ATTRIBUTE_ID_OP_READ, NULL, 0);
+    return issue_request_data(inst, attribute_id, SONAR_APPLICATION_ATTRIBUTE_ID_OP_READ, NULL, 0);
 }
 
 bool sonar_application_layer_write_request(sonar_application_layer_handle_t handle, uint16_t attribute_id, const uint8_t* data, uint32_t length) {
     instance_impl_t* inst = (instance_impl_t*)handle;
-    return issue_request(inst, attribute_id, SONAR_APPLICATION_ATTRIBUTE_ID_OP_WRITE, data, length);
+    return issue_request_data(inst, attribute_id, SONAR_APPLICATION_ATTRIBUTE_ID_OP_WRITE, data, length);
+}
+
+bool sonar_application_layer_write_request_chain(sonar_application_layer_handle_t handle, uint16_t attribute_id, const buffer_chain_entry_t* data, sonar_buffer_chain_release_callback_t release_callback, void* release_handle) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    return issue_request(inst, attribute_id, SONAR_APPLICATION_ATTRIBUTE_ID_OP_WRITE, data, release_callback, release_handle);
 }
 
 bool sonar_application_layer_notify_request(sonar_application_layer_handle_t handle, uint16_t attribute_id, const uint8_t* data, uint32_t length) {
     instance_impl_t* inst = (instance_impl_t*)handle;
-    return issue_request(inst, attribute_id, SONAR_APPLICATION_ATTRIBUTE_ID_OP_NOTIFY, data, length);
+    return issue_request_data(inst, attribute_id, SONAR_APPLICATION_ATTRIBUTE_ID_OP_NOTIFY, data, length);
+}
+
+bool sonar_application_layer_notify_request_chain(sonar_application_layer_handle_t handle, uint16_t attribute_id, const buffer_chain_entry_t* data, sonar_buffer_chain_release_callback_t release_callback, void* release_handle) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    return issue_request(inst, attribute_id, SONAR_APPLICATION_ATTRIBUTE_ID_OP_NOTIFY, data, release_callback, release_handle);
+}
+
+bool sonar_application_layer_notify_delta_request(sonar_application_layer_handle_t handle, uint16_t attribute_id, const uint8_t* data, uint32_t length) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    return issue_request_data(inst, attribute_id, SONAR_APPLICATION_ATTRIBUTE_ID_OP_NOTIFY_DELTA, data, length);
 }
 
 bool sonar_application_layer_handle_request(sonar_application_layer_handle_t handle, const uint8_t* data, uint32_t length) {
@@ -110,10 +140,10 @@ bool sonar_application_layer_handle_request(sonar_application_layer_handle_t han
                 LOG_ERROR("Invalid application layer packet: read request with data (%"PRIu32")", length);
                 return false;
             }
-            inst->request.pending_read_response = true;
+            inst->request.pending_response = true;
             const bool success = inst->init.attribute_read_handler(inst->init.attr_handler_handle, attribute_id);
-            const bool set_response = !inst->request.pending_read_response;
-            inst->request.pending_read_response = false;
+            const bool set_response = !inst->request.pending_response;
+            inst->request.pending_response = false;
             if (!success) {
                 return false;
             } else if (!set_response) {
@@ -134,21 +164,41 @@ bool sonar_application_layer_handle_request(sonar_application_layer_handle_t han
             inst->init.set_response_function(inst->init.send_data_handle, NULL, 0);
             return true;
         case SONAR_APPLICATION_ATTRIBUTE_ID_OP_NOTIFY:
+        case SONAR_APPLICATION_ATTRIBUTE_ID_OP_NOTIFY_DELTA: {
             if (inst->init.is_server) {
                 LOG_ERROR("Invalid application layer packet: notify request from client");
                 return false;
             }
-            if (!inst->init.attribute_notify_handler(inst->init.attr_handler_handle, attribute_id, data, length)) {
+            const bool is_delta = op == SONAR_APPLICATION_ATTRIBUTE_ID_OP_NOTIFY_DELTA;
+            if (is_delta && !inst->init.attribute_notify_delta_handler) {
+                LOG_ERROR("Invalid application layer packet: notify delta requests not supported");
                 return false;
             }
-            inst->init.set_response_function(inst->init.send_data_handle, NULL, 0);
+            inst->request.pending_response = true;
+            const bool success = is_delta ?
+                inst->init.attribute_notify_delta_handler(inst->init.attr_handler_handle, attribute_id, data, length) :
+                inst->init.attribute_notify_handler(inst->init.attr_handler_handle, attribute_id, data, length);
+            const bool set_response = !inst->request.pending_response;
+            inst->request.pending_response = false;
+            if (!success) {
+                return false;
+            } else if (!set_response) {
+                // the response data is optional for notify requests
+                inst->init.set_response_function(inst->init.send_data_handle, NULL, 0);
+            }
             return true;
+        }
         default:
             LOG_ERROR("Invalid application layer packet: invalid op (%u)", op);
             return false;
     }
 }
 
+bool sonar_application_layer_is_request_pending(sonar_application_layer_handle_t handle) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    return inst->request.is_active;
+}
+
 void sonar_application_layer_handle_response(sonar_application_layer_handle_t handle, bool success, const uint8_t* data, uint32_t length) {
     instance_impl_t* inst = (instance_impl_t*)handle;
     if (!inst->request.is_active) {
@@ -157,6 +207,12 @@ void sonar_application_layer_handle_response(sonar_application_layer_handle_t ha
         return;
     }
     inst->request.is_active = false;
+    if (inst->request.release_callback) {
+        // the request data is no longer referenced by the link layer
+        const sonar_buffer_chain_release_callback_t release_callback = inst->request.release_callback;
+        inst->request.release_callback = NULL;
+        release_callback(inst->request.release_handle);
+    }
     const uint16_t attribute_id = inst->request.header.attribute_id & SONAR_APPLICATION_ATTRIBUTE_ID_ATTRIBUTE_ID_MASK;
     switch (inst->request.header.attribute_id & SONAR_APPLICATION_ATTRIBUTE_ID_OP_MASK) {
         case SONAR_APPLICATION_ATTRIBUTE_ID_OP_READ:
@@ -166,7 +222,8 @@ void sonar_application_layer_handle_response(sonar_application_layer_handle_t ha
             inst->init.write_request_complete_handler(inst->init.request_complete_handle, attribute_id, success);
             break;
         case SONAR_APPLICATION_ATTRIBUTE_ID_OP_NOTIFY:
-            inst->init.notify_request_complete_handler(inst->init.request_complete_handle, attribute_id, success);
+        case SONAR_APPLICATION_ATTRIBUTE_ID_OP_NOTIFY_DELTA:
+            inst->init.notify_request_complete_handler(inst->init.request_complete_handle, attribute_id, success, data, length);
             break;
         default:
             // should never happen
@@ -177,10 +234,38 @@ void sonar_application_layer_handle_response(sonar_application_layer_handle_t ha
 
 void sonar_application_layer_read_response(sonar_application_layer_handle_t handle, const uint8_t* data, uint32_t length) {
     instance_impl_t* inst = (instance_impl_t*)handle;
-    if (!inst->request.pending_read_response) {
+    if (!inst->request.pending_response) {
         LOG_ERROR("Unexpected read response");
         return;
     }
-    inst->request.pending_read_response = false;
+    inst->request.pending_response = false;
+    inst->init.set_response_function(inst->init.send_data_handle, data, length);
+}
+
+void sonar_application_layer_read_response_writer(sonar_application_layer_handle_t handle, bool (*writer)(void* handle), void* writer_handle) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    if (!inst->request.pending_response) {
+        LOG_ERROR("Unexpected read response");
+        return;
+    } else if (!inst->init.set_response_writer_function) {
+        LOG_ERROR("Response writers are not supported");
+        return;
+    }
+    inst->request.pending_response = false;
+    inst->init.set_response_writer_function(inst->init.send_data_handle, writer, writer_handle);
+}
+
+void sonar_application_layer_write_response_data(sonar_application_layer_handle_t handle, const uint8_t* data, uint32_t length) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    inst->init.write_response_data_function(inst->init.send_data_handle, data, length);
+}
+
+void sonar_application_layer_notify_response(sonar_application_layer_handle_t handle, const uint8_t* data, uint32_t length) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    if (!inst->request.pending_response) {
+        LOG_ERROR("Unexpected notify response");
+        return;
+    }
+    inst->request.pending_response = false;
     inst->init.set_response_function(inst->init.send_data_handle, data, length);
 }
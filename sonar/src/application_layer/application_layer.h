@@ -8,6 +8,7 @@
 #define _SONAR_APPLICATION_LAYER_CONTEXT_SIZE ( \
     sizeof(uintptr_t) + /* pending_request_info_t.{is_active,header} */ \
     sizeof(buffer_chain_entry_t) * 2 + /* pending_request_info_t.{header_buffer_chain,data_buffer_chain} */ \
+    sizeof(void*) * 2 + /* pending_request_info_t.{release_callback,release_handle} */ \
     sizeof(sonar_application_layer_init_t))
 
 // Handle type passed to send_data_function()
@@ -26,23 +27,32 @@ typedef struct {
     bool (*send_data_function)(sonar_application_layer_send_data_handle_t handle, const buffer_chain_entry_t* data);
     // Function which is called to set the response while handling a request
     void (*set_response_function)(sonar_application_layer_send_data_handle_t handle, const uint8_t* data, uint32_t length);
+    // Function which is called to set a writer which produces the response as it's transmitted (optional)
+    void (*set_response_writer_function)(sonar_application_layer_send_data_handle_t handle, bool (*writer)(void* handle), void* writer_handle);
+    // Function which is called by response writers to write the next chunk of response data (optional)
+    void (*write_response_data_function)(sonar_application_layer_send_data_handle_t handle, const uint8_t* data, uint32_t length);
     // Handle passed to send_data_function()
     sonar_application_layer_send_data_handle_t send_data_handle;
     // Handler for attribute read requests
-    // NOTE: This must call sonar_application_layer_read_response() with the response data
+    // NOTE: This must call sonar_application_layer_read_response() with the response data (or
+    // sonar_application_layer_read_response_writer())
     bool (*attribute_read_handler)(sonar_application_layer_attribute_handler_handle_t handle, uint16_t attribute_id);
     // Handler for attribute write requests
     bool (*attribute_write_handler)(sonar_application_layer_attribute_handler_handle_t handle, uint16_t attribute_id, const uint8_t* data, uint32_t length);
     // Handler for attribute notify requests
+    // NOTE: This may call sonar_application_layer_notify_response() to include data in the response
     bool (*attribute_notify_handler)(sonar_application_layer_attribute_handler_handle_t handle, uint16_t attribute_id, const uint8_t* data, uint32_t length);
+    // Handler for attribute notify delta requests (optional)
+    // NOTE: This may call sonar_application_layer_notify_response() to include data in the response
+    bool (*attribute_notify_delta_handler)(sonar_application_layer_attribute_handler_handle_t handle, uint16_t attribute_id, const uint8_t* data, uint32_t length);
     // Handle passed to attribute_*_handler()
     sonar_application_layer_attribute_handler_handle_t attr_handler_handle;
     // Handler for read request completion
     void(*read_request_complete_handler)(sonar_application_layer_request_complete_handler_handle_t handle, uint16_t attribute_id, bool success, const uint8_t* data, uint32_t length);
     // Handler for write request completion
     void(*write_request_complete_handler)(sonar_application_layer_request_complete_handler_handle_t handle, uint16_t attribute_id, bool success);
-    // Handler for notify request completion
-    void(*notify_request_complete_handler)(sonar_application_layer_request_complete_handler_handle_t handle, uint16_t attribute_id, bool success);
+    // Handler for notify (and notify delta) request completion
+    void(*notify_request_complete_handler)(sonar_application_layer_request_complete_handler_handle_t handle, uint16_t attribute_id, bool success, const uint8_t* data, uint32_t length);
     // Handle passed to *_request_complete_handler()
     sonar_application_layer_request_complete_handler_handle_t request_complete_handle;
 } sonar_application_layer_init_t;
@@ -61,10 +71,27 @@ bool sonar_application_layer_read_request(sonar_application_layer_handle_t handl
 // NOTE: the data pointer must remain valid until the handler is called
 bool sonar_application_layer_write_request(sonar_application_layer_handle_t handle, uint16_t attribute_id, const uint8_t* data, uint32_t length);
 
+// Sends a SONAR application layer write request for a given attribute with the data referenced by a buffer chain
+// NOTE: the buffer chain (and its data) must remain valid until release_callback (if not NULL) is called, which happens
+// right before the handler is called
+bool sonar_application_layer_write_request_chain(sonar_application_layer_handle_t handle, uint16_t attribute_id, const buffer_chain_entry_t* data, sonar_buffer_chain_release_callback_t release_callback, void* release_handle);
+
 // Sends a SONAR application layer notify request for a given attribute, with the handler specified in sonar_application_layer_init_t being being called on completion
 // NOTE: the data pointer must remain valid until the handler is called
 bool sonar_application_layer_notify_request(sonar_application_layer_handle_t handle, uint16_t attribute_id, const uint8_t* data, uint32_t length);
 
+// Sends a SONAR application layer notify request for a given attribute with the data referenced by a buffer chain
+// NOTE: the buffer chain (and its data) must remain valid until release_callback (if not NULL) is called, which happens
+// right before the handler is called
+bool sonar_application_layer_notify_request_chain(sonar_application_layer_handle_t handle, uint16_t attribute_id, const buffer_chain_entry_t* data, sonar_buffer_chain_release_callback_t release_callback, void* release_handle);
+
+// Sends a SONAR application layer notify delta request for a given attribute, with the handler specified in sonar_application_layer_init_t being called on completion
+// NOTE: the data pointer must remain valid until the handler is called
+bool sonar_application_layer_notify_delta_request(sonar_application_layer_handle_t handle, uint16_t attribute_id, const uint8_t* data, uint32_t length);
+
+// Returns whether or not a request is pending (in which case no other request can be sent until it completes)
+bool sonar_application_layer_is_request_pending(sonar_application_layer_handle_t handle);
+
 // Handles a received SONAR application layer request, populating the response as applicable
 bool sonar_application_layer_handle_request(sonar_application_layer_handle_t handle, const uint8_t* data, uint32_t length);
 
@@ -73,3 +100,18 @@ void sonar_application_layer_handle_response(sonar_application_layer_handle_t ha
 
 // Sends a SONAR application layer read response - should only (and must) be called from attribute_read_handler()
 void sonar_application_layer_read_response(sonar_application_layer_handle_t handle, const uint8_t* data, uint32_t length);
+
+// Sets a writer which produces the SONAR application layer read response as it's transmitted by calling
+// sonar_application_layer_write_response_data() - may be called from attribute_read_handler() instead of
+// sonar_application_layer_read_response()
+// NOTE: The writer is called again if the response needs to be retransmitted
+void sonar_application_layer_read_response_writer(sonar_application_layer_handle_t handle, bool (*writer)(void* handle), void* writer_handle);
+
+// Writes the next chunk of read response data - should only be called from a writer passed to
+// sonar_application_layer_read_response_writer()
+void sonar_application_layer_write_response_data(sonar_application_layer_handle_t handle, const uint8_t* data, uint32_t length);
+
+// Sets the data for a SONAR application layer notify response - may only be called from attribute_notify_handler() or
+// attribute_notify_delta_handler()
+// NOTE: the data pointer must remain valid until the next request is handled
+void sonar_application_layer_notify_response(sonar_application_layer_handle_t handle, const uint8_t* data, uint32_t length);
@@ -8,6 +8,11 @@
 #define SONAR_APPLICATION_ATTRIBUTE_ID_OP_READ              (1 << SONAR_APPLICATION_ATTRIBUTE_ID_OP_OFFSET)
 #define SONAR_APPLICATION_ATTRIBUTE_ID_OP_WRITE             (2 << SONAR_APPLICATION_ATTRIBUTE_ID_OP_OFFSET)
 #define SONAR_APPLICATION_ATTRIBUTE_ID_OP_NOTIFY            (3 << SONAR_APPLICATION_ATTRIBUTE_ID_OP_OFFSET)
+#define SONAR_APPLICATION_ATTRIBUTE_ID_OP_NOTIFY_DELTA      (4 << SONAR_APPLICATION_ATTRIBUTE_ID_OP_OFFSET)
+
+// Optional status byte which the client may include in the response to a notify or notify delta request
+#define SONAR_APPLICATION_NOTIFY_STATUS_DELTA_BASE_MISMATCH 0x00
+#define SONAR_APPLICATION_NOTIFY_STATUS_DELTA_BASE_STORED   0x01
 
 
 typedef struct {
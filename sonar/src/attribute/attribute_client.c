@@ -2,6 +2,7 @@
 
 #include "../application_layer/types.h"
 #include "control_helpers.h"
+#include "../common/delta.h"
 
 #define LOGGING_MODULE_NAME "SONAR"
 #include "anchor/logging/logging.h"
@@ -15,8 +16,20 @@ typedef struct {
     sonar_attribute_def_t* next;
     bool is_available;
     bool is_registered;
+#if SONAR_ATTR_CACHE
+    bool has_cached_value;
+    uint32_t cached_length;
+    uint32_t cached_time_ms;
+#endif
+#if SONAR_ATTR_DELTA_NOTIFY
+    bool has_delta_base;
+    uint32_t delta_base_length;
+#endif
+#if SONAR_STATS
+    sonar_attribute_stats_t stats;
+#endif
 } attribute_context_t;
-_Static_assert(sizeof(attribute_context_t) == sizeof(((sonar_attribute_def_t*)0)->_private), "Invalid size");
+_Static_assert(sizeof(attribute_context_t) <= sizeof(((sonar_attribute_def_t*)0)->_private), "Invalid size");
 
 typedef struct {
     sonar_attribute_client_init_t init;
@@ -24,6 +37,9 @@ typedef struct {
     uint16_t num_attrs;
     uint16_t attr_offset;
     bool is_connected;
+#if SONAR_ATTR_SHARED_BUFFERS
+    bool is_shared_request_buffer_in_use;
+#endif
 } instance_impl_t;
 _Static_assert(sizeof(instance_impl_t) == sizeof(sonar_attribute_client_context_t), "Invalid context size");
 
@@ -36,6 +52,15 @@ static sonar_attribute_def_t* get_def_by_id(instance_impl_t* inst, uint16_t attr
     return NULL;
 }
 
+static uint8_t* get_request_buffer(instance_impl_t* inst, const sonar_attribute_def_t* def) {
+#if SONAR_ATTR_SHARED_BUFFERS
+    // the shared buffer holds the data for the pending write until it completes
+    return inst->is_shared_request_buffer_in_use ? NULL : inst->init.shared_request_buffer;
+#else
+    return def->request_buffer;
+#endif
+}
+
 static bool send_attribute_read(instance_impl_t* inst, uint16_t attribute_id) {
     return inst->init.send_read_request_function(inst->init.handle, attribute_id);
 }
@@ -44,6 +69,22 @@ static bool send_attribute_write(instance_impl_t* inst, uint16_t attribute_id, c
     return inst->init.send_write_request_function(inst->init.handle, attribute_id, data, length);
 }
 
+#if SONAR_ATTR_DELTA_NOTIFY
+static const uint8_t DELTA_BASE_MISMATCH_RESPONSE = SONAR_APPLICATION_NOTIFY_STATUS_DELTA_BASE_MISMATCH;
+static const uint8_t DELTA_BASE_STORED_RESPONSE = SONAR_APPLICATION_NOTIFY_STATUS_DELTA_BASE_STORED;
+#endif
+
+#if SONAR_ATTR_CACHE
+static void update_cache(instance_impl_t* inst, const sonar_attribute_def_t* def, const uint8_t* data, uint32_t length) {
+    // the response buffer isn't otherwise used by the client, so store the cached value there
+    memcpy(def->response_buffer, data, length);
+    attribute_context_t* context = GET_CONTEXT(def);
+    context->has_cached_value = true;
+    context->cached_length = length;
+    context->cached_time_ms = (uint32_t)inst->init.get_system_time_ms();
+}
+#endif
+
 static void disconnect(instance_impl_t* inst) {
     inst->is_connected = false;
     inst->init.connection_changed_callback(inst->init.handle, false);
@@ -155,7 +196,19 @@ void sonar_attribute_client_register(sonar_attribute_client_handle_t handle, son
         LOG_ERROR("Must register all attributes before a connection is established");
         return;
     }
+#if SONAR_ATTR_SHARED_BUFFERS
+    if (def->max_size > inst->init.shared_buffer_size) {
+        LOG_ERROR("Attribute (0x%x) is too big for the shared buffers", def->attribute_id);
+        return;
+    }
+#endif
     GET_CONTEXT(def)->is_registered = true;
+#if SONAR_ATTR_DELTA_NOTIFY
+    GET_CONTEXT(def)->has_delta_base = false;
+#endif
+#if SONAR_STATS
+    GET_CONTEXT(def)->stats = (sonar_attribute_stats_t){0};
+#endif
     if (inst->def_list) {
         // add to the front of the list
         GET_CONTEXT(def)->next = inst->def_list;
@@ -179,6 +232,12 @@ void sonar_attribute_client_low_level_connection_changed(sonar_attribute_client_
         LOG_INFO("Disconnected");
         for (const sonar_attribute_def_t* def = inst->def_list; def; def = GET_CONTEXT(def)->next) {
             GET_CONTEXT(def)->is_available = false;
+#if SONAR_ATTR_CACHE
+            GET_CONTEXT(def)->has_cached_value = false;
+#endif
+#if SONAR_ATTR_DELTA_NOTIFY
+            GET_CONTEXT(def)->has_delta_base = false;
+#endif
         }
         inst->is_connected = false;
         inst->init.connection_changed_callback(inst->init.handle, false);
@@ -209,9 +268,7 @@ bool sonar_attribute_client_read(sonar_attribute_client_handle_t handle, sonar_a
     return send_attribute_read(inst, def->attribute_id);
 }
 
-bool sonar_attribute_client_write(sonar_attribute_client_handle_t handle, sonar_attribute_t attr, const uint8_t* data, uint32_t length) {
-    instance_impl_t* inst = (instance_impl_t*)handle;
-    const sonar_attribute_def_t* def = attr;
+static bool validate_write_request(const sonar_attribute_def_t* def, uint32_t length) {
     if (!def) {
         LOG_ERROR("Unknown attribute");
         return false;
@@ -228,9 +285,64 @@ bool sonar_attribute_client_write(sonar_attribute_client_handle_t handle, sonar_
         LOG_ERROR("Write data is too big");
         return false;
     }
-    memcpy(def->request_buffer, data, length);
-    return send_attribute_write(inst, def->attribute_id, def->request_buffer, length);
+    return true;
+}
+
+bool sonar_attribute_client_write(sonar_attribute_client_handle_t handle, sonar_attribute_t attr, const uint8_t* data, uint32_t length) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    const sonar_attribute_def_t* def = attr;
+    if (!validate_write_request(def, length)) {
+        return false;
+    }
+    uint8_t* buffer = get_request_buffer(inst, def);
+    if (!buffer) {
+        LOG_ERROR("Request buffer is in use");
+        return false;
+    }
+    memcpy(buffer, data, length);
+    if (!send_attribute_write(inst, def->attribute_id, buffer, length)) {
+        return false;
+    }
+#if SONAR_ATTR_SHARED_BUFFERS
+    inst->is_shared_request_buffer_in_use = true;
+#endif
+    return true;
+}
+
+bool sonar_attribute_client_write_chain(sonar_attribute_client_handle_t handle, sonar_attribute_t attr, const buffer_chain_entry_t* data, sonar_buffer_chain_release_callback_t release_callback, void* release_handle) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    const sonar_attribute_def_t* def = attr;
+    if (!validate_write_request(def, buffer_chain_get_length(data))) {
+        return false;
+    }
+    return inst->init.send_write_chain_request_function(inst->init.handle, def->attribute_id, data, release_callback, release_handle);
+}
+
+#if SONAR_ATTR_CACHE
+bool sonar_attribute_client_read_cached(sonar_attribute_client_handle_t handle, sonar_attribute_t attr, uint32_t max_age_ms, const uint8_t** data, uint32_t* length) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    const sonar_attribute_def_t* def = attr;
+    if (!def) {
+        LOG_ERROR("Unknown attribute");
+        return false;
+    } else if (!GET_CONTEXT(def)->is_registered) {
+        LOG_ERROR("Attribute not registered");
+        return false;
+    }
+    const attribute_context_t* context = GET_CONTEXT(def);
+    if (!context->has_cached_value) {
+        return false;
+    }
+    // the unsigned subtraction handles the cached time wrapping
+    const uint32_t age_ms = (uint32_t)inst->init.get_system_time_ms() - context->cached_time_ms;
+    if (age_ms > max_age_ms) {
+        return false;
+    }
+    *data = def->response_buffer;
+    *length = context->cached_length;
+    return true;
 }
+#endif
 
 void sonar_attribute_client_handle_read_response(sonar_attribute_client_handle_t handle, uint16_t attribute_id, bool success, const uint8_t* data, uint32_t length) {
     instance_impl_t* inst = (instance_impl_t*)handle;
@@ -250,16 +362,33 @@ void sonar_attribute_client_handle_read_response(sonar_attribute_client_handle_t
     } else if (success && length > def->max_size) {
         LOG_ERROR("Read response is too big (%"PRIu32") for attribute (0x%x)", length, attribute_id);
         return;
-    } else if (!GET_CONTEXT(def)->is_available) {
-        // this could happen if we've recently disconnected
+    } else if (success && !GET_CONTEXT(def)->is_available) {
+        // this could happen if we've recently disconnected (failures are still passed through since a request which
+        // was pending when the link disconnected is failed after the attributes are marked unavailable)
         LOG_ERROR("Unexpected read response for unavailable attribute (0x%x)", attribute_id);
         return;
     }
+#if SONAR_ATTR_CACHE
+    if (success) {
+        update_cache(inst, def, data, length);
+    }
+#endif
+#if SONAR_STATS
+    if (success) {
+        GET_CONTEXT(def)->stats.reads++;
+    } else {
+        GET_CONTEXT(def)->stats.failures++;
+    }
+#endif
     inst->init.read_complete_handler(inst->init.handle, success, data, length);
 }
 
 void sonar_attribute_client_handle_write_response(sonar_attribute_client_handle_t handle, uint16_t attribute_id, bool success) {
     instance_impl_t* inst = (instance_impl_t*)handle;
+#if SONAR_ATTR_SHARED_BUFFERS
+    // the write is no longer pending
+    inst->is_shared_request_buffer_in_use = false;
+#endif
     // handle control attributes explicitly inline here since they aren't registered
     if (attribute_id == CTRL_ATTR_OFFSET_ID) {
         attr_offset_write_complete(inst, success);
@@ -270,23 +399,60 @@ void sonar_attribute_client_handle_write_response(sonar_attribute_client_handle_
         // should never happen
         LOG_ERROR("Unexpected write response");
         return;
-    } else if (!GET_CONTEXT(def)->is_available) {
-        // this could happen if we've recently disconnected
+    } else if (success && !GET_CONTEXT(def)->is_available) {
+        // this could happen if we've recently disconnected (failures are still passed through as with reads)
         LOG_ERROR("Unexpected write response for unavailable attribute");
         return;
     }
+#if SONAR_ATTR_CACHE
+    if (success) {
+        // the server's value may no longer match what we have cached
+        GET_CONTEXT(def)->has_cached_value = false;
+    }
+#endif
+#if SONAR_STATS
+    if (success) {
+        GET_CONTEXT(def)->stats.writes++;
+    } else {
+        GET_CONTEXT(def)->stats.failures++;
+    }
+#endif
     inst->init.write_complete_handler(inst->init.handle, success);
 }
 
-bool sonar_attribute_client_handle_notify_request(sonar_attribute_client_handle_t handle, uint16_t attribute_id, const uint8_t* data, uint32_t length) {
-    instance_impl_t* inst = (instance_impl_t*)handle;
-    sonar_attribute_def_t* def = get_def_by_id(inst, attribute_id);
+static bool validate_notify_request(const sonar_attribute_def_t* def, uint16_t attribute_id) {
     if (!def) {
         LOG_ERROR("Got notify request for unknown attribute (0x%x)", attribute_id);
         return false;
     } else if (!(def->ops & SONAR_ATTRIBUTE_OPS_N)) {
         LOG_ERROR("Notify request not supported for attribute (0x%x)", attribute_id);
         return false;
+    }
+    return true;
+}
+
+static bool handle_notify(instance_impl_t* inst, sonar_attribute_def_t* def, const uint8_t* data, uint32_t length) {
+    if (!inst->init.notify_handler(inst->init.handle, def, data, length)) {
+#if SONAR_STATS
+        GET_CONTEXT(def)->stats.failures++;
+#endif
+        return false;
+    }
+#if SONAR_STATS
+    GET_CONTEXT(def)->stats.notifies++;
+#endif
+#if SONAR_ATTR_CACHE
+    // only cache notifies which were accepted since rejected ones will be retried by the server
+    update_cache(inst, def, data, length);
+#endif
+    return true;
+}
+
+bool sonar_attribute_client_handle_notify_request(sonar_attribute_client_handle_t handle, uint16_t attribute_id, const uint8_t* data, uint32_t length) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    sonar_attribute_def_t* def = get_def_by_id(inst, attribute_id);
+    if (!validate_notify_request(def, attribute_id)) {
+        return false;
     } else if (length > def->max_size) {
         LOG_ERROR("Notify request is too big (%"PRIu32") for attribute (0x%x)", length, attribute_id);
         return false;
@@ -294,5 +460,62 @@ bool sonar_attribute_client_handle_notify_request(sonar_attribute_client_handle_
         LOG_ERROR("Notify request for an attribute which is not available");
         return false;
     }
-    return inst->init.notify_handler(inst->init.handle, def, data, length);
+#if SONAR_ATTR_DELTA_NOTIFY
+    attribute_context_t* context = GET_CONTEXT(def);
+    context->has_delta_base = false;
+    if (!handle_notify(inst, def, data, length)) {
+        return false;
+    }
+    if (def->delta_buffer) {
+        // store the value as the base for future deltas and let the server know that it can send them
+        memcpy(def->delta_buffer, data, length);
+        context->has_delta_base = true;
+        context->delta_base_length = length;
+        inst->init.notify_response_handler(inst->init.handle, &DELTA_BASE_STORED_RESPONSE, sizeof(DELTA_BASE_STORED_RESPONSE));
+    }
+    return true;
+#else
+    return handle_notify(inst, def, data, length);
+#endif
+}
+
+#if SONAR_ATTR_DELTA_NOTIFY
+bool sonar_attribute_client_handle_notify_delta_request(sonar_attribute_client_handle_t handle, uint16_t attribute_id, const uint8_t* data, uint32_t length) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    sonar_attribute_def_t* def = get_def_by_id(inst, attribute_id);
+    if (!validate_notify_request(def, attribute_id)) {
+        return false;
+    } else if (!GET_CONTEXT(def)->is_available) {
+        LOG_ERROR("Notify request for an attribute which is not available");
+        return false;
+    } else if (!def->delta_buffer) {
+        LOG_ERROR("Notify delta request for an attribute which doesn't support it (0x%x)", attribute_id);
+        return false;
+    }
+    attribute_context_t* context = GET_CONTEXT(def);
+    uint32_t value_length = context->delta_base_length;
+    if (!context->has_delta_base || !delta_apply(def->delta_buffer, &value_length, def->max_size, data, length)) {
+        // let the server know it needs to send the full value instead
+        LOG_WARN("Notify delta request doesn't match the base value (0x%x)", attribute_id);
+        context->has_delta_base = false;
+        inst->init.notify_response_handler(inst->init.handle, &DELTA_BASE_MISMATCH_RESPONSE, sizeof(DELTA_BASE_MISMATCH_RESPONSE));
+        return true;
+    }
+    context->delta_base_length = value_length;
+    if (!handle_notify(inst, def, def->delta_buffer, value_length)) {
+        // the delta buffer no longer matches what the server thinks we have
+        context->has_delta_base = false;
+        return false;
+    }
+    inst->init.notify_response_handler(inst->init.handle, &DELTA_BASE_STORED_RESPONSE, sizeof(DELTA_BASE_STORED_RESPONSE));
+    return true;
+}
+#endif
+
+#if SONAR_STATS
+void sonar_attribute_client_get_and_clear_stats(sonar_attribute_client_handle_t handle, sonar_attribute_t attr, sonar_attribute_stats_t* stats) {
+    attribute_context_t* context = GET_CONTEXT(attr);
+    *stats = context->stats;
+    context->stats = (sonar_attribute_stats_t){0};
 }
+#endif
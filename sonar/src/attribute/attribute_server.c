@@ -1,6 +1,7 @@
 #include "server.h"
 
 #include "../application_layer/types.h"
+#include "../common/delta.h"
 #include "control_helpers.h"
 
 #define LOGGING_MODULE_NAME "SONAR"
@@ -13,15 +14,32 @@
 typedef struct {
     sonar_attribute_t next;
     bool is_registered;
+#if SONAR_ATTR_DELTA_NOTIFY
+    bool has_delta_base;
+    uint32_t delta_base_length;
+#endif
+#if SONAR_STATS
+    sonar_attribute_stats_t stats;
+#endif
 } attribute_context_t;
-_Static_assert(sizeof(attribute_context_t) == sizeof(((sonar_attribute_t)0)->_private), "Invalid size");
+_Static_assert(sizeof(attribute_context_t) <= sizeof(((sonar_attribute_t)0)->_private), "Invalid size");
 
 typedef struct {
     sonar_attribute_server_init_t init;
     sonar_attribute_t attr_list;
+#if SONAR_ATTR_SHARED_BUFFERS
+    // the attribute which has a pending notify using the shared request buffer (NULL if it's not in use)
+    sonar_attribute_t shared_request_buffer_attr;
+#endif
     CTRL_NUM_ATTRS_TYPE ctrl_num_attrs;
     CTRL_ATTR_OFFSET_TYPE ctrl_attr_offset;
     CTRL_ATTR_LIST_TYPE ctrl_attr_list;
+#if SONAR_ATTR_DELTA_NOTIFY
+    sonar_attribute_t pending_notify_attr;
+    const uint8_t* pending_notify_data;
+    uint32_t pending_notify_length;
+    bool pending_notify_is_delta;
+#endif
 } instance_impl_t;
 _Static_assert(sizeof(instance_impl_t) == sizeof(sonar_attribute_server_context_t), "Invalid context size");
 
@@ -34,6 +52,24 @@ static sonar_attribute_t get_attr_by_id(instance_impl_t* inst, uint16_t attribut
     return NULL;
 }
 
+static uint8_t* get_request_buffer(instance_impl_t* inst, sonar_attribute_t attr) {
+#if SONAR_ATTR_SHARED_BUFFERS
+    // the shared buffer holds the data for the pending notify until it completes
+    return inst->shared_request_buffer_attr ? NULL : inst->init.shared_request_buffer;
+#else
+    return attr->request_buffer;
+#endif
+}
+
+static uint8_t* get_response_buffer(instance_impl_t* inst, sonar_attribute_t attr) {
+#if SONAR_ATTR_SHARED_BUFFERS
+    // the previous response is no longer needed once we get a new request, so it's always safe to reuse
+    return inst->init.shared_response_buffer;
+#else
+    return attr->response_buffer;
+#endif
+}
+
 static bool validate_attr_for_notify(instance_impl_t* inst, sonar_attribute_t attr) {
     if (!attr) {
         LOG_ERROR("Unknown attribute");
@@ -48,6 +84,83 @@ static bool validate_attr_for_notify(instance_impl_t* inst, sonar_attribute_t at
     return true;
 }
 
+#if SONAR_ATTR_DELTA_NOTIFY
+static bool send_pending_notify(instance_impl_t* inst, sonar_attribute_t attr, const uint8_t* data, uint32_t length, bool is_delta) {
+    bool (*send_function)(void*, uint16_t, const uint8_t*, uint32_t) =
+        is_delta ? inst->init.send_notify_delta_request_function : inst->init.send_notify_request_function;
+    if (!send_function(inst->init.handle, attr->attribute_id, data, length)) {
+        return false;
+    }
+    inst->pending_notify_attr = attr;
+    inst->pending_notify_data = data;
+    inst->pending_notify_length = length;
+    inst->pending_notify_is_delta = is_delta;
+    return true;
+}
+#endif
+
+static bool send_notify_data(instance_impl_t* inst, sonar_attribute_t attr, uint8_t* data, uint32_t length) {
+#if SONAR_ATTR_DELTA_NOTIFY
+    const attribute_context_t* context = GET_CONTEXT(attr);
+    if (attr->delta_buffer && context->has_delta_base) {
+        // only send a delta if it's actually smaller than the full value
+        const uint32_t delta_length = delta_get_encoded_length(attr->delta_buffer, context->delta_base_length, data, length);
+        if (delta_length < length) {
+            delta_encode(attr->delta_buffer, context->delta_base_length, data, length);
+            return send_pending_notify(inst, attr, data, delta_length, true);
+        }
+    }
+    return send_pending_notify(inst, attr, data, length, false);
+#else
+    return inst->init.send_notify_request_function(inst->init.handle, attr->attribute_id, data, length);
+#endif
+}
+
+static bool send_notify(instance_impl_t* inst, sonar_attribute_t attr, uint8_t* data, uint32_t length) {
+    if (!send_notify_data(inst, attr, data, length)) {
+        return false;
+    }
+#if SONAR_ATTR_SHARED_BUFFERS
+    inst->shared_request_buffer_attr = attr;
+#endif
+    return true;
+}
+
+#if SONAR_ATTR_DELTA_NOTIFY
+// Returns true if the full value was resent, in which case the request isn't complete yet
+static bool handle_delta_notify_response(instance_impl_t* inst, sonar_attribute_t attr, bool* success, const uint8_t* data, uint32_t length) {
+    attribute_context_t* context = GET_CONTEXT(attr);
+    if (!*success) {
+        // we don't know what the client has, so send the full value next time
+        context->has_delta_base = false;
+        return false;
+    }
+    // the client only stores the base if it supports delta notifies
+    const bool stored_base = length == 1 && data[0] == SONAR_APPLICATION_NOTIFY_STATUS_DELTA_BASE_STORED;
+    if (inst->pending_notify_is_delta) {
+        // reconstruct the value which was sent (this always succeeds as the delta was encoded against our own base)
+        delta_apply(attr->delta_buffer, &context->delta_base_length, attr->max_size, inst->pending_notify_data, inst->pending_notify_length);
+        if (!stored_base) {
+            // the client couldn't apply the delta, so resend the full value
+            LOG_WARN("Client rejected delta notify for attribute (0x%x)", attr->attribute_id);
+            context->has_delta_base = false;
+            if (send_pending_notify(inst, attr, attr->delta_buffer, context->delta_base_length, false)) {
+                return true;
+            }
+            // should never happen
+            LOG_ERROR("Failed to resend notify");
+            *success = false;
+            return false;
+        }
+    } else if (stored_base && inst->pending_notify_data != attr->delta_buffer) {
+        memcpy(attr->delta_buffer, inst->pending_notify_data, inst->pending_notify_length);
+        context->delta_base_length = inst->pending_notify_length;
+    }
+    context->has_delta_base = stored_base;
+    return false;
+}
+#endif
+
 void sonar_attribute_server_init(sonar_attribute_server_handle_t handle, const sonar_attribute_server_init_t* init) {
     instance_impl_t* inst = (instance_impl_t*)handle;
     *inst = (instance_impl_t){
@@ -68,7 +181,19 @@ void sonar_attribute_server_register(sonar_attribute_server_handle_t handle, son
         LOG_ERROR("Attribute with this ID (0x%x) already registered", attr->attribute_id);
         return;
     }
+#if SONAR_ATTR_SHARED_BUFFERS
+    if (attr->max_size > inst->init.shared_buffer_size) {
+        LOG_ERROR("Attribute (0x%x) is too big for the shared buffers", attr->attribute_id);
+        return;
+    }
+#endif
     GET_CONTEXT(attr)->is_registered = true;
+#if SONAR_ATTR_DELTA_NOTIFY
+    GET_CONTEXT(attr)->has_delta_base = false;
+#endif
+#if SONAR_STATS
+    GET_CONTEXT(attr)->stats = (sonar_attribute_stats_t){0};
+#endif
     if (inst->attr_list) {
         // add to the front of the list
         GET_CONTEXT(attr)->next = inst->attr_list;
@@ -79,6 +204,18 @@ void sonar_attribute_server_register(sonar_attribute_server_handle_t handle, son
     inst->ctrl_num_attrs++;
 }
 
+void sonar_attribute_server_low_level_connection_changed(sonar_attribute_server_handle_t handle, bool is_connected) {
+#if SONAR_ATTR_DELTA_NOTIFY
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    if (!is_connected) {
+        // the client no longer has any of the previous values
+        for (sonar_attribute_t attr = inst->attr_list; attr; attr = GET_CONTEXT(attr)->next) {
+            GET_CONTEXT(attr)->has_delta_base = false;
+        }
+    }
+#endif
+}
+
 bool sonar_attribute_server_notify(sonar_attribute_server_handle_t handle, sonar_attribute_t attr, const uint8_t* data, uint32_t length) {
     instance_impl_t* inst = (instance_impl_t*)handle;
     if (!validate_attr_for_notify(inst, attr)) {
@@ -87,8 +224,32 @@ bool sonar_attribute_server_notify(sonar_attribute_server_handle_t handle, sonar
         LOG_ERROR("Notify data is too big");
         return false;
     }
-    memcpy(attr->request_buffer, data, length);
-    return inst->init.send_notify_request_function(inst->init.handle, attr->attribute_id, attr->request_buffer, length);
+    uint8_t* buffer = get_request_buffer(inst, attr);
+    if (!buffer) {
+        LOG_ERROR("Request buffer is in use");
+        return false;
+    }
+    memcpy(buffer, data, length);
+    return send_notify(inst, attr, buffer, length);
+}
+
+bool sonar_attribute_server_notify_chain(sonar_attribute_server_handle_t handle, sonar_attribute_t attr, const buffer_chain_entry_t* data, sonar_buffer_chain_release_callback_t release_callback, void* release_handle) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    if (!validate_attr_for_notify(inst, attr)) {
+        return false;
+    } else if (buffer_chain_get_length(data) > attr->max_size) {
+        LOG_ERROR("Notify data is too big");
+        return false;
+    }
+    if (!inst->init.send_notify_chain_request_function(inst->init.handle, attr->attribute_id, data, release_callback, release_handle)) {
+        return false;
+    }
+#if SONAR_ATTR_DELTA_NOTIFY
+    // the data isn't kept once the request completes, so it can't be used as the base for the next delta
+    GET_CONTEXT(attr)->has_delta_base = false;
+    inst->pending_notify_attr = NULL;
+#endif
+    return true;
 }
 
 bool sonar_attribute_server_notify_read_data(sonar_attribute_server_handle_t handle, sonar_attribute_t attr) {
@@ -99,12 +260,17 @@ bool sonar_attribute_server_notify_read_data(sonar_attribute_server_handle_t han
         LOG_ERROR("Read request not supported");
         return false;
     }
-    const uint32_t length = inst->init.read_handler(inst->init.handle, attr, attr->request_buffer, attr->max_size);
+    uint8_t* buffer = get_request_buffer(inst, attr);
+    if (!buffer) {
+        LOG_ERROR("Request buffer is in use");
+        return false;
+    }
+    const uint32_t length = inst->init.read_handler(inst->init.handle, attr, buffer, attr->max_size);
     if (length > attr->max_size) {
         LOG_ERROR("Notify data is too big");
         return false;
     }
-    return inst->init.send_notify_request_function(inst->init.handle, attr->attribute_id, attr->request_buffer, length);
+    return send_notify(inst, attr, buffer, length);
 }
 
 bool sonar_attribute_server_handle_read_request(sonar_attribute_server_handle_t handle, uint16_t attribute_id) {
@@ -139,8 +305,29 @@ bool sonar_attribute_server_handle_read_request(sonar_attribute_server_handle_t
         LOG_ERROR("Read request not supported for attribute (0x%x)", attribute_id);
         return false;
     }
-    const uint32_t response_size = inst->init.read_handler(inst->init.handle, attr, attr->response_buffer, attr->max_size);
-    inst->init.read_response_handler(inst->init.handle, attr->response_buffer, response_size);
+#if SONAR_STATS
+    attribute_context_t* context = GET_CONTEXT(attr);
+#endif
+    if (inst->init.stream_read_handler && inst->init.stream_read_handler(inst->init.handle, attr)) {
+        // the response will be written as it's transmitted
+#if SONAR_STATS
+        context->stats.reads++;
+#endif
+        return true;
+    }
+    uint8_t* buffer = get_response_buffer(inst, attr);
+    if (!buffer) {
+        LOG_ERROR("No response buffer for attribute (0x%x)", attribute_id);
+#if SONAR_STATS
+        context->stats.failures++;
+#endif
+        return false;
+    }
+    const uint32_t response_size = inst->init.read_handler(inst->init.handle, attr, buffer, attr->max_size);
+    inst->init.read_response_handler(inst->init.handle, buffer, response_size);
+#if SONAR_STATS
+    context->stats.reads++;
+#endif
     return true;
 }
 
@@ -167,16 +354,51 @@ bool sonar_attribute_server_handle_write_request(sonar_attribute_server_handle_t
         LOG_ERROR("Write request is too big (%"PRIu32") for attribute (0x%x)", length, attribute_id);
         return false;
     }
+#if SONAR_STATS
+    const bool success = inst->init.write_handler(inst->init.handle, attr, data, length);
+    if (success) {
+        GET_CONTEXT(attr)->stats.writes++;
+    } else {
+        GET_CONTEXT(attr)->stats.failures++;
+    }
+    return success;
+#else
     return inst->init.write_handler(inst->init.handle, attr, data, length);
+#endif
 }
 
-void sonar_attribute_server_handle_notify_response(sonar_attribute_server_handle_t handle, uint16_t attribute_id, bool success) {
+void sonar_attribute_server_handle_notify_response(sonar_attribute_server_handle_t handle, uint16_t attribute_id, bool success, const uint8_t* data, uint32_t length) {
     instance_impl_t* inst = (instance_impl_t*)handle;
+#if SONAR_ATTR_SHARED_BUFFERS
+    // the notify is no longer pending (any delta notify retry is sent from the attribute's delta buffer)
+    inst->shared_request_buffer_attr = NULL;
+#endif
     sonar_attribute_t attr = get_attr_by_id(inst, attribute_id);
     if (!attr || !(attr->ops & SONAR_ATTRIBUTE_OPS_N)) {
         // should never happen
         LOG_ERROR("Unexpected notify response");
         return;
     }
+#if SONAR_ATTR_DELTA_NOTIFY
+    if (attr->delta_buffer && attr == inst->pending_notify_attr && handle_delta_notify_response(inst, attr, &success, data, length)) {
+        // the full value was resent, so wait for it to complete
+        return;
+    }
+#endif
+#if SONAR_STATS
+    if (success) {
+        GET_CONTEXT(attr)->stats.notifies++;
+    } else {
+        GET_CONTEXT(attr)->stats.failures++;
+    }
+#endif
     inst->init.notify_complete_handler(inst->init.handle, success);
 }
+
+#if SONAR_STATS
+void sonar_attribute_server_get_and_clear_stats(sonar_attribute_server_handle_t handle, sonar_attribute_t attr, sonar_attribute_stats_t* stats) {
+    attribute_context_t* context = GET_CONTEXT(attr);
+    *stats = context->stats;
+    context->stats = (sonar_attribute_stats_t){0};
+}
+#endif
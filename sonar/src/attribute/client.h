@@ -1,6 +1,8 @@
 #pragma once
 
 #include "anchor/sonar/attribute.h"
+#include "anchor/sonar/stats.h"
+#include "../common/buffer_chain.h"
 
 #include <inttypes.h>
 #include <stdbool.h>
@@ -11,10 +13,20 @@
 typedef struct {
     bool(*send_read_request_function)(void* handle, uint16_t attribute_id);
     bool(*send_write_request_function)(void* handle, uint16_t attribute_id, const uint8_t* data, uint32_t length);
+    bool(*send_write_chain_request_function)(void* handle, uint16_t attribute_id, const buffer_chain_entry_t* data, sonar_buffer_chain_release_callback_t release_callback, void* release_handle);
     void(*connection_changed_callback)(void* handle, bool connected);
     void(*read_complete_handler)(void* handle, bool success, const uint8_t* data, uint32_t length);
     void(*write_complete_handler)(void* handle, bool success);
     bool(*notify_handler)(void* handle, sonar_attribute_t attr, const uint8_t* data, uint32_t length);
+    uint64_t(*get_system_time_ms)(void);
+#if SONAR_ATTR_DELTA_NOTIFY
+    void(*notify_response_handler)(void* handle, const uint8_t* data, uint32_t length);
+#endif
+#if SONAR_ATTR_SHARED_BUFFERS
+    // Buffer which is shared by all attributes for write requests, of shared_buffer_size bytes
+    uint8_t* shared_request_buffer;
+    uint32_t shared_buffer_size;
+#endif
     void* handle;
 } sonar_attribute_client_init_t;
 
@@ -40,6 +52,14 @@ bool sonar_attribute_client_read(sonar_attribute_client_handle_t handle, sonar_a
 // Issue a write request for an attribute
 bool sonar_attribute_client_write(sonar_attribute_client_handle_t handle, sonar_attribute_t attr, const uint8_t* data, uint32_t length);
 
+// Issue a write request for an attribute with caller-owned data which is sent without being copied
+bool sonar_attribute_client_write_chain(sonar_attribute_client_handle_t handle, sonar_attribute_t attr, const buffer_chain_entry_t* data, sonar_buffer_chain_release_callback_t release_callback, void* release_handle);
+
+#if SONAR_ATTR_CACHE
+// Gets the cached value of an attribute if it was updated within the last max_age_ms
+bool sonar_attribute_client_read_cached(sonar_attribute_client_handle_t handle, sonar_attribute_t attr, uint32_t max_age_ms, const uint8_t** data, uint32_t* length);
+#endif
+
 // Handles a received attribute read response
 void sonar_attribute_client_handle_read_response(sonar_attribute_client_handle_t handle, uint16_t attribute_id, bool success, const uint8_t* data, uint32_t length);
 
@@ -48,3 +68,13 @@ void sonar_attribute_client_handle_write_response(sonar_attribute_client_handle_
 
 // Handles a received attribute notify request
 bool sonar_attribute_client_handle_notify_request(sonar_attribute_client_handle_t handle, uint16_t attribute_id, const uint8_t* data, uint32_t length);
+
+#if SONAR_ATTR_DELTA_NOTIFY
+// Handles a received attribute notify delta request
+bool sonar_attribute_client_handle_notify_delta_request(sonar_attribute_client_handle_t handle, uint16_t attribute_id, const uint8_t* data, uint32_t length);
+#endif
+
+#if SONAR_STATS
+// Get and then clear the operation counts for an attribute
+void sonar_attribute_client_get_and_clear_stats(sonar_attribute_client_handle_t handle, sonar_attribute_t attr, sonar_attribute_stats_t* stats);
+#endif
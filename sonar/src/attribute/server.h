@@ -1,19 +1,36 @@
 #pragma once
 
 #include "anchor/sonar/attribute.h"
+#include "anchor/sonar/stats.h"
+#include "../common/buffer_chain.h"
 
 #include <inttypes.h>
 #include <stdbool.h>
 
-#define _SONAR_ATTRIBUTE_SERVER_CONTEXT_SIZE \
-    (sizeof(sonar_attribute_server_init_t) + sizeof(void*) + sizeof(uintptr_t) + sizeof(uint16_t) * 8)
+#define _SONAR_ATTRIBUTE_SERVER_CONTEXT_SIZE ( \
+    sizeof(sonar_attribute_server_init_t) + sizeof(void*) + sizeof(uintptr_t) + sizeof(uint16_t) * 8 + \
+    (SONAR_ATTR_DELTA_NOTIFY ? sizeof(void*) * 2 + sizeof(uint32_t) * 2 : 0) + \
+    (SONAR_ATTR_SHARED_BUFFERS ? sizeof(void*) : 0))
 
 typedef struct {
     bool (*send_notify_request_function)(void* handle, uint16_t attribute_id, const uint8_t* data, uint32_t length);
+    bool (*send_notify_chain_request_function)(void* handle, uint16_t attribute_id, const buffer_chain_entry_t* data, sonar_buffer_chain_release_callback_t release_callback, void* release_handle);
+#if SONAR_ATTR_DELTA_NOTIFY
+    bool (*send_notify_delta_request_function)(void* handle, uint16_t attribute_id, const uint8_t* data, uint32_t length);
+#endif
     void (*read_response_handler)(void* handle, const uint8_t* data, uint32_t length);
     uint32_t (*read_handler)(void* handle, sonar_attribute_t attr, void* response_data, uint32_t response_max_size);
+    // Handler which is called before read_handler() and may instead set a writer to stream the read response (optional)
+    // NOTE: This returns false if the attribute doesn't stream its read responses
+    bool (*stream_read_handler)(void* handle, sonar_attribute_t attr);
     bool (*write_handler)(void* handle, sonar_attribute_t attr, const uint8_t* data, uint32_t length);
     void (*notify_complete_handler)(void* handle, bool success);
+#if SONAR_ATTR_SHARED_BUFFERS
+    // Buffers which are shared by all attributes for requests and responses, each of shared_buffer_size bytes
+    uint8_t* shared_request_buffer;
+    uint8_t* shared_response_buffer;
+    uint32_t shared_buffer_size;
+#endif
     void* handle;
 } sonar_attribute_server_init_t;
 
@@ -27,9 +44,15 @@ void sonar_attribute_server_init(sonar_attribute_server_handle_t handle, const s
 // Register an implementation for an attribute supported by the server
 void sonar_attribute_server_register(sonar_attribute_server_handle_t handle, sonar_attribute_t attribute);
 
+// Called when the low-level connection status changes
+void sonar_attribute_server_low_level_connection_changed(sonar_attribute_server_handle_t handle, bool is_connected);
+
 // Issue a notify request for an attribute
 bool sonar_attribute_server_notify(sonar_attribute_server_handle_t handle, sonar_attribute_t attribute, const uint8_t* data, uint32_t length);
 
+// Issue a notify request for an attribute with caller-owned data which is sent without being copied
+bool sonar_attribute_server_notify_chain(sonar_attribute_server_handle_t handle, sonar_attribute_t attribute, const buffer_chain_entry_t* data, sonar_buffer_chain_release_callback_t release_callback, void* release_handle);
+
 // Issue a notify request for an attribute, using the data returned by calling the read handlers
 bool sonar_attribute_server_notify_read_data(sonar_attribute_server_handle_t handle, sonar_attribute_t attribute);
 
@@ -40,4 +63,9 @@ bool sonar_attribute_server_handle_read_request(sonar_attribute_server_handle_t
 bool sonar_attribute_server_handle_write_request(sonar_attribute_server_handle_t handle, uint16_t attribute_id, const uint8_t* data, uint32_t length);
 
 // Handles a received attribute notify response
-void sonar_attribute_server_handle_notify_response(sonar_attribute_server_handle_t handle, uint16_t attribute_id, bool success);
+void sonar_attribute_server_handle_notify_response(sonar_attribute_server_handle_t handle, uint16_t attribute_id, bool success, const uint8_t* data, uint32_t length);
+
+#if SONAR_STATS
+// Get and then clear the operation counts for an attribute
+void sonar_attribute_server_get_and_clear_stats(sonar_attribute_server_handle_t handle, sonar_attribute_t attr, sonar_attribute_stats_t* stats);
+#endif
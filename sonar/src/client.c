@@ -57,6 +57,12 @@ static bool application_layer_attribute_notify_handler(void* handle, uint16_t at
     return sonar_attribute_client_handle_notify_request(handle, attribute_id, data, length);
 }
 
+#if SONAR_ATTR_DELTA_NOTIFY
+static bool application_layer_attribute_notify_delta_handler(void* handle, uint16_t attribute_id, const uint8_t* data, uint32_t length) {
+    return sonar_attribute_client_handle_notify_delta_request(handle, attribute_id, data, length);
+}
+#endif
+
 static void attribute_client_handle_read_response(void* handle, uint16_t attribute_id, bool success, const uint8_t* data, uint32_t length) {
     sonar_attribute_client_handle_read_response(handle, attribute_id, success, data, length);
 }
@@ -75,6 +81,18 @@ static bool attribute_client_send_write_request_function(void* handle, uint16_t
     return sonar_application_layer_write_request(inst->application_layer_handle, attribute_id, data, length);
 }
 
+static bool attribute_client_send_write_chain_request_function(void* handle, uint16_t attribute_id, const buffer_chain_entry_t* data, sonar_buffer_chain_release_callback_t release_callback, void* release_handle) {
+    instance_impl_t* inst = handle;
+    return sonar_application_layer_write_request_chain(inst->application_layer_handle, attribute_id, data, release_callback, release_handle);
+}
+
+#if SONAR_ATTR_DELTA_NOTIFY
+static void attribute_client_notify_response_handler(void* handle, const uint8_t* data, uint32_t length) {
+    instance_impl_t* inst = handle;
+    sonar_application_layer_notify_response(inst->application_layer_handle, data, length);
+}
+#endif
+
 static void attribute_client_connection_changed_callback(void* handle, bool connected) {
     instance_impl_t* inst = handle;
     inst->init.connection_changed_callback(connected);
@@ -127,10 +145,19 @@ void sonar_client_init(sonar_client_handle_t handle, const sonar_client_init_t*
     const sonar_attribute_client_init_t init_attr_client = {
         .send_read_request_function = attribute_client_send_read_request_function,
         .send_write_request_function = attribute_client_send_write_request_function,
+        .send_write_chain_request_function = attribute_client_send_write_chain_request_function,
         .connection_changed_callback = attribute_client_connection_changed_callback,
         .read_complete_handler = attribute_client_read_complete_handler,
         .write_complete_handler = attribute_client_write_complete_handler,
         .notify_handler = attribute_client_notify_handler,
+        .get_system_time_ms = init->get_system_time_ms,
+#if SONAR_ATTR_DELTA_NOTIFY
+        .notify_response_handler = attribute_client_notify_response_handler,
+#endif
+#if SONAR_ATTR_SHARED_BUFFERS
+        .shared_request_buffer = handle->shared_request_buffer,
+        .shared_buffer_size = handle->shared_buffer_size,
+#endif
         .handle = inst,
     };
     sonar_attribute_client_init(inst->attr_client_handle, &init_attr_client);
@@ -143,6 +170,9 @@ void sonar_client_init(sonar_client_handle_t handle, const sonar_client_init_t*
         .attribute_read_handler = application_layer_attribute_read_handler,
         .attribute_write_handler = application_layer_attribute_write_handler,
         .attribute_notify_handler = application_layer_attribute_notify_handler,
+#if SONAR_ATTR_DELTA_NOTIFY
+        .attribute_notify_delta_handler = application_layer_attribute_notify_delta_handler,
+#endif
         .attr_handler_handle = inst->attr_client_handle,
 
         .read_request_complete_handler = attribute_client_handle_read_response,
@@ -152,6 +182,11 @@ void sonar_client_init(sonar_client_handle_t handle, const sonar_client_init_t*
     sonar_application_layer_init(inst->application_layer_handle, &init_application_layer);
 }
 
+uint64_t sonar_client_get_next_deadline_ms(sonar_client_handle_t handle) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    return sonar_link_layer_get_next_deadline_ms(inst->link_layer_handle);
+}
+
 bool sonar_client_is_connected(sonar_client_handle_t handle) {
     instance_impl_t* inst = (instance_impl_t*)handle;
     return sonar_attribute_client_is_connected(inst->attr_client_handle);
@@ -178,6 +213,18 @@ bool sonar_client_write(sonar_client_handle_t handle, sonar_attribute_t attr, co
     return sonar_attribute_client_write(inst->attr_client_handle, attr, data, length);
 }
 
+bool sonar_client_write_chain(sonar_client_handle_t handle, sonar_attribute_t attr, const sonar_buffer_chain_entry_t* data, sonar_buffer_chain_release_callback_t release_callback, void* release_handle) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    return sonar_attribute_client_write_chain(inst->attr_client_handle, attr, data, release_callback, release_handle);
+}
+
+#if SONAR_ATTR_CACHE
+bool sonar_client_read_cached(sonar_client_handle_t handle, sonar_attribute_t attr, uint32_t max_age_ms, const void** data, uint32_t* length) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    return sonar_attribute_client_read_cached(inst->attr_client_handle, attr, max_age_ms, (const uint8_t**)data, length);
+}
+#endif
+
 void sonar_client_get_and_clear_errors(sonar_client_handle_t handle, sonar_errors_t* errors) {
     instance_impl_t* inst = (instance_impl_t*)handle;
     sonar_link_layer_errors_t link_layer_errors;
@@ -198,3 +245,22 @@ void sonar_client_get_and_clear_errors(sonar_client_handle_t handle, sonar_error
         },
     };
 }
+
+#if SONAR_STATS
+void sonar_client_get_and_clear_stats(sonar_client_handle_t handle, sonar_stats_t* stats) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    sonar_link_layer_get_and_clear_stats(inst->link_layer_handle, stats);
+}
+
+void sonar_client_get_and_clear_attribute_stats(sonar_client_handle_t handle, sonar_attribute_t attr, sonar_attribute_stats_t* stats) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    sonar_attribute_client_get_and_clear_stats(inst->attr_client_handle, attr, stats);
+}
+#endif
+
+#if SONAR_CAPTURE
+void sonar_client_set_capture(sonar_client_handle_t handle, sonar_capture_handle_t capture) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    sonar_link_layer_set_capture(inst->link_layer_handle, capture);
+}
+#endif
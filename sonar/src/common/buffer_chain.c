@@ -11,3 +11,11 @@ void buffer_chain_push_back(buffer_chain_entry_t* chain, buffer_chain_entry_t* t
     }
     chain->next = to_insert;
 }
+
+uint32_t buffer_chain_get_length(const buffer_chain_entry_t* chain) {
+    uint32_t length = 0;
+    FOREACH_BUFFER_CHAIN_ENTRY(chain, entry) {
+        length += entry->length;
+    }
+    return length;
+}
@@ -1,21 +1,19 @@
 #pragma once
 
+#include "anchor/sonar/buffer_chain.h"
+
 #include <inttypes.h>
 
 #define FOREACH_BUFFER_CHAIN_ENTRY(START_PTR, ENTRY_PTR_NAME) \
     for (const buffer_chain_entry_t* ENTRY_PTR_NAME = START_PTR; ENTRY_PTR_NAME; ENTRY_PTR_NAME = (ENTRY_PTR_NAME)->next)
 
-typedef struct buffer_chain_entry {
-    // Next entry in the chain
-    struct buffer_chain_entry* next;
-    // The data buffer represented by this entry
-    const uint8_t* data;
-    // The length of the data buffer represented by this entry
-    uint32_t length;
-} buffer_chain_entry_t;
+typedef sonar_buffer_chain_entry_t buffer_chain_entry_t;
 
 // Sets the data represented by a buffer chain entry
 void buffer_chain_set_data(buffer_chain_entry_t* entry, const uint8_t* data, uint32_t length);
 
 // Inserts a new entry at the end of the chain
 void buffer_chain_push_back(buffer_chain_entry_t* chain, buffer_chain_entry_t* to_insert);
+
+// Gets the total length of the data represented by a chain
+uint32_t buffer_chain_get_length(const buffer_chain_entry_t* chain);
@@ -0,0 +1,183 @@
+#include "capture.h"
+
+#include "../link_layer/types.h"
+
+#include <string.h>
+
+typedef struct {
+    sonar_capture_init_t init;
+    // The index of the oldest record in the ring buffer and the number of bytes in it
+    uint32_t head;
+    uint32_t count;
+    uint32_t num_dropped;
+    // The number of bytes (including any which didn't fit in the buffer) of the frame which is being transmitted
+    uint32_t frame_length;
+} capture_impl_t;
+_Static_assert(sizeof(((sonar_capture_handle_t)0)->_private) >= sizeof(capture_impl_t), "Invalid context size");
+
+static uint8_t peek_byte(sonar_capture_handle_t handle, uint32_t offset) {
+    capture_impl_t* impl = (capture_impl_t*)handle->_private;
+    return handle->buffer[(impl->head + offset) % handle->buffer_size];
+}
+
+static uint32_t peek_record_length(sonar_capture_handle_t handle) {
+    const uint16_t length = peek_byte(handle, 1) | (peek_byte(handle, 2) << 8);
+    return SONAR_CAPTURE_RECORD_HEADER_SIZE + length;
+}
+
+static void push_bytes(sonar_capture_handle_t handle, const uint8_t* data, uint32_t length) {
+    capture_impl_t* impl = (capture_impl_t*)handle->_private;
+    for (uint32_t i = 0; i < length; i++) {
+        handle->buffer[(impl->head + impl->count) % handle->buffer_size] = data[i];
+        impl->count++;
+    }
+}
+
+static void write_data(sonar_capture_handle_t handle, const uint8_t* data, uint32_t length) {
+    capture_impl_t* impl = (capture_impl_t*)handle->_private;
+    if (!length) {
+        return;
+    }
+    if (impl->init.write_function) {
+        impl->init.write_function(data, length);
+    } else {
+        push_bytes(handle, data, length);
+    }
+}
+
+static void write_record(sonar_capture_handle_t handle, sonar_capture_type_t type, uint8_t flags, const uint8_t* prefix, uint32_t prefix_length, const uint8_t* data, uint32_t length) {
+    capture_impl_t* impl = (capture_impl_t*)handle->_private;
+    uint32_t total_length = prefix_length + length;
+    if (total_length > UINT16_MAX) {
+        flags |= SONAR_CAPTURE_FLAG_TRUNCATED;
+        total_length = UINT16_MAX;
+        if (prefix_length > total_length) {
+            prefix_length = total_length;
+        }
+        length = total_length - prefix_length;
+    }
+    const uint32_t time_ms = (uint32_t)impl->init.get_system_time_ms();
+    const uint8_t header[SONAR_CAPTURE_RECORD_HEADER_SIZE] = {
+        (uint8_t)type | flags,
+        total_length & 0xff,
+        total_length >> 8,
+        time_ms & 0xff,
+        (time_ms >> 8) & 0xff,
+        (time_ms >> 16) & 0xff,
+        time_ms >> 24,
+    };
+    if (!impl->init.write_function) {
+        const uint32_t record_length = SONAR_CAPTURE_RECORD_HEADER_SIZE + total_length;
+        if (record_length > handle->buffer_size) {
+            impl->num_dropped++;
+            return;
+        }
+        // drop the oldest records to make room
+        while (handle->buffer_size - impl->count < record_length) {
+            const uint32_t oldest_length = peek_record_length(handle);
+            impl->head = (impl->head + oldest_length) % handle->buffer_size;
+            impl->count -= oldest_length;
+            impl->num_dropped++;
+        }
+    }
+    write_data(handle, header, sizeof(header));
+    write_data(handle, prefix, prefix_length);
+    write_data(handle, data, length);
+}
+
+void capture_write_record(sonar_capture_handle_t handle, sonar_capture_type_t type, bool is_server, const uint8_t* prefix, uint32_t prefix_length, const uint8_t* data, uint32_t length) {
+    write_record(handle, type, is_server ? SONAR_CAPTURE_FLAG_IS_SERVER : 0, prefix, prefix_length, data, length);
+}
+
+void capture_tx_byte(sonar_capture_handle_t handle, uint8_t byte) {
+    capture_impl_t* impl = (capture_impl_t*)handle->_private;
+    if (impl->frame_length < handle->frame_buffer_size) {
+        handle->frame_buffer[impl->frame_length] = byte;
+    }
+    impl->frame_length++;
+}
+
+void capture_tx_frame_end(sonar_capture_handle_t handle, bool is_server) {
+    capture_impl_t* impl = (capture_impl_t*)handle->_private;
+    const bool is_truncated = impl->frame_length > handle->frame_buffer_size;
+    const uint32_t raw_length = is_truncated ? handle->frame_buffer_size : impl->frame_length;
+    impl->frame_length = 0;
+    const uint8_t flags = (is_server ? SONAR_CAPTURE_FLAG_IS_SERVER : 0) | (is_truncated ? SONAR_CAPTURE_FLAG_TRUNCATED : 0);
+    write_record(handle, SONAR_CAPTURE_TYPE_TX_RAW, flags, NULL, 0, handle->frame_buffer, raw_length);
+    if (is_truncated) {
+        // can't decode a partial frame
+        return;
+    }
+
+    // decode the frame in place (skipping the flag bytes on either end)
+    uint8_t* frame = handle->frame_buffer;
+    uint32_t length = 0;
+    bool escaping = false;
+    for (uint32_t i = 1; i + 1 < raw_length; i++) {
+        uint8_t byte = frame[i];
+        if (escaping) {
+            escaping = false;
+            byte ^= SONAR_ENCODING_ESCAPE_XOR;
+        } else if (byte == SONAR_ENCODING_ESCAPE_BYTE) {
+            escaping = true;
+            continue;
+        }
+        frame[length++] = byte;
+    }
+    if (escaping || length < sizeof(sonar_link_layer_header_t) + sizeof(sonar_link_layer_footer_t)) {
+        // the frame was aborted
+        return;
+    }
+    capture_write_record(handle, SONAR_CAPTURE_TYPE_TX_FRAME, is_server, NULL, 0, frame, length - sizeof(sonar_link_layer_footer_t));
+}
+
+void sonar_capture_init(sonar_capture_handle_t handle, const sonar_capture_init_t* init) {
+    capture_impl_t* impl = (capture_impl_t*)handle->_private;
+    memset(impl, 0, sizeof(*impl));
+    impl->init = *init;
+}
+
+uint32_t sonar_capture_read(sonar_capture_handle_t handle, uint8_t* buffer, uint32_t size) {
+    capture_impl_t* impl = (capture_impl_t*)handle->_private;
+    uint32_t num_read = 0;
+    while (impl->count) {
+        const uint32_t record_length = peek_record_length(handle);
+        if (record_length > size - num_read) {
+            break;
+        }
+        for (uint32_t i = 0; i < record_length; i++) {
+            buffer[num_read++] = peek_byte(handle, i);
+        }
+        impl->head = (impl->head + record_length) % handle->buffer_size;
+        impl->count -= record_length;
+    }
+    return num_read;
+}
+
+uint32_t sonar_capture_get_num_dropped(sonar_capture_handle_t handle) {
+    capture_impl_t* impl = (capture_impl_t*)handle->_private;
+    return impl->num_dropped;
+}
+
+uint32_t sonar_capture_parse_record(const uint8_t* data, uint32_t length, sonar_capture_record_t* record) {
+    if (length < SONAR_CAPTURE_RECORD_HEADER_SIZE) {
+        return 0;
+    }
+    const uint16_t data_length = data[1] | (data[2] << 8);
+    if (length - SONAR_CAPTURE_RECORD_HEADER_SIZE < data_length) {
+        return 0;
+    }
+    const uint8_t type = data[0] & SONAR_CAPTURE_TYPE_MASK;
+    if (type < SONAR_CAPTURE_TYPE_RX_RAW || type > SONAR_CAPTURE_TYPE_TX_FRAME) {
+        return 0;
+    }
+    *record = (sonar_capture_record_t){
+        .type = (sonar_capture_type_t)type,
+        .is_server = data[0] & SONAR_CAPTURE_FLAG_IS_SERVER,
+        .is_truncated = data[0] & SONAR_CAPTURE_FLAG_TRUNCATED,
+        .time_ms = (uint32_t)data[3] | ((uint32_t)data[4] << 8) | ((uint32_t)data[5] << 16) | ((uint32_t)data[6] << 24),
+        .data = &data[SONAR_CAPTURE_RECORD_HEADER_SIZE],
+        .length = data_length,
+    };
+    return SONAR_CAPTURE_RECORD_HEADER_SIZE + data_length;
+}
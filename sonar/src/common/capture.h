@@ -0,0 +1,15 @@
+#pragma once
+
+#include "anchor/sonar/capture.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+// Captures a record whose data is the concatenation of prefix and data (either of which may be NULL)
+void capture_write_record(sonar_capture_handle_t handle, sonar_capture_type_t type, bool is_server, const uint8_t* prefix, uint32_t prefix_length, const uint8_t* data, uint32_t length);
+
+// Captures the next raw byte of the frame which is being transmitted
+void capture_tx_byte(sonar_capture_handle_t handle, uint8_t byte);
+
+// Captures the frame which was being transmitted once it's complete (as both TX_RAW and TX_FRAME records)
+void capture_tx_frame_end(sonar_capture_handle_t handle, bool is_server);
@@ -0,0 +1,135 @@
+#include "delta.h"
+
+#include "crc16.h"
+
+#include <string.h>
+
+// Each range is encoded as its data followed by a u16 offset and a u16 length, and the delta ends with a trailer made
+// up of the u16 length of the new data and a u16 CRC of the base it was encoded against. Placing the offset and length
+// after the data allows for encoding in place.
+#define RANGE_OVERHEAD      4
+#define TRAILER_LENGTH      4
+
+// Ranges which are separated by this many (or fewer) unchanged bytes are merged, as doing so is never larger than
+// encoding them separately. This also guarantees that the encoded output never overtakes the data which still needs
+// to be encoded when encoding in place.
+#define MAX_MERGE_GAP       RANGE_OVERHEAD
+
+static bool is_changed(const uint8_t* base, uint32_t base_length, const uint8_t* data, uint32_t offset) {
+    return offset >= base_length || base[offset] != data[offset];
+}
+
+static bool get_next_range(const uint8_t* base, uint32_t base_length, const uint8_t* data, uint32_t length, uint32_t start, uint32_t* range_offset, uint32_t* range_length) {
+    uint32_t offset = start;
+    while (offset < length && !is_changed(base, base_length, data, offset)) {
+        offset++;
+    }
+    if (offset == length) {
+        return false;
+    }
+    uint32_t end = offset + 1;
+    for (uint32_t i = end; i < length && i - end <= MAX_MERGE_GAP; i++) {
+        if (is_changed(base, base_length, data, i)) {
+            end = i + 1;
+        }
+    }
+    *range_offset = offset;
+    *range_length = end - offset;
+    return true;
+}
+
+static void write_u16(uint8_t* buffer, uint16_t value) {
+    buffer[0] = value & 0xff;
+    buffer[1] = value >> 8;
+}
+
+static uint16_t read_u16(const uint8_t* buffer) {
+    return buffer[0] | (buffer[1] << 8);
+}
+
+uint32_t delta_get_encoded_length(const uint8_t* base, uint32_t base_length, const uint8_t* data, uint32_t length) {
+    if (length > DELTA_MAX_LENGTH) {
+        return UINT32_MAX;
+    }
+    uint32_t encoded_length = TRAILER_LENGTH;
+    uint32_t offset = 0;
+    uint32_t range_offset;
+    uint32_t range_length;
+    while (get_next_range(base, base_length, data, length, offset, &range_offset, &range_length)) {
+        encoded_length += range_length + RANGE_OVERHEAD;
+        offset = range_offset + range_length;
+    }
+    return encoded_length;
+}
+
+uint32_t delta_encode(const uint8_t* base, uint32_t base_length, uint8_t* data, uint32_t length) {
+    uint32_t encoded_length = 0;
+    uint32_t range_offset = 0;
+    uint32_t range_length = 0;
+    bool has_range = get_next_range(base, base_length, data, length, 0, &range_offset, &range_length);
+    while (has_range) {
+        // find the next range before writing this one, as writing the offset and length may overwrite the unchanged
+        // bytes which follow this range
+        uint32_t next_range_offset = 0;
+        uint32_t next_range_length = 0;
+        const bool has_next_range = get_next_range(base, base_length, data, length, range_offset + range_length, &next_range_offset, &next_range_length);
+        // the range data is never behind the current output position, so move it down
+        memmove(&data[encoded_length], &data[range_offset], range_length);
+        encoded_length += range_length;
+        write_u16(&data[encoded_length], range_offset);
+        write_u16(&data[encoded_length + 2], range_length);
+        encoded_length += RANGE_OVERHEAD;
+        has_range = has_next_range;
+        range_offset = next_range_offset;
+        range_length = next_range_length;
+    }
+    write_u16(&data[encoded_length], length);
+    write_u16(&data[encoded_length + 2], crc16(base, base_length, CRC16_INITIAL_VALUE));
+    return encoded_length + TRAILER_LENGTH;
+}
+
+bool delta_apply(uint8_t* base, uint32_t* base_length, uint32_t max_length, const uint8_t* delta, uint32_t delta_length) {
+    if (delta_length < TRAILER_LENGTH) {
+        return false;
+    }
+    const uint32_t new_length = read_u16(&delta[delta_length - TRAILER_LENGTH]);
+    const uint16_t base_crc = read_u16(&delta[delta_length - TRAILER_LENGTH + 2]);
+    if (new_length > max_length || base_crc != crc16(base, *base_length, CRC16_INITIAL_VALUE)) {
+        return false;
+    }
+
+    // validate the ranges (which are walked from the end and so are in descending order) before applying any of them
+    uint32_t position = delta_length - TRAILER_LENGTH;
+    uint32_t prev_range_offset = new_length;
+    while (position > 0) {
+        if (position < RANGE_OVERHEAD) {
+            return false;
+        }
+        const uint32_t range_offset = read_u16(&delta[position - RANGE_OVERHEAD]);
+        const uint32_t range_length = read_u16(&delta[position - RANGE_OVERHEAD + 2]);
+        position -= RANGE_OVERHEAD;
+        if (range_length == 0 || range_length > position || range_offset + range_length > prev_range_offset) {
+            return false;
+        } else if (prev_range_offset == new_length && new_length > *base_length &&
+                   (range_offset + range_length != new_length || range_offset > *base_length)) {
+            // the last range must cover any data beyond the end of the base
+            return false;
+        }
+        position -= range_length;
+        prev_range_offset = range_offset;
+    }
+    if (prev_range_offset == new_length && new_length > *base_length) {
+        // no ranges to cover the data beyond the end of the base
+        return false;
+    }
+
+    position = delta_length - TRAILER_LENGTH;
+    while (position > 0) {
+        const uint32_t range_offset = read_u16(&delta[position - RANGE_OVERHEAD]);
+        const uint32_t range_length = read_u16(&delta[position - RANGE_OVERHEAD + 2]);
+        position -= RANGE_OVERHEAD + range_length;
+        memcpy(&base[range_offset], &delta[position], range_length);
+    }
+    *base_length = new_length;
+    return true;
+}
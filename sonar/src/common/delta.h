@@ -0,0 +1,18 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+// The maximum length of data which can be delta-encoded (offsets and lengths are encoded as u16 values)
+#define DELTA_MAX_LENGTH UINT16_MAX
+
+// Gets the length of the delta encoding of data against base (may be larger than the data itself)
+uint32_t delta_get_encoded_length(const uint8_t* base, uint32_t base_length, const uint8_t* data, uint32_t length);
+
+// Encodes data in place as a delta against base and returns the encoded length
+// NOTE: This should only be called if delta_get_encoded_length() returned a length which fits within the data buffer
+uint32_t delta_encode(const uint8_t* base, uint32_t base_length, uint8_t* data, uint32_t length);
+
+// Applies a delta to base in place, returning false (and leaving base unmodified) if the delta is invalid or was
+// encoded against a different base
+bool delta_apply(uint8_t* base, uint32_t* base_length, uint32_t max_length, const uint8_t* delta, uint32_t delta_length);
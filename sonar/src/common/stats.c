@@ -0,0 +1,31 @@
+#include "stats.h"
+
+void stats_histogram_add(uint32_t histogram[SONAR_STATS_LATENCY_BUCKETS], uint64_t value_ms) {
+    // the bucket is the number of bits in the value, which avoids any division
+    uint32_t bucket = 0;
+    while (value_ms && bucket < SONAR_STATS_LATENCY_BUCKETS - 1) {
+        value_ms >>= 1;
+        bucket++;
+    }
+    histogram[bucket]++;
+}
+
+uint64_t sonar_stats_get_percentile_ms(const uint32_t histogram[SONAR_STATS_LATENCY_BUCKETS], uint32_t percentile) {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < SONAR_STATS_LATENCY_BUCKETS; i++) {
+        total += histogram[i];
+    }
+    if (!total) {
+        return 0;
+    }
+    // find the first bucket at which the cumulative count reaches the percentile
+    const uint64_t target = (total * percentile + 99) / 100;
+    uint64_t count = 0;
+    for (uint32_t i = 0; i < SONAR_STATS_LATENCY_BUCKETS - 1; i++) {
+        count += histogram[i];
+        if (count >= target && count) {
+            return (uint64_t)1 << i;
+        }
+    }
+    return UINT64_MAX;
+}
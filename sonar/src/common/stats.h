@@ -0,0 +1,8 @@
+#pragma once
+
+#include "anchor/sonar/stats.h"
+
+#include <inttypes.h>
+
+// Adds a value to a latency histogram
+void stats_histogram_add(uint32_t histogram[SONAR_STATS_LATENCY_BUCKETS], uint64_t value_ms);
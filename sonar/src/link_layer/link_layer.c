@@ -3,12 +3,22 @@
 #include "receive.h"
 #include "transmit.h"
 #include "timeouts.h"
+#include "types.h"
+#include "../common/capture.h"
+#include "../common/stats.h"
 
 #define LOGGING_MODULE_NAME "SONAR"
+// a noisy physical layer can cause a storm of errors from this file, so its lines are rate limited (unless the build
+// configures rate limiting itself)
+#ifndef LOGGING_RATE_LIMIT
+#define LOGGING_RATE_LIMIT 1
+#endif
 #include "anchor/logging/logging.h"
 
 #include <string.h>
 
+#define MIN(A, B) ((A) < (B) ? (A) : (B))
+
 typedef struct {
     bool is_active;
     uint8_t prev_sequence_num;
@@ -19,6 +29,9 @@ typedef struct {
     bool is_active;
     bool is_link_control;
     uint8_t sequence_num;
+#if SONAR_STATS
+    uint32_t num_retries;
+#endif
     uint64_t first_request_time_ms;
     uint64_t last_request_time_ms;
     const buffer_chain_entry_t* data;
@@ -29,8 +42,12 @@ typedef struct {
     bool is_active;
     bool is_link_control;
     uint8_t sequence_num;
+    bool is_writing;
+    bool has_started_packet;
     uint32_t length;
     const uint8_t* data;
+    bool (*writer)(void* handle);
+    void* writer_handle;
 } pending_response_info_t;
 
 typedef struct {
@@ -45,6 +62,13 @@ typedef struct {
     uint8_t connection_data;
     pending_request_info_t pending_request;
     pending_response_info_t pending_response;
+#if SONAR_STATS
+    sonar_stats_t stats;
+    uint64_t connection_changed_time_ms;
+#endif
+#if SONAR_CAPTURE
+    sonar_capture_handle_t capture;
+#endif
 } instance_impl_t;
 _Static_assert(sizeof(sonar_link_layer_context_t) >= sizeof(instance_impl_t), "Invalid context size");
 
@@ -54,6 +78,9 @@ static void set_pending_request(instance_impl_t* inst, bool is_link_control, con
     inst->pending_request.sequence_num++;
     inst->pending_request.is_link_control = is_link_control;
     inst->pending_request.data = data;
+#if SONAR_STATS
+    inst->pending_request.num_retries = 0;
+#endif
 }
 
 static void send_pending_request(instance_impl_t* inst) {
@@ -61,16 +88,82 @@ static void send_pending_request(instance_impl_t* inst) {
     sonar_link_layer_transmit_send_packet(inst->transmit_handle, false, inst->pending_request.is_link_control, inst->pending_request.sequence_num, inst->pending_request.data);
 }
 
+static void start_pending_response_packet(instance_impl_t* inst) {
+    sonar_link_layer_transmit_start_packet(inst->transmit_handle, true, inst->pending_response.is_link_control, inst->pending_response.sequence_num);
+    inst->pending_response.has_started_packet = true;
+}
+
 static void send_pending_response(instance_impl_t* inst) {
-    buffer_chain_entry_t data = {0};
-    buffer_chain_set_data(&data, inst->pending_response.data, inst->pending_response.length);
-    sonar_link_layer_transmit_send_packet(inst->transmit_handle, true, inst->pending_response.is_link_control, inst->pending_response.sequence_num, &data);
+    if (!inst->pending_response.writer) {
+        buffer_chain_entry_t data = {0};
+        buffer_chain_set_data(&data, inst->pending_response.data, inst->pending_response.length);
+        sonar_link_layer_transmit_send_packet(inst->transmit_handle, true, inst->pending_response.is_link_control, inst->pending_response.sequence_num, &data);
+        return;
+    }
+    // the packet isn't started until the first data is written so that nothing is sent if the writer fails up front
+    inst->pending_response.is_writing = true;
+    inst->pending_response.has_started_packet = false;
+    const bool success = inst->pending_response.writer(inst->pending_response.writer_handle);
+    inst->pending_response.is_writing = false;
+    if (success && !inst->pending_response.has_started_packet) {
+        start_pending_response_packet(inst);
+    }
+    if (inst->pending_response.has_started_packet) {
+        if (!success) {
+            LOG_ERROR("Response writer failed");
+        }
+        sonar_link_layer_transmit_end_packet(inst->transmit_handle, !success);
+    }
+}
+
+#if SONAR_STATS
+static void stats_update_connection_time(instance_impl_t* inst, bool was_connected) {
+    // attribute the time since the last update to the state we were in
+    const uint64_t time_ms = inst->init.functions.get_system_time_ms();
+    const uint64_t duration_ms = time_ms - inst->connection_changed_time_ms;
+    inst->connection_changed_time_ms = time_ms;
+    if (was_connected) {
+        inst->stats.connection.connected_ms += duration_ms;
+    } else {
+        inst->stats.connection.disconnected_ms += duration_ms;
+    }
+}
+
+static void stats_connection_changed(instance_impl_t* inst, bool connected) {
+    stats_update_connection_time(inst, !connected);
+    if (connected) {
+        inst->stats.connection.connects++;
+    } else {
+        inst->stats.connection.disconnects++;
+    }
+}
+
+static void stats_request_complete(instance_impl_t* inst, bool success) {
+    if (inst->pending_request.is_link_control) {
+        return;
+    }
+    if (success) {
+        const uint64_t latency_ms = inst->init.functions.get_system_time_ms() - inst->pending_request.first_request_time_ms;
+        const uint32_t num_retries = inst->pending_request.num_retries;
+        inst->stats.requests.completed++;
+        inst->stats.requests.retries[MIN(num_retries, SONAR_STATS_RETRY_BUCKETS - 1)]++;
+        stats_histogram_add(inst->stats.requests.latency_ms, latency_ms);
+    } else {
+        inst->stats.requests.failed++;
+    }
 }
+#endif
 
 static void disconnect(instance_impl_t* inst) {
     const bool had_pending_request = inst->pending_request.is_active;
     inst->pending_request.is_active = false;
     inst->connection.is_active = false;
+#if SONAR_STATS
+    stats_connection_changed(inst, false);
+    if (had_pending_request) {
+        stats_request_complete(inst, false);
+    }
+#endif
     // need to clear the pending request and connected state before running the callbacks so that
     // the user doesn't try to issue a new request
     LOG_INFO("Disconnected");
@@ -99,14 +192,14 @@ static bool handle_link_control_packet(instance_impl_t* inst, bool is_response,
             inst->errors.invalid_packet++;
             return false;
         }
-        uint32_t request_length = 0;
-        FOREACH_BUFFER_CHAIN_ENTRY(inst->pending_request.data, entry) {
-            request_length += entry->length;
-        }
+        const uint32_t request_length = buffer_chain_get_length(inst->pending_request.data);
         const bool did_connect = !inst->connection.is_active && inst->pending_request.is_link_control && request_length == 1;
         inst->pending_request.is_active = false;
         inst->connection.is_active = true;
         if (did_connect) {
+#if SONAR_STATS
+            stats_connection_changed(inst, true);
+#endif
             LOG_INFO("Connected");
             inst->init.handlers.connection_changed(inst->init.handlers.handler_handle, true);
         }
@@ -126,6 +219,9 @@ static bool handle_link_control_packet(instance_impl_t* inst, bool is_response,
                 // disconnect first since this is a new connection
                 disconnect(inst);
             }
+#if SONAR_STATS
+            stats_connection_changed(inst, true);
+#endif
             LOG_INFO("Connected");
             // grab the data as our sequence number
             inst->pending_request.sequence_num = data[0] - 1;
@@ -143,6 +239,7 @@ static bool handle_link_control_packet(instance_impl_t* inst, bool is_response,
         inst->pending_response.is_link_control = true;
         inst->pending_response.data = NULL;
         inst->pending_response.length = 0;
+        inst->pending_response.writer = NULL;
         send_pending_response(inst);
         return true;
     }
@@ -150,6 +247,22 @@ static bool handle_link_control_packet(instance_impl_t* inst, bool is_response,
 
 static void receive_handler(void* handle, bool is_response, bool is_link_control, uint8_t sequence_num, const uint8_t* data, uint32_t length) {
     instance_impl_t* inst = handle;
+#if SONAR_STATS
+    inst->stats.link_layer.frames_received++;
+    inst->stats.link_layer.decoded_bytes_received += sizeof(sonar_link_layer_header_t) + length + sizeof(sonar_link_layer_footer_t);
+#endif
+#if SONAR_CAPTURE
+    if (inst->capture) {
+        const sonar_link_layer_header_t header = {
+            .flags = (SONAR_VERSION << SONAR_LINK_LAYER_FLAGS_VERSION_OFFSET) |
+                (is_link_control ? SONAR_LINK_LAYER_FLAGS_LINK_CONTROL_MASK : 0) |
+                (inst->init.config.is_server ? 0 : SONAR_LINK_LAYER_FLAGS_DIRECTION_MASK) |
+                (is_response ? SONAR_LINK_LAYER_FLAGS_RESPONSE_MASK : 0),
+            .sequence_num = sequence_num,
+        };
+        capture_write_record(inst->capture, SONAR_CAPTURE_TYPE_RX_FRAME, inst->init.config.is_server, (const uint8_t*)&header, sizeof(header), data, length);
+    }
+#endif
     if (!is_link_control && !inst->connection.is_active) {
         LOG_ERROR("Invalid packet: Not connected");
             inst->errors.unexpected_packet++;
@@ -174,6 +287,13 @@ static void receive_handler(void* handle, bool is_response, bool is_link_control
         return;
     }
 
+#if SONAR_STATS
+    if (is_response) {
+        // the round trip time is measured from the most recent (re)transmission of the request
+        stats_histogram_add(inst->stats.requests.rtt_ms, inst->init.functions.get_system_time_ms() - inst->pending_request.last_request_time_ms);
+    }
+#endif
+
     if (is_link_control) {
         // handle_link_control_packet() is idempotent, so we can just call it every time and it'll also send the response
         if (!handle_link_control_packet(inst, is_response, sequence_num, data, length)) {
@@ -186,6 +306,9 @@ static void receive_handler(void* handle, bool is_response, bool is_link_control
         if (is_response) {
             // mark the request as inactive first so the response handler can trigger another request
             inst->pending_request.is_active = false;
+#if SONAR_STATS
+            stats_request_complete(inst, true);
+#endif
             inst->init.handlers.request_complete(inst->init.handlers.handler_handle, true, data, length);
         } else {
             // this was a valid packet as far as the link layer is concerned, so update our previous sequence number
@@ -222,6 +345,9 @@ void sonar_link_layer_init(sonar_link_layer_handle_t handle, const sonar_link_la
         .transmit_handle = &inst->transmit_context,
     };
     buffer_chain_set_data(&inst->connection_data_buffer_chain, (const uint8_t*)&inst->connection_data, sizeof(inst->connection_data));
+#if SONAR_STATS
+    inst->connection_changed_time_ms = inst->init.functions.get_system_time_ms();
+#endif
 
     const sonar_link_layer_receive_init_t link_layer_receive_init = {
         .is_server = inst->init.config.is_server,
@@ -246,6 +372,14 @@ bool sonar_link_layer_is_connected(sonar_link_layer_handle_t handle) {
 
 void sonar_link_layer_handle_receive_data(sonar_link_layer_handle_t handle, const uint8_t* data, uint32_t length) {
     instance_impl_t* inst = (instance_impl_t*)handle;
+#if SONAR_STATS
+    inst->stats.link_layer.raw_bytes_received += length;
+#endif
+#if SONAR_CAPTURE
+    if (inst->capture && length) {
+        capture_write_record(inst->capture, SONAR_CAPTURE_TYPE_RX_RAW, inst->init.config.is_server, NULL, 0, data, length);
+    }
+#endif
     sonar_link_layer_receive_process_data(inst->receive_handle, data, length);
 }
 
@@ -259,6 +393,11 @@ bool sonar_link_layer_send_request(sonar_link_layer_handle_t handle, const buffe
         LOG_ERROR("ERROR: Request already pending");
         return false;
     }
+    if (inst->pending_response.is_writing) {
+        // we're in the middle of transmitting a response
+        LOG_ERROR("Can't send a request from a response writer");
+        return false;
+    }
     set_pending_request(inst, false, data);
     send_pending_request(inst);
     return true;
@@ -280,6 +419,9 @@ void sonar_link_layer_process(sonar_link_layer_handle_t handle) {
         if (time_ms - inst->pending_request.first_request_time_ms >= REQUEST_TIMEOUT_MS) {
             // pending request has timed out
             inst->pending_request.is_active = false;
+#if SONAR_STATS
+            stats_request_complete(inst, false);
+#endif
             if (inst->pending_request.is_link_control) {
                 LOG_WARN("Link control request timed out");
             } else {
@@ -290,6 +432,9 @@ void sonar_link_layer_process(sonar_link_layer_handle_t handle) {
             // send the request again
             send_pending_request(inst);
             inst->errors.retries++;
+#if SONAR_STATS
+            inst->pending_request.num_retries++;
+#endif
         }
     } else if (!inst->init.config.is_server) {
         // the bus is free so check if the client should send a link control request
@@ -307,6 +452,27 @@ void sonar_link_layer_process(sonar_link_layer_handle_t handle) {
     }
 }
 
+uint64_t sonar_link_layer_get_next_deadline_ms(sonar_link_layer_handle_t handle) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    uint64_t deadline_ms = UINT64_MAX;
+    if (inst->connection.is_active) {
+        deadline_ms = inst->connection.last_packet_time_ms + CONNECTION_TIMEOUT_MS;
+    }
+    if (inst->pending_request.is_active) {
+        const uint64_t timeout_ms = inst->pending_request.first_request_time_ms + REQUEST_TIMEOUT_MS;
+        const uint64_t retry_ms = inst->pending_request.last_request_time_ms + REQUEST_RETRY_INTERVAL_MS;
+        deadline_ms = MIN(deadline_ms, MIN(timeout_ms, retry_ms));
+    } else if (!inst->init.config.is_server) {
+        if (!inst->connection.is_active) {
+            // should try to connect right away
+            deadline_ms = 0;
+        } else {
+            deadline_ms = MIN(deadline_ms, inst->connection.last_packet_time_ms + CONNECTION_MAINTENANCE_INTERVAL_MS);
+        }
+    }
+    return deadline_ms;
+}
+
 void sonar_link_layer_set_response(sonar_link_layer_handle_t handle, const uint8_t* data, uint32_t length) {
     instance_impl_t* inst = (instance_impl_t*)handle;
     if (!inst->pending_response.is_pending) {
@@ -317,6 +483,33 @@ void sonar_link_layer_set_response(sonar_link_layer_handle_t handle, const uint8
     inst->pending_response.is_active = true;
     inst->pending_response.data = data;
     inst->pending_response.length = length;
+    inst->pending_response.writer = NULL;
+}
+
+void sonar_link_layer_set_response_writer(sonar_link_layer_handle_t handle, bool (*writer)(void* handle), void* writer_handle) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    if (!inst->pending_response.is_pending) {
+        LOG_ERROR("Not pending a response");
+        return;
+    }
+    inst->pending_response.is_pending = false;
+    inst->pending_response.is_active = true;
+    inst->pending_response.data = NULL;
+    inst->pending_response.length = 0;
+    inst->pending_response.writer = writer;
+    inst->pending_response.writer_handle = writer_handle;
+}
+
+void sonar_link_layer_write_response_data(sonar_link_layer_handle_t handle, const uint8_t* data, uint32_t length) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    if (!inst->pending_response.is_writing) {
+        LOG_ERROR("Not writing a response");
+        return;
+    }
+    if (!inst->pending_response.has_started_packet) {
+        start_pending_response_packet(inst);
+    }
+    sonar_link_layer_transmit_write_data(inst->transmit_handle, data, length);
 }
 
 void sonar_link_layer_get_and_clear_errors(sonar_link_layer_handle_t handle, sonar_link_layer_errors_t* errors, sonar_link_layer_receive_errors_t* receive_errors) {
@@ -325,3 +518,26 @@ void sonar_link_layer_get_and_clear_errors(sonar_link_layer_handle_t handle, son
     inst->errors = (sonar_link_layer_errors_t){0};
     sonar_link_layer_receive_get_and_clear_errors(inst->receive_handle, receive_errors);
 }
+
+#if SONAR_STATS
+void sonar_link_layer_get_and_clear_stats(sonar_link_layer_handle_t handle, sonar_stats_t* stats) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    // account for the time spent in the current connection state so far
+    stats_update_connection_time(inst, inst->connection.is_active);
+    sonar_link_layer_transmit_stats_t transmit_stats;
+    sonar_link_layer_transmit_get_and_clear_stats(inst->transmit_handle, &transmit_stats);
+    inst->stats.link_layer.frames_sent = transmit_stats.packets;
+    inst->stats.link_layer.raw_bytes_sent = transmit_stats.encoded_bytes;
+    inst->stats.link_layer.decoded_bytes_sent = transmit_stats.decoded_bytes;
+    *stats = inst->stats;
+    inst->stats = (sonar_stats_t){0};
+}
+#endif
+
+#if SONAR_CAPTURE
+void sonar_link_layer_set_capture(sonar_link_layer_handle_t handle, sonar_capture_handle_t capture) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    inst->capture = capture;
+    sonar_link_layer_transmit_set_capture(inst->transmit_handle, capture);
+}
+#endif
@@ -19,7 +19,10 @@
     sizeof(uint64_t) * 4 + \
     sizeof(uintptr_t) + sizeof(uint64_t) * 2 + sizeof(void*) + \
     sizeof(uint32_t) * 2 + sizeof(void*) + \
-    sizeof(uintptr_t))
+    sizeof(void*) * 3 + \
+    sizeof(uintptr_t) + \
+    (SONAR_STATS ? sizeof(sonar_stats_t) + sizeof(uint64_t) : 0) + \
+    (SONAR_CAPTURE ? sizeof(void*) : 0))
 
 typedef struct {
     struct {
@@ -83,8 +86,30 @@ bool sonar_link_layer_send_request(sonar_link_layer_handle_t handle, const buffe
 // Run link layer processing (should be called regularly - ideally at least every 1ms)
 void sonar_link_layer_process(sonar_link_layer_handle_t handle);
 
+// Gets the system time at which sonar_link_layer_process() next needs to be called to handle a timeout or retry (or
+// UINT64_MAX if there isn't one), assuming no data is received before then
+uint64_t sonar_link_layer_get_next_deadline_ms(sonar_link_layer_handle_t handle);
+
 // Sets the SONAR link layer response - should only (and must) be called from handlers.request()
 void sonar_link_layer_set_response(sonar_link_layer_handle_t handle, const uint8_t* data, uint32_t length);
 
+// Sets a writer which produces the SONAR link layer response data as it's transmitted by calling
+// sonar_link_layer_write_response_data() - may be called from handlers.request() instead of sonar_link_layer_set_response()
+// NOTE: The writer is called again if the response needs to be retransmitted, and the response is dropped if it returns false
+void sonar_link_layer_set_response_writer(sonar_link_layer_handle_t handle, bool (*writer)(void* handle), void* writer_handle);
+
+// Writes the next chunk of response data - should only be called from a writer passed to sonar_link_layer_set_response_writer()
+void sonar_link_layer_write_response_data(sonar_link_layer_handle_t handle, const uint8_t* data, uint32_t length);
+
 // Get and then clear the current error counters
 void sonar_link_layer_get_and_clear_errors(sonar_link_layer_handle_t handle, sonar_link_layer_errors_t* errors, sonar_link_layer_receive_errors_t* receive_errors);
+
+#if SONAR_STATS
+// Get and then clear the current stats
+void sonar_link_layer_get_and_clear_stats(sonar_link_layer_handle_t handle, sonar_stats_t* stats);
+#endif
+
+#if SONAR_CAPTURE
+// Sets the capture object which received and transmitted data is recorded to (or NULL to stop capturing)
+void sonar_link_layer_set_capture(sonar_link_layer_handle_t handle, sonar_capture_handle_t capture);
+#endif
@@ -4,6 +4,11 @@
 #include "types.h"
 
 #define LOGGING_MODULE_NAME "SONAR"
+// a noisy physical layer can cause a storm of errors from this file, so its lines are rate limited (unless the build
+// configures rate limiting itself)
+#ifndef LOGGING_RATE_LIMIT
+#define LOGGING_RATE_LIMIT 1
+#endif
 #include "anchor/logging/logging.h"
 
 #include <stdbool.h>
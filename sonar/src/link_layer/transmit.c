@@ -1,21 +1,44 @@
 #include "transmit.h"
 
+#include "../common/capture.h"
 #include "../common/crc16.h"
 #include "types.h"
 
 typedef struct {
     sonar_link_layer_transmit_init_t init;
+    uint16_t crc;
+#if SONAR_STATS
+    sonar_link_layer_transmit_stats_t stats;
+#endif
+#if SONAR_CAPTURE
+    sonar_capture_handle_t capture;
+#endif
 } instance_impl_t;
 _Static_assert(sizeof(instance_impl_t) == sizeof(sonar_link_layer_transmit_context_t), "Invalid context size");
 
+static void write_byte(instance_impl_t* inst, uint8_t byte) {
+#if SONAR_STATS
+    inst->stats.encoded_bytes++;
+#endif
+#if SONAR_CAPTURE
+    if (inst->capture) {
+        capture_tx_byte(inst->capture, byte);
+    }
+#endif
+    inst->init.write_byte_function(byte);
+}
+
 static void write_encoded_bytes(instance_impl_t* inst, const uint8_t* data, uint32_t length) {
+#if SONAR_STATS
+    inst->stats.decoded_bytes += length;
+#endif
     for (uint32_t i = 0; i < length; i++) {
         uint8_t byte = data[i];
         if (byte == SONAR_ENCODING_FLAG_BYTE || byte == SONAR_ENCODING_ESCAPE_BYTE) {
-            inst->init.write_byte_function(SONAR_ENCODING_ESCAPE_BYTE);
+            write_byte(inst, SONAR_ENCODING_ESCAPE_BYTE);
             byte ^= SONAR_ENCODING_ESCAPE_XOR;
         }
-        inst->init.write_byte_function(byte);
+        write_byte(inst, byte);
     }
 }
 
@@ -27,11 +50,21 @@ void sonar_link_layer_transmit_init(sonar_link_layer_transmit_handle_t handle, c
 }
 
 void sonar_link_layer_transmit_send_packet(sonar_link_layer_transmit_handle_t handle, bool is_response, bool is_link_control, uint8_t sequence_num, const buffer_chain_entry_t* data) {
+    sonar_link_layer_transmit_start_packet(handle, is_response, is_link_control, sequence_num);
+    FOREACH_BUFFER_CHAIN_ENTRY(data, entry) {
+        sonar_link_layer_transmit_write_data(handle, entry->data, entry->length);
+    }
+    sonar_link_layer_transmit_end_packet(handle, false);
+}
+
+void sonar_link_layer_transmit_start_packet(sonar_link_layer_transmit_handle_t handle, bool is_response, bool is_link_control, uint8_t sequence_num) {
     instance_impl_t* inst = (instance_impl_t*)handle;
-    uint16_t crc = CRC16_INITIAL_VALUE;
 
     // write the starting flag byte
-    inst->init.write_byte_function(SONAR_ENCODING_FLAG_BYTE);
+#if SONAR_STATS
+    inst->stats.packets++;
+#endif
+    write_byte(inst, SONAR_ENCODING_FLAG_BYTE);
 
     // write the header
     const sonar_link_layer_header_t header = {
@@ -42,20 +75,52 @@ void sonar_link_layer_transmit_send_packet(sonar_link_layer_transmit_handle_t ha
         .sequence_num = sequence_num,
     };
     write_encoded_bytes(inst, (const uint8_t*)&header, sizeof(header));
-    crc = crc16((const uint8_t*)&header, sizeof(header), crc);
+    inst->crc = crc16((const uint8_t*)&header, sizeof(header), CRC16_INITIAL_VALUE);
+}
 
-    // write the data
-    FOREACH_BUFFER_CHAIN_ENTRY(data, entry) {
-        write_encoded_bytes(inst, entry->data, entry->length);
-        crc = crc16(entry->data, entry->length, crc);
-    }
+void sonar_link_layer_transmit_write_data(sonar_link_layer_transmit_handle_t handle, const uint8_t* data, uint32_t length) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    write_encoded_bytes(inst, data, length);
+    inst->crc = crc16(data, length, inst->crc);
+}
 
-    // write the footer
-    const sonar_link_layer_footer_t footer = {
-        .crc = crc,
-    };
-    write_encoded_bytes(inst, (const uint8_t*)&footer, sizeof(footer));
+void sonar_link_layer_transmit_end_packet(sonar_link_layer_transmit_handle_t handle, bool abort) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+
+    if (abort) {
+        // write an illegal escape sequence (an escape byte followed by the flag byte) to guarantee the receiver drops it
+#if SONAR_STATS
+        inst->stats.aborted_packets++;
+#endif
+        write_byte(inst, SONAR_ENCODING_ESCAPE_BYTE);
+    } else {
+        // write the footer
+        const sonar_link_layer_footer_t footer = {
+            .crc = inst->crc,
+        };
+        write_encoded_bytes(inst, (const uint8_t*)&footer, sizeof(footer));
+    }
 
     // write the ending flag byte
-    inst->init.write_byte_function(SONAR_ENCODING_FLAG_BYTE);
+    write_byte(inst, SONAR_ENCODING_FLAG_BYTE);
+#if SONAR_CAPTURE
+    if (inst->capture) {
+        capture_tx_frame_end(inst->capture, inst->init.is_server);
+    }
+#endif
+}
+
+#if SONAR_STATS
+void sonar_link_layer_transmit_get_and_clear_stats(sonar_link_layer_transmit_handle_t handle, sonar_link_layer_transmit_stats_t* stats) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    *stats = inst->stats;
+    inst->stats = (sonar_link_layer_transmit_stats_t){0};
+}
+#endif
+
+#if SONAR_CAPTURE
+void sonar_link_layer_transmit_set_capture(sonar_link_layer_transmit_handle_t handle, sonar_capture_handle_t capture) {
+    instance_impl_t* inst = (instance_impl_t*)handle;
+    inst->capture = capture;
 }
+#endif
@@ -1,12 +1,16 @@
 #pragma once
 
 #include "../common/buffer_chain.h"
+#include "anchor/sonar/capture.h"
+#include "anchor/sonar/stats.h"
 
 #include <inttypes.h>
 #include <stdbool.h>
 
-#define _SONAR_LINK_LAYER_TRANSMIT_CONTEXT_SIZE \
-    (sizeof(sonar_link_layer_transmit_init_t))
+#define _SONAR_LINK_LAYER_TRANSMIT_CONTEXT_SIZE ( \
+    sizeof(sonar_link_layer_transmit_init_t) + sizeof(uintptr_t) + \
+    (SONAR_STATS ? sizeof(sonar_link_layer_transmit_stats_t) : 0) + \
+    (SONAR_CAPTURE ? sizeof(void*) : 0))
 
 typedef struct {
     // Whether or not this is the server (vs. client)
@@ -15,6 +19,17 @@ typedef struct {
     void (*write_byte_function)(uint8_t byte);
 } sonar_link_layer_transmit_init_t;
 
+typedef struct {
+    // Packets transmitted (including aborted ones)
+    uint32_t packets;
+    // Packets which were aborted
+    uint32_t aborted_packets;
+    // Bytes written to the physical link
+    uint32_t encoded_bytes;
+    // Bytes of packet data (including the header and footer) before encoding
+    uint32_t decoded_bytes;
+} sonar_link_layer_transmit_stats_t;
+
 
 // The handle is a pointer to a pre-allocated context type (to be accessed by the SONAR implementation only)
 typedef uint8_t sonar_link_layer_transmit_context_t[_SONAR_LINK_LAYER_TRANSMIT_CONTEXT_SIZE];
@@ -25,3 +40,24 @@ void sonar_link_layer_transmit_init(sonar_link_layer_transmit_handle_t handle, c
 
 // Transmits a SONAR link layer packet
 void sonar_link_layer_transmit_send_packet(sonar_link_layer_transmit_handle_t handle, bool is_response, bool is_link_control, uint8_t sequence_num, const buffer_chain_entry_t* data);
+
+// Starts transmitting a SONAR link layer packet whose data is then passed in chunks to
+// sonar_link_layer_transmit_write_data() before calling sonar_link_layer_transmit_end_packet()
+void sonar_link_layer_transmit_start_packet(sonar_link_layer_transmit_handle_t handle, bool is_response, bool is_link_control, uint8_t sequence_num);
+
+// Transmits the next chunk of data for a packet started with sonar_link_layer_transmit_start_packet()
+void sonar_link_layer_transmit_write_data(sonar_link_layer_transmit_handle_t handle, const uint8_t* data, uint32_t length);
+
+// Finishes transmitting a packet started with sonar_link_layer_transmit_start_packet()
+// NOTE: If abort is true, the packet is terminated such that the receiver will discard it
+void sonar_link_layer_transmit_end_packet(sonar_link_layer_transmit_handle_t handle, bool abort);
+
+#if SONAR_STATS
+// Get and then clear the current stats
+void sonar_link_layer_transmit_get_and_clear_stats(sonar_link_layer_transmit_handle_t handle, sonar_link_layer_transmit_stats_t* stats);
+#endif
+
+#if SONAR_CAPTURE
+// Sets the capture object which transmitted frames are recorded to (or NULL to stop capturing)
+void sonar_link_layer_transmit_set_capture(sonar_link_layer_transmit_handle_t handle, sonar_capture_handle_t capture);
+#endif
@@ -0,0 +1,123 @@
+#include "anchor/sonar/log_stream.h"
+
+#include <string.h>
+
+// NOTE: Nothing in here logs, since the logs may be what's being written to the stream
+
+#define GET_IMPL(HANDLE) ((log_stream_impl_t*)((HANDLE)->_private))
+
+typedef struct {
+    // The time at which the first write was buffered into the batch which is being filled (first so that it doesn't
+    // need any padding before it)
+    uint64_t batch_start_ms;
+    sonar_log_stream_init_t init;
+    // The entry which references the batch which is being sent
+    sonar_buffer_chain_entry_t chain;
+    // The number of bytes in the batch which is being filled
+    uint32_t batch_length;
+    // The number of writes in the batch which is being filled
+    uint32_t batch_writes;
+    // The index of the batch which is being filled
+    uint8_t batch_index;
+    // Whether or not the other batch is being sent
+    bool is_sending;
+    sonar_log_stream_stats_t stats;
+} log_stream_impl_t;
+_Static_assert(sizeof(((sonar_log_stream_handle_t)0)->_private) >= sizeof(log_stream_impl_t), "Invalid context size");
+
+static bool is_batch_ready(sonar_log_stream_handle_t handle, uint64_t now_ms) {
+    log_stream_impl_t* impl = GET_IMPL(handle);
+    if (!impl->batch_length) {
+        return false;
+    }
+    return impl->batch_length >= impl->init.flush_size ||
+        (impl->init.flush_age_ms && now_ms - impl->batch_start_ms >= impl->init.flush_age_ms);
+}
+
+static void release_callback(void* handle) {
+    log_stream_impl_t* impl = GET_IMPL((sonar_log_stream_handle_t)handle);
+    impl->is_sending = false;
+}
+
+void sonar_log_stream_init(sonar_log_stream_handle_t handle, const sonar_log_stream_init_t* init) {
+    log_stream_impl_t* impl = GET_IMPL(handle);
+    memset(impl, 0, sizeof(*impl));
+    impl->init = *init;
+    if (!impl->init.flush_size || impl->init.flush_size > handle->batch_size) {
+        impl->init.flush_size = handle->batch_size;
+    }
+    sonar_server_register(impl->init.server, handle->attr);
+}
+
+bool sonar_log_stream_write(sonar_log_stream_handle_t handle, const void* data, uint32_t length) {
+    log_stream_impl_t* impl = GET_IMPL(handle);
+    if (length > handle->batch_size - impl->batch_length) {
+        // the link can't keep up (or it's too big to ever fit)
+        impl->stats.dropped++;
+        return false;
+    }
+    if (!impl->batch_length) {
+        impl->batch_start_ms = impl->init.get_system_time_ms();
+    }
+    memcpy(&handle->buffer[impl->batch_index * handle->batch_size + impl->batch_length], data, length);
+    impl->batch_length += length;
+    impl->batch_writes++;
+    impl->stats.writes++;
+    return true;
+}
+
+void sonar_log_stream_process(sonar_log_stream_handle_t handle) {
+    log_stream_impl_t* impl = GET_IMPL(handle);
+    if (!is_batch_ready(handle, impl->init.get_system_time_ms())) {
+        return;
+    } else if (impl->is_sending || !sonar_server_can_notify(impl->init.server)) {
+        impl->stats.busy++;
+        return;
+    }
+
+    // send the batch and start filling the other one (which is free since nothing is being sent)
+    impl->chain = (sonar_buffer_chain_entry_t) {
+        .next = NULL,
+        .data = &handle->buffer[impl->batch_index * handle->batch_size],
+        .length = impl->batch_length,
+    };
+    const uint32_t length = impl->batch_length;
+    const uint32_t writes = impl->batch_writes;
+    impl->is_sending = true;
+    impl->batch_index ^= 1;
+    impl->batch_length = 0;
+    impl->batch_writes = 0;
+    if (!sonar_server_notify_chain(impl->init.server, handle->attr, &impl->chain, release_callback, handle)) {
+        // shouldn't happen since the link wasn't busy, so keep the batch to try again if nothing was written into the
+        // other one in the meantime (i.e. by a log from within SONAR), and otherwise drop it
+        impl->is_sending = false;
+        if (!impl->batch_length) {
+            impl->batch_index ^= 1;
+            impl->batch_length = length;
+            impl->batch_writes = writes;
+        } else {
+            impl->stats.dropped += writes;
+        }
+        return;
+    }
+    impl->stats.notifies++;
+}
+
+uint64_t sonar_log_stream_get_next_deadline_ms(sonar_log_stream_handle_t handle) {
+    log_stream_impl_t* impl = GET_IMPL(handle);
+    if (!impl->batch_length || impl->is_sending || !sonar_server_can_notify(impl->init.server)) {
+        // nothing can be sent until the link is free, which happens from within sonar_server_process()
+        return UINT64_MAX;
+    } else if (impl->batch_length >= impl->init.flush_size) {
+        return impl->batch_start_ms;
+    } else if (!impl->init.flush_age_ms) {
+        return UINT64_MAX;
+    }
+    return impl->batch_start_ms + impl->init.flush_age_ms;
+}
+
+void sonar_log_stream_get_and_clear_stats(sonar_log_stream_handle_t handle, sonar_log_stream_stats_t* stats) {
+    log_stream_impl_t* impl = GET_IMPL(handle);
+    *stats = impl->stats;
+    memset(&impl->stats, 0, sizeof(impl->stats));
+}
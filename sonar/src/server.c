@@ -21,6 +21,11 @@ typedef struct {
     sonar_link_layer_handle_t link_layer_handle;
     sonar_application_layer_handle_t application_layer_handle;
     sonar_attribute_server_handle_t attr_server_handle;
+    // the attribute of the pending stream read response, whose stream read handler is called each time it's transmitted
+    sonar_server_attribute_t stream_response_attr;
+    // the attribute whose stream read handler is currently running (NULL otherwise)
+    sonar_server_attribute_t stream_read_attr;
+    uint32_t stream_read_length;
 } instance_impl_t;
 _Static_assert(sizeof(instance_impl_t) == sizeof(((sonar_server_handle_t)0)->_private), "Invalid context size");
 
@@ -43,6 +48,7 @@ static sonar_server_attribute_t get_server_attr(sonar_server_handle_t handle, so
 
 static void link_layer_connection_changed_callback(void* handle, bool connected) {
     instance_impl_t* inst = handle;
+    sonar_attribute_server_low_level_connection_changed(inst->attr_server_handle, connected);
     inst->init.connection_changed_callback(handle, connected);
 }
 
@@ -64,6 +70,14 @@ static void application_layer_set_response_function(void* handle, const uint8_t*
     return sonar_link_layer_set_response(handle, data, length);
 }
 
+static void application_layer_set_response_writer_function(void* handle, bool (*writer)(void* handle), void* writer_handle) {
+    sonar_link_layer_set_response_writer(handle, writer, writer_handle);
+}
+
+static void application_layer_write_response_data_function(void* handle, const uint8_t* data, uint32_t length) {
+    sonar_link_layer_write_response_data(handle, data, length);
+}
+
 static bool application_layer_attribute_read_handler(void* handle, uint16_t attribute_id) {
     return sonar_attribute_server_handle_read_request(handle, attribute_id);
 }
@@ -78,8 +92,8 @@ static bool application_layer_attribute_notify_handler(void* handle, uint16_t at
     return false;
 }
 
-static void attribute_server_handle_notify_response(void* handle, uint16_t attribute_id, bool success) {
-    sonar_attribute_server_handle_notify_response(handle, attribute_id, success);
+static void attribute_server_handle_notify_response(void* handle, uint16_t attribute_id, bool success, const uint8_t* data, uint32_t length) {
+    sonar_attribute_server_handle_notify_response(handle, attribute_id, success, data, length);
 }
 
 static bool attribute_server_send_notify_request_function(void* handle, uint16_t attribute_id, const uint8_t* data, uint32_t length) {
@@ -87,25 +101,64 @@ static bool attribute_server_send_notify_request_function(void* handle, uint16_t
     return sonar_application_layer_notify_request(inst->application_layer_handle, attribute_id, data, length);
 }
 
+static bool attribute_server_send_notify_chain_request_function(void* handle, uint16_t attribute_id, const buffer_chain_entry_t* data, sonar_buffer_chain_release_callback_t release_callback, void* release_handle) {
+    instance_impl_t* inst = handle;
+    return sonar_application_layer_notify_request_chain(inst->application_layer_handle, attribute_id, data, release_callback, release_handle);
+}
+
+#if SONAR_ATTR_DELTA_NOTIFY
+static bool attribute_server_send_notify_delta_request_function(void* handle, uint16_t attribute_id, const uint8_t* data, uint32_t length) {
+    instance_impl_t* inst = handle;
+    return sonar_application_layer_notify_delta_request(inst->application_layer_handle, attribute_id, data, length);
+}
+#endif
+
 static void attribute_server_read_response_handler(void* handle, const uint8_t* data, uint32_t length) {
     instance_impl_t* inst = handle;
     sonar_application_layer_read_response(inst->application_layer_handle, data, length);
 }
 
 static uint32_t attribute_server_read_handler(void* handle, sonar_attribute_t attr, void* response_data, uint32_t response_max_size) {
+    instance_impl_t* inst = handle;
     sonar_server_attribute_t server_attr = get_server_attr(handle, attr);
     if (!server_attr) {
         LOG_ERROR("Unknown attribute for read request");
         return 0;
+    } else if (inst->init.attribute_read_handler) {
+        return inst->init.attribute_read_handler(handle, server_attr, response_data, response_max_size);
     }
     return server_attr->read_handler(response_data, response_max_size);
 }
 
+static bool stream_read_response_writer(void* handle) {
+    instance_impl_t* inst = handle;
+    inst->stream_read_attr = inst->stream_response_attr;
+    inst->stream_read_length = 0;
+    const bool result = inst->stream_read_attr->stream_read_handler((sonar_server_handle_t)inst, inst->stream_read_attr->attr->max_size);
+    // the stream is done (whether or not it succeeded), so any later writes are rejected
+    inst->stream_read_attr = NULL;
+    return result;
+}
+
+static bool attribute_server_stream_read_handler(void* handle, sonar_attribute_t attr) {
+    instance_impl_t* inst = handle;
+    sonar_server_attribute_t server_attr = get_server_attr(handle, attr);
+    if (!server_attr || !server_attr->stream_read_handler) {
+        return false;
+    }
+    inst->stream_response_attr = server_attr;
+    sonar_application_layer_read_response_writer(inst->application_layer_handle, stream_read_response_writer, inst);
+    return true;
+}
+
 static bool attribute_server_write_handler(void* handle, sonar_attribute_t attr, const uint8_t* data, uint32_t length) {
+    instance_impl_t* inst = handle;
     sonar_server_attribute_t server_attr = get_server_attr(handle, attr);
     if (!server_attr) {
         LOG_ERROR("Unknown attribute for write request");
         return false;
+    } else if (inst->init.attribute_write_handler) {
+        return inst->init.attribute_write_handler(handle, server_attr, data, length);
     }
     return server_attr->write_handler(data, length);
 }
@@ -148,6 +201,8 @@ void sonar_server_init(sonar_server_handle_t handle, const sonar_server_init_t*
         .is_server = true,
         .send_data_function = application_layer_send_data_function,
         .set_response_function = application_layer_set_response_function,
+        .set_response_writer_function = application_layer_set_response_writer_function,
+        .write_response_data_function = application_layer_write_response_data_function,
         .send_data_handle = inst->link_layer_handle,
         .attribute_read_handler = application_layer_attribute_read_handler,
         .attribute_write_handler = application_layer_attribute_write_handler,
@@ -161,15 +216,30 @@ void sonar_server_init(sonar_server_handle_t handle, const sonar_server_init_t*
 
     const sonar_attribute_server_init_t init_attr_server = {
         .send_notify_request_function = attribute_server_send_notify_request_function,
+        .send_notify_chain_request_function = attribute_server_send_notify_chain_request_function,
+#if SONAR_ATTR_DELTA_NOTIFY
+        .send_notify_delta_request_function = attribute_server_send_notify_delta_request_function,
+#endif
         .read_response_handler = attribute_server_read_response_handler,
         .read_handler = attribute_server_read_handler,
+        .stream_read_handler = attribute_server_stream_read_handler,
         .write_handler = attribute_server_write_handler,
         .notify_complete_handler = attribute_server_notify_complete_handler,
+#if SONAR_ATTR_SHARED_BUFFERS
+        .shared_request_buffer = handle->shared_request_buffer,
+        .shared_response_buffer = handle->shared_response_buffer,
+        .shared_buffer_size = handle->shared_buffer_size,
+#endif
         .handle = inst,
     };
     sonar_attribute_server_init(inst->attr_server_handle, &init_attr_server);
 }
 
+uint64_t sonar_server_get_next_deadline_ms(sonar_server_handle_t handle) {
+    instance_impl_t* inst = GET_SERVER_IMPL(handle);
+    return sonar_link_layer_get_next_deadline_ms(inst->link_layer_handle);
+}
+
 bool sonar_server_is_connected(sonar_server_handle_t handle) {
     instance_impl_t* inst = GET_SERVER_IMPL(handle);
     return sonar_link_layer_is_connected(inst->link_layer_handle);
@@ -190,16 +260,45 @@ void sonar_server_register(sonar_server_handle_t handle, sonar_server_attribute_
     sonar_attribute_server_register(inst->attr_server_handle, attr->attr);
 }
 
+bool sonar_server_can_notify(sonar_server_handle_t handle) {
+    instance_impl_t* inst = GET_SERVER_IMPL(handle);
+    return sonar_link_layer_is_connected(inst->link_layer_handle) &&
+        !sonar_application_layer_is_request_pending(inst->application_layer_handle);
+}
+
 bool sonar_server_notify(sonar_server_handle_t handle, sonar_server_attribute_t attr, const void* data, uint32_t length) {
     instance_impl_t* inst = GET_SERVER_IMPL(handle);
     return sonar_attribute_server_notify(inst->attr_server_handle, attr->attr, data, length);
 }
 
+bool sonar_server_notify_chain(sonar_server_handle_t handle, sonar_server_attribute_t attr, const sonar_buffer_chain_entry_t* data, sonar_buffer_chain_release_callback_t release_callback, void* release_handle) {
+    instance_impl_t* inst = GET_SERVER_IMPL(handle);
+    return sonar_attribute_server_notify_chain(inst->attr_server_handle, attr->attr, data, release_callback, release_handle);
+}
+
 bool sonar_server_notify_read_data(sonar_server_handle_t handle, sonar_server_attribute_t attr) {
     instance_impl_t* inst = GET_SERVER_IMPL(handle);
+    if (!attr->read_handler) {
+        LOG_ERROR("Attribute doesn't have a read handler");
+        return false;
+    }
     return sonar_attribute_server_notify_read_data(inst->attr_server_handle, attr->attr);
 }
 
+bool sonar_server_write_response_data(sonar_server_handle_t handle, const void* data, uint32_t length) {
+    instance_impl_t* inst = GET_SERVER_IMPL(handle);
+    if (!inst->stream_read_attr) {
+        LOG_ERROR("No stream read in progress");
+        return false;
+    } else if (length > inst->stream_read_attr->attr->max_size - inst->stream_read_length) {
+        LOG_ERROR("Stream read response is too big for attribute (0x%x)", inst->stream_read_attr->attr->attribute_id);
+        return false;
+    }
+    inst->stream_read_length += length;
+    sonar_application_layer_write_response_data(inst->application_layer_handle, data, length);
+    return true;
+}
+
 void sonar_server_get_and_clear_errors(sonar_server_handle_t handle, sonar_errors_t* errors) {
     instance_impl_t* inst = GET_SERVER_IMPL(handle);
     sonar_link_layer_errors_t link_layer_errors;
@@ -220,3 +319,22 @@ void sonar_server_get_and_clear_errors(sonar_server_handle_t handle, sonar_error
         },
     };
 }
+
+#if SONAR_STATS
+void sonar_server_get_and_clear_stats(sonar_server_handle_t handle, sonar_stats_t* stats) {
+    instance_impl_t* inst = GET_SERVER_IMPL(handle);
+    sonar_link_layer_get_and_clear_stats(inst->link_layer_handle, stats);
+}
+
+void sonar_server_get_and_clear_attribute_stats(sonar_server_handle_t handle, sonar_server_attribute_t attr, sonar_attribute_stats_t* stats) {
+    instance_impl_t* inst = GET_SERVER_IMPL(handle);
+    sonar_attribute_server_get_and_clear_stats(inst->attr_server_handle, attr->attr, stats);
+}
+#endif
+
+#if SONAR_CAPTURE
+void sonar_server_set_capture(sonar_server_handle_t handle, sonar_capture_handle_t capture) {
+    instance_impl_t* inst = GET_SERVER_IMPL(handle);
+    sonar_link_layer_set_capture(inst->link_layer_handle, capture);
+}
+#endif
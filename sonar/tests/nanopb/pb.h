@@ -0,0 +1,24 @@
+#pragma once
+
+// A minimal stand-in for the parts of nanopb which are used by sonar::NanopbCodec, which "encodes" a message as a tag
+// byte and a length byte followed by the raw bytes of the struct
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#define PB_TEST_TAG 0x0a
+
+typedef uint8_t pb_byte_t;
+
+typedef struct {
+  size_t struct_size;
+} pb_msgdesc_t;
+
+namespace nanopb {
+
+// Specialized for each message type (as done by the nanopb generator) to provide its fields()
+template <typename T>
+struct MessageDescriptor;
+
+}  // namespace nanopb
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "pb.h"
+
+typedef struct {
+  const pb_byte_t* buf;
+  size_t bytes_left;
+} pb_istream_t;
+
+static inline pb_istream_t pb_istream_from_buffer(const pb_byte_t* buf, size_t bufsize) {
+  return (pb_istream_t){.buf = buf, .bytes_left = bufsize};
+}
+
+static inline bool pb_decode(pb_istream_t* stream, const pb_msgdesc_t* fields, void* dest_struct) {
+  if (stream->bytes_left != 2 + fields->struct_size || stream->buf[0] != PB_TEST_TAG ||
+      stream->buf[1] != fields->struct_size) {
+    return false;
+  }
+  memcpy(dest_struct, &stream->buf[2], fields->struct_size);
+  stream->buf += stream->bytes_left;
+  stream->bytes_left = 0;
+  return true;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "pb.h"
+
+typedef struct {
+  pb_byte_t* buf;
+  size_t max_size;
+  size_t bytes_written;
+} pb_ostream_t;
+
+static inline pb_ostream_t pb_ostream_from_buffer(pb_byte_t* buf, size_t bufsize) {
+  return (pb_ostream_t){.buf = buf, .max_size = bufsize, .bytes_written = 0};
+}
+
+static inline bool pb_encode(pb_ostream_t* stream, const pb_msgdesc_t* fields, const void* src_struct) {
+  if (stream->bytes_written + 2 + fields->struct_size > stream->max_size) {
+    return false;
+  }
+  stream->buf[stream->bytes_written++] = PB_TEST_TAG;
+  stream->buf[stream->bytes_written++] = (pb_byte_t)fields->struct_size;
+  memcpy(&stream->buf[stream->bytes_written], src_struct, fields->struct_size);
+  stream->bytes_written += fields->struct_size;
+  return true;
+}
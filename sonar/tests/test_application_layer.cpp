@@ -143,6 +143,15 @@ static uint16_t m_complete_attribute_id;;
 static std::vector<uint8_t> m_complete_data;
 static std::vector<uint8_t> m_response_data;
 static uint32_t m_response_length;
+static int m_num_releases;
+static int m_num_complete_before_release;
+static void* m_release_handle;
+
+static void release_callback(void* handle) {
+  m_num_releases++;
+  m_num_complete_before_release = m_num_read_complete + m_num_write_complete + m_num_notify_complete;
+  m_release_handle = handle;
+}
 
 static bool send_data_function(void* handle, const buffer_chain_entry_t* data) {
   m_num_sent_packets++;
@@ -196,10 +205,11 @@ static void write_request_complete_handler(void* handle, uint16_t attribute_id,
   m_complete_success = success;
 }
 
-static void notify_request_complete_handler(void* handle, uint16_t attribute_id, bool success) {
+static void notify_request_complete_handler(void* handle, uint16_t attribute_id, bool success, const uint8_t* data, uint32_t length) {
   m_num_notify_complete++;
   m_complete_attribute_id = attribute_id;
   m_complete_success = success;
+  m_complete_data.insert(m_complete_data.end(), data, data + length);
 }
 
 class ApplicationLayerTest : public ::testing::Test {
@@ -299,6 +309,35 @@ TEST_F(ApplicationLayerClientTest, SendWriteRequest) {
   EXPECT_WRITE_COMPLETE(0xabc, true);
 }
 
+TEST_F(ApplicationLayerClientTest, SendWriteRequestChain) {
+  // request with data spread across multiple caller-owned buffers
+  static const uint8_t data1[] = {0xff, 0xee};
+  static const uint8_t data2[] = {0xdd};
+  buffer_chain_entry_t chain1 = {};
+  buffer_chain_entry_t chain2 = {};
+  buffer_chain_set_data(&chain1, data1, sizeof(data1));
+  buffer_chain_set_data(&chain2, data2, sizeof(data2));
+  buffer_chain_push_back(&chain1, &chain2);
+  m_num_releases = 0;
+  EXPECT_TRUE(sonar_application_layer_write_request_chain(handle_, 0xabc, &chain1, release_callback, &chain1));
+  EXPECT_AND_CLEAR_SENT_PACKET(0x2abc, 0xff, 0xee, 0xdd);
+  EXPECT_EQ(m_num_releases, 0);
+
+  // the buffers should be released right before the request completes (even if it fails)
+  HANDLE_RESPONSE(false);
+  EXPECT_EQ(m_num_releases, 1);
+  EXPECT_EQ(m_num_complete_before_release, 0);
+  EXPECT_EQ(m_release_handle, &chain1);
+  EXPECT_WRITE_COMPLETE(0xabc, false);
+
+  // a normal request should still work afterwards
+  SEND_WRITE_REQUEST(0xabc, 0x11);
+  EXPECT_AND_CLEAR_SENT_PACKET(0x2abc, 0x11);
+  HANDLE_RESPONSE(true);
+  EXPECT_WRITE_COMPLETE(0xabc, true);
+  EXPECT_EQ(m_num_releases, 1);
+}
+
 TEST_F(ApplicationLayerClientTest, HandleNotifyRequest) {
   // no data
   HANDLE_REQUEST_DATA_NO_RESPONSE(0xbc, 0x3a);
@@ -327,6 +366,47 @@ TEST_F(ApplicationLayerServerTest, SendNotifyRequest) {
   EXPECT_NOTIFY_COMPLETE(0xabc, true);
 }
 
+TEST_F(ApplicationLayerServerTest, SendNotifyRequestChain) {
+  static const uint8_t data[] = {0xff, 0xee};
+  buffer_chain_entry_t chain = {};
+  buffer_chain_set_data(&chain, data, sizeof(data));
+  m_num_releases = 0;
+  EXPECT_TRUE(sonar_application_layer_notify_request_chain(handle_, 0xabc, &chain, release_callback, NULL));
+  EXPECT_AND_CLEAR_SENT_PACKET(0x3abc, 0xff, 0xee);
+
+  // can't send another request while this one is pending
+  EXPECT_FALSE(sonar_application_layer_notify_request_chain(handle_, 0xabc, &chain, release_callback, NULL));
+  EXPECT_EQ(m_num_sent_packets, 0);
+
+  // response
+  HANDLE_RESPONSE(true);
+  EXPECT_EQ(m_num_releases, 1);
+  EXPECT_NOTIFY_COMPLETE(0xabc, true);
+}
+
+TEST_F(ApplicationLayerClientTest, HandleNotifyDeltaRequest) {
+  // not supported without a handler
+  static const uint8_t request[] = {0xbc, 0x4a, 0x11, 0x22};
+  EXPECT_FALSE(sonar_application_layer_handle_request(handle_, request, sizeof(request)));
+  EXPECT_TRUE(m_response_data.empty());
+}
+
+TEST_F(ApplicationLayerServerTest, SendNotifyDeltaRequest) {
+  const uint8_t data[] = {0xff, 0xee};
+  EXPECT_TRUE(sonar_application_layer_notify_delta_request(handle_, 0xabc, data, sizeof(data)));
+  EXPECT_AND_CLEAR_SENT_PACKET(0x4abc, 0xff, 0xee);
+
+  // response with a status byte
+  HANDLE_RESPONSE(true, 0x01);
+  EXPECT_EQ(m_num_notify_complete, 1);
+  m_num_notify_complete = 0;
+  EXPECT_EQ(m_complete_attribute_id, 0xabc);
+  EXPECT_TRUE(m_complete_success);
+  const uint8_t expected_response[] = {0x01};
+  EXPECT_TRUE(DataMatches(m_complete_data, expected_response, sizeof(expected_response)));
+  m_complete_data.clear();
+}
+
 TEST_F(ApplicationLayerServerTest, HandleReadRequest) {
   // no data
   HANDLE_REQUEST_NO_DATA_WITH_RESPONSE(0xbc, 0x1a);
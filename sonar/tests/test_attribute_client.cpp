@@ -5,11 +5,13 @@
 extern "C" {
 
 #include "src/attribute/client.h"
+#include "src/common/delta.h"
 
 };
 
 SONAR_ATTR_DEF(TEST_ATTR, 0xff1, sizeof(uint32_t), RW);
 SONAR_ATTR_DEF(TEST_ATTR2, 0xff2, sizeof(uint32_t), N);
+SONAR_ATTR_DEF(TEST_DELTA_ATTR, 0xff3, 64, N);
 
 static uint32_t m_test_attr_num_read_complete;
 static bool m_test_attr_read_complete_success;
@@ -18,6 +20,7 @@ static uint32_t m_test_attr_num_write_complete;
 static bool m_test_attr_write_complete_success;
 static uint32_t m_test_attr_num_notifies;
 static uint32_t m_test_notify_data;
+static std::vector<uint8_t> m_test_notify_data_vector;
 static uint32_t m_read_request_num;
 static uint32_t m_read_request_attribute_id;
 static uint32_t m_write_request_num;
@@ -25,6 +28,8 @@ static uint16_t m_write_request_attribute_id;
 static std::vector<uint8_t> m_write_request_data;
 static int m_num_connections;
 static int m_num_disconnections;
+static uint64_t m_system_time_ms;
+static std::vector<uint8_t> m_notify_response_data;
 
 static bool send_read_request_function(void* handle, uint16_t attribute_id) {
   m_read_request_num++;
@@ -57,9 +62,22 @@ static bool notify_handler(void* handle, sonar_attribute_t attr, const uint8_t*
   if (length == sizeof(uint32_t)) {
     m_test_notify_data = *(uint32_t*)data;
   }
+  m_test_notify_data_vector.assign(data, data + length);
   return true;
 }
 
+#if SONAR_ATTR_SHARED_BUFFERS
+static uint8_t m_shared_request_buffer[64];
+#endif
+
+static uint64_t get_system_time_ms(void) {
+  return m_system_time_ms;
+}
+
+static void notify_response_handler(void* handle, const uint8_t* data, uint32_t length) {
+  m_notify_response_data.insert(m_notify_response_data.end(), data, data + length);
+}
+
 static void connection_changed_callback(void* handle, bool connected) {
   if (connected) {
     m_num_connections++;
@@ -78,6 +96,7 @@ class AttributeClientTest : public ::testing::Test {
     m_test_attr_write_complete_success = false;
     m_test_attr_num_notifies = 0;
     m_test_notify_data = 0;
+    m_test_notify_data_vector.clear();
     m_read_request_num = 0;
     m_read_request_attribute_id = 0;
     m_write_request_num = 0;
@@ -85,6 +104,8 @@ class AttributeClientTest : public ::testing::Test {
     m_write_request_data.clear();
     m_num_connections = 0;
     m_num_disconnections = 0;
+    m_system_time_ms = 0;
+    m_notify_response_data.clear();
 
     static sonar_attribute_client_context_t context;
     const sonar_attribute_client_init_t init_attribute_client = {
@@ -94,12 +115,21 @@ class AttributeClientTest : public ::testing::Test {
       .read_complete_handler = read_complete_handler,
       .write_complete_handler = write_complete_handler,
       .notify_handler = notify_handler,
+      .get_system_time_ms = get_system_time_ms,
+#if SONAR_ATTR_DELTA_NOTIFY
+      .notify_response_handler = notify_response_handler,
+#endif
+#if SONAR_ATTR_SHARED_BUFFERS
+      .shared_request_buffer = m_shared_request_buffer,
+      .shared_buffer_size = sizeof(m_shared_request_buffer),
+#endif
       .handle = NULL,
     };
     handle_ = &context;
     sonar_attribute_client_init(handle_, &init_attribute_client);
     sonar_attribute_client_register(handle_, TEST_ATTR);
     sonar_attribute_client_register(handle_, TEST_ATTR2);
+    sonar_attribute_client_register(handle_, TEST_DELTA_ATTR);
 
     // Run (and test) the connection process as it's required before any of the other tests can run
 
@@ -110,7 +140,7 @@ class AttributeClientTest : public ::testing::Test {
     EXPECT_EQ(m_read_request_attribute_id, 0x101);
 
     // Respond to the CTRL_NUM_ATTRS read request and expect a CTRL_ATTR_OFFSET write request
-    const uint16_t num = 5;
+    const uint16_t num = 6;
     sonar_attribute_client_handle_read_response(handle_, 0x101, true, (const uint8_t*)&num, sizeof(num));
     EXPECT_EQ(m_write_request_num, 1);
     m_write_request_num = 0;
@@ -126,7 +156,7 @@ class AttributeClientTest : public ::testing::Test {
     EXPECT_EQ(m_read_request_attribute_id, 0x103);
 
     // Respond to the CTRL_ATTR_LIST read request
-    const uint16_t attr_list[8] = { 0x4ff2, 0x3ff1, 0x1103, 0x3102, 0x1101 };
+    const uint16_t attr_list[8] = { 0x4ff3, 0x4ff2, 0x3ff1, 0x1103, 0x3102, 0x1101 };
     sonar_attribute_client_handle_read_response(handle_, 0x103, true, (const uint8_t*)&attr_list, sizeof(attr_list));
     EXPECT_EQ(m_num_connections, 1);
     m_num_connections = 0;
@@ -208,6 +238,32 @@ TEST_F(AttributeClientTest, WriteResponse) {
   EXPECT_EQ(m_test_attr_write_complete_success, false);
 }
 
+#if SONAR_ATTR_SHARED_BUFFERS
+TEST_F(AttributeClientTest, SharedBuffers) {
+  // send a write which uses the shared request buffer
+  const uint32_t value = 0xabcdabcd;
+  EXPECT_TRUE(sonar_attribute_client_write(handle_, TEST_ATTR, (const uint8_t*)&value, sizeof(value)));
+  EXPECT_EQ(m_write_request_num, 1);
+  m_write_request_num = 0;
+  m_write_request_data.clear();
+
+  // can't send another write until the pending one completes
+  EXPECT_FALSE(sonar_attribute_client_write(handle_, TEST_ATTR, (const uint8_t*)&value, sizeof(value)));
+  EXPECT_EQ(m_write_request_num, 0);
+  sonar_attribute_client_handle_write_response(handle_, 0xff1, true);
+  EXPECT_EQ(m_test_attr_num_write_complete, 1);
+  m_test_attr_num_write_complete = 0;
+  EXPECT_TRUE(sonar_attribute_client_write(handle_, TEST_ATTR, (const uint8_t*)&value, sizeof(value)));
+  EXPECT_EQ(m_write_request_num, 1);
+  m_write_request_num = 0;
+  EXPECT_EQ(*(uint32_t*)m_write_request_data.data(), 0xabcdabcd);
+  m_write_request_data.clear();
+  sonar_attribute_client_handle_write_response(handle_, 0xff1, true);
+  EXPECT_EQ(m_test_attr_num_write_complete, 1);
+  m_test_attr_num_write_complete = 0;
+}
+#endif
+
 TEST_F(AttributeClientTest, HandleValidNotify) {
   const uint32_t data = 0x12345678;
   EXPECT_TRUE(sonar_attribute_client_handle_notify_request(handle_, 0xff2, (const uint8_t*)&data, sizeof(data)));
@@ -235,7 +291,127 @@ TEST_F(AttributeClientTest, TestDisconnect) {
   const uint32_t data = 0x44556677;
   sonar_attribute_client_handle_read_response(handle_, 0xff1, true, (const uint8_t*)&data, sizeof(data));
   sonar_attribute_client_handle_write_response(handle_, 0xff1, true);
+  EXPECT_EQ(m_test_attr_num_read_complete, 0);
+  EXPECT_EQ(m_test_attr_num_write_complete, 0);
 
   // requests should fail
   EXPECT_FALSE(sonar_attribute_client_handle_notify_request(handle_, 0xff2, (const uint8_t*)&data, sizeof(data)));
 }
+
+TEST_F(AttributeClientTest, TestDisconnectWithPendingRequest) {
+  // the link layer fails a pending request after the attributes are marked unavailable, which should still complete
+  sonar_attribute_client_low_level_connection_changed(handle_, false);
+  m_num_disconnections = 0;
+  sonar_attribute_client_handle_read_response(handle_, 0xff1, false, NULL, 0);
+  EXPECT_EQ(m_test_attr_num_read_complete, 1);
+  EXPECT_FALSE(m_test_attr_read_complete_success);
+  m_test_attr_num_read_complete = 0;
+  sonar_attribute_client_handle_write_response(handle_, 0xff1, false);
+  EXPECT_EQ(m_test_attr_num_write_complete, 1);
+  EXPECT_FALSE(m_test_attr_write_complete_success);
+  m_test_attr_num_write_complete = 0;
+}
+
+#if SONAR_ATTR_CACHE
+TEST_F(AttributeClientTest, ReadCached) {
+  const void* cached_data;
+  uint32_t cached_length;
+
+  // nothing should be cached initially
+  EXPECT_FALSE(sonar_attribute_client_read_cached(handle_, TEST_ATTR, 1000, (const uint8_t**)&cached_data, &cached_length));
+
+  // a failed read response shouldn't populate the cache
+  sonar_attribute_client_handle_read_response(handle_, 0xff1, false, NULL, 0);
+  EXPECT_EQ(m_test_attr_num_read_complete, 1);
+  m_test_attr_num_read_complete = 0;
+  EXPECT_FALSE(sonar_attribute_client_read_cached(handle_, TEST_ATTR, 1000, (const uint8_t**)&cached_data, &cached_length));
+
+  // a successful read response should populate the cache
+  const uint32_t data = 0x44556677;
+  m_system_time_ms = 100;
+  sonar_attribute_client_handle_read_response(handle_, 0xff1, true, (const uint8_t*)&data, sizeof(data));
+  EXPECT_EQ(m_test_attr_num_read_complete, 1);
+  m_test_attr_num_read_complete = 0;
+  EXPECT_TRUE(sonar_attribute_client_read_cached(handle_, TEST_ATTR, 1000, (const uint8_t**)&cached_data, &cached_length));
+  EXPECT_EQ(cached_length, sizeof(data));
+  EXPECT_EQ(*(const uint32_t*)cached_data, data);
+
+  // the cached value should expire once it's older than the max age
+  m_system_time_ms = 150;
+  EXPECT_TRUE(sonar_attribute_client_read_cached(handle_, TEST_ATTR, 50, (const uint8_t**)&cached_data, &cached_length));
+  EXPECT_FALSE(sonar_attribute_client_read_cached(handle_, TEST_ATTR, 49, (const uint8_t**)&cached_data, &cached_length));
+
+  // a successful write should invalidate the cache
+  sonar_attribute_client_handle_write_response(handle_, 0xff1, true);
+  EXPECT_EQ(m_test_attr_num_write_complete, 1);
+  m_test_attr_num_write_complete = 0;
+  EXPECT_FALSE(sonar_attribute_client_read_cached(handle_, TEST_ATTR, 1000, (const uint8_t**)&cached_data, &cached_length));
+}
+
+TEST_F(AttributeClientTest, NotifyCached) {
+  const void* cached_data;
+  uint32_t cached_length;
+
+  // an accepted notify should populate the cache
+  const uint32_t data = 0x12345678;
+  EXPECT_TRUE(sonar_attribute_client_handle_notify_request(handle_, 0xff2, (const uint8_t*)&data, sizeof(data)));
+  EXPECT_EQ(m_test_attr_num_notifies, 1);
+  m_test_attr_num_notifies = 0;
+  EXPECT_TRUE(sonar_attribute_client_read_cached(handle_, TEST_ATTR2, 0, (const uint8_t**)&cached_data, &cached_length));
+  EXPECT_EQ(cached_length, sizeof(data));
+  EXPECT_EQ(*(const uint32_t*)cached_data, data);
+
+  // the cache should be cleared on disconnect
+  sonar_attribute_client_low_level_connection_changed(handle_, false);
+  EXPECT_EQ(m_num_disconnections, 1);
+  m_num_disconnections = 0;
+  EXPECT_FALSE(sonar_attribute_client_read_cached(handle_, TEST_ATTR2, 1000, (const uint8_t**)&cached_data, &cached_length));
+}
+#endif
+
+#if SONAR_ATTR_DELTA_NOTIFY
+TEST_F(AttributeClientTest, NotifyDelta) {
+  std::vector<uint8_t> data(64);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = i;
+  }
+
+  // a delta notify before we have a base should be responded to with a mismatch
+  uint8_t delta[sizeof(uint32_t)] = {0x40, 0x00, 0x00, 0x00};
+  EXPECT_TRUE(sonar_attribute_client_handle_notify_delta_request(handle_, 0xff3, delta, sizeof(delta)));
+  EXPECT_EQ(m_test_attr_num_notifies, 0);
+  EXPECT_EQ(m_notify_response_data, std::vector<uint8_t>({0x00}));
+  m_notify_response_data.clear();
+
+  // a full notify should be stored as the base
+  EXPECT_TRUE(sonar_attribute_client_handle_notify_request(handle_, 0xff3, data.data(), data.size()));
+  EXPECT_EQ(m_test_attr_num_notifies, 1);
+  m_test_attr_num_notifies = 0;
+  EXPECT_EQ(m_test_notify_data_vector, data);
+  EXPECT_EQ(m_notify_response_data, std::vector<uint8_t>({0x01}));
+  m_notify_response_data.clear();
+
+  // a delta against the stored base should be applied and passed to the notify handler in full
+  std::vector<uint8_t> encoded = data;
+  encoded[10] = 0xaa;
+  encoded.resize(data.size() + 8);
+  const uint32_t encoded_length = delta_encode(data.data(), data.size(), encoded.data(), data.size());
+  data[10] = 0xaa;
+  EXPECT_TRUE(sonar_attribute_client_handle_notify_delta_request(handle_, 0xff3, encoded.data(), encoded_length));
+  EXPECT_EQ(m_test_attr_num_notifies, 1);
+  m_test_attr_num_notifies = 0;
+  EXPECT_EQ(m_test_notify_data_vector, data);
+  EXPECT_EQ(m_notify_response_data, std::vector<uint8_t>({0x01}));
+  m_notify_response_data.clear();
+
+  // the same delta no longer matches the base
+  EXPECT_TRUE(sonar_attribute_client_handle_notify_delta_request(handle_, 0xff3, encoded.data(), encoded_length));
+  EXPECT_EQ(m_test_attr_num_notifies, 0);
+  EXPECT_EQ(m_notify_response_data, std::vector<uint8_t>({0x00}));
+  m_notify_response_data.clear();
+
+  // deltas aren't supported for small attributes
+  EXPECT_FALSE(sonar_attribute_client_handle_notify_delta_request(handle_, 0xff2, encoded.data(), encoded_length));
+  EXPECT_TRUE(m_notify_response_data.empty());
+}
+#endif
@@ -17,6 +17,13 @@ extern "C" {
 
 SONAR_ATTR_DEF(TEST_ATTR, 0xff1, sizeof(uint32_t), RW);
 SONAR_ATTR_DEF(TEST_ATTR2, 0xff2, sizeof(uint32_t), N);
+SONAR_ATTR_DEF(TEST_DELTA_ATTR, 0xff3, 64, N);
+SONAR_ATTR_DEF(TEST_BIG_ATTR, 0xff4, 128, N);
+
+#if SONAR_ATTR_SHARED_BUFFERS
+static uint8_t m_shared_request_buffer[64];
+static uint8_t m_shared_response_buffer[64];
+#endif
 
 static uint32_t m_test_attr_num_reads;
 static uint32_t m_test_attr_num_writes;
@@ -26,6 +33,8 @@ static bool m_test_attr_notify_complete_success;
 static uint32_t m_notify_request_num;
 static uint16_t m_notify_request_attribute_id;
 static std::vector<uint8_t> m_notify_request_data;
+static uint32_t m_notify_delta_request_num;
+static std::vector<uint8_t> m_notify_delta_request_data;
 static std::vector<uint8_t> m_response_data;
 
 static bool send_notify_request_function(void* handle, uint16_t attribute_id, const uint8_t* data, uint32_t length) {
@@ -35,6 +44,13 @@ static bool send_notify_request_function(void* handle, uint16_t attribute_id, co
   return true;
 }
 
+static bool send_notify_delta_request_function(void* handle, uint16_t attribute_id, const uint8_t* data, uint32_t length) {
+  m_notify_delta_request_num++;
+  m_notify_request_attribute_id = attribute_id;
+  m_notify_delta_request_data.insert(m_notify_delta_request_data.end(), data, data + length);
+  return true;
+}
+
 static void read_response_handler(void* handle, const uint8_t* data, uint32_t length) {
   m_response_data.insert(m_response_data.end(), data, data + length);
 }
@@ -78,14 +94,22 @@ class AttributeServerTest : public ::testing::Test {
     m_notify_request_num = 0;
     m_notify_request_attribute_id = 0;
     m_notify_request_data.clear();
+    m_notify_delta_request_num = 0;
+    m_notify_delta_request_data.clear();
     static sonar_attribute_server_context_t context;
     handle_ = &context;
     const sonar_attribute_server_init_t init_attribute_server = {
       .send_notify_request_function = send_notify_request_function,
+      .send_notify_delta_request_function = send_notify_delta_request_function,
       .read_response_handler = read_response_handler,
       .read_handler = read_handler,
       .write_handler = write_handler,
       .notify_complete_handler = notify_complete_handler,
+#if SONAR_ATTR_SHARED_BUFFERS
+      .shared_request_buffer = m_shared_request_buffer,
+      .shared_response_buffer = m_shared_response_buffer,
+      .shared_buffer_size = sizeof(m_shared_request_buffer),
+#endif
       .handle = handle_,
     };
     sonar_attribute_server_init(handle_, &init_attribute_server);
@@ -98,6 +122,7 @@ class AttributeServerTest : public ::testing::Test {
     EXPECT_EQ(m_test_attr_num_writes, 0);
     EXPECT_EQ(m_test_attr_num_notify_complete, 0);
     EXPECT_EQ(m_notify_request_num, 0);
+    EXPECT_EQ(m_notify_delta_request_num, 0);
   }
 
   sonar_attribute_server_handle_t handle_;
@@ -161,18 +186,135 @@ TEST_F(AttributeServerTest, InvalidNotifyRequest) {
 
 TEST_F(AttributeServerTest, NotifyResponse) {
   // success response
-  sonar_attribute_server_handle_notify_response(handle_, 0xff2, true);
+  sonar_attribute_server_handle_notify_response(handle_, 0xff2, true, NULL, 0);
   EXPECT_EQ(m_test_attr_num_notify_complete, 1);
   m_test_attr_num_notify_complete = 0;
   EXPECT_EQ(m_test_attr_notify_complete_success, true);
 
   // failed response
-  sonar_attribute_server_handle_notify_response(handle_, 0xff2, false);
+  sonar_attribute_server_handle_notify_response(handle_, 0xff2, false, NULL, 0);
   EXPECT_EQ(m_test_attr_num_notify_complete, 1);
   m_test_attr_num_notify_complete = 0;
   EXPECT_EQ(m_test_attr_notify_complete_success, false);
 }
 
+#if SONAR_ATTR_SHARED_BUFFERS
+TEST_F(AttributeServerTest, SharedBuffers) {
+  // attributes which are too big for the shared buffers can't be registered
+  sonar_attribute_server_register(handle_, TEST_BIG_ATTR);
+  const uint8_t big_data[128] = {};
+  EXPECT_FALSE(sonar_attribute_server_notify(handle_, TEST_BIG_ATTR, big_data, sizeof(big_data)));
+
+  // send a notify which uses the shared request buffer
+  const uint32_t data = 0xabcdabcd;
+  EXPECT_TRUE(sonar_attribute_server_notify(handle_, TEST_ATTR2, (const uint8_t*)&data, sizeof(data)));
+  EXPECT_EQ(m_notify_request_num, 1);
+  m_notify_request_num = 0;
+  m_notify_request_data.clear();
+
+  // can't send another notify until the pending one completes
+  EXPECT_FALSE(sonar_attribute_server_notify(handle_, TEST_ATTR2, (const uint8_t*)&data, sizeof(data)));
+  EXPECT_EQ(m_notify_request_num, 0);
+  sonar_attribute_server_handle_notify_response(handle_, 0xff2, true, NULL, 0);
+  EXPECT_EQ(m_test_attr_num_notify_complete, 1);
+  m_test_attr_num_notify_complete = 0;
+  EXPECT_TRUE(sonar_attribute_server_notify(handle_, TEST_ATTR2, (const uint8_t*)&data, sizeof(data)));
+  EXPECT_EQ(m_notify_request_num, 1);
+  m_notify_request_num = 0;
+  m_notify_request_data.clear();
+  sonar_attribute_server_handle_notify_response(handle_, 0xff2, false, NULL, 0);
+  EXPECT_EQ(m_test_attr_num_notify_complete, 1);
+  m_test_attr_num_notify_complete = 0;
+
+  // reads use the shared response buffer
+  READ_EXPECT_RESPONSE(0xff1, 0x44, 0x33, 0x22, 0x11);
+  EXPECT_EQ(m_test_attr_num_reads, 1);
+  m_test_attr_num_reads = 0;
+}
+#endif
+
+TEST_F(AttributeServerTest, DeltaNotify) {
+  const uint8_t stored_response[] = {0x01};
+  const uint8_t mismatch_response[] = {0x00};
+  sonar_attribute_server_register(handle_, TEST_DELTA_ATTR);
+  std::vector<uint8_t> data(64);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = i;
+  }
+
+  // the first notify is sent in full and the client stores it as the base
+  EXPECT_TRUE(sonar_attribute_server_notify(handle_, TEST_DELTA_ATTR, data.data(), data.size()));
+  EXPECT_EQ(m_notify_request_num, 1);
+  m_notify_request_num = 0;
+  EXPECT_EQ(m_notify_request_data, data);
+  m_notify_request_data.clear();
+  sonar_attribute_server_handle_notify_response(handle_, 0xff3, true, stored_response, sizeof(stored_response));
+  EXPECT_EQ(m_test_attr_num_notify_complete, 1);
+  m_test_attr_num_notify_complete = 0;
+  EXPECT_TRUE(m_test_attr_notify_complete_success);
+
+  // the next notify is sent as a delta
+  data[10] = 0xaa;
+  EXPECT_TRUE(sonar_attribute_server_notify(handle_, TEST_DELTA_ATTR, data.data(), data.size()));
+  EXPECT_EQ(m_notify_delta_request_num, 1);
+  m_notify_delta_request_num = 0;
+  EXPECT_EQ(m_notify_request_attribute_id, 0xff3);
+  const uint8_t expected_delta[] = {0xaa, 0x0a, 0x00, 0x01, 0x00, 0x40, 0x00};
+  EXPECT_EQ(m_notify_delta_request_data.size(), sizeof(expected_delta) + 2);
+  EXPECT_EQ(memcmp(m_notify_delta_request_data.data(), expected_delta, sizeof(expected_delta)), 0);
+  m_notify_delta_request_data.clear();
+  sonar_attribute_server_handle_notify_response(handle_, 0xff3, true, stored_response, sizeof(stored_response));
+  EXPECT_EQ(m_test_attr_num_notify_complete, 1);
+  m_test_attr_num_notify_complete = 0;
+  EXPECT_TRUE(m_test_attr_notify_complete_success);
+
+  // the client doesn't have a matching base, so the full value is resent before completing
+  data[20] = 0xbb;
+  EXPECT_TRUE(sonar_attribute_server_notify(handle_, TEST_DELTA_ATTR, data.data(), data.size()));
+  EXPECT_EQ(m_notify_delta_request_num, 1);
+  m_notify_delta_request_num = 0;
+  m_notify_delta_request_data.clear();
+  sonar_attribute_server_handle_notify_response(handle_, 0xff3, true, mismatch_response, sizeof(mismatch_response));
+  EXPECT_EQ(m_test_attr_num_notify_complete, 0);
+  EXPECT_EQ(m_notify_request_num, 1);
+  m_notify_request_num = 0;
+  EXPECT_EQ(m_notify_request_data, data);
+  m_notify_request_data.clear();
+  sonar_attribute_server_handle_notify_response(handle_, 0xff3, true, stored_response, sizeof(stored_response));
+  EXPECT_EQ(m_test_attr_num_notify_complete, 1);
+  m_test_attr_num_notify_complete = 0;
+  EXPECT_TRUE(m_test_attr_notify_complete_success);
+
+  // a failed delta notify means the next one is sent in full
+  data[30] = 0xcc;
+  EXPECT_TRUE(sonar_attribute_server_notify(handle_, TEST_DELTA_ATTR, data.data(), data.size()));
+  EXPECT_EQ(m_notify_delta_request_num, 1);
+  m_notify_delta_request_num = 0;
+  m_notify_delta_request_data.clear();
+  sonar_attribute_server_handle_notify_response(handle_, 0xff3, false, NULL, 0);
+  EXPECT_EQ(m_test_attr_num_notify_complete, 1);
+  m_test_attr_num_notify_complete = 0;
+  EXPECT_FALSE(m_test_attr_notify_complete_success);
+  EXPECT_TRUE(sonar_attribute_server_notify(handle_, TEST_DELTA_ATTR, data.data(), data.size()));
+  EXPECT_EQ(m_notify_request_num, 1);
+  m_notify_request_num = 0;
+  EXPECT_EQ(m_notify_request_data, data);
+  m_notify_request_data.clear();
+
+  // a client which doesn't support deltas doesn't store the base, so notifies are always sent in full
+  sonar_attribute_server_handle_notify_response(handle_, 0xff3, true, NULL, 0);
+  EXPECT_EQ(m_test_attr_num_notify_complete, 1);
+  m_test_attr_num_notify_complete = 0;
+  data[40] = 0xdd;
+  EXPECT_TRUE(sonar_attribute_server_notify(handle_, TEST_DELTA_ATTR, data.data(), data.size()));
+  EXPECT_EQ(m_notify_request_num, 1);
+  m_notify_request_num = 0;
+  m_notify_request_data.clear();
+  sonar_attribute_server_handle_notify_response(handle_, 0xff3, true, NULL, 0);
+  EXPECT_EQ(m_test_attr_num_notify_complete, 1);
+  m_test_attr_num_notify_complete = 0;
+}
+
 TEST_F(AttributeServerTest, ControlAttrs) {
   uint32_t data_len;
 
@@ -0,0 +1,300 @@
+#include "test_common.h"
+
+#include <vector>
+
+extern "C" {
+
+#include "anchor/sonar/host/replay.h"
+#include "src/common/capture.h"
+
+};
+
+SONAR_CAPTURE_DEF(m_capture, 64, 64);
+SONAR_CAPTURE_DEF(m_replay_capture, 64, 64);
+SONAR_CHANNEL_SIM_DEF(m_channel, 1024);
+SONAR_CLIENT_DEF(m_client, 64);
+SONAR_SERVER_DEF(m_server, 64);
+SONAR_ATTR_DEF(CLIENT_TEST_ATTR, 0x100, sizeof(uint32_t), RW);
+SONAR_SERVER_ATTR_DEF(TestAttr, SERVER_TEST_ATTR, 0x100, sizeof(uint32_t), RW);
+
+static uint32_t m_attr_value;
+static int m_num_read_complete;
+static std::vector<uint8_t> m_trace;
+static std::vector<uint8_t> m_replay_trace;
+
+static void capture_write_function(const uint8_t* data, uint32_t length) {
+  m_trace.insert(m_trace.end(), data, data + length);
+}
+
+static void replay_capture_write_function(const uint8_t* data, uint32_t length) {
+  m_replay_trace.insert(m_replay_trace.end(), data, data + length);
+}
+
+static bool TestAttr_write_handler(const void* data, uint32_t length) {
+  memcpy(&m_attr_value, data, sizeof(m_attr_value));
+  return true;
+}
+
+static uint32_t TestAttr_read_handler(void* response_data, uint32_t response_max_size) {
+  memcpy(response_data, &m_attr_value, sizeof(m_attr_value));
+  return sizeof(m_attr_value);
+}
+
+// the handle is the simulated time of the fixture
+static void replay_set_time_ms(void* handle, uint64_t time_ms) {
+  *static_cast<uint64_t*>(handle) = time_ms * 1000;
+}
+
+static void replay_process(void* handle, const uint8_t* data, uint32_t length) {
+  sonar_server_process(m_server, data, length);
+}
+
+static uint64_t replay_get_next_deadline_ms(void* handle) {
+  return sonar_server_get_next_deadline_ms(m_server);
+}
+
+static std::vector<sonar_capture_record_t> ParseTrace(const std::vector<uint8_t>& trace) {
+  std::vector<sonar_capture_record_t> records;
+  size_t offset = 0;
+  while (offset < trace.size()) {
+    sonar_capture_record_t record;
+    const uint32_t length = sonar_capture_parse_record(&trace[offset], trace.size() - offset, &record);
+    EXPECT_GT(length, 0);
+    if (!length) {
+      break;
+    }
+    records.push_back(record);
+    offset += length;
+  }
+  return records;
+}
+
+static std::vector<std::vector<uint8_t>> GetFrames(const std::vector<sonar_capture_record_t>& records,
+    sonar_capture_type_t type) {
+  std::vector<std::vector<uint8_t>> frames;
+  for (const sonar_capture_record_t& record : records) {
+    if (record.type == type) {
+      frames.emplace_back(record.data, record.data + record.length);
+    }
+  }
+  return frames;
+}
+
+class CaptureTest : public ClientServerTest {
+ protected:
+  CaptureTest() : ClientServerTest(m_channel, m_client, m_server) {}
+
+  void SetUp() override {
+    ClientServerTest::SetUp();
+    m_attr_value = 0x12345678;
+    m_num_read_complete = 0;
+    m_trace.clear();
+    m_replay_trace.clear();
+  }
+
+  void OnReadComplete(bool success, const void* data, uint32_t length) override {
+    m_num_read_complete++;
+  }
+
+  void InitClientServer(const sonar_channel_sim_config_t& config) {
+    InitChannel(config);
+    InitClient(CLIENT_TEST_ATTR);
+    InitServer(SERVER_TEST_ATTR);
+  }
+};
+
+TEST_F(CaptureTest, Ring) {
+  const sonar_capture_init_t init = {
+    .get_system_time_ms = get_system_time_ms,
+    .write_function = nullptr,
+  };
+  sonar_capture_init(m_capture, &init);
+  const uint8_t data[20] = {1, 2, 3};
+  time_us_ = 0x12345678ULL * 1000;
+  capture_write_record(m_capture, SONAR_CAPTURE_TYPE_RX_RAW, true, nullptr, 0, data, 10);
+  time_us_ += 1000;
+  capture_write_record(m_capture, SONAR_CAPTURE_TYPE_RX_FRAME, false, data, 2, data, 3);
+
+  uint8_t buffer[64];
+  EXPECT_EQ(sonar_capture_read(m_capture, buffer, 16), 0);
+  uint32_t length = sonar_capture_read(m_capture, buffer, 20);
+  ASSERT_EQ(length, 17);
+  sonar_capture_record_t record;
+  EXPECT_EQ(sonar_capture_parse_record(buffer, length, &record), 17);
+  EXPECT_EQ(record.type, SONAR_CAPTURE_TYPE_RX_RAW);
+  EXPECT_TRUE(record.is_server);
+  EXPECT_FALSE(record.is_truncated);
+  EXPECT_EQ(record.time_ms, 0x12345678);
+  EXPECT_EQ(record.length, 10);
+  EXPECT_EQ(memcmp(record.data, data, 10), 0);
+  length = sonar_capture_read(m_capture, buffer, sizeof(buffer));
+  ASSERT_EQ(length, 12);
+  EXPECT_EQ(sonar_capture_parse_record(buffer, length, &record), 12);
+  EXPECT_EQ(record.type, SONAR_CAPTURE_TYPE_RX_FRAME);
+  EXPECT_FALSE(record.is_server);
+  EXPECT_EQ(record.time_ms, 0x12345679);
+  EXPECT_EQ(record.length, 5);
+  EXPECT_EQ(sonar_capture_parse_record(buffer, length - 1, &record), 0);
+
+  // the oldest records should be dropped to make room (wrapping around the end of the buffer)
+  for (int i = 0; i < 5; i++) {
+    capture_write_record(m_capture, SONAR_CAPTURE_TYPE_RX_RAW, true, nullptr, 0, data, i + 10);
+  }
+  EXPECT_EQ(sonar_capture_get_num_dropped(m_capture), 2);
+  length = sonar_capture_read(m_capture, buffer, sizeof(buffer));
+  ASSERT_EQ(length, 3 * 7 + 12 + 13 + 14);
+  EXPECT_EQ(sonar_capture_parse_record(buffer, length, &record), 19);
+  EXPECT_EQ(record.length, 12);
+
+  // a record which doesn't fit at all should be dropped
+  capture_write_record(m_capture, SONAR_CAPTURE_TYPE_RX_RAW, true, nullptr, 0, data, 60);
+  EXPECT_EQ(sonar_capture_get_num_dropped(m_capture), 3);
+  EXPECT_EQ(sonar_capture_read(m_capture, buffer, sizeof(buffer)), 0);
+}
+
+TEST_F(CaptureTest, Frames) {
+  InitClientServer({});
+  const sonar_capture_init_t init = {
+    .get_system_time_ms = get_system_time_ms,
+    .write_function = capture_write_function,
+  };
+  sonar_capture_init(m_capture, &init);
+  sonar_server_set_capture(m_server, m_capture);
+  Run(50000);
+  ASSERT_TRUE(sonar_client_is_connected(m_client));
+  // data which needs to be escaped should be decoded
+  m_attr_value = 0x7d7e7d7e;
+  ASSERT_TRUE(sonar_client_read(m_client, CLIENT_TEST_ATTR));
+  Run(10000);
+  EXPECT_EQ(m_num_read_complete, 1);
+
+  const std::vector<sonar_capture_record_t> records = ParseTrace(m_trace);
+  const std::vector<std::vector<uint8_t>> rx_raw = GetFrames(records, SONAR_CAPTURE_TYPE_RX_RAW);
+  const std::vector<std::vector<uint8_t>> rx_frames = GetFrames(records, SONAR_CAPTURE_TYPE_RX_FRAME);
+  const std::vector<std::vector<uint8_t>> tx_raw = GetFrames(records, SONAR_CAPTURE_TYPE_TX_RAW);
+  const std::vector<std::vector<uint8_t>> tx_frames = GetFrames(records, SONAR_CAPTURE_TYPE_TX_FRAME);
+  for (const sonar_capture_record_t& record : records) {
+    EXPECT_TRUE(record.is_server);
+    EXPECT_FALSE(record.is_truncated);
+  }
+  ASSERT_GT(rx_raw.size(), 0);
+  ASSERT_GT(rx_frames.size(), 0);
+  // every request should have been responded to
+  ASSERT_EQ(tx_raw.size(), rx_frames.size());
+  ASSERT_EQ(tx_frames.size(), rx_frames.size());
+
+  // the last response should be the attribute value
+  const std::vector<uint8_t>& raw = tx_raw.back();
+  const std::vector<uint8_t>& frame = tx_frames.back();
+  EXPECT_EQ(raw.front(), 0x7e);
+  EXPECT_EQ(raw.back(), 0x7e);
+  ASSERT_GE(frame.size(), 2 + sizeof(m_attr_value));
+  // response from the server
+  EXPECT_EQ(frame[0] & 0x03, 0x03);
+  EXPECT_EQ(memcmp(&frame[frame.size() - sizeof(m_attr_value)], &m_attr_value, sizeof(m_attr_value)), 0);
+  // the flag bytes, CRC, and escape bytes for the value
+  EXPECT_GE(raw.size(), frame.size() + 2 + 2 + 4);
+  // the last request should be a read request from the client
+  EXPECT_EQ(rx_frames.back()[0] & 0x03, 0x00);
+
+  // stop capturing
+  sonar_server_set_capture(m_server, nullptr);
+  const size_t trace_size = m_trace.size();
+  Run(1000000);
+  EXPECT_EQ(m_trace.size(), trace_size);
+}
+
+TEST_F(CaptureTest, TruncatedFrame) {
+  InitClientServer({});
+  const sonar_capture_init_t init = {
+    .get_system_time_ms = get_system_time_ms,
+    .write_function = capture_write_function,
+  };
+  // capture from the start with a frame buffer which is too small for the response
+  SONAR_CAPTURE_DEF(small_capture, 64, 8);
+  sonar_capture_init(small_capture, &init);
+  sonar_server_set_capture(m_server, small_capture);
+  Run(50000);
+  ASSERT_TRUE(sonar_client_read(m_client, CLIENT_TEST_ATTR));
+  Run(10000);
+  EXPECT_EQ(m_num_read_complete, 1);
+
+  const std::vector<sonar_capture_record_t> records = ParseTrace(m_trace);
+  ASSERT_GT(records.size(), 0);
+  const sonar_capture_record_t& record = records.back();
+  EXPECT_EQ(record.type, SONAR_CAPTURE_TYPE_TX_RAW);
+  EXPECT_TRUE(record.is_truncated);
+  EXPECT_EQ(record.length, 8);
+}
+
+TEST_F(CaptureTest, Replay) {
+  // capture the server on a lossy link so that there are retries
+  sonar_channel_sim_config_t config = {};
+  config.byte_drop_rate = 0.005;
+  config.latency_us = 2000;
+  config.baud_rate = 115200;
+  config.seed = 1;
+  InitClientServer(config);
+  const sonar_capture_init_t init = {
+    .get_system_time_ms = get_system_time_ms,
+    .write_function = capture_write_function,
+  };
+  sonar_capture_init(m_capture, &init);
+  sonar_server_set_capture(m_server, m_capture);
+  Run(100000);
+  ASSERT_TRUE(sonar_client_is_connected(m_client));
+  for (int i = 0; i < 50; i++) {
+    ASSERT_TRUE(sonar_client_read(m_client, CLIENT_TEST_ATTR));
+    for (int j = 0; j < 2000 && m_num_read_complete == i; j++) {
+      Run(tick_us_);
+    }
+    ASSERT_EQ(m_num_read_complete, i + 1);
+  }
+  sonar_server_set_capture(m_server, nullptr);
+  const std::vector<sonar_capture_record_t> records = ParseTrace(m_trace);
+
+  // replay the trace into a fresh server under a virtual clock
+  time_us_ = sonar_replay_get_start_time_ms(m_trace.data(), m_trace.size()) * 1000;
+  InitServer(SERVER_TEST_ATTR);
+  const sonar_capture_init_t replay_init = {
+    .get_system_time_ms = get_system_time_ms,
+    .write_function = replay_capture_write_function,
+  };
+  sonar_capture_init(m_replay_capture, &replay_init);
+  sonar_server_set_capture(m_server, m_replay_capture);
+  const sonar_replay_init_t init_replay = {
+    .set_time_ms = replay_set_time_ms,
+    .process = replay_process,
+    .get_next_deadline_ms = replay_get_next_deadline_ms,
+    .handle = &time_us_,
+  };
+  sonar_replay_result_t result;
+  ASSERT_TRUE(sonar_replay_run(m_trace.data(), m_trace.size(), &init_replay, &result));
+  EXPECT_TRUE(result.is_server);
+  EXPECT_EQ(result.num_records, records.size());
+  EXPECT_EQ(result.num_rx_chunks, GetFrames(records, SONAR_CAPTURE_TYPE_RX_RAW).size());
+  EXPECT_GT(result.num_tx_frames, 50);
+  EXPECT_EQ(result.start_time_ms, records.front().time_ms);
+  EXPECT_EQ(result.end_time_ms, records.back().time_ms);
+
+  // the server should have transmitted exactly the same frames at the same times
+  const std::vector<sonar_capture_record_t> replay_records = ParseTrace(m_replay_trace);
+  std::vector<std::pair<uint32_t, std::vector<uint8_t>>> expected;
+  std::vector<std::pair<uint32_t, std::vector<uint8_t>>> actual;
+  for (const sonar_capture_record_t& record : records) {
+    if (record.type == SONAR_CAPTURE_TYPE_TX_FRAME) {
+      expected.emplace_back(record.time_ms, std::vector<uint8_t>(record.data, record.data + record.length));
+    }
+  }
+  for (const sonar_capture_record_t& record : replay_records) {
+    if (record.type == SONAR_CAPTURE_TYPE_TX_FRAME) {
+      actual.emplace_back(record.time_ms, std::vector<uint8_t>(record.data, record.data + record.length));
+    }
+  }
+  EXPECT_EQ(actual.size(), result.num_tx_frames);
+  EXPECT_EQ(actual, expected);
+
+  // an invalid trace should be rejected
+  m_trace.push_back(0xff);
+  EXPECT_FALSE(sonar_replay_run(m_trace.data(), m_trace.size(), &init_replay, &result));
+}
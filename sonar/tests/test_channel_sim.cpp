@@ -0,0 +1,213 @@
+#include "test_common.h"
+
+SONAR_CHANNEL_SIM_DEF(m_channel, 1024);
+SONAR_CLIENT_DEF(m_client, 64);
+SONAR_SERVER_DEF(m_server, 64);
+SONAR_ATTR_DEF(CLIENT_TEST_ATTR, 0x100, sizeof(uint32_t), RW);
+SONAR_SERVER_ATTR_DEF(TestAttr, SERVER_TEST_ATTR, 0x100, sizeof(uint32_t), RW);
+
+static uint32_t m_attr_value;
+static int m_num_read_complete;
+static int m_num_read_success;
+
+static bool TestAttr_write_handler(const void* data, uint32_t length) {
+  memcpy(&m_attr_value, data, sizeof(m_attr_value));
+  return true;
+}
+
+static uint32_t TestAttr_read_handler(void* response_data, uint32_t response_max_size) {
+  memcpy(response_data, &m_attr_value, sizeof(m_attr_value));
+  return sizeof(m_attr_value);
+}
+
+class ChannelSimTest : public ClientServerTest {
+ protected:
+  ChannelSimTest() : ClientServerTest(m_channel, m_client, m_server) {}
+
+  void SetUp() override {
+    ClientServerTest::SetUp();
+    m_attr_value = 0x12345678;
+    m_num_read_complete = 0;
+    m_num_read_success = 0;
+  }
+
+  void OnReadComplete(bool success, const void* data, uint32_t length) override {
+    m_num_read_complete++;
+    if (success && length == sizeof(uint32_t) && !memcmp(data, &m_attr_value, length)) {
+      m_num_read_success++;
+    }
+  }
+
+  std::vector<uint8_t> Read(sonar_channel_sim_dir_t dir, uint64_t now_us) {
+    uint8_t buffer[256];
+    const uint32_t length = sonar_channel_sim_read(m_channel, dir, now_us, buffer, sizeof(buffer));
+    return std::vector<uint8_t>(buffer, buffer + length);
+  }
+};
+
+TEST_F(ChannelSimTest, Ideal) {
+  InitChannel({});
+  // bytes should be delivered immediately and unmodified in both directions
+  sonar_channel_sim_write(m_channel, CLIENT_TO_SERVER, 0x11, 0);
+  sonar_channel_sim_write(m_channel, CLIENT_TO_SERVER, 0x22, 0);
+  sonar_channel_sim_write(m_channel, SERVER_TO_CLIENT, 0x33, 0);
+  EXPECT_EQ(Read(CLIENT_TO_SERVER, 0), std::vector<uint8_t>({0x11, 0x22}));
+  EXPECT_EQ(Read(SERVER_TO_CLIENT, 0), std::vector<uint8_t>({0x33}));
+  EXPECT_EQ(sonar_channel_sim_get_next_delivery_us(m_channel, CLIENT_TO_SERVER), UINT64_MAX);
+
+  sonar_channel_sim_stats_t stats;
+  sonar_channel_sim_get_stats(m_channel, CLIENT_TO_SERVER, &stats);
+  EXPECT_EQ(stats.bytes_written, 2);
+  EXPECT_EQ(stats.bytes_delivered, 2);
+  EXPECT_EQ(stats.bytes_dropped, 0);
+  EXPECT_EQ(stats.bits_flipped, 0);
+}
+
+TEST_F(ChannelSimTest, SerializationAndLatency) {
+  // at 10000 baud, each byte takes 1ms to serialize
+  sonar_channel_sim_config_t config = {};
+  config.baud_rate = 10000;
+  config.latency_us = 500;
+  InitChannel(config);
+  sonar_channel_sim_write(m_channel, CLIENT_TO_SERVER, 0x11, 0);
+  sonar_channel_sim_write(m_channel, CLIENT_TO_SERVER, 0x22, 0);
+  sonar_channel_sim_write(m_channel, CLIENT_TO_SERVER, 0x33, 5000);
+  // a full-duplex channel should serialize the other direction at the same time
+  sonar_channel_sim_write(m_channel, SERVER_TO_CLIENT, 0x44, 0);
+
+  EXPECT_EQ(sonar_channel_sim_get_next_delivery_us(m_channel, CLIENT_TO_SERVER), 1500);
+  EXPECT_EQ(sonar_channel_sim_get_next_delivery_us(m_channel, SERVER_TO_CLIENT), 1500);
+  EXPECT_EQ(Read(CLIENT_TO_SERVER, 1499), std::vector<uint8_t>());
+  EXPECT_EQ(Read(CLIENT_TO_SERVER, 1500), std::vector<uint8_t>({0x11}));
+  EXPECT_EQ(Read(CLIENT_TO_SERVER, 2500), std::vector<uint8_t>({0x22}));
+  // the line was idle when the third byte was written
+  EXPECT_EQ(sonar_channel_sim_get_next_delivery_us(m_channel, CLIENT_TO_SERVER), 6500);
+  EXPECT_EQ(Read(CLIENT_TO_SERVER, 10000), std::vector<uint8_t>({0x33}));
+}
+
+TEST_F(ChannelSimTest, HalfDuplex) {
+  sonar_channel_sim_config_t config = {};
+  config.baud_rate = 10000;
+  config.half_duplex = true;
+  config.turnaround_us = 200;
+  InitChannel(config);
+  sonar_channel_sim_write(m_channel, CLIENT_TO_SERVER, 0x11, 0);
+  sonar_channel_sim_write(m_channel, CLIENT_TO_SERVER, 0x22, 0);
+  // the other direction should wait for the line to be free and turned around
+  sonar_channel_sim_write(m_channel, SERVER_TO_CLIENT, 0x33, 0);
+  EXPECT_EQ(sonar_channel_sim_get_next_delivery_us(m_channel, SERVER_TO_CLIENT), 3200);
+  // as should the original direction when it transmits again
+  Read(CLIENT_TO_SERVER, 2000);
+  sonar_channel_sim_write(m_channel, CLIENT_TO_SERVER, 0x44, 0);
+  EXPECT_EQ(sonar_channel_sim_get_next_delivery_us(m_channel, CLIENT_TO_SERVER), 4400);
+  // no turnaround is needed once the line is idle in the same direction
+  Read(CLIENT_TO_SERVER, 4400);
+  sonar_channel_sim_write(m_channel, CLIENT_TO_SERVER, 0x55, 4400);
+  EXPECT_EQ(sonar_channel_sim_get_next_delivery_us(m_channel, CLIENT_TO_SERVER), 5400);
+}
+
+TEST_F(ChannelSimTest, Errors) {
+  sonar_channel_sim_config_t config = {};
+  config.bit_error_rate = 1.0;
+  InitChannel(config);
+  sonar_channel_sim_write(m_channel, CLIENT_TO_SERVER, 0x0f, 0);
+  EXPECT_EQ(Read(CLIENT_TO_SERVER, 0), std::vector<uint8_t>({0xf0}));
+
+  config.bit_error_rate = 0.0;
+  config.byte_drop_rate = 1.0;
+  InitChannel(config);
+  sonar_channel_sim_write(m_channel, CLIENT_TO_SERVER, 0x0f, 0);
+  EXPECT_EQ(Read(CLIENT_TO_SERVER, 0), std::vector<uint8_t>());
+
+  sonar_channel_sim_stats_t stats;
+  sonar_channel_sim_get_stats(m_channel, CLIENT_TO_SERVER, &stats);
+  EXPECT_EQ(stats.bytes_written, 1);
+  EXPECT_EQ(stats.bytes_dropped, 1);
+  EXPECT_EQ(stats.burst_bytes_dropped, 0);
+}
+
+TEST_F(ChannelSimTest, BurstLoss) {
+  // bursts with a mean length of 10 bytes, which start once every ~1000 bytes
+  sonar_channel_sim_config_t config = {};
+  config.burst_start_rate = 0.001;
+  config.burst_end_rate = 0.1;
+  config.seed = 1;
+  std::vector<bool> delivered[2];
+  for (std::vector<bool>& result : delivered) {
+    InitChannel(config);
+    for (int i = 0; i < 100000; i++) {
+      sonar_channel_sim_write(m_channel, CLIENT_TO_SERVER, 0, 0);
+      result.push_back(!Read(CLIENT_TO_SERVER, 0).empty());
+    }
+  }
+  // the same seed should give the same results
+  EXPECT_EQ(delivered[0], delivered[1]);
+
+  sonar_channel_sim_stats_t stats;
+  sonar_channel_sim_get_stats(m_channel, CLIENT_TO_SERVER, &stats);
+  EXPECT_EQ(stats.bytes_dropped, stats.burst_bytes_dropped);
+  EXPECT_GT(stats.bytes_dropped, 500);
+  EXPECT_LT(stats.bytes_dropped, 2000);
+  // the losses should be grouped into bursts
+  int num_bursts = 0;
+  for (size_t i = 1; i < delivered[0].size(); i++) {
+    if (delivered[0][i - 1] && !delivered[0][i]) {
+      num_bursts++;
+    }
+  }
+  EXPECT_GT(num_bursts, 0);
+  EXPECT_GT((double)stats.bytes_dropped / num_bursts, 5.0);
+}
+
+TEST_F(ChannelSimTest, QueueOverflow) {
+  sonar_channel_sim_config_t config = {};
+  config.latency_us = 1000;
+  InitChannel(config);
+  for (int i = 0; i < 1025; i++) {
+    sonar_channel_sim_write(m_channel, CLIENT_TO_SERVER, (uint8_t)i, 0);
+  }
+  sonar_channel_sim_stats_t stats;
+  sonar_channel_sim_get_stats(m_channel, CLIENT_TO_SERVER, &stats);
+  EXPECT_EQ(stats.queue_overflows, 1);
+  EXPECT_EQ(Read(CLIENT_TO_SERVER, 1000).size(), 256);
+}
+
+TEST_F(ChannelSimTest, ClientServer) {
+  // a lossy 115200 baud link should still complete requests by retrying them
+  sonar_channel_sim_config_t config = {};
+  config.bit_error_rate = 0.0001;
+  config.byte_drop_rate = 0.002;
+  config.latency_us = 2000;
+  config.baud_rate = 115200;
+  config.seed = 1;
+  InitChannel(config);
+  InitClient(CLIENT_TEST_ATTR);
+  InitServer(SERVER_TEST_ATTR);
+  Run(100000);
+  ASSERT_TRUE(sonar_client_is_connected(m_client));
+  ASSERT_TRUE(sonar_server_is_connected(m_server));
+
+  const int kNumReads = 200;
+  for (int i = 0; i < kNumReads; i++) {
+    ASSERT_TRUE(sonar_client_read(m_client, CLIENT_TEST_ATTR));
+    for (int j = 0; j < 2000 && m_num_read_complete == i; j++) {
+      Run(tick_us_);
+    }
+    ASSERT_EQ(m_num_read_complete, i + 1);
+  }
+  EXPECT_EQ(m_num_read_success, kNumReads);
+
+  sonar_errors_t errors;
+  sonar_client_get_and_clear_errors(m_client, &errors);
+  EXPECT_GT(errors.link_layer.retries, 0);
+  uint32_t bytes_dropped = 0;
+  uint32_t bits_flipped = 0;
+  for (sonar_channel_sim_dir_t dir : {CLIENT_TO_SERVER, SERVER_TO_CLIENT}) {
+    sonar_channel_sim_stats_t stats;
+    sonar_channel_sim_get_stats(m_channel, dir, &stats);
+    bytes_dropped += stats.bytes_dropped;
+    bits_flipped += stats.bits_flipped;
+  }
+  EXPECT_GT(bytes_dropped, 0);
+  EXPECT_GT(bits_flipped, 0);
+}
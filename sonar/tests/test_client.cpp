@@ -147,4 +147,13 @@ TEST_F(ClientTest, Full) {
   m_attr_num_notify = 0;
   // expect a response
   EXPECT_WRITE_PACKET(0x11, 0x00);
+
+#if SONAR_ATTR_CACHE
+  // the notify data should now be cached
+  const void* cached_data;
+  uint32_t cached_length;
+  EXPECT_TRUE(sonar_client_read_cached(handle_, TEST_ATTR, 0, &cached_data, &cached_length));
+  EXPECT_EQ(cached_length, sizeof(uint32_t));
+  EXPECT_EQ(*(const uint32_t*)cached_data, 0xbb99aa88);
+#endif
 }
@@ -4,11 +4,17 @@
 
 extern "C" {
 
+#include "anchor/sonar/client.h"
+#include "anchor/sonar/server.h"
+#include "anchor/sonar/host/channel_sim.h"
 #include "src/common/buffer_chain.h"
 #include "src/common/crc16.h"
 
 };
 
+#define CLIENT_TO_SERVER SONAR_CHANNEL_SIM_DIR_A_TO_B
+#define SERVER_TO_CLIENT SONAR_CHANNEL_SIM_DIR_B_TO_A
+
 #define BUILD_PACKET_BUFFER(NAME, ...) \
   const uint8_t NAME##_data[] = {__VA_ARGS__}; \
   uint8_t NAME[sizeof(NAME##_data) + 4]; \
@@ -45,3 +51,120 @@ static std::vector<uint8_t> buffer_chain_to_vector(const buffer_chain_entry_t* d
   }
   return result;
 }
+
+// Base fixture for suites which run a client and a server against each other over a simulated channel. The suite
+// defines the objects (so that it controls their sizes) and overrides the handlers for the callbacks it cares about.
+class ClientServerTest : public ::testing::Test {
+ protected:
+  ClientServerTest(sonar_channel_sim_handle_t channel, sonar_client_handle_t client, sonar_server_handle_t server) :
+      channel_(channel), client_(client), server_(server) {}
+
+  void SetUp() override {
+    Active() = this;
+    time_us_ = 0;
+  }
+
+  void TearDown() override {
+    Active() = nullptr;
+  }
+
+  void InitChannel(const sonar_channel_sim_config_t& config) {
+    sonar_channel_sim_init(channel_, &config);
+  }
+
+  void InitClient(sonar_attribute_t attr) {
+    const sonar_client_init_t init_client = {
+      .write_byte = client_write_byte,
+      .get_system_time_ms = get_system_time_ms,
+      .connection_changed_callback = client_connection_changed_callback,
+      .attribute_read_complete_handler = client_read_complete_handler,
+      .attribute_write_complete_handler = client_write_complete_handler,
+      .attribute_notify_handler = client_notify_handler,
+    };
+    sonar_client_init(client_, &init_client);
+    sonar_client_register(client_, attr);
+  }
+
+  // The attribute is optional
+  void InitServer(sonar_server_attribute_t attr) {
+    const sonar_server_init_t init_server = {
+      .write_byte = server_write_byte,
+      .get_system_time_ms = get_system_time_ms,
+      .connection_changed_callback = server_connection_changed_callback,
+      .attribute_notify_complete_handler = server_notify_complete_handler,
+    };
+    sonar_server_init(server_, &init_server);
+    if (attr) {
+      sonar_server_register(server_, attr);
+    }
+  }
+
+  // Advances the simulated time in steps of tick_us_, passing any delivered bytes to the client and server (or
+  // dropping the ones from the server)
+  void Run(uint64_t duration_us, bool drop_server_data = false) {
+    const uint64_t end_time_us = time_us_ + duration_us;
+    while (time_us_ < end_time_us) {
+      time_us_ += tick_us_;
+      uint8_t buffer[256];
+      const uint32_t client_length = sonar_channel_sim_read(channel_, SERVER_TO_CLIENT, time_us_, buffer, sizeof(buffer));
+      sonar_client_process(client_, buffer, drop_server_data ? 0 : client_length);
+      const uint32_t server_length = sonar_channel_sim_read(channel_, CLIENT_TO_SERVER, time_us_, buffer, sizeof(buffer));
+      sonar_server_process(server_, buffer, server_length);
+      OnTick();
+    }
+  }
+
+  // Handlers for the client / server callbacks
+  virtual void OnTick() {}
+  virtual void OnReadComplete(bool success, const void* data, uint32_t length) {}
+  virtual void OnWriteComplete(bool success) {}
+  virtual bool OnNotify(sonar_attribute_t attr, const void* data, uint32_t length) { return false; }
+  virtual void OnNotifyComplete(bool success) {}
+
+  static uint64_t get_system_time_ms(void) {
+    return Active()->time_us_ / 1000;
+  }
+
+  sonar_channel_sim_handle_t channel_;
+  sonar_client_handle_t client_;
+  sonar_server_handle_t server_;
+  uint64_t time_us_ = 0;
+  uint64_t tick_us_ = 100;
+
+ private:
+  // The callbacks don't take a context, so they go through the fixture of the test which is running
+  static ClientServerTest*& Active() {
+    static ClientServerTest* active = nullptr;
+    return active;
+  }
+
+  static void client_write_byte(uint8_t byte) {
+    sonar_channel_sim_write(Active()->channel_, CLIENT_TO_SERVER, byte, Active()->time_us_);
+  }
+
+  static void server_write_byte(uint8_t byte) {
+    sonar_channel_sim_write(Active()->channel_, SERVER_TO_CLIENT, byte, Active()->time_us_);
+  }
+
+  static void client_connection_changed_callback(bool connected) {
+  }
+
+  static void client_read_complete_handler(bool success, const void* data, uint32_t length) {
+    Active()->OnReadComplete(success, data, length);
+  }
+
+  static void client_write_complete_handler(bool success) {
+    Active()->OnWriteComplete(success);
+  }
+
+  static bool client_notify_handler(sonar_attribute_t attr, const void* data, uint32_t length) {
+    return Active()->OnNotify(attr, data, length);
+  }
+
+  static void server_connection_changed_callback(sonar_server_handle_t handle, bool connected) {
+  }
+
+  static void server_notify_complete_handler(sonar_server_handle_t handle, bool success) {
+    Active()->OnNotifyComplete(success);
+  }
+};
@@ -0,0 +1,243 @@
+#include "gtest/gtest.h"
+
+#include "anchor/sonar/host/coroutine.hpp"
+
+#include <memory>
+#include <vector>
+
+extern "C" {
+
+#include "anchor/sonar/server.h"
+
+};
+
+SONAR_SERVER_DEF(m_server, 64);
+// the C++ tests can only define server attributes which have both read and write handlers
+SONAR_SERVER_ATTR_DEF(ConfigAttr, SERVER_CONFIG_ATTR, 0x100, sizeof(uint32_t), RW);
+SONAR_SERVER_ATTR_DEF(ModeAttr, SERVER_MODE_ATTR, 0x101, sizeof(uint32_t), RW);
+SONAR_SERVER_ATTR_DEF(EventAttr, SERVER_EVENT_ATTR, 0x102, sizeof(uint32_t), RWN);
+
+static std::vector<uint8_t> m_client_write_data;
+static std::vector<uint8_t> m_server_write_data;
+static uint32_t m_config_value;
+static uint32_t m_mode_value;
+static int m_num_mode_write;
+static uint64_t m_system_time;
+
+static uint64_t get_system_time_ms(void) {
+  return m_system_time;
+}
+
+static void server_write_byte(uint8_t byte) {
+  m_server_write_data.push_back(byte);
+}
+
+static void server_connection_changed_callback(sonar_server_handle_t handle, bool connected) {
+}
+
+static void server_notify_complete_handler(sonar_server_handle_t handle, bool success) {
+}
+
+static uint32_t ConfigAttr_read_handler(void* response_data, uint32_t response_max_size) {
+  memcpy(response_data, &m_config_value, sizeof(m_config_value));
+  return sizeof(m_config_value);
+}
+
+static bool ConfigAttr_write_handler(const void* data, uint32_t length) {
+  return false;
+}
+
+static uint32_t ModeAttr_read_handler(void* response_data, uint32_t response_max_size) {
+  return 0;
+}
+
+static bool EventAttr_write_handler(const void* data, uint32_t length) {
+  return false;
+}
+
+static uint32_t EventAttr_read_handler(void* response_data, uint32_t response_max_size) {
+  return 0;
+}
+
+static bool ModeAttr_write_handler(const void* data, uint32_t length) {
+  m_num_mode_write++;
+  memcpy(&m_mode_value, data, sizeof(m_mode_value));
+  return true;
+}
+
+using TestClient = sonar::CoroutineClient<64>;
+
+class CoroutineClientTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    m_client_write_data.clear();
+    m_server_write_data.clear();
+    m_config_value = 0x1234;
+    m_mode_value = 0;
+    m_num_mode_write = 0;
+    m_system_time = 0;
+    const sonar_server_init_t init_server = {
+      .write_byte = server_write_byte,
+      .get_system_time_ms = get_system_time_ms,
+      .connection_changed_callback = server_connection_changed_callback,
+      .attribute_notify_complete_handler = server_notify_complete_handler,
+    };
+    sonar_server_init(m_server, &init_server);
+    sonar_server_register(m_server, SERVER_CONFIG_ATTR);
+    sonar_server_register(m_server, SERVER_MODE_ATTR);
+    sonar_server_register(m_server, SERVER_EVENT_ATTR);
+
+    client_.reset(new TestClient([](uint8_t byte) { m_client_write_data.push_back(byte); }, get_system_time_ms));
+    client_->register_attr(config_attr_);
+    client_->register_attr(mode_attr_);
+    client_->register_attr(event_attr_);
+    Process(5);
+    ASSERT_TRUE(client_->is_connected());
+  }
+
+  void Process(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+      m_system_time += 10;
+      std::vector<uint8_t> data;
+      data.swap(m_server_write_data);
+      client_->process(data.data(), data.size());
+      data.clear();
+      data.swap(m_client_write_data);
+      sonar_server_process(m_server, data.data(), data.size());
+    }
+  }
+
+  void Notify(uint32_t value) {
+    EXPECT_TRUE(sonar_server_notify(m_server, SERVER_EVENT_ATTR, &value, sizeof(value)));
+  }
+
+  // declared before the client so they're destroyed after any tasks which use them
+  sonar::Attribute<uint32_t> config_attr_{0x100, SONAR_ATTRIBUTE_OPS_RW};
+  sonar::Attribute<uint32_t> mode_attr_{0x101, SONAR_ATTRIBUTE_OPS_RW};
+  sonar::Attribute<uint32_t> event_attr_{0x102, SONAR_ATTRIBUTE_OPS_RWN};
+  std::unique_ptr<TestClient> client_;
+};
+
+static sonar::Task<uint32_t> ReadConfig(TestClient& client, sonar::Attribute<uint32_t>& attr) {
+  const sonar::ReadResult<uint32_t> result = co_await client.read(attr);
+  co_return result.success ? result.value : 0;
+}
+
+static sonar::Task<> DeviceScript(TestClient& client, sonar::Attribute<uint32_t>& config_attr,
+    sonar::Attribute<uint32_t>& mode_attr, sonar::Attribute<uint32_t>& event_attr, uint32_t* event) {
+  const uint32_t config = co_await ReadConfig(client, config_attr);
+  EXPECT_TRUE(co_await client.write(mode_attr, config + 1));
+  *event = co_await client.next_notify(event_attr);
+}
+
+TEST_F(CoroutineClientTest, Script) {
+  uint32_t event = 0;
+  sonar::Task<> task = DeviceScript(*client_, config_attr_, mode_attr_, event_attr_, &event);
+  task.start();
+  Process(5);
+  EXPECT_EQ(m_num_mode_write, 1);
+  EXPECT_EQ(m_mode_value, 0x1235);
+  EXPECT_FALSE(task.done());
+
+  Notify(0xabcd);
+  Process(2);
+  ASSERT_TRUE(task.done());
+  task.result();
+  EXPECT_EQ(event, 0xabcd);
+  // the frames should have all come from the client's arena
+  EXPECT_GT(client_->coroutine_arena().used(), 0);
+  EXPECT_EQ(client_->coroutine_arena().num_heap_allocations(), 0);
+}
+
+static sonar::Task<> WriteLoop(TestClient& client, sonar::Attribute<uint32_t>& attr, uint32_t value, int count,
+    int* num_success) {
+  for (int i = 0; i < count; i++) {
+    if (co_await client.write(attr, value)) {
+      (*num_success)++;
+    }
+  }
+}
+
+TEST_F(CoroutineClientTest, ConcurrentScripts) {
+  // the requests from all the tasks should be queued and sent one at a time
+  const int kNumTasks = 50;
+  int num_success = 0;
+  std::vector<sonar::Task<>> tasks;
+  for (int i = 0; i < kNumTasks; i++) {
+    tasks.push_back(WriteLoop(*client_, mode_attr_, i, 2, &num_success));
+    tasks.back().start();
+  }
+  for (int i = 0; i < kNumTasks * 2 * 2 && num_success < kNumTasks * 2; i++) {
+    Process(1);
+  }
+  EXPECT_EQ(num_success, kNumTasks * 2);
+  EXPECT_EQ(m_num_mode_write, kNumTasks * 2);
+  for (sonar::Task<>& task : tasks) {
+    EXPECT_TRUE(task.done());
+  }
+
+  // the frames should be reused once the tasks are destroyed
+  const size_t used = client_->coroutine_arena().used();
+  tasks.clear();
+  for (int i = 0; i < kNumTasks; i++) {
+    tasks.push_back(WriteLoop(*client_, mode_attr_, i, 1, &num_success));
+  }
+  EXPECT_EQ(client_->coroutine_arena().used(), used);
+  EXPECT_EQ(client_->coroutine_arena().num_heap_allocations(), 0);
+}
+
+TEST_F(CoroutineClientTest, Notify) {
+  // every waiting coroutine should get the notify
+  uint32_t events[3] = {};
+  auto wait = [](TestClient& client, sonar::Attribute<uint32_t>& attr, uint32_t* event) -> sonar::Task<> {
+    *event = co_await client.next_notify(attr);
+  };
+  std::vector<sonar::Task<>> tasks;
+  for (uint32_t& event : events) {
+    tasks.push_back(wait(*client_, event_attr_, &event));
+    tasks.back().start();
+  }
+  // destroying a waiting task should remove it
+  tasks.pop_back();
+  Notify(0x55);
+  Process(2);
+  EXPECT_EQ(events[0], 0x55);
+  EXPECT_EQ(events[1], 0x55);
+  EXPECT_EQ(events[2], 0);
+}
+
+TEST_F(CoroutineClientTest, CancelRequest) {
+  int num_success = 0;
+  sonar::Task<> task1 = WriteLoop(*client_, mode_attr_, 1, 1, &num_success);
+  sonar::Task<> task2 = WriteLoop(*client_, mode_attr_, 2, 1, &num_success);
+  sonar::Task<> task3 = WriteLoop(*client_, mode_attr_, 3, 1, &num_success);
+  task1.start();
+  task2.start();
+  task3.start();
+  // destroy the task whose request is in flight along with one which is queued
+  task1 = WriteLoop(*client_, mode_attr_, 4, 0, &num_success);
+  task2 = WriteLoop(*client_, mode_attr_, 5, 0, &num_success);
+  Process(5);
+  EXPECT_TRUE(task3.done());
+  EXPECT_EQ(num_success, 1);
+  EXPECT_EQ(m_mode_value, 3);
+}
+
+// this doesn't take the client as its first argument, so the frame comes from the heap rather than the arena
+static sonar::Task<> HeapWrite(TestClient* client, sonar::Attribute<uint32_t>& attr, uint32_t value) {
+  co_await client->write(attr, value);
+}
+
+TEST_F(CoroutineClientTest, CancelRequestHeapFrame) {
+  // the response to a request whose coroutine was destroyed shouldn't touch the freed frame
+  sonar::Task<> task = HeapWrite(client_.get(), mode_attr_, 1);
+  task.start();
+  task = HeapWrite(client_.get(), mode_attr_, 2);
+  Process(5);
+  EXPECT_EQ(m_mode_value, 1);
+  task.start();
+  Process(5);
+  EXPECT_TRUE(task.done());
+  EXPECT_EQ(m_mode_value, 2);
+  EXPECT_EQ(client_->coroutine_arena().used(), 0);
+}
@@ -0,0 +1,231 @@
+#include "gtest/gtest.h"
+
+#include "anchor/sonar/host/client.hpp"
+
+#include <memory>
+#include <vector>
+
+extern "C" {
+
+#include "anchor/sonar/server.h"
+
+};
+
+#define NUM_SESSIONS 2
+
+struct TestValue {
+  uint32_t a;
+  uint16_t b;
+};
+
+SONAR_SERVER_DEF(m_server0, 64);
+SONAR_SERVER_DEF(m_server1, 64);
+SONAR_SERVER_ATTR_DEF(TestAttr, SERVER0_TEST_ATTR, 0x100, sizeof(TestValue), RWN);
+SONAR_SERVER_ATTR_DEF(TestAttr, SERVER1_TEST_ATTR, 0x100, sizeof(TestValue), RWN);
+
+static const sonar_server_handle_t m_servers[NUM_SESSIONS] = {m_server0, m_server1};
+static const sonar_server_attribute_t m_server_attrs[NUM_SESSIONS] = {SERVER0_TEST_ATTR, SERVER1_TEST_ATTR};
+static std::vector<uint8_t> m_client_write_data[NUM_SESSIONS];
+static std::vector<uint8_t> m_server_write_data[NUM_SESSIONS];
+// the server which is currently being called into
+static int m_active_server;
+static TestValue m_attr_value;
+static int m_num_notify_complete;
+static uint64_t m_system_time;
+
+static uint64_t get_system_time_ms(void) {
+  return m_system_time;
+}
+
+static void server_write_byte(uint8_t byte) {
+  m_server_write_data[m_active_server].push_back(byte);
+}
+
+static void server_connection_changed_callback(sonar_server_handle_t handle, bool connected) {
+}
+
+static void server_notify_complete_handler(sonar_server_handle_t handle, bool success) {
+  m_num_notify_complete++;
+}
+
+static bool TestAttr_write_handler(const void* data, uint32_t length) {
+  if (length != sizeof(m_attr_value)) {
+    return false;
+  }
+  memcpy(&m_attr_value, data, sizeof(m_attr_value));
+  return true;
+}
+
+static uint32_t TestAttr_read_handler(void* response_data, uint32_t response_max_size) {
+  memcpy(response_data, &m_attr_value, sizeof(m_attr_value));
+  return sizeof(m_attr_value);
+}
+
+using TestClient = sonar::Client<64, 4>;
+
+class CppClientTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    m_system_time = 0;
+    m_attr_value = {};
+    m_num_notify_complete = 0;
+    for (int i = 0; i < NUM_SESSIONS; i++) {
+      m_client_write_data[i].clear();
+      m_server_write_data[i].clear();
+      m_active_server = i;
+      const sonar_server_init_t init_server = {
+        .write_byte = server_write_byte,
+        .get_system_time_ms = get_system_time_ms,
+        .connection_changed_callback = server_connection_changed_callback,
+        .attribute_notify_complete_handler = server_notify_complete_handler,
+      };
+      sonar_server_init(m_servers[i], &init_server);
+      sonar_server_register(m_servers[i], m_server_attrs[i]);
+
+      // each client writes into its own buffer via a capturing lambda
+      std::vector<uint8_t>* write_data = &m_client_write_data[i];
+      clients_[i].reset(new TestClient([write_data](uint8_t byte) { write_data->push_back(byte); },
+          get_system_time_ms, [this, i](bool connected) { num_connection_changed_[i]++; }));
+      attrs_[i].reset(new sonar::Attribute<TestValue>(0x100, SONAR_ATTRIBUTE_OPS_RWN));
+      clients_[i]->register_attr(*attrs_[i]);
+    }
+  }
+
+  void Process(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+      m_system_time += 10;
+      for (int j = 0; j < NUM_SESSIONS; j++) {
+        std::vector<uint8_t> data;
+        data.swap(m_server_write_data[j]);
+        clients_[j]->process(data.data(), data.size());
+        data.clear();
+        data.swap(m_client_write_data[j]);
+        m_active_server = j;
+        sonar_server_process(m_servers[j], data.data(), data.size());
+      }
+    }
+  }
+
+  void Connect() {
+    Process(5);
+    for (int i = 0; i < NUM_SESSIONS; i++) {
+      ASSERT_TRUE(clients_[i]->is_connected());
+      ASSERT_TRUE(sonar_server_is_connected(m_servers[i]));
+      EXPECT_EQ(num_connection_changed_[i], 1);
+    }
+  }
+
+  std::unique_ptr<TestClient> clients_[NUM_SESSIONS];
+  std::unique_ptr<sonar::Attribute<TestValue>> attrs_[NUM_SESSIONS];
+  int num_connection_changed_[NUM_SESSIONS] = {};
+};
+
+TEST_F(CppClientTest, Callbacks) {
+  Connect();
+
+  // write from one session and read it back from both of them
+  const TestValue value = {.a = 0x11223344, .b = 0x5566};
+  int num_write_complete = 0;
+  EXPECT_TRUE(clients_[0]->write(*attrs_[0], value, [&](bool success) {
+    EXPECT_TRUE(success);
+    num_write_complete++;
+  }));
+  EXPECT_TRUE(clients_[0]->is_request_pending());
+  // only one request can be pending at a time
+  EXPECT_FALSE(clients_[0]->read(*attrs_[0], [](bool success, const TestValue& read_value) {}));
+  Process(2);
+  EXPECT_EQ(num_write_complete, 1);
+  EXPECT_FALSE(clients_[0]->is_request_pending());
+  EXPECT_EQ(m_attr_value.a, value.a);
+  EXPECT_EQ(m_attr_value.b, value.b);
+
+  int num_read_complete = 0;
+  for (int i = 0; i < NUM_SESSIONS; i++) {
+    EXPECT_TRUE(clients_[i]->read(*attrs_[i], [&](bool success, const TestValue& read_value) {
+      EXPECT_TRUE(success);
+      EXPECT_EQ(read_value.a, value.a);
+      EXPECT_EQ(read_value.b, value.b);
+      num_read_complete++;
+    }));
+  }
+  Process(2);
+  EXPECT_EQ(num_read_complete, NUM_SESSIONS);
+}
+
+TEST_F(CppClientTest, ChainedRequests) {
+  Connect();
+
+  // a completion callback should be able to issue the next request
+  int num_read_complete = 0;
+  std::function<void(bool, const TestValue&)> on_read = [&](bool success, const TestValue& value) {
+    EXPECT_TRUE(success);
+    if (++num_read_complete < 3) {
+      EXPECT_TRUE(clients_[0]->read(*attrs_[0], on_read));
+    }
+  };
+  EXPECT_TRUE(clients_[0]->read(*attrs_[0], on_read));
+  Process(10);
+  EXPECT_EQ(num_read_complete, 3);
+}
+
+TEST_F(CppClientTest, Futures) {
+  Connect();
+
+  const TestValue value = {.a = 0xaabbccdd, .b = 0xeeff};
+  std::future<bool> write_future = clients_[1]->write(*attrs_[1], value);
+  ASSERT_TRUE(write_future.valid());
+  EXPECT_EQ(write_future.wait_for(std::chrono::seconds(0)), std::future_status::timeout);
+  // a request can't be sent while another is pending
+  EXPECT_FALSE(clients_[1]->read(*attrs_[1]).valid());
+  Process(2);
+  ASSERT_EQ(write_future.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+  EXPECT_TRUE(write_future.get());
+
+  for (int i = 0; i < 10; i++) {
+    std::future<sonar::ReadResult<TestValue>> read_future = clients_[1]->read(*attrs_[1]);
+    ASSERT_TRUE(read_future.valid());
+    Process(2);
+    const sonar::ReadResult<TestValue> result = read_future.get();
+    EXPECT_TRUE(result.success);
+    EXPECT_EQ(result.value.a, value.a);
+    EXPECT_EQ(result.value.b, value.b);
+  }
+  // the futures' shared state should have come from the pool
+  EXPECT_EQ(clients_[1]->num_future_heap_allocations(), 0);
+}
+
+TEST_F(CppClientTest, FutureBrokenOnDestroy) {
+  Connect();
+
+  std::future<sonar::ReadResult<TestValue>> read_future = clients_[0]->read(*attrs_[0]);
+  ASSERT_TRUE(read_future.valid());
+  // destroying the client with a request pending should break the promise
+  clients_[0].reset();
+  // getting the result releases the future's shared state back to the pool after the client is gone
+  EXPECT_THROW(read_future.get(), std::future_error);
+}
+
+TEST_F(CppClientTest, Notify) {
+  Connect();
+
+  int num_notify[NUM_SESSIONS] = {};
+  TestValue notify_value = {};
+  for (int i = 0; i < NUM_SESSIONS; i++) {
+    attrs_[i]->set_notify_handler([&num_notify, &notify_value, i](const TestValue& value) {
+      num_notify[i]++;
+      notify_value = value;
+      return true;
+    });
+  }
+
+  // only the second session should get the notify
+  const TestValue value = {.a = 0x01020304, .b = 0x0506};
+  m_active_server = 1;
+  EXPECT_TRUE(sonar_server_notify(m_server1, SERVER1_TEST_ATTR, &value, sizeof(value)));
+  Process(2);
+  EXPECT_EQ(num_notify[0], 0);
+  EXPECT_EQ(num_notify[1], 1);
+  EXPECT_EQ(notify_value.a, value.a);
+  EXPECT_EQ(notify_value.b, value.b);
+  EXPECT_EQ(m_num_notify_complete, 1);
+}
@@ -0,0 +1,167 @@
+#include "gtest/gtest.h"
+
+// NOTE: This file is built with SONAR_CPP_NANOPB=1 against the nanopb stand-in within nanopb/
+#include "anchor/sonar/host/client.hpp"
+
+#include <memory>
+#include <vector>
+
+extern "C" {
+
+#include "anchor/sonar/server.h"
+
+};
+
+// What the nanopb generator would produce for a message
+typedef struct {
+  uint32_t id;
+  int32_t value;
+} TestMsg;
+static const pb_msgdesc_t TestMsg_msg = {sizeof(TestMsg)};
+#define TestMsg_msgid 0x100
+#define TestMsg_size (2 + sizeof(TestMsg))
+#define TestMsg_ops RWN
+
+namespace nanopb {
+
+template <>
+struct MessageDescriptor<TestMsg> {
+  static const pb_msgdesc_t* fields() { return &TestMsg_msg; }
+};
+
+}  // namespace nanopb
+
+SONAR_SERVER_DEF(m_server, 64);
+SONAR_SERVER_ATTR_DEF(TestAttr, SERVER_TEST_ATTR, TestMsg_msgid, TestMsg_size, RWN);
+
+static std::vector<uint8_t> m_client_write_data;
+static std::vector<uint8_t> m_server_write_data;
+// the encoded value of the attribute on the server
+static std::vector<uint8_t> m_attr_data;
+static uint64_t m_system_time;
+
+static uint64_t get_system_time_ms(void) {
+  return m_system_time;
+}
+
+static void server_write_byte(uint8_t byte) {
+  m_server_write_data.push_back(byte);
+}
+
+static void server_connection_changed_callback(sonar_server_handle_t handle, bool connected) {
+}
+
+static void server_notify_complete_handler(sonar_server_handle_t handle, bool success) {
+}
+
+static bool TestAttr_write_handler(const void* data, uint32_t length) {
+  m_attr_data.assign((const uint8_t*)data, (const uint8_t*)data + length);
+  return true;
+}
+
+static uint32_t TestAttr_read_handler(void* response_data, uint32_t response_max_size) {
+  memcpy(response_data, m_attr_data.data(), m_attr_data.size());
+  return m_attr_data.size();
+}
+
+static std::vector<uint8_t> Encode(const TestMsg& msg) {
+  uint8_t buffer[TestMsg_size];
+  pb_ostream_t stream = pb_ostream_from_buffer(buffer, sizeof(buffer));
+  EXPECT_TRUE(pb_encode(&stream, &TestMsg_msg, &msg));
+  return std::vector<uint8_t>(buffer, buffer + stream.bytes_written);
+}
+
+using TestClient = sonar::Client<64, 4>;
+
+class CppNanopbTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    m_system_time = 0;
+    m_client_write_data.clear();
+    m_server_write_data.clear();
+    m_attr_data.clear();
+    const sonar_server_init_t init_server = {
+      .write_byte = server_write_byte,
+      .get_system_time_ms = get_system_time_ms,
+      .connection_changed_callback = server_connection_changed_callback,
+      .attribute_notify_complete_handler = server_notify_complete_handler,
+    };
+    sonar_server_init(m_server, &init_server);
+    sonar_server_register(m_server, SERVER_TEST_ATTR);
+
+    client_.reset(new TestClient([](uint8_t byte) { m_client_write_data.push_back(byte); }, get_system_time_ms,
+        [](bool connected) {}));
+    client_->register_attr(attr_);
+  }
+
+  void Process(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+      m_system_time += 10;
+      std::vector<uint8_t> data;
+      data.swap(m_server_write_data);
+      client_->process(data.data(), data.size());
+      data.clear();
+      data.swap(m_client_write_data);
+      sonar_server_process(m_server, data.data(), data.size());
+    }
+  }
+
+  void Connect() {
+    Process(5);
+    ASSERT_TRUE(client_->is_connected());
+    ASSERT_TRUE(sonar_server_is_connected(m_server));
+  }
+
+  std::unique_ptr<TestClient> client_;
+  SONAR_CPP_PROTO_ATTR_DEF(TestMsg, attr_);
+};
+
+TEST_F(CppNanopbTest, ReadWriteNotify) {
+  Connect();
+  EXPECT_EQ(attr_.get()->attribute_id, TestMsg_msgid);
+  EXPECT_EQ(attr_.get()->max_size, TestMsg_size);
+  EXPECT_EQ(attr_.get()->ops, SONAR_ATTRIBUTE_OPS_RWN);
+
+  // the write should be encoded
+  const TestMsg write_value = {.id = 1, .value = -1234};
+  bool write_success = false;
+  EXPECT_TRUE(client_->write(attr_, write_value, [&](bool success) { write_success = success; }));
+  Process(2);
+  EXPECT_TRUE(write_success);
+  EXPECT_EQ(m_attr_data, Encode(write_value));
+
+  // the read response should be decoded
+  const TestMsg read_value = {.id = 2, .value = 5678};
+  m_attr_data = Encode(read_value);
+  bool read_success = false;
+  TestMsg value = {};
+  EXPECT_TRUE(client_->read(attr_, [&](bool success, const TestMsg& response) {
+    read_success = success;
+    value = response;
+  }));
+  Process(2);
+  EXPECT_TRUE(read_success);
+  EXPECT_EQ(value.id, read_value.id);
+  EXPECT_EQ(value.value, read_value.value);
+
+  // the notify should be decoded
+  int num_notify = 0;
+  attr_.set_notify_handler([&](const TestMsg& notify_value) {
+    num_notify++;
+    value = notify_value;
+    return true;
+  });
+  const TestMsg notify_value = {.id = 3, .value = 42};
+  const std::vector<uint8_t> notify_data = Encode(notify_value);
+  EXPECT_TRUE(sonar_server_notify(m_server, SERVER_TEST_ATTR, notify_data.data(), notify_data.size()));
+  Process(2);
+  EXPECT_EQ(num_notify, 1);
+  EXPECT_EQ(value.id, notify_value.id);
+  EXPECT_EQ(value.value, notify_value.value);
+
+  // a notify which doesn't decode shouldn't be passed to the handler
+  const uint8_t invalid_data[TestMsg_size] = {};
+  EXPECT_TRUE(sonar_server_notify(m_server, SERVER_TEST_ATTR, invalid_data, sizeof(invalid_data)));
+  Process(2);
+  EXPECT_EQ(num_notify, 1);
+}
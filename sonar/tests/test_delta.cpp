@@ -0,0 +1,117 @@
+#include "gtest/gtest.h"
+
+extern "C" {
+
+#include "src/common/delta.h"
+
+};
+
+static void encode_and_apply(const std::vector<uint8_t>& base, const std::vector<uint8_t>& data, uint32_t expected_length) {
+  std::vector<uint8_t> buffer = data;
+  buffer.resize(data.size() + 32);
+  const uint32_t encoded_length = delta_get_encoded_length(base.data(), base.size(), data.data(), data.size());
+  EXPECT_EQ(encoded_length, expected_length);
+  EXPECT_EQ(delta_encode(base.data(), base.size(), buffer.data(), data.size()), encoded_length);
+
+  std::vector<uint8_t> result = base;
+  result.resize(64);
+  uint32_t result_length = base.size();
+  EXPECT_TRUE(delta_apply(result.data(), &result_length, result.size(), buffer.data(), encoded_length));
+  result.resize(result_length);
+  EXPECT_EQ(result, data);
+}
+
+TEST(Delta, Unchanged) {
+  const std::vector<uint8_t> base = {1, 2, 3, 4, 5, 6, 7, 8};
+  // just the trailer
+  encode_and_apply(base, base, 4);
+}
+
+TEST(Delta, SingleRange) {
+  const std::vector<uint8_t> base = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+  std::vector<uint8_t> data = base;
+  data[5] = 0xaa;
+  data[6] = 0xbb;
+  encode_and_apply(base, data, 2 + 4 + 4);
+
+  // check the encoding itself
+  uint8_t buffer[16];
+  memcpy(buffer, data.data(), sizeof(buffer));
+  ASSERT_EQ(delta_encode(base.data(), base.size(), buffer, sizeof(buffer)), 10);
+  const uint8_t expected[] = {0xaa, 0xbb, 0x05, 0x00, 0x02, 0x00, 0x10, 0x00};
+  EXPECT_EQ(memcmp(buffer, expected, sizeof(expected)), 0);
+}
+
+TEST(Delta, MergedRanges) {
+  const std::vector<uint8_t> base(32, 0);
+  std::vector<uint8_t> data = base;
+  // separated by a gap of 4 bytes, so merged into a single range
+  data[2] = 1;
+  data[7] = 1;
+  // separated by a gap of 5 bytes, so encoded as a separate range
+  data[13] = 1;
+  encode_and_apply(base, data, (6 + 4) + (1 + 4) + 4);
+}
+
+TEST(Delta, LengthChanged) {
+  const std::vector<uint8_t> base = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+  // grow
+  std::vector<uint8_t> data = base;
+  data.push_back(13);
+  data.push_back(14);
+  encode_and_apply(base, data, 2 + 4 + 4);
+  // shrink
+  data = base;
+  data.resize(6);
+  encode_and_apply(base, data, 4);
+  // empty base
+  encode_and_apply({}, base, base.size() + 4 + 4);
+}
+
+TEST(Delta, BaseMismatch) {
+  const std::vector<uint8_t> base = {1, 2, 3, 4, 5, 6, 7, 8};
+  uint8_t buffer[16] = {1, 2, 3, 0xaa, 5, 6, 7, 8};
+  const uint32_t encoded_length = delta_encode(base.data(), base.size(), buffer, base.size());
+
+  // try to apply it against a different base
+  uint8_t other_base[8] = {8, 7, 6, 5, 4, 3, 2, 1};
+  uint32_t other_base_length = sizeof(other_base);
+  EXPECT_FALSE(delta_apply(other_base, &other_base_length, sizeof(other_base), buffer, encoded_length));
+  EXPECT_EQ(other_base_length, sizeof(other_base));
+  EXPECT_EQ(other_base[3], 5);
+}
+
+TEST(Delta, Invalid) {
+  uint8_t base[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+  uint32_t base_length = sizeof(base);
+  uint8_t delta[sizeof(base) + 16];
+  memcpy(delta, base, sizeof(base));
+  delta[1] = 0xaa;
+  // should be encoded as {0xaa, 0x01, 0x00, 0x01, 0x00, 0x08, 0x00, <crc>}
+  const uint32_t encoded_length = delta_encode(base, sizeof(base), delta, sizeof(base));
+  ASSERT_EQ(encoded_length, 9);
+
+  // too short
+  EXPECT_FALSE(delta_apply(base, &base_length, sizeof(base), delta, 3));
+  // too long for the buffer
+  EXPECT_FALSE(delta_apply(base, &base_length, sizeof(base) - 1, delta, encoded_length));
+  // range which extends past the end of the data
+  delta[3] = 0x09;
+  EXPECT_FALSE(delta_apply(base, &base_length, sizeof(base), delta, encoded_length));
+  // zero-length range
+  delta[3] = 0x00;
+  EXPECT_FALSE(delta_apply(base, &base_length, sizeof(base), delta, encoded_length));
+  // range which is out of bounds
+  delta[3] = 0x01;
+  delta[1] = 0x08;
+  EXPECT_FALSE(delta_apply(base, &base_length, sizeof(base), delta, encoded_length));
+  // nothing should have been modified
+  EXPECT_EQ(base_length, sizeof(base));
+  EXPECT_EQ(base[1], 2);
+
+  // valid
+  delta[1] = 0x01;
+  EXPECT_TRUE(delta_apply(base, &base_length, sizeof(base), delta, encoded_length));
+  EXPECT_EQ(base_length, sizeof(base));
+  EXPECT_EQ(base[1], 0xaa);
+}
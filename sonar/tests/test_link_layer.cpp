@@ -63,6 +63,11 @@ static uint64_t m_system_time_ms;
 static int m_num_connected_callbacks;
 static int m_num_disconnected_callbacks;
 static bool m_should_fail_request;
+static bool m_use_response_writer;
+static int m_num_response_writer_calls;
+static int m_response_writer_fail_after;
+static uint8_t m_response_writer_data[1024];
+static uint32_t m_response_writer_length;
 
 static uint64_t get_system_time_ms_function(void) {
   return m_system_time_ms;
@@ -80,10 +85,28 @@ static void connection_changed_handler(void* handle, bool connected) {
   }
 }
 
+static bool response_writer(void* handle) {
+  m_num_response_writer_calls++;
+  // write the echo'd data back one byte at a time
+  for (uint32_t i = 0; i < m_response_writer_length; i++) {
+    if ((int)i == m_response_writer_fail_after) {
+      return false;
+    }
+    sonar_link_layer_write_response_data((sonar_link_layer_handle_t)handle, &m_response_writer_data[i], 1);
+  }
+  return m_response_writer_fail_after < 0;
+}
+
 static bool request_handler(void* handle, const uint8_t* data, uint32_t length) {
   if (m_should_fail_request) {
     return false;
   }
+  if (m_use_response_writer) {
+    memcpy(m_response_writer_data, data, length);
+    m_response_writer_length = length;
+    sonar_link_layer_set_response_writer((sonar_link_layer_handle_t)handle, response_writer, handle);
+    return true;
+  }
   // echo the data back
   static buffer_chain_entry_t response_buffer_chain;
   static uint8_t response_data[1024];
@@ -138,6 +161,9 @@ class LinkLayerTest : public ::testing::Test {
     m_num_connected_callbacks = 0;
     m_num_disconnected_callbacks = 0;
     m_should_fail_request = false;
+    m_use_response_writer = false;
+    m_num_response_writer_calls = 0;
+    m_response_writer_fail_after = -1;
   }
 
   void TearDown() override {
@@ -255,6 +281,44 @@ TEST_F(LinkLayerServerTest, ResponseRetries) {
   EXPECT_NO_RESPONSE();
 }
 
+TEST_F(LinkLayerServerTest, ResponseWriter) {
+  // connect
+  RECEIVE_HANDLE_DATA(0x14, 0x0b, 0x42);
+  EXPECT_AND_CLEAR_SENT_DATA(0x17, 0x0b);
+  EXPECT_EQ(m_num_connected_callbacks, 1);
+  m_num_connected_callbacks = 0;
+  m_use_response_writer = true;
+
+  // the written response should be the same as if it was set directly
+  RECEIVE_HANDLE_DATA(0x10, 0x0c, 0x77, 0x66, 0x88);
+  EXPECT_AND_CLEAR_SENT_DATA(0x13, 0x0c, 0x77, 0x66, 0x88);
+  EXPECT_EQ(m_num_response_writer_calls, 1);
+  m_num_response_writer_calls = 0;
+
+  // the writer should be called again for retries
+  RECEIVE_HANDLE_DATA(0x10, 0x0c, 0x77, 0x66, 0x88);
+  EXPECT_AND_CLEAR_SENT_DATA(0x13, 0x0c, 0x77, 0x66, 0x88);
+  EXPECT_EQ(m_num_response_writer_calls, 1);
+  m_num_response_writer_calls = 0;
+
+  // nothing should be sent if the writer fails before writing anything
+  m_response_writer_fail_after = 0;
+  RECEIVE_HANDLE_DATA(0x10, 0x0d, 0x33);
+  EXPECT_TRUE(m_sent_data.empty());
+  EXPECT_EQ(m_num_response_writer_calls, 1);
+  m_num_response_writer_calls = 0;
+
+  // the packet should be terminated with an invalid escape sequence if the writer fails part way through
+  m_response_writer_fail_after = 1;
+  RECEIVE_HANDLE_DATA(0x10, 0x0e, 0x44, 0x55);
+  const uint8_t expected_data[] = {0x7e, 0x13, 0x0e, 0x44, 0x7d, 0x7e};
+  EXPECT_TRUE(DataMatches(m_sent_data, expected_data, sizeof(expected_data)));
+  m_sent_data.clear();
+  EXPECT_EQ(m_num_response_writer_calls, 1);
+  m_num_response_writer_calls = 0;
+  EXPECT_NO_RESPONSE();
+}
+
 TEST_F(LinkLayerServerTest, RequestNormal) {
   // need to connect first (also covered by ServerResponse test case)
   RECEIVE_HANDLE_DATA(0x14, 0x0b, 0x42);
@@ -366,6 +430,50 @@ TEST_F(LinkLayerServerTest, RequestRetriesAndTimeout) {
   sonar_link_layer_process(handle_);
 }
 
+TEST_F(LinkLayerServerTest, NextDeadline) {
+  // nothing to do until a client connects
+  EXPECT_EQ(sonar_link_layer_get_next_deadline_ms(handle_), UINT64_MAX);
+
+  // connect and the deadline should be the connection timeout
+  m_system_time_ms = 1000;
+  RECEIVE_HANDLE_DATA(0x14, 0x0b, 0x42);
+  EXPECT_AND_CLEAR_SENT_DATA(0x17, 0x0b);
+  ASSERT_TRUE(sonar_link_layer_is_connected(handle_));
+  m_num_connected_callbacks = 0;
+  EXPECT_EQ(sonar_link_layer_get_next_deadline_ms(handle_), 1000 + CONNECTION_TIMEOUT_MS);
+
+  // send a request and the deadline should be the retry
+  m_system_time_ms += 10;
+  SEND_REQUEST(0xaa);
+  EXPECT_AND_CLEAR_SENT_DATA(0x12, 0x42, 0xaa);
+  EXPECT_EQ(sonar_link_layer_get_next_deadline_ms(handle_), 1010 + REQUEST_RETRY_INTERVAL_MS);
+
+  // the deadline shouldn't change if we process before it
+  m_system_time_ms += REQUEST_RETRY_INTERVAL_MS - 1;
+  sonar_link_layer_process(handle_);
+  EXPECT_TRUE(m_sent_data.empty());
+  EXPECT_EQ(sonar_link_layer_get_next_deadline_ms(handle_), 1010 + REQUEST_RETRY_INTERVAL_MS);
+
+  // process at the deadline and we should retry
+  m_system_time_ms = sonar_link_layer_get_next_deadline_ms(handle_);
+  sonar_link_layer_process(handle_);
+  EXPECT_AND_CLEAR_SENT_DATA(0x12, 0x42, 0xaa);
+  EXPECT_ERRORS(0, 0, 0, 1);
+  EXPECT_EQ(sonar_link_layer_get_next_deadline_ms(handle_), 1010 + REQUEST_RETRY_INTERVAL_MS * 2);
+
+  // get the response and we should go back to the connection timeout
+  RECEIVE_HANDLE_DATA(0x11, 0x42);
+  EXPECT_AND_CLEAR_RESPONSE_DATA();
+  EXPECT_EQ(sonar_link_layer_get_next_deadline_ms(handle_), m_system_time_ms + CONNECTION_TIMEOUT_MS);
+
+  // disconnect
+  m_system_time_ms = sonar_link_layer_get_next_deadline_ms(handle_);
+  sonar_link_layer_process(handle_);
+  EXPECT_FALSE(sonar_link_layer_is_connected(handle_));
+  m_num_disconnected_callbacks = 0;
+  EXPECT_EQ(sonar_link_layer_get_next_deadline_ms(handle_), UINT64_MAX);
+}
+
 TEST_F(LinkLayerClientTest, Connection) {
   ASSERT_FALSE(sonar_link_layer_is_connected(handle_));
 
@@ -409,6 +517,26 @@ TEST_F(LinkLayerClientTest, Connection) {
   m_num_disconnected_callbacks = 0;
 }
 
+TEST_F(LinkLayerClientTest, NextDeadline) {
+  // should try to connect right away
+  m_system_time_ms = 1000;
+  EXPECT_EQ(sonar_link_layer_get_next_deadline_ms(handle_), 0);
+  sonar_link_layer_process(handle_);
+  EXPECT_AND_CLEAR_SENT_DATA(0x14, 0x01, 1000 & 0xff);
+  EXPECT_EQ(sonar_link_layer_get_next_deadline_ms(handle_), 1000 + REQUEST_RETRY_INTERVAL_MS);
+
+  // once connected, the deadline should be the next connection maintenance request
+  m_system_time_ms += 10;
+  RECEIVE_HANDLE_DATA(0x17, 0x01);
+  ASSERT_TRUE(sonar_link_layer_is_connected(handle_));
+  m_num_connected_callbacks = 0;
+  EXPECT_EQ(sonar_link_layer_get_next_deadline_ms(handle_), 1010 + CONNECTION_MAINTENANCE_INTERVAL_MS);
+  m_system_time_ms = sonar_link_layer_get_next_deadline_ms(handle_);
+  sonar_link_layer_process(handle_);
+  EXPECT_AND_CLEAR_SENT_DATA(0x14, 0x02);
+  RECEIVE_HANDLE_DATA(0x17, 0x02);
+}
+
 TEST_F(LinkLayerClientTest, ResponseNormal) {
   // need to connect first (also covered by ClientConnection test case)
   sonar_link_layer_process(handle_);
@@ -0,0 +1,158 @@
+#include "test_common.h"
+
+#include <string>
+#include <vector>
+
+extern "C" {
+
+#include "anchor/sonar/log_stream.h"
+
+};
+
+#define BATCH_SIZE 32
+
+SONAR_CHANNEL_SIM_DEF(m_channel, 1024);
+SONAR_CLIENT_DEF(m_client, 64);
+SONAR_SERVER_DEF(m_server, 64);
+SONAR_LOG_STREAM_DEF(m_log_stream, BATCH_SIZE);
+SONAR_ATTR_DEF(CLIENT_LOG_ATTR, SONAR_LOG_STREAM_ATTR_ID, BATCH_SIZE, N);
+
+static std::vector<std::string> m_notifies;
+
+class LogStreamTest : public ClientServerTest {
+ protected:
+  LogStreamTest() : ClientServerTest(m_channel, m_client, m_server) {}
+
+  void SetUp() override {
+    ClientServerTest::SetUp();
+    m_notifies.clear();
+    InitChannel(config_);
+    InitClient(CLIENT_LOG_ATTR);
+    InitServer(nullptr);
+  }
+
+  bool OnNotify(sonar_attribute_t attr, const void* data, uint32_t length) override {
+    EXPECT_EQ(attr, CLIENT_LOG_ATTR);
+    m_notifies.push_back(std::string((const char*)data, length));
+    return true;
+  }
+
+  void OnTick() override {
+    sonar_log_stream_process(m_log_stream);
+  }
+
+  void Init(uint32_t flush_size, uint32_t flush_age_ms) {
+    const sonar_log_stream_init_t init = {
+      .server = m_server,
+      .get_system_time_ms = get_system_time_ms,
+      .flush_size = flush_size,
+      .flush_age_ms = flush_age_ms,
+    };
+    sonar_log_stream_init(m_log_stream, &init);
+  }
+
+  void Connect() {
+    Run(500 * 1000);
+    ASSERT_TRUE(sonar_client_is_connected(m_client));
+    ASSERT_TRUE(sonar_server_is_connected(m_server));
+  }
+
+  bool Write(const char* str) {
+    return sonar_log_stream_write(m_log_stream, str, strlen(str));
+  }
+
+  sonar_channel_sim_config_t config_ = {};
+};
+
+TEST_F(LogStreamTest, NoAttributeBuffers) {
+  // the notifies are sent directly from the batches
+  EXPECT_EQ(_m_log_stream_attr->request_buffer, nullptr);
+  EXPECT_EQ(_m_log_stream_attr->response_buffer, nullptr);
+#if SONAR_ATTR_DELTA_NOTIFY
+  EXPECT_EQ(_m_log_stream_attr->delta_buffer, nullptr);
+#endif
+}
+
+TEST_F(LogStreamTest, FlushSize) {
+  Init(16, 0);
+  Connect();
+
+  // writes should be buffered until they reach the flush size
+  EXPECT_TRUE(Write("line 1\n"));
+  EXPECT_TRUE(Write("line 2\n"));
+  EXPECT_EQ(sonar_log_stream_get_next_deadline_ms(m_log_stream), UINT64_MAX);
+  Run(10 * 1000);
+  EXPECT_TRUE(m_notifies.empty());
+  EXPECT_TRUE(Write("line 3\n"));
+  EXPECT_LE(sonar_log_stream_get_next_deadline_ms(m_log_stream), get_system_time_ms());
+  Run(10 * 1000);
+  ASSERT_EQ(m_notifies.size(), 1);
+  EXPECT_EQ(m_notifies[0], "line 1\nline 2\nline 3\n");
+
+  // a write should never be split across notifies
+  EXPECT_FALSE(Write("this line is longer than a batch\n"));
+  sonar_log_stream_stats_t stats;
+  sonar_log_stream_get_and_clear_stats(m_log_stream, &stats);
+  EXPECT_EQ(stats.writes, 3);
+  EXPECT_EQ(stats.dropped, 1);
+  EXPECT_EQ(stats.notifies, 1);
+  EXPECT_EQ(stats.busy, 0);
+}
+
+TEST_F(LogStreamTest, FlushAge) {
+  Init(0, 50);
+  Connect();
+
+  // a partial batch should be sent once it's old enough
+  EXPECT_TRUE(Write("line 1\n"));
+  const uint64_t deadline_ms = sonar_log_stream_get_next_deadline_ms(m_log_stream);
+  EXPECT_EQ(deadline_ms, get_system_time_ms() + 50);
+  Run(40 * 1000);
+  EXPECT_TRUE(m_notifies.empty());
+  EXPECT_TRUE(Write("line 2\n"));
+  EXPECT_EQ(sonar_log_stream_get_next_deadline_ms(m_log_stream), deadline_ms);
+  Run(20 * 1000);
+  ASSERT_EQ(m_notifies.size(), 1);
+  EXPECT_EQ(m_notifies[0], "line 1\nline 2\n");
+  EXPECT_EQ(sonar_log_stream_get_next_deadline_ms(m_log_stream), UINT64_MAX);
+}
+
+TEST_F(LogStreamTest, Backpressure) {
+  // at 10000 baud, a full batch takes a few ms to send
+  config_.baud_rate = 10000;
+  InitChannel(config_);
+  Init(8, 0);
+
+  // nothing should be sent until a client connects, and writes should be dropped once the batch is full
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(Write("line 1\n"));
+    sonar_log_stream_process(m_log_stream);
+  }
+  EXPECT_FALSE(Write("line 1\n"));
+  Connect();
+  ASSERT_EQ(m_notifies.size(), 1);
+  EXPECT_EQ(m_notifies[0].size(), 4 * 7);
+
+  // fill the other batch while one is being sent
+  ASSERT_TRUE(Write("line 2\n"));
+  ASSERT_TRUE(Write("line 3\n"));
+  sonar_log_stream_process(m_log_stream);
+  EXPECT_FALSE(sonar_server_can_notify(m_server));
+  EXPECT_EQ(sonar_log_stream_get_next_deadline_ms(m_log_stream), UINT64_MAX);
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(Write("line 4\n"));
+  }
+  EXPECT_FALSE(Write("line 4\n"));
+  sonar_log_stream_process(m_log_stream);
+  Run(100 * 1000);
+  ASSERT_EQ(m_notifies.size(), 3);
+  EXPECT_EQ(m_notifies[1], "line 2\nline 3\n");
+  EXPECT_EQ(m_notifies[2], "line 4\nline 4\nline 4\nline 4\n");
+
+  sonar_log_stream_stats_t stats;
+  sonar_log_stream_get_and_clear_stats(m_log_stream, &stats);
+  EXPECT_EQ(stats.writes, 10);
+  EXPECT_EQ(stats.dropped, 2);
+  EXPECT_EQ(stats.notifies, 3);
+  EXPECT_GT(stats.busy, 0);
+}
@@ -5,10 +5,14 @@
 extern "C" {
 
 #include "anchor/sonar/server.h"
+#include "anchor/sonar/proto_helpers.h"
 #include "src/link_layer/timeouts.h"
+#include "anchor/logging/logging.h"
 
 };
 
+#include <algorithm>
+
 #define PROCESS_RECEIVE_PACKET(...) do { \
     BUILD_PACKET_BUFFER(_buffer, __VA_ARGS__); \
     sonar_server_process(handle_, _buffer, sizeof(_buffer)); \
@@ -20,7 +24,64 @@ extern "C" {
     m_write_data.clear(); \
   } while (0)
 
+// A minimal stand-in for the parts of nanopb which are used by the proto stream macros, which "encodes" a message by
+// writing its data to the stream in chunks of up to 2 bytes (as nanopb writes each field separately) and never decodes
+typedef uint8_t pb_byte_t;
+typedef struct { uint8_t unused; } pb_msgdesc_t;
+typedef struct pb_ostream_s pb_ostream_t;
+struct pb_ostream_s {
+  bool (*callback)(pb_ostream_t* stream, const pb_byte_t* buf, size_t count);
+  void* state;
+  size_t max_size;
+  size_t bytes_written;
+};
+
+typedef struct {
+  uint8_t data[8];
+  uint32_t length;
+  // the number of bytes after which encoding fails (0 to never fail)
+  uint32_t fail_after;
+} TestMsg;
+static const pb_msgdesc_t TestMsg_msg = {};
+#define TestMsg_fields (&TestMsg_msg)
+#define TestMsg_msgid 0xffd
+#define TestMsg_size 6
+#define TestMsg_ops RW
+
+static bool pb_get_encoded_size(size_t* size, const pb_msgdesc_t* fields, const void* src_struct) {
+  *size = ((const TestMsg*)src_struct)->length;
+  return true;
+}
+
+typedef struct {
+  const void* buf;
+  size_t bytes_left;
+} pb_istream_t;
+
+static pb_istream_t pb_istream_from_buffer(const void* buf, size_t bufsize) {
+  return (pb_istream_t){.buf = buf, .bytes_left = bufsize};
+}
+
+static bool pb_decode(pb_istream_t* stream, const pb_msgdesc_t* fields, void* dest_struct) {
+  return false;
+}
+
+static bool pb_encode(pb_ostream_t* stream, const pb_msgdesc_t* fields, const void* src_struct) {
+  const TestMsg* msg = (const TestMsg*)src_struct;
+  for (uint32_t i = 0; i < msg->length; i += 2) {
+    const size_t count = std::min<size_t>(2, msg->length - i);
+    if ((msg->fail_after && i >= msg->fail_after) || stream->bytes_written + count > stream->max_size ||
+        !stream->callback(stream, &msg->data[i], count)) {
+      return false;
+    }
+    stream->bytes_written += count;
+  }
+  return true;
+}
+
 SONAR_SERVER_ATTR_DEF(TestAttr, TEST_ATTR, 0xfff, sizeof(uint32_t), RWN);
+SONAR_SERVER_STREAM_ATTR_DEF(TestStreamAttr, TEST_STREAM_ATTR, 0xffe, sizeof(uint32_t), RW);
+SONAR_SERVER_PROTO_STREAM_ATTR_DEF(TestMsg, TEST_PROTO_STREAM_ATTR);
 
 static sonar_server_handle_t m_handle;
 static std::vector<uint8_t> m_write_data;
@@ -32,6 +93,10 @@ static int m_attr_num_write;
 static uint32_t m_attr_write_data;
 static int m_attr_num_notify_complete;
 static bool m_attr_notify_complete_success;
+static int m_stream_attr_num_read;
+static bool m_stream_attr_write_extra;
+static int m_proto_attr_num_read;
+static TestMsg m_proto_attr_msg;
 
 static void write_byte(uint8_t byte) {
   m_write_data.push_back(byte);
@@ -68,6 +133,37 @@ static uint32_t TestAttr_read_handler(void* response_data, uint32_t response_max
   }
 }
 
+static bool TestStreamAttr_write_handler(const void* data, uint32_t length) {
+  return false;
+}
+
+static bool TestStreamAttr_stream_read_handler(sonar_server_handle_t handle, uint32_t response_max_size) {
+  m_stream_attr_num_read++;
+  EXPECT_EQ(response_max_size, sizeof(uint32_t));
+  // write the response in multiple chunks
+  const uint8_t data1[] = {0x44, 0x33};
+  const uint8_t data2[] = {0x22, 0x11};
+  if (!sonar_server_write_response_data(handle, data1, sizeof(data1)) ||
+      !sonar_server_write_response_data(handle, data2, sizeof(data2))) {
+    return false;
+  }
+  if (m_stream_attr_write_extra) {
+    const uint8_t data3[] = {0x00};
+    return sonar_server_write_response_data(handle, data3, sizeof(data3));
+  }
+  return true;
+}
+
+static bool TestMsg_write_handler(const TestMsg* msg) {
+  return false;
+}
+
+static bool TestMsg_read_handler(TestMsg* msg) {
+  m_proto_attr_num_read++;
+  *msg = m_proto_attr_msg;
+  return true;
+}
+
 static void attribute_notify_complete_handler(sonar_server_handle_t handle, bool success) {
   m_attr_num_notify_complete++;
   m_attr_notify_complete_success = success;
@@ -83,6 +179,9 @@ class ServerTest : public ::testing::Test {
     m_attr_num_read = 0;
     m_attr_num_write = 0;
     m_attr_num_notify_complete = 0;
+    m_stream_attr_num_read = 0;
+    m_stream_attr_write_extra = false;
+    m_proto_attr_num_read = 0;
 
     SONAR_SERVER_DEF(handle, 1024);
     handle_ = handle;
@@ -103,6 +202,8 @@ class ServerTest : public ::testing::Test {
     EXPECT_EQ(m_attr_num_read, 0);
     EXPECT_EQ(m_attr_num_write, 0);
     EXPECT_EQ(m_attr_num_notify_complete, 0);
+    EXPECT_EQ(m_stream_attr_num_read, 0);
+    EXPECT_EQ(m_proto_attr_num_read, 0);
   }
   sonar_server_handle_t handle_;
 };
@@ -155,6 +256,81 @@ TEST_F(ServerTest, Read) {
   m_attr_num_read = 0;
 }
 
+TEST_F(ServerTest, StreamRead) {
+  // register our attribute
+  sonar_server_register(handle_, TEST_STREAM_ATTR);
+
+  // connect (also tested by ServerTest.Connection)
+  PROCESS_RECEIVE_PACKET(0x14, 0x00, 0x80);
+  EXPECT_WRITE_PACKET(0x17, 0x00);
+  EXPECT_TRUE(sonar_server_is_connected(handle_));
+  EXPECT_EQ(m_num_connections, 1);
+  m_num_connections = 0;
+
+  // process a read request and make sure we send the streamed response
+  PROCESS_RECEIVE_PACKET(0x10, 0x01, 0xfe, 0x1f);
+  EXPECT_WRITE_PACKET(0x13, 0x01, 0x44, 0x33, 0x22, 0x11);
+  EXPECT_EQ(m_stream_attr_num_read, 1);
+  m_stream_attr_num_read = 0;
+
+  // writing more than the max size should abort the response packet
+  m_stream_attr_write_extra = true;
+  PROCESS_RECEIVE_PACKET(0x10, 0x02, 0xfe, 0x1f);
+  const uint8_t expected_data[] = {0x7e, 0x13, 0x02, 0x44, 0x33, 0x22, 0x11, 0x7d, 0x7e};
+  EXPECT_TRUE(DataMatches(m_write_data, expected_data, sizeof(expected_data)));
+  m_write_data.clear();
+  EXPECT_EQ(m_stream_attr_num_read, 1);
+  m_stream_attr_num_read = 0;
+}
+
+TEST_F(ServerTest, ProtoStreamRead) {
+  // register our attribute
+  sonar_server_register(handle_, TEST_PROTO_STREAM_ATTR);
+
+  // connect (also tested by ServerTest.Connection)
+  PROCESS_RECEIVE_PACKET(0x14, 0x00, 0x80);
+  EXPECT_WRITE_PACKET(0x17, 0x00);
+  EXPECT_TRUE(sonar_server_is_connected(handle_));
+  EXPECT_EQ(m_num_connections, 1);
+  m_num_connections = 0;
+
+  // process a read request and make sure the message is encoded into the response across multiple chunks
+  const uint8_t extra_data[] = {0x00};
+  m_proto_attr_msg = (TestMsg){.data = {0x01, 0x02, 0x03, 0x04, 0x05}, .length = 5};
+  PROCESS_RECEIVE_PACKET(0x10, 0x01, 0xfd, 0x1f);
+  EXPECT_WRITE_PACKET(0x13, 0x01, 0x01, 0x02, 0x03, 0x04, 0x05);
+  EXPECT_EQ(m_proto_attr_num_read, 1);
+  m_proto_attr_num_read = 0;
+  // the stream is done, so writing more data should fail
+  EXPECT_FALSE(sonar_server_write_response_data(handle_, extra_data, sizeof(extra_data)));
+  EXPECT_TRUE(m_write_data.empty());
+
+  // a message which is too big shouldn't send anything
+  m_proto_attr_msg.length = 8;
+  PROCESS_RECEIVE_PACKET(0x10, 0x02, 0xfd, 0x1f);
+  EXPECT_TRUE(m_write_data.empty());
+  EXPECT_EQ(m_proto_attr_num_read, 1);
+  m_proto_attr_num_read = 0;
+  EXPECT_FALSE(sonar_server_write_response_data(handle_, extra_data, sizeof(extra_data)));
+
+  // the retried request should call the read handler again to retransmit the response
+  m_proto_attr_msg.length = 6;
+  PROCESS_RECEIVE_PACKET(0x10, 0x02, 0xfd, 0x1f);
+  EXPECT_WRITE_PACKET(0x13, 0x02, 0x01, 0x02, 0x03, 0x04, 0x05, 0x00);
+  EXPECT_EQ(m_proto_attr_num_read, 1);
+  m_proto_attr_num_read = 0;
+
+  // failing part way through should abort the response packet
+  m_proto_attr_msg.fail_after = 2;
+  PROCESS_RECEIVE_PACKET(0x10, 0x03, 0xfd, 0x1f);
+  const uint8_t expected_data[] = {0x7e, 0x13, 0x03, 0x01, 0x02, 0x7d, 0x7e};
+  EXPECT_TRUE(DataMatches(m_write_data, expected_data, sizeof(expected_data)));
+  m_write_data.clear();
+  EXPECT_EQ(m_proto_attr_num_read, 1);
+  m_proto_attr_num_read = 0;
+  EXPECT_FALSE(sonar_server_write_response_data(handle_, extra_data, sizeof(extra_data)));
+}
+
 TEST_F(ServerTest, Write) {
   // register our attribute
   sonar_server_register(handle_, TEST_ATTR);
@@ -209,6 +385,46 @@ TEST_F(ServerTest, Notify) {
   m_attr_num_notify_complete = 0;
 }
 
+static void notify_chain_release_callback(void* handle) {
+  (*(int*)handle)++;
+}
+
+TEST_F(ServerTest, NotifyChain) {
+  // register our attribute
+  sonar_server_register(handle_, TEST_ATTR);
+
+  // connect (also tested by ServerTest.Connection)
+  PROCESS_RECEIVE_PACKET(0x14, 0x00, 0x80);
+  EXPECT_WRITE_PACKET(0x17, 0x00);
+  EXPECT_TRUE(sonar_server_is_connected(handle_));
+  EXPECT_EQ(m_num_connections, 1);
+  m_num_connections = 0;
+
+  // send a notify request with the data spread across multiple buffers
+  const uint8_t data1[] = {0x04, 0x03};
+  const uint8_t data2[] = {0x02, 0x01};
+  sonar_buffer_chain_entry_t chain2 = {NULL, data2, sizeof(data2)};
+  sonar_buffer_chain_entry_t chain1 = {&chain2, data1, sizeof(data1)};
+  int num_releases = 0;
+  EXPECT_TRUE(sonar_server_notify_chain(handle_, TEST_ATTR, &chain1, notify_chain_release_callback, &num_releases));
+  EXPECT_WRITE_PACKET(0x12, 0x80, 0xff, 0x3f, 0x04, 0x03, 0x02, 0x1);
+
+  // the buffers are released once the response is received
+  PROCESS_RECEIVE_PACKET(0x11, 0x80);
+  EXPECT_EQ(num_releases, 1);
+  EXPECT_TRUE(m_attr_notify_complete_success);
+  EXPECT_EQ(m_attr_num_notify_complete, 1);
+  m_attr_num_notify_complete = 0;
+
+  // too much data
+  const uint8_t data3[] = {0x00};
+  sonar_buffer_chain_entry_t chain3 = {NULL, data3, sizeof(data3)};
+  chain2.next = &chain3;
+  EXPECT_FALSE(sonar_server_notify_chain(handle_, TEST_ATTR, &chain1, notify_chain_release_callback, &num_releases));
+  EXPECT_TRUE(m_write_data.empty());
+  EXPECT_EQ(num_releases, 1);
+}
+
 TEST_F(ServerTest, ConcurrentReadNotify) {
   // register our attribute
   sonar_server_register(handle_, TEST_ATTR);
@@ -0,0 +1,284 @@
+#include "gtest/gtest.h"
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+extern "C" {
+
+#include "anchor/sonar/client.h"
+#include "anchor/sonar/host/server_host.h"
+
+};
+
+#define NUM_LINKS 3
+
+SONAR_CLIENT_DEF(m_client0, 64);
+SONAR_CLIENT_DEF(m_client1, 64);
+SONAR_CLIENT_DEF(m_client2, 64);
+SONAR_ATTR_DEF(CLIENT0_TEST_ATTR, 0x100, sizeof(uint32_t), RWN);
+SONAR_ATTR_DEF(CLIENT1_TEST_ATTR, 0x100, sizeof(uint32_t), RWN);
+SONAR_ATTR_DEF(CLIENT2_TEST_ATTR, 0x100, sizeof(uint32_t), RWN);
+SONAR_SERVER_ATTR_DEF(TestAttr, SERVER_TEST_ATTR, 0x100, sizeof(uint32_t), RWN);
+
+static const sonar_client_handle_t m_clients[NUM_LINKS] = {m_client0, m_client1, m_client2};
+static const sonar_attribute_t m_client_attrs[NUM_LINKS] = {CLIENT0_TEST_ATTR, CLIENT1_TEST_ATTR, CLIENT2_TEST_ATTR};
+static int m_client_fds[NUM_LINKS];
+static int m_server_fds[NUM_LINKS];
+// the client which is currently being called into
+static int m_active_client;
+static uint32_t m_attr_value;
+static int m_attr_num_write;
+static int m_num_connections[NUM_LINKS];
+static int m_num_notify_complete[NUM_LINKS];
+static int m_client_num_read_complete[NUM_LINKS];
+static uint32_t m_client_read_value[NUM_LINKS];
+static int m_client_num_notify[NUM_LINKS];
+static uint32_t m_client_notify_value[NUM_LINKS];
+static uint32_t m_link_attr_values[NUM_LINKS];
+static int m_link_attr_num_write[NUM_LINKS];
+
+static void client_write_byte(uint8_t byte) {
+  ASSERT_EQ(write(m_client_fds[m_active_client], &byte, sizeof(byte)), 1);
+}
+
+static uint64_t get_system_time_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void client_connection_changed_callback(bool connected) {
+}
+
+static void client_read_complete_handler(bool success, const void* data, uint32_t length) {
+  m_client_num_read_complete[m_active_client]++;
+  if (success && length == sizeof(uint32_t)) {
+    memcpy(&m_client_read_value[m_active_client], data, length);
+  }
+}
+
+static void client_write_complete_handler(bool success) {
+}
+
+static bool client_notify_handler(sonar_attribute_t attr, const void* data, uint32_t length) {
+  m_client_num_notify[m_active_client]++;
+  memcpy(&m_client_notify_value[m_active_client], data, sizeof(uint32_t));
+  return true;
+}
+
+static bool TestAttr_write_handler(const void* data, uint32_t length) {
+  m_attr_num_write++;
+  memcpy(&m_attr_value, data, sizeof(m_attr_value));
+  return true;
+}
+
+static uint32_t TestAttr_read_handler(void* response_data, uint32_t response_max_size) {
+  memcpy(response_data, &m_attr_value, sizeof(m_attr_value));
+  return sizeof(m_attr_value);
+}
+
+static void connection_changed_callback(sonar_server_host_handle_t handle, uint32_t link_index, bool connected) {
+  if (connected) {
+    m_num_connections[link_index]++;
+  }
+}
+
+static void attribute_notify_complete_handler(sonar_server_host_handle_t handle, uint32_t link_index, bool success) {
+  EXPECT_TRUE(success);
+  m_num_notify_complete[link_index]++;
+}
+
+static uint32_t link_attribute_read_handler(sonar_server_host_handle_t handle, uint32_t link_index,
+    sonar_server_attribute_t attr, void* response_data, uint32_t response_max_size) {
+  EXPECT_EQ(attr, SERVER_TEST_ATTR);
+  memcpy(response_data, &m_link_attr_values[link_index], sizeof(uint32_t));
+  return sizeof(uint32_t);
+}
+
+static bool link_attribute_write_handler(sonar_server_host_handle_t handle, uint32_t link_index,
+    sonar_server_attribute_t attr, const void* data, uint32_t length) {
+  EXPECT_EQ(attr, SERVER_TEST_ATTR);
+  m_link_attr_num_write[link_index]++;
+  memcpy(&m_link_attr_values[link_index], data, sizeof(uint32_t));
+  return true;
+}
+
+class ServerHostTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    m_attr_value = 0;
+    m_attr_num_write = 0;
+    memset(m_num_connections, 0, sizeof(m_num_connections));
+    memset(m_num_notify_complete, 0, sizeof(m_num_notify_complete));
+    memset(m_client_num_read_complete, 0, sizeof(m_client_num_read_complete));
+    memset(m_client_num_notify, 0, sizeof(m_client_num_notify));
+    memset(m_link_attr_values, 0, sizeof(m_link_attr_values));
+    memset(m_link_attr_num_write, 0, sizeof(m_link_attr_num_write));
+
+    for (int i = 0; i < NUM_LINKS; i++) {
+      int fds[2];
+      ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+      m_client_fds[i] = fds[0];
+      m_server_fds[i] = fds[1];
+      ASSERT_EQ(fcntl(m_client_fds[i], F_SETFL, O_NONBLOCK), 0);
+
+      const sonar_client_init_t init_client = {
+        .write_byte = client_write_byte,
+        .get_system_time_ms = get_system_time_ms,
+        .connection_changed_callback = client_connection_changed_callback,
+        .attribute_read_complete_handler = client_read_complete_handler,
+        .attribute_write_complete_handler = client_write_complete_handler,
+        .attribute_notify_handler = client_notify_handler,
+      };
+      sonar_client_init(m_clients[i], &init_client);
+      sonar_client_register(m_clients[i], m_client_attrs[i]);
+    }
+    CreateHost(false);
+  }
+
+  void CreateHost(bool use_link_handlers) {
+    static const sonar_server_attribute_t attrs[] = {SERVER_TEST_ATTR};
+    const sonar_server_host_init_t init_host = {
+      .fds = m_server_fds,
+      .num_links = NUM_LINKS,
+      .attrs = attrs,
+      .num_attrs = 1,
+      .max_attr_size = 64,
+      .connection_changed_callback = connection_changed_callback,
+      .attribute_notify_complete_handler = attribute_notify_complete_handler,
+      .attribute_read_handler = use_link_handlers ? link_attribute_read_handler : nullptr,
+      .attribute_write_handler = use_link_handlers ? link_attribute_write_handler : nullptr,
+    };
+    host_ = sonar_server_host_create(&init_host);
+    ASSERT_NE(host_, nullptr);
+  }
+
+  void TearDown() override {
+    sonar_server_host_destroy(host_);
+    for (int i = 0; i < NUM_LINKS; i++) {
+      close(m_client_fds[i]);
+      close(m_server_fds[i]);
+    }
+  }
+
+  void ProcessClient(int index) {
+    uint8_t buffer[256];
+    ssize_t length = read(m_client_fds[index], buffer, sizeof(buffer));
+    m_active_client = index;
+    sonar_client_process(m_clients[index], buffer, length > 0 ? length : 0);
+  }
+
+  // run the host and clients for a bit
+  void Process(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+      for (int j = 0; j < NUM_LINKS; j++) {
+        ProcessClient(j);
+      }
+      ASSERT_TRUE(sonar_server_host_run_once(host_, 1));
+    }
+  }
+
+  void Connect() {
+    for (int i = 0; i < 10; i++) {
+      Process(1);
+      if (sonar_client_is_connected(m_client0) && sonar_client_is_connected(m_client1) &&
+          sonar_client_is_connected(m_client2)) {
+        break;
+      }
+    }
+    for (int i = 0; i < NUM_LINKS; i++) {
+      ASSERT_TRUE(sonar_client_is_connected(m_clients[i]));
+      ASSERT_TRUE(sonar_server_is_connected(sonar_server_host_get_server(host_, i)));
+      EXPECT_EQ(m_num_connections[i], 1);
+    }
+  }
+
+  sonar_server_host_handle_t host_;
+};
+
+TEST_F(ServerHostTest, ReadWrite) {
+  Connect();
+
+  // write from one link and read it back from the others
+  m_active_client = 1;
+  const uint32_t value = 0x11223344;
+  EXPECT_TRUE(sonar_client_write(m_client1, CLIENT1_TEST_ATTR, &value, sizeof(value)));
+  Process(5);
+  EXPECT_EQ(m_attr_num_write, 1);
+  EXPECT_EQ(m_attr_value, value);
+
+  for (int i = 0; i < NUM_LINKS; i++) {
+    m_active_client = i;
+    EXPECT_TRUE(sonar_client_read(m_clients[i], m_client_attrs[i]));
+  }
+  Process(5);
+  for (int i = 0; i < NUM_LINKS; i++) {
+    EXPECT_EQ(m_client_num_read_complete[i], 1);
+    EXPECT_EQ(m_client_read_value[i], value);
+  }
+}
+
+TEST_F(ServerHostTest, LinkHandlers) {
+  sonar_server_host_destroy(host_);
+  CreateHost(true);
+  Connect();
+
+  // each link should be able to have its own value
+  const uint32_t values[NUM_LINKS] = {0x11111111, 0x22222222, 0x33333333};
+  for (int i = 0; i < NUM_LINKS; i++) {
+    m_active_client = i;
+    EXPECT_TRUE(sonar_client_write(m_clients[i], m_client_attrs[i], &values[i], sizeof(values[i])));
+  }
+  Process(5);
+  for (int i = 0; i < NUM_LINKS; i++) {
+    EXPECT_EQ(m_link_attr_num_write[i], 1);
+    EXPECT_EQ(m_link_attr_values[i], values[i]);
+  }
+  // the attribute's own write handler shouldn't have been called
+  EXPECT_EQ(m_attr_num_write, 0);
+
+  for (int i = 0; i < NUM_LINKS; i++) {
+    m_active_client = i;
+    EXPECT_TRUE(sonar_client_read(m_clients[i], m_client_attrs[i]));
+  }
+  Process(5);
+  for (int i = 0; i < NUM_LINKS; i++) {
+    EXPECT_EQ(m_client_num_read_complete[i], 1);
+    EXPECT_EQ(m_client_read_value[i], values[i]);
+  }
+}
+
+TEST_F(ServerHostTest, Notify) {
+  Connect();
+
+  // only link 2 should get the notify
+  const uint32_t value = 0x55667788;
+  EXPECT_TRUE(sonar_server_host_notify(host_, 2, SERVER_TEST_ATTR, &value, sizeof(value)));
+  Process(5);
+  EXPECT_EQ(m_client_num_notify[0], 0);
+  EXPECT_EQ(m_client_num_notify[1], 0);
+  EXPECT_EQ(m_client_num_notify[2], 1);
+  EXPECT_EQ(m_client_notify_value[2], value);
+  EXPECT_EQ(m_num_notify_complete[2], 1);
+
+  // invalid link
+  EXPECT_FALSE(sonar_server_host_notify(host_, NUM_LINKS, SERVER_TEST_ATTR, &value, sizeof(value)));
+}
+
+TEST_F(ServerHostTest, Deadline) {
+  Connect();
+
+  // once a client goes away, the server should time out the connection without receiving any data
+  const uint64_t start_time_ms = get_system_time_ms();
+  while (sonar_server_is_connected(sonar_server_host_get_server(host_, 0)) &&
+      get_system_time_ms() - start_time_ms < 2000) {
+    ProcessClient(1);
+    ProcessClient(2);
+    ASSERT_TRUE(sonar_server_host_run_once(host_, 50));
+  }
+  EXPECT_FALSE(sonar_server_is_connected(sonar_server_host_get_server(host_, 0)));
+  EXPECT_TRUE(sonar_server_is_connected(sonar_server_host_get_server(host_, 1)));
+  EXPECT_TRUE(sonar_server_is_connected(sonar_server_host_get_server(host_, 2)));
+}
@@ -0,0 +1,206 @@
+#include "test_common.h"
+
+extern "C" {
+
+#include "anchor/sonar/stats.h"
+
+};
+
+SONAR_CHANNEL_SIM_DEF(m_channel, 1024);
+SONAR_CLIENT_DEF(m_client, 64);
+SONAR_SERVER_DEF(m_server, 64);
+SONAR_ATTR_DEF(CLIENT_TEST_ATTR, 0x100, sizeof(uint32_t), RWN);
+// the C++ tests can only define server attributes which have both read and write handlers
+SONAR_SERVER_ATTR_DEF(TestAttr, SERVER_TEST_ATTR, 0x100, sizeof(uint32_t), RWN);
+
+static uint32_t m_attr_value;
+static bool m_write_success;
+static int m_num_complete;
+static int m_num_success;
+
+static bool TestAttr_write_handler(const void* data, uint32_t length) {
+  memcpy(&m_attr_value, data, sizeof(m_attr_value));
+  return m_write_success;
+}
+
+static uint32_t TestAttr_read_handler(void* response_data, uint32_t response_max_size) {
+  memcpy(response_data, &m_attr_value, sizeof(m_attr_value));
+  return sizeof(m_attr_value);
+}
+
+class StatsTest : public ClientServerTest {
+ protected:
+  StatsTest() : ClientServerTest(m_channel, m_client, m_server) {}
+
+  void SetUp() override {
+    ClientServerTest::SetUp();
+    m_attr_value = 0x12345678;
+    m_write_success = true;
+    m_num_complete = 0;
+    m_num_success = 0;
+    // the latencies below are in terms of 10ms iterations over an ideal channel
+    tick_us_ = 10 * 1000;
+    InitChannel({});
+    InitClient(CLIENT_TEST_ATTR);
+    InitServer(SERVER_TEST_ATTR);
+  }
+
+  void OnReadComplete(bool success, const void* data, uint32_t length) override { Complete(success); }
+  void OnWriteComplete(bool success) override { Complete(success); }
+  bool OnNotify(sonar_attribute_t attr, const void* data, uint32_t length) override { return true; }
+  void OnNotifyComplete(bool success) override { Complete(success); }
+
+  void Complete(bool success) {
+    m_num_complete++;
+    if (success) {
+      m_num_success++;
+    }
+  }
+
+  // Advances the time by 10ms and then passes the data which each side wrote to the other side
+  void Process(int iterations, bool drop_server_data = false) {
+    Run(iterations * tick_us_, drop_server_data);
+  }
+
+  void Connect() {
+    Process(5);
+    ASSERT_TRUE(sonar_client_is_connected(m_client));
+    ASSERT_TRUE(sonar_server_is_connected(m_server));
+    // start from a clean slate
+    sonar_stats_t stats;
+    sonar_client_get_and_clear_stats(m_client, &stats);
+    sonar_server_get_and_clear_stats(m_server, &stats);
+  }
+};
+
+TEST_F(StatsTest, Percentile) {
+  uint32_t histogram[SONAR_STATS_LATENCY_BUCKETS] = {};
+  EXPECT_EQ(sonar_stats_get_percentile_ms(histogram, 50), 0);
+
+  // bucket 0 is 0ms, and bucket N is [2^(N-1), 2^N)
+  histogram[0] = 10;
+  histogram[3] = 80;
+  histogram[5] = 9;
+  histogram[SONAR_STATS_LATENCY_BUCKETS - 1] = 1;
+  EXPECT_EQ(sonar_stats_get_percentile_ms(histogram, 0), 1);
+  EXPECT_EQ(sonar_stats_get_percentile_ms(histogram, 10), 1);
+  EXPECT_EQ(sonar_stats_get_percentile_ms(histogram, 11), 8);
+  EXPECT_EQ(sonar_stats_get_percentile_ms(histogram, 50), 8);
+  EXPECT_EQ(sonar_stats_get_percentile_ms(histogram, 90), 8);
+  EXPECT_EQ(sonar_stats_get_percentile_ms(histogram, 99), 32);
+  EXPECT_EQ(sonar_stats_get_percentile_ms(histogram, 100), UINT64_MAX);
+}
+
+TEST_F(StatsTest, Traffic) {
+  Connect();
+  const int kNumReads = 5;
+  for (int i = 0; i < kNumReads; i++) {
+    EXPECT_TRUE(sonar_client_read(m_client, CLIENT_TEST_ATTR));
+    Process(2);
+  }
+  EXPECT_EQ(m_num_success, kNumReads);
+
+  sonar_stats_t client_stats;
+  sonar_stats_t server_stats;
+  sonar_client_get_and_clear_stats(m_client, &client_stats);
+  sonar_server_get_and_clear_stats(m_server, &server_stats);
+
+  // everything which was sent should have been received by the other side
+  EXPECT_EQ(client_stats.link_layer.frames_sent, kNumReads);
+  EXPECT_EQ(server_stats.link_layer.frames_received, kNumReads);
+  EXPECT_EQ(server_stats.link_layer.frames_sent, kNumReads);
+  EXPECT_EQ(client_stats.link_layer.frames_received, kNumReads);
+  EXPECT_EQ(client_stats.link_layer.raw_bytes_sent, server_stats.link_layer.raw_bytes_received);
+  EXPECT_EQ(server_stats.link_layer.raw_bytes_sent, client_stats.link_layer.raw_bytes_received);
+  EXPECT_EQ(client_stats.link_layer.decoded_bytes_sent, server_stats.link_layer.decoded_bytes_received);
+  EXPECT_EQ(server_stats.link_layer.decoded_bytes_sent, client_stats.link_layer.decoded_bytes_received);
+  // the encoded frames include the flag bytes (and any escape bytes)
+  EXPECT_GE(client_stats.link_layer.raw_bytes_sent, client_stats.link_layer.decoded_bytes_sent + kNumReads * 2);
+
+  // each request took two 10ms iterations to complete without being retried
+  EXPECT_EQ(client_stats.requests.completed, kNumReads);
+  EXPECT_EQ(client_stats.requests.failed, 0);
+  EXPECT_EQ(client_stats.requests.retries[0], kNumReads);
+  EXPECT_EQ(client_stats.requests.latency_ms[5], kNumReads);
+  EXPECT_EQ(client_stats.requests.rtt_ms[5], kNumReads);
+  EXPECT_EQ(sonar_stats_get_percentile_ms(client_stats.requests.latency_ms, 99), 32);
+  EXPECT_EQ(server_stats.requests.completed, 0);
+
+  // the stats should have been cleared
+  sonar_client_get_and_clear_stats(m_client, &client_stats);
+  EXPECT_EQ(client_stats.link_layer.frames_sent, 0);
+  EXPECT_EQ(client_stats.requests.completed, 0);
+}
+
+TEST_F(StatsTest, Retries) {
+  Connect();
+  // drop the first two responses so that the request has to be retried twice
+  EXPECT_TRUE(sonar_client_write(m_client, CLIENT_TEST_ATTR, &m_attr_value, sizeof(m_attr_value)));
+  Process(20, true);
+  Process(2);
+  EXPECT_EQ(m_num_success, 1);
+
+  sonar_stats_t stats;
+  sonar_client_get_and_clear_stats(m_client, &stats);
+  EXPECT_EQ(stats.requests.completed, 1);
+  EXPECT_EQ(stats.requests.retries[2], 1);
+  // the latency includes the retries, but the RTT is only measured from the last retry
+  EXPECT_EQ(sonar_stats_get_percentile_ms(stats.requests.latency_ms, 50), 256);
+  EXPECT_EQ(sonar_stats_get_percentile_ms(stats.requests.rtt_ms, 50), 16);
+}
+
+TEST_F(StatsTest, Connection) {
+  Process(5);
+  ASSERT_TRUE(sonar_client_is_connected(m_client));
+  Process(10);
+  sonar_stats_t stats;
+  sonar_client_get_and_clear_stats(m_client, &stats);
+  EXPECT_EQ(stats.connection.connects, 1);
+  EXPECT_EQ(stats.connection.disconnects, 0);
+  EXPECT_EQ(stats.connection.disconnected_ms + stats.connection.connected_ms, 150);
+  EXPECT_EQ(stats.connection.connected_ms, 130);
+
+  // a request which is pending when the link times out should count as failed
+  EXPECT_TRUE(sonar_client_read(m_client, CLIENT_TEST_ATTR));
+  Process(110, true);
+  EXPECT_FALSE(sonar_client_is_connected(m_client));
+  EXPECT_EQ(m_num_complete, 1);
+  EXPECT_EQ(m_num_success, 0);
+  sonar_client_get_and_clear_stats(m_client, &stats);
+  EXPECT_EQ(stats.requests.completed, 0);
+  EXPECT_EQ(stats.requests.failed, 1);
+  EXPECT_EQ(stats.connection.connects, 0);
+  EXPECT_EQ(stats.connection.disconnects, 1);
+  EXPECT_EQ(stats.connection.disconnected_ms + stats.connection.connected_ms, 1100);
+}
+
+TEST_F(StatsTest, AttributeStats) {
+  Connect();
+  EXPECT_TRUE(sonar_client_read(m_client, CLIENT_TEST_ATTR));
+  Process(2);
+  EXPECT_TRUE(sonar_client_write(m_client, CLIENT_TEST_ATTR, &m_attr_value, sizeof(m_attr_value)));
+  Process(2);
+  // a rejected write gets no response, so it times out on the client
+  m_write_success = false;
+  EXPECT_TRUE(sonar_client_write(m_client, CLIENT_TEST_ATTR, &m_attr_value, sizeof(m_attr_value)));
+  Process(35);
+  EXPECT_TRUE(sonar_server_notify(m_server, SERVER_TEST_ATTR, &m_attr_value, sizeof(m_attr_value)));
+  Process(2);
+  EXPECT_EQ(m_num_complete, 4);
+
+  sonar_attribute_stats_t stats;
+  sonar_client_get_and_clear_attribute_stats(m_client, CLIENT_TEST_ATTR, &stats);
+  EXPECT_EQ(stats.reads, 1);
+  EXPECT_EQ(stats.writes, 1);
+  EXPECT_EQ(stats.notifies, 1);
+  EXPECT_EQ(stats.failures, 1);
+  sonar_server_get_and_clear_attribute_stats(m_server, SERVER_TEST_ATTR, &stats);
+  EXPECT_EQ(stats.reads, 1);
+  EXPECT_EQ(stats.writes, 1);
+  EXPECT_EQ(stats.notifies, 1);
+  EXPECT_EQ(stats.failures, 1);
+
+  // the stats should have been cleared
+  sonar_server_get_and_clear_attribute_stats(m_server, SERVER_TEST_ATTR, &stats);
+  EXPECT_EQ(stats.reads + stats.writes + stats.notifies + stats.failures, 0);
+}
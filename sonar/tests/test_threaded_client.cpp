@@ -0,0 +1,246 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+extern "C" {
+
+#include "anchor/sonar/host/threaded_client.h"
+#include "anchor/sonar/server.h"
+
+};
+
+#define NUM_CHANNELS 4
+#define QUEUE_DEPTH 8
+
+SONAR_THREADED_CLIENT_DEF(m_client, 64, NUM_CHANNELS, QUEUE_DEPTH);
+SONAR_SERVER_DEF(m_server, 64);
+SONAR_ATTR_DEF(CLIENT_TEST_ATTR, 0xfff, sizeof(uint32_t), RW);
+SONAR_ATTR_DEF(CLIENT_OTHER_ATTR, 0xffe, sizeof(uint32_t), RW);
+SONAR_SERVER_ATTR_DEF(TestAttr, SERVER_TEST_ATTR, 0xfff, sizeof(uint32_t), RW);
+
+// only accessed from the process thread
+static std::vector<uint8_t> m_client_write_data;
+static std::vector<uint8_t> m_server_write_data;
+static uint32_t m_attr_value;
+static uint64_t m_system_time;
+
+static void client_write_byte(uint8_t byte) {
+  m_client_write_data.push_back(byte);
+}
+
+static void server_write_byte(uint8_t byte) {
+  m_server_write_data.push_back(byte);
+}
+
+static uint64_t get_system_time_ms(void) {
+  return m_system_time;
+}
+
+static bool TestAttr_write_handler(const void* data, uint32_t length) {
+  if (length != sizeof(m_attr_value)) {
+    return false;
+  }
+  memcpy(&m_attr_value, data, length);
+  return true;
+}
+
+static uint32_t TestAttr_read_handler(void* response_data, uint32_t response_max_size) {
+  memcpy(response_data, &m_attr_value, sizeof(m_attr_value));
+  return sizeof(m_attr_value);
+}
+
+static void server_connection_changed_callback(sonar_server_handle_t handle, bool connected) {
+}
+
+static void server_attribute_notify_complete_handler(sonar_server_handle_t handle, bool success) {
+}
+
+static void process() {
+  // pass the data written by each side to the other
+  std::vector<uint8_t> data;
+  data.swap(m_client_write_data);
+  sonar_server_process(m_server, data.data(), data.size());
+  data.clear();
+  data.swap(m_server_write_data);
+  sonar_threaded_client_process(m_client, data.data(), data.size());
+}
+
+class ThreadedClientTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    m_client_write_data.clear();
+    m_server_write_data.clear();
+    m_attr_value = 0;
+    m_system_time = 0;
+
+    const sonar_server_init_t init_server = {
+      .write_byte = server_write_byte,
+      .get_system_time_ms = get_system_time_ms,
+      .connection_changed_callback = server_connection_changed_callback,
+      .attribute_notify_complete_handler = server_attribute_notify_complete_handler,
+    };
+    sonar_server_init(m_server, &init_server);
+    sonar_server_register(m_server, SERVER_TEST_ATTR);
+
+    const sonar_threaded_client_init_t init_client = {
+      .write_byte = client_write_byte,
+      .get_system_time_ms = get_system_time_ms,
+      .connection_changed_callback = nullptr,
+      .attribute_notify_handler = nullptr,
+    };
+    sonar_threaded_client_init(m_client, &init_client);
+    sonar_threaded_client_register(m_client, CLIENT_TEST_ATTR);
+    sonar_threaded_client_register(m_client, CLIENT_OTHER_ATTR);
+
+    for (int i = 0; i < 10 && !sonar_threaded_client_is_connected(m_client); i++) {
+      process();
+    }
+    ASSERT_TRUE(sonar_threaded_client_is_connected(m_client));
+  }
+};
+
+TEST_F(ThreadedClientTest, ReadWrite) {
+  sonar_threaded_client_channel_t channel = sonar_threaded_client_get_channel(m_client, 0);
+  ASSERT_NE(channel, nullptr);
+  EXPECT_EQ(sonar_threaded_client_get_channel(m_client, NUM_CHANNELS), nullptr);
+
+  // submit a write followed by a read
+  int context1;
+  int context2;
+  const uint32_t value = 0x11223344;
+  EXPECT_TRUE(sonar_threaded_client_submit_write(channel, CLIENT_TEST_ATTR, &value, sizeof(value), &context1));
+  EXPECT_TRUE(sonar_threaded_client_submit_read(channel, CLIENT_TEST_ATTR, &context2));
+  // writes which are too large should be rejected
+  const uint8_t large_data[65] = {};
+  EXPECT_FALSE(sonar_threaded_client_submit_write(channel, CLIENT_TEST_ATTR, large_data, sizeof(large_data), nullptr));
+
+  sonar_threaded_client_completion_t completion;
+  EXPECT_FALSE(sonar_threaded_client_poll_completion(channel, &completion));
+  for (int i = 0; i < 10; i++) {
+    process();
+  }
+  EXPECT_EQ(m_attr_value, value);
+
+  ASSERT_TRUE(sonar_threaded_client_poll_completion(channel, &completion));
+  EXPECT_EQ(completion.attr, CLIENT_TEST_ATTR);
+  EXPECT_EQ(completion.context, &context1);
+  EXPECT_EQ(completion.op, SONAR_THREADED_CLIENT_OP_WRITE);
+  EXPECT_TRUE(completion.success);
+  EXPECT_EQ(completion.length, 0);
+
+  ASSERT_TRUE(sonar_threaded_client_poll_completion(channel, &completion));
+  EXPECT_EQ(completion.context, &context2);
+  EXPECT_EQ(completion.op, SONAR_THREADED_CLIENT_OP_READ);
+  EXPECT_TRUE(completion.success);
+  ASSERT_EQ(completion.length, sizeof(value));
+  EXPECT_EQ(memcmp(completion.data, &value, sizeof(value)), 0);
+
+  EXPECT_FALSE(sonar_threaded_client_poll_completion(channel, &completion));
+}
+
+TEST_F(ThreadedClientTest, Failures) {
+  sonar_threaded_client_channel_t channel = sonar_threaded_client_get_channel(m_client, 1);
+
+  // the server doesn't support this attribute, so it should fail without being sent
+  EXPECT_TRUE(sonar_threaded_client_submit_read(channel, CLIENT_OTHER_ATTR, nullptr));
+  process();
+  EXPECT_TRUE(m_client_write_data.empty());
+  sonar_threaded_client_completion_t completion;
+  ASSERT_TRUE(sonar_threaded_client_poll_completion(channel, &completion));
+  EXPECT_EQ(completion.attr, CLIENT_OTHER_ATTR);
+  EXPECT_FALSE(completion.success);
+
+  // the server rejects writes of the wrong length, so the request should time out
+  const uint16_t value = 0x1234;
+  EXPECT_TRUE(sonar_threaded_client_submit_write(channel, CLIENT_TEST_ATTR, &value, sizeof(value), nullptr));
+  for (int i = 0; i < 10; i++) {
+    process();
+    m_system_time += 50;
+  }
+  ASSERT_TRUE(sonar_threaded_client_poll_completion(channel, &completion));
+  EXPECT_EQ(completion.op, SONAR_THREADED_CLIENT_OP_WRITE);
+  EXPECT_FALSE(completion.success);
+}
+
+TEST_F(ThreadedClientTest, QueueFull) {
+  sonar_threaded_client_channel_t channel = sonar_threaded_client_get_channel(m_client, 2);
+  for (int i = 0; i < QUEUE_DEPTH; i++) {
+    EXPECT_TRUE(sonar_threaded_client_submit_read(channel, CLIENT_TEST_ATTR, nullptr));
+  }
+  EXPECT_FALSE(sonar_threaded_client_submit_read(channel, CLIENT_TEST_ATTR, nullptr));
+
+  // process until all the requests have completed, at which point the completion queue is full
+  for (int i = 0; i < QUEUE_DEPTH * 4; i++) {
+    process();
+  }
+  for (int i = 0; i < QUEUE_DEPTH; i++) {
+    EXPECT_TRUE(sonar_threaded_client_submit_read(channel, CLIENT_TEST_ATTR, nullptr));
+  }
+  // no more requests should be issued until there's space for their completions
+  process();
+  process();
+  EXPECT_TRUE(m_client_write_data.empty());
+
+  int num_completions = 0;
+  sonar_threaded_client_completion_t completion;
+  for (int i = 0; i < QUEUE_DEPTH * 8; i++) {
+    while (sonar_threaded_client_poll_completion(channel, &completion)) {
+      EXPECT_TRUE(completion.success);
+      num_completions++;
+    }
+    process();
+  }
+  EXPECT_EQ(num_completions, QUEUE_DEPTH * 2);
+}
+
+TEST_F(ThreadedClientTest, Stress) {
+  const uint32_t num_requests = 2000;
+  std::atomic<bool> done(false);
+  std::thread process_thread([&done]() {
+    while (!done.load()) {
+      process();
+      std::this_thread::yield();
+    }
+  });
+
+  std::vector<std::thread> threads;
+  std::atomic<uint32_t> num_failures(0);
+  for (uint32_t c = 0; c < NUM_CHANNELS; c++) {
+    threads.emplace_back([c, &num_failures]() {
+      sonar_threaded_client_channel_t channel = sonar_threaded_client_get_channel(m_client, c);
+      uint32_t num_submitted = 0;
+      uint32_t num_completed = 0;
+      while (num_completed < num_requests) {
+        if (num_submitted < num_requests) {
+          // alternate between reads and writes, using the index as the context
+          const uint32_t value = (c << 24) | num_submitted;
+          void* context = (void*)(uintptr_t)num_submitted;
+          const bool submitted = (num_submitted % 2) ?
+              sonar_threaded_client_submit_read(channel, CLIENT_TEST_ATTR, context) :
+              sonar_threaded_client_submit_write(channel, CLIENT_TEST_ATTR, &value, sizeof(value), context);
+          if (submitted) {
+            num_submitted++;
+          }
+        }
+        sonar_threaded_client_completion_t completion;
+        while (sonar_threaded_client_poll_completion(channel, &completion)) {
+          // requests from a single channel complete in order
+          if (!completion.success || completion.context != (void*)(uintptr_t)num_completed ||
+              completion.op != ((num_completed % 2) ? SONAR_THREADED_CLIENT_OP_READ : SONAR_THREADED_CLIENT_OP_WRITE)) {
+            num_failures++;
+          }
+          num_completed++;
+        }
+        std::this_thread::yield();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  done = true;
+  process_thread.join();
+  EXPECT_EQ(num_failures.load(), 0);
+}
@@ -0,0 +1,288 @@
+#include "gtest/gtest.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+extern "C" {
+
+#include "anchor/sonar/client.h"
+#include "anchor/sonar/server.h"
+#include "anchor/sonar/host/transport.h"
+
+};
+
+SONAR_TRANSPORT_DEF(m_client_transport, 128);
+SONAR_TRANSPORT_DEF(m_server_transport, 128);
+SONAR_CLIENT_DEF(m_client, 64);
+SONAR_SERVER_DEF(m_server, 64);
+SONAR_ATTR_DEF(CLIENT_TEST_ATTR, 0x100, sizeof(uint32_t), RW);
+SONAR_SERVER_ATTR_DEF(TestAttr, SERVER_TEST_ATTR, 0x100, sizeof(uint32_t), RW);
+
+static int m_client_fd;
+static int m_server_fd;
+static uint32_t m_attr_value;
+static int m_num_read_complete;
+static uint32_t m_read_value;
+
+static uint64_t get_system_time_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void client_connection_changed_callback(bool connected) {
+}
+
+static void client_read_complete_handler(bool success, const void* data, uint32_t length) {
+  m_num_read_complete++;
+  if (success && length == sizeof(uint32_t)) {
+    memcpy(&m_read_value, data, length);
+  }
+}
+
+static void client_write_complete_handler(bool success) {
+}
+
+static bool client_notify_handler(sonar_attribute_t attr, const void* data, uint32_t length) {
+  return false;
+}
+
+static void server_connection_changed_callback(sonar_server_handle_t handle, bool connected) {
+}
+
+static void server_notify_complete_handler(sonar_server_handle_t handle, bool success) {
+}
+
+static bool TestAttr_write_handler(const void* data, uint32_t length) {
+  memcpy(&m_attr_value, data, sizeof(m_attr_value));
+  return true;
+}
+
+static uint32_t TestAttr_read_handler(void* response_data, uint32_t response_max_size) {
+  memcpy(response_data, &m_attr_value, sizeof(m_attr_value));
+  return sizeof(m_attr_value);
+}
+
+class TransportTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    m_attr_value = 0;
+    m_num_read_complete = 0;
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    m_client_fd = fds[0];
+    m_server_fd = fds[1];
+    sonar_transport_init(m_client_transport, m_client_fd);
+    sonar_transport_init(m_server_transport, m_server_fd);
+  }
+
+  void TearDown() override {
+    close(m_client_fd);
+    close(m_server_fd);
+  }
+
+  void InitClientServer() {
+    const sonar_client_init_t init_client = {
+      .write_byte = m_client_transport_write_byte,
+      .get_system_time_ms = get_system_time_ms,
+      .connection_changed_callback = client_connection_changed_callback,
+      .attribute_read_complete_handler = client_read_complete_handler,
+      .attribute_write_complete_handler = client_write_complete_handler,
+      .attribute_notify_handler = client_notify_handler,
+    };
+    sonar_client_init(m_client, &init_client);
+    sonar_client_register(m_client, CLIENT_TEST_ATTR);
+
+    const sonar_server_init_t init_server = {
+      .write_byte = m_server_transport_write_byte,
+      .get_system_time_ms = get_system_time_ms,
+      .connection_changed_callback = server_connection_changed_callback,
+      .attribute_notify_complete_handler = server_notify_complete_handler,
+    };
+    sonar_server_init(m_server, &init_server);
+    sonar_server_register(m_server, SERVER_TEST_ATTR);
+  }
+
+  void Process(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+      uint8_t buffer[256];
+      int32_t length = sonar_transport_receive(m_client_transport, buffer, sizeof(buffer));
+      ASSERT_GE(length, 0);
+      sonar_client_process(m_client, buffer, length);
+      length = sonar_transport_receive(m_server_transport, buffer, sizeof(buffer));
+      ASSERT_GE(length, 0);
+      sonar_server_process(m_server, buffer, length);
+    }
+  }
+};
+
+TEST_F(TransportTest, FrameBatching) {
+  sonar_transport_stats_t stats;
+
+  // nothing should be written until the closing flag
+  const uint8_t frame[] = {0x7e, 0x01, 0x7d, 0x5e, 0x02, 0x7e};
+  for (size_t i = 0; i < sizeof(frame) - 1; i++) {
+    sonar_transport_write_byte(m_client_transport, frame[i]);
+  }
+  sonar_transport_get_stats(m_client_transport, &stats);
+  EXPECT_EQ(stats.write_calls, 0);
+  EXPECT_TRUE(sonar_transport_has_pending_tx(m_client_transport));
+  sonar_transport_write_byte(m_client_transport, frame[sizeof(frame) - 1]);
+  sonar_transport_get_stats(m_client_transport, &stats);
+  EXPECT_EQ(stats.write_calls, 1);
+  EXPECT_EQ(stats.bytes_written, sizeof(frame));
+  EXPECT_EQ(stats.frames_written, 1);
+  EXPECT_FALSE(sonar_transport_has_pending_tx(m_client_transport));
+
+  // the peer should get the whole frame in a single read
+  uint8_t buffer[64];
+  EXPECT_EQ(sonar_transport_receive(m_server_transport, buffer, sizeof(buffer)), (int32_t)sizeof(frame));
+  EXPECT_EQ(memcmp(buffer, frame, sizeof(frame)), 0);
+  EXPECT_EQ(sonar_transport_receive(m_server_transport, buffer, sizeof(buffer)), 0);
+  sonar_transport_get_stats(m_server_transport, &stats);
+  EXPECT_EQ(stats.read_calls, 2);
+  EXPECT_EQ(stats.bytes_read, sizeof(frame));
+
+  // a closed peer should be reported
+  close(m_client_fd);
+  m_client_fd = -1;
+  EXPECT_EQ(sonar_transport_receive(m_server_transport, buffer, sizeof(buffer)), -1);
+}
+
+TEST_F(TransportTest, Overflow) {
+  // a frame which is larger than the TX buffer is written in chunks
+  uint8_t buffer[512];
+  sonar_transport_write_byte(m_client_transport, 0x7e);
+  for (int i = 0; i < 200; i++) {
+    sonar_transport_write_byte(m_client_transport, 0x55);
+  }
+  sonar_transport_write_byte(m_client_transport, 0x7e);
+  sonar_transport_stats_t stats;
+  sonar_transport_get_stats(m_client_transport, &stats);
+  EXPECT_EQ(stats.write_calls, 2);
+  EXPECT_EQ(stats.bytes_written, 202);
+  EXPECT_EQ(stats.frames_written, 1);
+  EXPECT_EQ(stats.tx_dropped_bytes, 0);
+  EXPECT_EQ(sonar_transport_receive(m_server_transport, buffer, sizeof(buffer)), 202);
+}
+
+TEST_F(TransportTest, ClientServer) {
+  InitClientServer();
+  for (int i = 0; i < 10 && !sonar_client_is_connected(m_client); i++) {
+    Process(1);
+  }
+  ASSERT_TRUE(sonar_client_is_connected(m_client));
+  ASSERT_TRUE(sonar_server_is_connected(m_server));
+
+  const uint32_t value = 0x11223344;
+  EXPECT_TRUE(sonar_client_write(m_client, CLIENT_TEST_ATTR, &value, sizeof(value)));
+  Process(2);
+  EXPECT_EQ(m_attr_value, value);
+  EXPECT_TRUE(sonar_client_read(m_client, CLIENT_TEST_ATTR));
+  Process(2);
+  EXPECT_EQ(m_num_read_complete, 1);
+  EXPECT_EQ(m_read_value, value);
+
+  // every frame should have taken exactly one write
+  sonar_transport_stats_t stats;
+  sonar_transport_get_stats(m_client_transport, &stats);
+  EXPECT_GT(stats.frames_written, 0);
+  EXPECT_EQ(stats.write_calls, stats.frames_written);
+  sonar_transport_get_stats(m_server_transport, &stats);
+  EXPECT_GT(stats.frames_written, 0);
+  EXPECT_EQ(stats.write_calls, stats.frames_written);
+}
+
+TEST_F(TransportTest, Pty) {
+  char peer_path[64];
+  const int fd = sonar_transport_open_pty(peer_path, sizeof(peer_path));
+  ASSERT_GE(fd, 0);
+  const int peer_fd = sonar_transport_open_serial(peer_path, 115200);
+  ASSERT_GE(peer_fd, 0);
+  sonar_transport_init(m_client_transport, fd);
+  sonar_transport_init(m_server_transport, peer_fd);
+
+  // raw mode should pass the frame through untouched
+  const uint8_t frame[] = {0x7e, 0x0a, 0x0d, 0x03, 0x04, 0x7e};
+  for (size_t i = 0; i < sizeof(frame); i++) {
+    sonar_transport_write_byte(m_client_transport, frame[i]);
+  }
+  uint8_t buffer[64];
+  int32_t length = 0;
+  for (int i = 0; i < 100 && length == 0; i++) {
+    length = sonar_transport_receive(m_server_transport, buffer, sizeof(buffer));
+    if (length == 0) {
+      usleep(1000);
+    }
+  }
+  ASSERT_EQ(length, (int32_t)sizeof(frame));
+  EXPECT_EQ(memcmp(buffer, frame, sizeof(frame)), 0);
+  close(peer_fd);
+  close(fd);
+}
+
+TEST_F(TransportTest, OpenFailures) {
+  EXPECT_EQ(sonar_transport_open_serial("/nonexistent", 115200), -1);
+  EXPECT_EQ(sonar_transport_connect_unix("/nonexistent"), -1);
+}
+
+TEST_F(TransportTest, TxOverflow) {
+  // fill up the socket so that nothing else can be written
+  uint8_t filler[1024];
+  memset(filler, 0xaa, sizeof(filler));
+  size_t filler_length = 0;
+  while (true) {
+    const ssize_t result = write(m_client_fd, filler, sizeof(filler));
+    if (result < 0) {
+      ASSERT_TRUE(errno == EAGAIN || errno == EWOULDBLOCK);
+      break;
+    }
+    filler_length += result;
+  }
+
+  // a frame which fits should be buffered
+  uint8_t frame1[12];
+  memset(frame1, 0x55, sizeof(frame1));
+  frame1[0] = frame1[sizeof(frame1) - 1] = 0x7e;
+  for (size_t i = 0; i < sizeof(frame1); i++) {
+    sonar_transport_write_byte(m_client_transport, frame1[i]);
+  }
+
+  // a frame which doesn't fit should be dropped entirely, including the part of it which was buffered
+  sonar_transport_write_byte(m_client_transport, 0x7e);
+  for (int i = 0; i < 200; i++) {
+    sonar_transport_write_byte(m_client_transport, 0x66);
+  }
+  sonar_transport_write_byte(m_client_transport, 0x7e);
+  sonar_transport_stats_t stats;
+  sonar_transport_get_stats(m_client_transport, &stats);
+  EXPECT_EQ(stats.tx_dropped_bytes, 202);
+  EXPECT_EQ(stats.frames_written, 1);
+
+  // the next frame should be buffered normally
+  uint8_t frame2[12];
+  memset(frame2, 0x77, sizeof(frame2));
+  frame2[0] = frame2[sizeof(frame2) - 1] = 0x7e;
+  for (size_t i = 0; i < sizeof(frame2); i++) {
+    sonar_transport_write_byte(m_client_transport, frame2[i]);
+  }
+  sonar_transport_get_stats(m_client_transport, &stats);
+  EXPECT_EQ(stats.tx_dropped_bytes, 202);
+  EXPECT_EQ(stats.frames_written, 2);
+
+  // drain the socket and check that only the two whole frames were written
+  uint8_t buffer[1024];
+  while (filler_length > 0) {
+    const int32_t length = sonar_transport_receive(m_server_transport, buffer, filler_length < sizeof(buffer) ? filler_length : sizeof(buffer));
+    ASSERT_GT(length, 0);
+    filler_length -= length;
+  }
+  EXPECT_TRUE(sonar_transport_flush(m_client_transport));
+  EXPECT_FALSE(sonar_transport_has_pending_tx(m_client_transport));
+  EXPECT_EQ(sonar_transport_receive(m_server_transport, buffer, sizeof(buffer)), (int32_t)(sizeof(frame1) + sizeof(frame2)));
+  EXPECT_EQ(memcmp(buffer, frame1, sizeof(frame1)), 0);
+  EXPECT_EQ(memcmp(&buffer[sizeof(frame1)], frame2, sizeof(frame2)), 0);
+}
@@ -0,0 +1,292 @@
+// Tool for inspecting and replaying traces which were captured from a SONAR client or server (see capture.h).
+//
+// Usage: sonar_trace dump TRACE
+//        sonar_trace replay TRACE
+// The dump command prints every record along with the link layer header of each frame, followed by a summary of the
+// trace which includes the number of retransmitted frames (i.e. a retry storm shows up as a large number of these). The
+// replay command feeds the received data from the trace back into a bare client or server (depending on which one
+// captured it) under a virtual clock, and prints the resulting stats along with whether or not the frames it
+// transmitted match the trace. Since the bare client or server has no attributes, only the link layer (i.e.
+// connection and retries) is reproduced exactly; an application can link its own attributes in using the replay API.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+
+#include "anchor/sonar/client.h"
+#include "anchor/sonar/server.h"
+#include "anchor/sonar/capture.h"
+#include "anchor/sonar/stats.h"
+#include "anchor/sonar/host/replay.h"
+#include "src/link_layer/types.h"
+
+};
+
+#define MAX_ATTR_SIZE 256
+
+SONAR_CLIENT_DEF(m_client, MAX_ATTR_SIZE);
+SONAR_SERVER_DEF(m_server, MAX_ATTR_SIZE);
+SONAR_CAPTURE_DEF(m_capture, 64, MAX_ATTR_SIZE * 2 + 16);
+
+static uint64_t m_time_ms;
+static std::vector<uint8_t> m_replay_trace;
+
+static const char* get_type_name(sonar_capture_type_t type) {
+  switch (type) {
+    case SONAR_CAPTURE_TYPE_RX_RAW:
+      return "RX_RAW";
+    case SONAR_CAPTURE_TYPE_TX_RAW:
+      return "TX_RAW";
+    case SONAR_CAPTURE_TYPE_RX_FRAME:
+      return "RX_FRAME";
+    case SONAR_CAPTURE_TYPE_TX_FRAME:
+      return "TX_FRAME";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+static bool read_file(const char* path, std::vector<uint8_t>* data) {
+  FILE* file = fopen(path, "rb");
+  if (!file) {
+    fprintf(stderr, "Failed to open %s\n", path);
+    return false;
+  }
+  uint8_t buffer[4096];
+  size_t length;
+  while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data->insert(data->end(), buffer, buffer + length);
+  }
+  fclose(file);
+  return true;
+}
+
+// Splits a trace into its records, returning false if it's invalid
+static bool parse_trace(const std::vector<uint8_t>& trace, std::vector<sonar_capture_record_t>* records) {
+  uint32_t offset = 0;
+  while (offset < trace.size()) {
+    sonar_capture_record_t record;
+    const uint32_t length = sonar_capture_parse_record(&trace[offset], trace.size() - offset, &record);
+    if (!length) {
+      fprintf(stderr, "Invalid record at offset %u\n", offset);
+      return false;
+    }
+    records->push_back(record);
+    offset += length;
+  }
+  return true;
+}
+
+static void print_frame_header(const sonar_capture_record_t* record) {
+  if (record->length < sizeof(sonar_link_layer_header_t)) {
+    printf(" (too short)");
+    return;
+  }
+  const uint8_t flags = record->data[0];
+  const uint8_t sequence_num = record->data[1];
+  printf(" seq=%u %s %s%s", sequence_num,
+    (flags & SONAR_LINK_LAYER_FLAGS_RESPONSE_MASK) ? "response" : "request",
+    (flags & SONAR_LINK_LAYER_FLAGS_DIRECTION_MASK) ? "server->client" : "client->server",
+    (flags & SONAR_LINK_LAYER_FLAGS_LINK_CONTROL_MASK) ? " link-control" : "");
+  printf(" data=%u", record->length - (uint32_t)sizeof(sonar_link_layer_header_t));
+}
+
+static int dump(const std::vector<uint8_t>& trace) {
+  std::vector<sonar_capture_record_t> records;
+  if (!parse_trace(trace, &records)) {
+    return 1;
+  }
+  uint32_t num_records[SONAR_CAPTURE_TYPE_MASK + 1] = {};
+  uint32_t num_bytes[SONAR_CAPTURE_TYPE_MASK + 1] = {};
+  uint32_t num_retransmits = 0;
+  bool has_last_tx_frame = false;
+  uint8_t last_tx_header[sizeof(sonar_link_layer_header_t)] = {};
+  for (const sonar_capture_record_t& record : records) {
+    printf("%10u %-8s %s len=%u%s", record.time_ms, get_type_name(record.type), record.is_server ? "server" : "client",
+      record.length, record.is_truncated ? " (truncated)" : "");
+    if (record.type == SONAR_CAPTURE_TYPE_RX_FRAME || record.type == SONAR_CAPTURE_TYPE_TX_FRAME) {
+      print_frame_header(&record);
+    }
+    printf("\n");
+    num_records[record.type & SONAR_CAPTURE_TYPE_MASK]++;
+    num_bytes[record.type & SONAR_CAPTURE_TYPE_MASK] += record.length;
+    if (record.type == SONAR_CAPTURE_TYPE_TX_FRAME && record.length >= sizeof(last_tx_header)) {
+      // a request which is sent again with the same header is a retry
+      if (has_last_tx_frame && !memcmp(last_tx_header, record.data, sizeof(last_tx_header)) &&
+          !(record.data[0] & SONAR_LINK_LAYER_FLAGS_RESPONSE_MASK)) {
+        num_retransmits++;
+      }
+      memcpy(last_tx_header, record.data, sizeof(last_tx_header));
+      has_last_tx_frame = true;
+    }
+  }
+
+  printf("\n%zu records", records.size());
+  if (!records.empty()) {
+    printf(" over %u ms", records.back().time_ms - records.front().time_ms);
+  }
+  printf("\n");
+  for (int type = SONAR_CAPTURE_TYPE_RX_RAW; type <= SONAR_CAPTURE_TYPE_TX_FRAME; type++) {
+    printf("  %-8s %8u records %10u bytes\n", get_type_name((sonar_capture_type_t)type), num_records[type],
+      num_bytes[type]);
+  }
+  printf("  retransmitted requests: %u\n", num_retransmits);
+  return 0;
+}
+
+static uint64_t get_system_time_ms(void) {
+  return m_time_ms;
+}
+
+static void write_byte(uint8_t byte) {
+  // the transmitted data is captured, so there's nothing else to do with it
+}
+
+static void capture_write_function(const uint8_t* data, uint32_t length) {
+  m_replay_trace.insert(m_replay_trace.end(), data, data + length);
+}
+
+static void client_connection_changed_callback(bool connected) {
+}
+
+static void client_read_complete_handler(bool success, const void* data, uint32_t length) {
+}
+
+static void client_write_complete_handler(bool success) {
+}
+
+static bool client_notify_handler(sonar_attribute_t attr, const void* data, uint32_t length) {
+  return false;
+}
+
+static void server_connection_changed_callback(sonar_server_handle_t handle, bool connected) {
+}
+
+static void server_notify_complete_handler(sonar_server_handle_t handle, bool success) {
+}
+
+static void replay_set_time_ms(void* handle, uint64_t time_ms) {
+  m_time_ms = time_ms;
+}
+
+static void replay_client_process(void* handle, const uint8_t* data, uint32_t length) {
+  sonar_client_process(m_client, data, length);
+}
+
+static uint64_t replay_client_get_next_deadline_ms(void* handle) {
+  return sonar_client_get_next_deadline_ms(m_client);
+}
+
+static void replay_server_process(void* handle, const uint8_t* data, uint32_t length) {
+  sonar_server_process(m_server, data, length);
+}
+
+static uint64_t replay_server_get_next_deadline_ms(void* handle) {
+  return sonar_server_get_next_deadline_ms(m_server);
+}
+
+// Gets the (time, data) of each transmitted frame in a trace
+static std::vector<std::vector<uint8_t>> get_tx_frames(const std::vector<uint8_t>& trace) {
+  std::vector<sonar_capture_record_t> records;
+  std::vector<std::vector<uint8_t>> frames;
+  if (!parse_trace(trace, &records)) {
+    return frames;
+  }
+  for (const sonar_capture_record_t& record : records) {
+    if (record.type != SONAR_CAPTURE_TYPE_TX_FRAME) {
+      continue;
+    }
+    std::vector<uint8_t> frame((const uint8_t*)&record.time_ms, (const uint8_t*)&record.time_ms + sizeof(record.time_ms));
+    frame.insert(frame.end(), record.data, record.data + record.length);
+    frames.push_back(frame);
+  }
+  return frames;
+}
+
+static int replay(const std::vector<uint8_t>& trace) {
+  std::vector<sonar_capture_record_t> records;
+  if (!parse_trace(trace, &records) || records.empty()) {
+    fprintf(stderr, "Empty or invalid trace\n");
+    return 1;
+  }
+  const bool is_server = records.front().is_server;
+  m_time_ms = sonar_replay_get_start_time_ms(trace.data(), trace.size());
+  const sonar_capture_init_t init_capture = {
+    .get_system_time_ms = get_system_time_ms,
+    .write_function = capture_write_function,
+  };
+  sonar_capture_init(m_capture, &init_capture);
+  sonar_replay_init_t init_replay = {
+    .set_time_ms = replay_set_time_ms,
+    .process = is_server ? replay_server_process : replay_client_process,
+    .get_next_deadline_ms = is_server ? replay_server_get_next_deadline_ms : replay_client_get_next_deadline_ms,
+    .handle = NULL,
+  };
+  if (is_server) {
+    const sonar_server_init_t init_server = {
+      .write_byte = write_byte,
+      .get_system_time_ms = get_system_time_ms,
+      .connection_changed_callback = server_connection_changed_callback,
+      .attribute_notify_complete_handler = server_notify_complete_handler,
+    };
+    sonar_server_init(m_server, &init_server);
+    sonar_server_set_capture(m_server, m_capture);
+  } else {
+    const sonar_client_init_t init_client = {
+      .write_byte = write_byte,
+      .get_system_time_ms = get_system_time_ms,
+      .connection_changed_callback = client_connection_changed_callback,
+      .attribute_read_complete_handler = client_read_complete_handler,
+      .attribute_write_complete_handler = client_write_complete_handler,
+      .attribute_notify_handler = client_notify_handler,
+    };
+    sonar_client_init(m_client, &init_client);
+    sonar_client_set_capture(m_client, m_capture);
+  }
+
+  sonar_replay_result_t result;
+  if (!sonar_replay_run(trace.data(), trace.size(), &init_replay, &result)) {
+    fprintf(stderr, "Failed to replay the trace\n");
+    return 1;
+  }
+  printf("Replayed %u records into a %s over %" PRIu64 " ms\n", result.num_records, is_server ? "server" : "client",
+    result.end_time_ms - result.start_time_ms);
+  printf("  received: %u chunks, %u bytes\n", result.num_rx_chunks, result.num_rx_bytes);
+  printf("  deadlines: %u\n", result.num_deadlines);
+
+  sonar_stats_t stats;
+  if (is_server) {
+    sonar_server_get_and_clear_stats(m_server, &stats);
+  } else {
+    sonar_client_get_and_clear_stats(m_client, &stats);
+  }
+  printf("  frames: %u sent, %u received\n", stats.link_layer.frames_sent, stats.link_layer.frames_received);
+  printf("  connection: %u connects, %u disconnects, %" PRIu64 " ms connected\n", stats.connection.connects,
+    stats.connection.disconnects, stats.connection.connected_ms);
+
+  const std::vector<std::vector<uint8_t>> expected = get_tx_frames(trace);
+  const std::vector<std::vector<uint8_t>> actual = get_tx_frames(m_replay_trace);
+  size_t num_matching = 0;
+  while (num_matching < expected.size() && num_matching < actual.size() &&
+      expected[num_matching] == actual[num_matching]) {
+    num_matching++;
+  }
+  printf("  transmitted frames: %zu in trace, %zu replayed, first %zu match\n", expected.size(), actual.size(),
+    num_matching);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 3 || (strcmp(argv[1], "dump") && strcmp(argv[1], "replay"))) {
+    fprintf(stderr, "Usage: %s dump|replay TRACE\n", argv[0]);
+    return 1;
+  }
+  std::vector<uint8_t> trace;
+  if (!read_file(argv[2], &trace)) {
+    return 1;
+  }
+  return strcmp(argv[1], "dump") ? replay(trace) : dump(trace);
+}